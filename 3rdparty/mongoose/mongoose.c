@@ -2850,7 +2850,7 @@ static void base64_encode(const unsigned char *src, int src_len, char *dst) {
 }
 
 static void send_websocket_handshake(struct mg_connection *conn,
-                                     const char *key) {
+                                     const char *key, const char *protocol) {
   static const char *magic = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
   char buf[500], sha[20], b64_sha[sizeof(sha) * 2];
   SHA1_CTX sha_ctx;
@@ -2860,15 +2860,28 @@ static void send_websocket_handshake(struct mg_connection *conn,
   SHA1Update(&sha_ctx, (unsigned char *) buf, strlen(buf));
   SHA1Final((unsigned char *) sha, &sha_ctx);
   base64_encode((unsigned char *) sha, sizeof(sha), b64_sha);
-  mg_snprintf(buf, sizeof(buf), "%s%s%s",
+  mg_snprintf(buf, sizeof(buf), "%s%s%s%s%s%s",
               "HTTP/1.1 101 Switching Protocols\r\n"
               "Upgrade: websocket\r\n"
               "Connection: Upgrade\r\n"
-              "Sec-WebSocket-Accept: ", b64_sha, "\r\n\r\n");
+              "Sec-WebSocket-Accept: ", b64_sha, "\r\n",
+              protocol == NULL ? "" : "Sec-WebSocket-Protocol: ",
+              protocol == NULL ? "" : protocol,
+              protocol == NULL ? "\r\n" : "\r\n\r\n");
 
   mg_write(conn, buf, strlen(buf));
 }
 
+// For a MG_WS_HANDSHAKE handler which accepts one of the subprotocols the
+// client offered (NULL for none). The handler must then return MG_TRUE.
+void mg_send_websocket_handshake(struct mg_connection *conn,
+                                 const char *protocol) {
+  const char *key = mg_get_header(conn, "Sec-WebSocket-Key");
+  if (key != NULL) {
+    send_websocket_handshake(conn, key, protocol);
+  }
+}
+
 static int deliver_websocket_frame(struct connection *conn) {
   // Having buf unsigned char * is important, as it is used below in arithmetic
   unsigned char *buf = (unsigned char *) conn->ns_conn->recv_iobuf.buf;
@@ -2991,7 +3004,7 @@ static void send_websocket_handshake_if_requested(struct mg_connection *conn) {
   if (ver != NULL && key != NULL) {
     conn->is_websocket = 1;
     if (call_user(MG_CONN_2_CONN(conn), MG_WS_HANDSHAKE) == MG_FALSE) {
-      send_websocket_handshake(conn, key);
+      send_websocket_handshake(conn, key, NULL);
     }
     call_user(MG_CONN_2_CONN(conn), MG_WS_CONNECT);
   }
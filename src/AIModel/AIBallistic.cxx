@@ -656,7 +656,37 @@ void FGAIBallistic::slaveToAC(double dt) {
 
 void FGAIBallistic::Run(double dt) {
     _life_timer += dt;
-    
+    updateLife();
+
+    // Set the contents in the appropriate tank or other property in the parent to zero
+    setContents(0);
+
+    runPhysics(dt);
+    handleEvents();
+}
+
+bool FGAIBallistic::isParallelUpdateSafe() const {
+    // anything touching the property tree, the terrain or the shared random
+    // number generator during the integration stays on the main thread
+    return !_slave_to_ac && !invisible && !_random && !_external_force
+        && !_slave_load_to_ac;
+}
+
+void FGAIBallistic::integrate(double dt) {
+    prepareUpdate();
+    _life_timer += dt;
+    runPhysics(dt);
+}
+
+void FGAIBallistic::commit(double dt) {
+    finishUpdate();
+    updateLife();
+    setContents(0);
+    handleEvents();
+    Transform();
+}
+
+void FGAIBallistic::updateLife() {
     //_pass += 1;
     //cout<<"AIBallistic run: name " << _name.c_str() 
     //    << " dt " << dt <<  " _life_timer " << _life_timer << " pass " << _pass << endl;
@@ -676,10 +706,9 @@ void FGAIBallistic::Run(double dt) {
 
         setTime(0);
     }
+}
 
-    // Set the contents in the appropriate tank or other property in the parent to zero
-    setContents(0);
-
+void FGAIBallistic::runPhysics(double dt) {
     if (_random) {
         // Keep the new Cd within +- 10% of the current Cd to avoid a fluctuating value
         double cd_min = _cd * 0.9;
@@ -924,7 +953,9 @@ void FGAIBallistic::Run(double dt) {
         setPch(force_pitch,dt, coeff);
         setHdg(_azimuth, dt, coeff);
     }
+}
 
+void FGAIBallistic::handleEvents() {
     // Do impacts and collisions
     if (_report_impact && !_impact_reported)
         handle_impact();
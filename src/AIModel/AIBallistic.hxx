@@ -45,6 +45,10 @@ public:
     virtual void reinit();
     virtual void update(double dt);
 
+    virtual bool isParallelUpdateSafe() const;
+    virtual void integrate(double dt);
+    virtual void commit(double dt);
+
     virtual const char* getTypeString(void) const { return "ballistic"; }
 
     void Run(double dt);
@@ -215,6 +219,9 @@ private:
     void handle_impact();
     void report_impact(double elevation, const FGAIBase *target = 0);
     void slaveToAC(double dt);
+    void updateLife();
+    void runPhysics(double dt);
+    void handleEvents();
     void setContents(double c);
     void calcVSHS();
     void calcNE();
@@ -265,11 +265,22 @@ void FGAIBase::update(double dt) {
     if (_otype == otStatic)
         return;
 
+    prepareUpdate();
+    finishUpdate();
+}
+
+/** the part of update() which only depends on the object itself */
+void FGAIBase::prepareUpdate() {
+
     if (_otype == otBallistic)
         CalculateMach();
 
     ft_per_deg_lat = 366468.96 - 3717.12 * cos(pos.getLatitudeRad());
     ft_per_deg_lon = 365228.16 * cos(pos.getLatitudeRad());
+}
+
+/** the part of update() which must run in the main thread */
+void FGAIBase::finishUpdate() {
 
     if ( _fx )
     {
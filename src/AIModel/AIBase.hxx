@@ -64,6 +64,17 @@ public:
     virtual void unbind();
     virtual void reinit() {}
 
+    /**
+     * Objects returning true are updated in two phases when the manager runs
+     * the parallel update: integrate() may run on a worker thread, concurrent
+     * with other objects, and must only touch the object's own state - no
+     * property tree writes, scene graph or terrain queries. commit() then
+     * runs on the main thread and does everything else update() would do.
+     */
+    virtual bool isParallelUpdateSafe() const { return false; }
+    virtual void integrate(double dt) {}
+    virtual void commit(double dt) {}
+
     void updateLOD();
     void updateInterior();
     void setManager(FGAIManager* mgr, SGPropertyNode* p);
@@ -230,6 +241,8 @@ protected:
 
     void Transform();
     void CalculateMach();
+    void prepareUpdate();
+    void finishUpdate();
     double UpdateRadar(FGAIManager* manager);
 
     void removeModel();
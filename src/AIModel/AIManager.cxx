@@ -20,6 +20,7 @@
 
 #include <cstring>
 #include <algorithm>
+#include <thread>
 
 #include <simgear/sg_inlines.h>
 #include <simgear/math/sg_geodesy.hxx>
@@ -47,6 +48,16 @@
 #include "AIGroundVehicle.hxx"
 #include "AIEscort.hxx"
 
+// objects handed to a worker thread at a time by the parallel update
+static const size_t PARALLEL_CHUNK_SIZE = 32;
+
+// state of an object after FGAIManager::integrateParallel()
+enum {
+    INTEGRATE_NONE,   // not integrated, update() serially
+    INTEGRATE_DONE,   // integrated, commit() serially
+    INTEGRATE_FAILED  // threw, the object is dead already
+};
+
 class FGAIManager::Scenario
 {
 public:
@@ -129,6 +140,9 @@ FGAIManager::init() {
 
     user_altitude_agl_node  = fgGetNode("/position/altitude-agl-ft", true);
     user_speed_node     = fgGetNode("/velocities/uBody-fps", true);
+
+    _parallelUpdateNode = root->getNode("parallel-update", true);
+    _updateThreadsNode = root->getNode("update-threads", true);
     
     globals->get_commands()->addCommand("load-scenario", this, &FGAIManager::loadScenarioCommand);
     globals->get_commands()->addCommand("unload-scenario", this, &FGAIManager::unloadScenarioCommand);
@@ -196,6 +210,10 @@ FGAIManager::shutdown()
     }
     
     ai_list.clear();
+    _spatialIndex.clear();
+    _workerPool.reset();
+    _parallelObjects.clear();
+    _integrated.clear();
     _environmentVisiblity.clear();
     _userAircraft.clear();
     
@@ -221,6 +239,7 @@ void FGAIManager::removeDeadItem(FGAIBase* base)
     
     props->setBoolValue("valid", false);
     base->unbind();
+    _spatialIndex.remove(base);
     
     // for backward compatibility reset properties, so that aircraft,
     // which don't know the <valid> property, keep working
@@ -253,16 +272,28 @@ FGAIManager::update(double dt)
   
     ai_list.erase(ai_list.begin(), firstAlive);
   
+    _integrated.assign(ai_list.size(), INTEGRATE_NONE);
+    if (_parallelUpdateNode->getBoolValue())
+        integrateParallel(dt);
+
     // every remaining item is alive. update them in turn, but guard for
     // exceptions, so a single misbehaving AI object doesn't bring down the
-    // entire subsystem.
-    for (FGAIBase* base : ai_list) {
+    // entire subsystem. Objects may be attached while updating others, so
+    // only visit the ones present at the start.
+    const size_t count = ai_list.size();
+    for (size_t i = 0; i < count; ++i) {
+        FGAIBase* base = ai_list[i];
         try {
-            if (base->isa(FGAIBase::otThermal)) {
+            if (_integrated[i] == INTEGRATE_FAILED) {
+                continue;
+            } else if (_integrated[i] == INTEGRATE_DONE) {
+                base->commit(dt);
+            } else if (base->isa(FGAIBase::otThermal)) {
                 processThermal(dt, (FGAIThermal*)base);
             } else {
                 base->update(dt);
             }
+            _spatialIndex.update(base, base->getType(), base->getCartPos());
         } catch (sg_exception& e) {
             SG_LOG(SG_AI, SG_WARN, "caught exception updating AI model:" << base->_getName()<< ", which will be killed."
                    "\n\tError:" << e.getFormattedMessage());
@@ -273,6 +304,48 @@ FGAIManager::update(double dt)
     thermal_lift_node->setDoubleValue( strength );  // for thermals
 }
 
+/**
+ * Run the first update phase of all objects which support it on the worker
+ * threads. Only the object's own state changes here, the rest happens in
+ * the commit phase of the serial loop in update().
+ */
+void
+FGAIManager::integrateParallel(double dt)
+{
+    _parallelObjects.clear();
+    for (size_t i = 0; i < ai_list.size(); ++i) {
+        if (ai_list[i]->isParallelUpdateSafe())
+            _parallelObjects.push_back(i);
+    }
+
+    // threading overhead isn't worth it for a handful of objects
+    if (_parallelObjects.size() < 2 * PARALLEL_CHUNK_SIZE)
+        return;
+
+    if (!_workerPool) {
+        int threads = _updateThreadsNode->getIntValue();
+        if (threads <= 0)
+            threads = std::max<int>(std::thread::hardware_concurrency(), 2) - 1;
+        SG_LOG(SG_AI, SG_INFO, "AI manager: parallel update using " << threads
+               << " worker threads");
+        _workerPool.reset(new FGAIWorkerPool(threads));
+    }
+
+    _workerPool->run(_parallelObjects.size(), PARALLEL_CHUNK_SIZE, [this, dt](size_t n) {
+        size_t i = _parallelObjects[n];
+        FGAIBase* base = ai_list[i];
+        try {
+            base->integrate(dt);
+            _integrated[i] = INTEGRATE_DONE;
+        } catch (sg_exception& e) {
+            SG_LOG(SG_AI, SG_WARN, "caught exception updating AI model:" << base->_getName()<< ", which will be killed."
+                   "\n\tError:" << e.getFormattedMessage());
+            base->setDie(true);
+            _integrated[i] = INTEGRATE_FAILED;
+        }
+    });
+}
+
 /** update LOD settings of all AI/MP models */
 void
 FGAIManager::updateLOD(SGPropertyNode* node)
@@ -311,6 +384,7 @@ FGAIManager::attach(FGAIBase *model)
         || model->getType()==FGAIBase::otStatic);
     model->bind();
     p->setBoolValue("valid", true);
+    _spatialIndex.update(model, model->getType(), model->getCartPos());
 }
 
 bool FGAIManager::isVisible(const SGGeod& pos) const
@@ -536,55 +610,45 @@ const FGAIBase *
 FGAIManager::calcCollision(double alt, double lat, double lon, double fuse_range)
 {
     // we specify tgt extent (ft) according to the AIObject type
-    double tgt_ht[]     = {0,  50, 100, 250, 0, 100, 0, 0,  50,  50, 20, 100,  50};
-    double tgt_length[] = {0, 100, 200, 750, 0,  50, 0, 0, 200, 100, 40, 200, 100};
-    ai_list_iterator ai_list_itr = ai_list.begin();
-    ai_list_iterator end = ai_list.end();
+    static const double tgt_ht[]     = {0,  50, 100, 250, 0, 100, 0, 0,  50,  50, 20, 100,  50};
+    static const double tgt_length[] = {0, 100, 200, 750, 0,  50, 0, 0, 200, 100, 40, 200, 100};
+    static const double max_length =
+        *std::max_element(tgt_length, tgt_length + FGAIBase::MAX_OBJECTS);
+
+    // ballistic objects, storms and thermals can't be hit
+    static const unsigned tgt_types = FGAISpatialIndex::AllTypes
+        & ~FGAISpatialIndex::typeBit(FGAIBase::otBallistic)
+        & ~FGAISpatialIndex::typeBit(FGAIBase::otStorm)
+        & ~FGAISpatialIndex::typeBit(FGAIBase::otThermal);
 
     SGGeod pos(SGGeod::fromDegFt(lon, lat, alt));
     SGVec3d cartPos(SGVec3d::fromGeod(pos));
-    
-    while (ai_list_itr != end) {
-        double tgt_alt = (*ai_list_itr)->_getAltitude();
-        int type       = (*ai_list_itr)->getType();
-        tgt_ht[type] += fuse_range;
-
-        if (fabs(tgt_alt - alt) > tgt_ht[type] || type == FGAIBase::otBallistic
-            || type == FGAIBase::otStorm || type == FGAIBase::otThermal ) {
-                //SG_LOG(SG_AI, SG_DEBUG, "AIManager: skipping "
-                //    << fabs(tgt_alt - alt)
-                //    << " "
-                //    << type
-                //    );
-                ++ai_list_itr;
-                continue;
-        }
 
-        int id         = (*ai_list_itr)->getID();
+    // only objects within the largest target extent are candidates
+    FGAISpatialIndex::ResultList candidates;
+    _spatialIndex.findInRange(cartPos, (max_length + fuse_range) * SG_FEET_TO_METER,
+                              candidates, tgt_types);
+
+    for (FGAIBase* ai : candidates) {
+        double tgt_alt = ai->_getAltitude();
+        int type       = ai->getType();
 
-        double range = calcRangeFt(cartPos, (*ai_list_itr));
+        if (fabs(tgt_alt - alt) > tgt_ht[type] + fuse_range)
+            continue;
 
-        //SG_LOG(SG_AI, SG_DEBUG, "AIManager:  AI list size "
-        //    << ai_list.size()
-        //    << " type " << type
-        //    << " ID " << id
-        //    << " range " << range
-        //    //<< " bearing " << bearing
-        //    << " alt " << tgt_alt
-        //    );
+        int id         = ai->getID();
 
-        tgt_length[type] += fuse_range;
+        double range = calcRangeFt(cartPos, ai);
 
-        if (range < tgt_length[type]){
+        if (range < tgt_length[type] + fuse_range){
             SG_LOG(SG_AI, SG_DEBUG, "AIManager: HIT! "
                 << " type " << type
                 << " ID " << id
                 << " range " << range
                 << " alt " << tgt_alt
                 );
-            return (*ai_list_itr).get();
+            return ai;
         }
-        ++ai_list_itr;
     }
     return 0;
 }
@@ -25,10 +25,14 @@
 
 #include <list>
 #include <map>
+#include <memory>
 
 #include <simgear/structure/subsystem_mgr.hxx>
 #include <simgear/structure/SGSharedPtr.hxx>
 
+#include "AISpatialIndex.hxx"
+#include "AIWorkerPool.hxx"
+
 class FGAIBase;
 class FGAIThermal;
 class FGAIAircraft;
@@ -83,6 +87,24 @@ public:
 
     double calcRangeFt(const SGVec3d& aCartPos, const FGAIBase* aObject) const;
 
+    /**
+     * @brief collect the AI objects within aRangeM meters of a position,
+     * optionally restricted to some object types (see FGAISpatialIndex::typeBit)
+     */
+    void findObjectsInRange(const SGVec3d& aCartPos, double aRangeM,
+                            FGAISpatialIndex::ResultList& aResult,
+                            unsigned aTypeMask = FGAISpatialIndex::AllTypes) const
+    { _spatialIndex.findInRange(aCartPos, aRangeM, aResult, aTypeMask); }
+
+    /**
+     * @brief collect up to aCount AI objects nearest to a position (and within
+     * aMaxRangeM meters of it), nearest first
+     */
+    void findNearestObjects(const SGVec3d& aCartPos, size_t aCount, double aMaxRangeM,
+                            FGAISpatialIndex::ResultList& aResult,
+                            unsigned aTypeMask = FGAISpatialIndex::AllTypes) const
+    { _spatialIndex.findNearest(aCartPos, aCount, aMaxRangeM, aResult, aTypeMask); }
+
     static const char* subsystemName() { return "ai-model"; }
     
     /**
@@ -120,9 +142,21 @@ private:
     SGPropertyNode_ptr wind_from_east_node;
     SGPropertyNode_ptr wind_from_north_node;
     SGPropertyNode_ptr _environmentVisiblity;
-
+    SGPropertyNode_ptr _parallelUpdateNode;
+    SGPropertyNode_ptr _updateThreadsNode;
 
     ai_list_type ai_list;
+
+    // positions of the objects in ai_list, updated every frame
+    FGAISpatialIndex _spatialIndex;
+
+    // parallel integration of the objects supporting it, see
+    // FGAIBase::isParallelUpdateSafe()
+    void integrateParallel(double dt);
+
+    std::unique_ptr<FGAIWorkerPool> _workerPool;
+    std::vector<size_t> _parallelObjects; // indices into ai_list
+    std::vector<char> _integrated;        // per ai_list entry, see integrateParallel()
     
     double user_altitude_agl;
     double user_heading;
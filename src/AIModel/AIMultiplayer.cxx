@@ -26,6 +26,7 @@
 #endif
 
 #include <string>
+#include <cstring>
 #include <stdio.h>
 
 #include <Main/globals.hxx>
@@ -38,6 +39,117 @@ using std::string;
 
 // #define SG_DEBUG SG_ALERT
 
+// Initial and maximum number of motion samples kept per aircraft (powers of two)
+static const size_t MIN_MOTION_HISTORY = 16;
+static const size_t MAX_MOTION_HISTORY = 256;
+
+void FGAIMotionSample::assign(const FGExternalMotionData& motionInfo)
+{
+  time = motionInfo.time;
+  lag = motionInfo.lag;
+  position = motionInfo.position;
+  orientation = motionInfo.orientation;
+  linearVel = motionInfo.linearVel;
+  angularVel = motionInfo.angularVel;
+  linearAccel = motionInfo.linearAccel;
+  angularAccel = motionInfo.angularAccel;
+
+  // clear() keeps the capacity, so a recycled sample does not allocate
+  properties.clear();
+  strings.clear();
+  std::vector<FGPropertyData*>::const_iterator propIt = motionInfo.properties.begin();
+  for (; propIt != motionInfo.properties.end(); ++propIt) {
+    const FGPropertyData* data = *propIt;
+    Property prop;
+    prop.id = data->id;
+    prop.type = data->type;
+    switch (data->type) {
+      case simgear::props::INT:
+      case simgear::props::BOOL:
+      case simgear::props::LONG:
+        prop.int_value = data->int_value;
+        break;
+      case simgear::props::STRING:
+      case simgear::props::UNSPECIFIED:
+        prop.string_offset = strings.size();
+        if (data->string_value)
+          strings.insert(strings.end(), data->string_value,
+                         data->string_value + strlen(data->string_value));
+        strings.push_back('\0');
+        break;
+      default:
+        prop.float_value = data->float_value;
+        break;
+    }
+    properties.push_back(prop);
+  }
+}
+
+FGAIMotionHistory::FGAIMotionHistory() :
+  mSlots(MIN_MOTION_HISTORY),
+  mHead(0),
+  mSize(0),
+  mCursor(0)
+{
+}
+
+FGAIMotionSample&
+FGAIMotionHistory::push_back()
+{
+  if (mSize == mSlots.size()) {
+    if (mSlots.size() < MAX_MOTION_HISTORY) {
+      // unroll into a ring twice the size, moving (not copying) the samples
+      std::vector<FGAIMotionSample> slots(2 * mSlots.size());
+      for (size_t i = 0; i < mSize; ++i)
+        std::swap(slots[i], (*this)[i]);
+      mSlots.swap(slots);
+      mHead = 0;
+    } else {
+      // overwrite the oldest sample
+      pop_front(1);
+    }
+  }
+  ++mSize;
+  return back();
+}
+
+void
+FGAIMotionHistory::pop_front(size_t count)
+{
+  if (count > mSize)
+    count = mSize;
+  mHead = (mHead + count) & (mSlots.size() - 1);
+  mSize -= count;
+  mCursor = (mCursor > count) ? mCursor - count : 0;
+}
+
+size_t
+FGAIMotionHistory::upper_bound(double t)
+{
+  if (mCursor > mSize)
+    mCursor = mSize;
+
+  if (mCursor > 0 && (*this)[mCursor - 1].time > t) {
+    // moved back in time: binary search the samples before the cursor
+    size_t lo = 0, hi = mCursor - 1;
+    while (lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      if ((*this)[mid].time > t)
+        hi = mid;
+      else
+        lo = mid + 1;
+    }
+    mCursor = lo;
+  } else {
+    // the interpolation time advances steadily, so usually this is a
+    // step of at most one sample from the previous result
+    while (mCursor < mSize && (*this)[mCursor].time <= t)
+      ++mCursor;
+  }
+  return mCursor;
+}
+
+
 FGAIMultiplayer::FGAIMultiplayer() :
    FGAIBase(otMultiplayer, fgGetBool("/sim/multiplay/hot", false))
 {
@@ -137,8 +249,8 @@ void FGAIMultiplayer::update(double dt)
   double curtime = globals->get_subsystem<TimeManager>()->getMPProtocolClockSec();
 
   // Get the last available time
-  MotionInfo::reverse_iterator it = mMotionInfo.rbegin();
-  double curentPkgTime = it->second.time;
+  FGAIMotionSample& newest = mMotionInfo.back();
+  double curentPkgTime = newest.time;
 
   // Dynamically optimize the time offset between the feeder and the client
   // Well, 'dynamically' means that the dynamic of that update must be very
@@ -149,7 +261,7 @@ void FGAIMultiplayer::update(double dt)
   // component will provide this. We just take the error of the currently
   // requested time to the most recent available packet. This is the
   // target we want to reach in average.
-  double lag = it->second.lag;
+  double lag = newest.lag;
   if (!mTimeOffsetSet) {
     mTimeOffsetSet = true;
     mTimeOffset = curentPkgTime - curtime - lag;
@@ -212,7 +324,7 @@ void FGAIMultiplayer::update(double dt)
       SG_LOG(SG_AI, SG_DEBUG, "Offset adjust system: time offset = "
              << mTimeOffset << ", expected longitudinal position error due to "
              " current adjustment of the offset: "
-             << fabs(norm(it->second.linearVel)*systemIncrement));
+             << fabs(norm(newest.linearVel)*systemIncrement));
     }
   }
 
@@ -230,71 +342,32 @@ void FGAIMultiplayer::update(double dt)
     // that is good ...
 
     // Find the first packet before the target time
-    MotionInfo::iterator nextIt = mMotionInfo.upper_bound(tInterp);
-    if (nextIt == mMotionInfo.begin()) {
+    size_t next = mMotionInfo.upper_bound(tInterp);
+    if (next == 0) {
       SG_LOG(SG_AI, SG_DEBUG, "Taking oldest packet!");
       // We have no packet before the target time, just use the first one
-      MotionInfo::iterator firstIt = mMotionInfo.begin();
-      ecPos = firstIt->second.position;
-      ecOrient = firstIt->second.orientation;
-      ecLinearVel = firstIt->second.linearVel;
+      FGAIMotionSample& first = mMotionInfo.front();
+      ecPos = first.position;
+      ecOrient = first.orientation;
+      ecLinearVel = first.linearVel;
       speed = norm(ecLinearVel) * SG_METER_TO_NM * 3600.0;
 
-      std::vector<FGPropertyData*>::const_iterator firstPropIt;
-      std::vector<FGPropertyData*>::const_iterator firstPropItEnd;
-      firstPropIt = firstIt->second.properties.begin();
-      firstPropItEnd = firstIt->second.properties.end();
-      while (firstPropIt != firstPropItEnd) {
-        //cout << " Setting property..." << (*firstPropIt)->id;
-        PropertyMap::iterator pIt = mPropertyMap.find((*firstPropIt)->id);
-        if (pIt != mPropertyMap.end())
-        {
-          //cout << "Found " << pIt->second->getPath() << ":";
-          switch ((*firstPropIt)->type) {
-            case props::INT:
-            case props::BOOL:
-            case props::LONG:
-              pIt->second->setIntValue((*firstPropIt)->int_value);
-              //cout << "Int: " << (*firstPropIt)->int_value << "\n";
-              break;
-            case props::FLOAT:
-            case props::DOUBLE:
-              pIt->second->setFloatValue((*firstPropIt)->float_value);
-              //cout << "Flo: " << (*firstPropIt)->float_value << "\n";
-              break;
-            case props::STRING:
-            case props::UNSPECIFIED:
-              pIt->second->setStringValue((*firstPropIt)->string_value);
-              //cout << "Str: " << (*firstPropIt)->string_value << "\n";    
-              break;
-            default:
-              // FIXME - currently defaults to float values
-              pIt->second->setFloatValue((*firstPropIt)->float_value);
-              //cout << "Unknown: " << (*firstPropIt)->float_value << "\n";
-              break;
-          }            
-        }
-        else
-        {
-          SG_LOG(SG_AI, SG_DEBUG, "Unable to find property: " << (*firstPropIt)->id << "\n");
-        }
-        ++firstPropIt;
-      }
+      applyProperties(first);
 
     } else {
       // Ok, we have really found something where our target time is in between
       // do interpolation here
-      MotionInfo::iterator prevIt = nextIt;
-      --prevIt;
-
       /*
       * RJH: 2017-02-16 another exception thrown here when running under debug (and hence huge frame delays)
       * the value of nextIt was already end(); which I think means that we cannot run the entire next section of code.
       */
-      if (nextIt != prevIt && nextIt != mMotionInfo.end()) {
+      if (next < mMotionInfo.size()) {
+          FGAIMotionSample& prevSample = mMotionInfo[next - 1];
+          FGAIMotionSample& nextSample = mMotionInfo[next];
+
           // Interpolation coefficient is between 0 and 1
-          double intervalStart = prevIt->second.time;
-          double intervalEnd = nextIt->second.time;
+          double intervalStart = prevSample.time;
+          double intervalEnd = nextSample.time;
 
           double intervalLen = intervalEnd - intervalStart;
           double tau = 0.0;
@@ -305,25 +378,23 @@ void FGAIMultiplayer::update(double dt)
               << intervalLen << ", interpolation parameter = " << tau);
 
           // Here we do just linear interpolation on the position
-          ecPos = interpolate(tau, prevIt->second.position, nextIt->second.position);
-          ecOrient = interpolate((float)tau, prevIt->second.orientation,
-              nextIt->second.orientation);
-          ecLinearVel = interpolate((float)tau, prevIt->second.linearVel, nextIt->second.linearVel);
+          ecPos = interpolate(tau, prevSample.position, nextSample.position);
+          ecOrient = interpolate((float)tau, prevSample.orientation,
+              nextSample.orientation);
+          ecLinearVel = interpolate((float)tau, prevSample.linearVel, nextSample.linearVel);
           speed = norm(ecLinearVel) * SG_METER_TO_NM * 3600.0;
 
-          if (prevIt->second.properties.size()
-              == nextIt->second.properties.size()) {
-              std::vector<FGPropertyData*>::const_iterator prevPropIt;
-              std::vector<FGPropertyData*>::const_iterator prevPropItEnd;
-              std::vector<FGPropertyData*>::const_iterator nextPropIt;
-              std::vector<FGPropertyData*>::const_iterator nextPropItEnd;
-              prevPropIt = prevIt->second.properties.begin();
-              prevPropItEnd = prevIt->second.properties.end();
-              nextPropIt = nextIt->second.properties.begin();
-              nextPropItEnd = nextIt->second.properties.end();
+          if (prevSample.properties.size()
+              == nextSample.properties.size()) {
+              std::vector<FGAIMotionSample::Property>::const_iterator prevPropIt;
+              std::vector<FGAIMotionSample::Property>::const_iterator prevPropItEnd;
+              std::vector<FGAIMotionSample::Property>::const_iterator nextPropIt;
+              prevPropIt = prevSample.properties.begin();
+              prevPropItEnd = prevSample.properties.end();
+              nextPropIt = nextSample.properties.begin();
               while (prevPropIt != prevPropItEnd) {
-                  PropertyMap::iterator pIt = mPropertyMap.find((*prevPropIt)->id);
-                  //cout << " Setting property..." << (*prevPropIt)->id;
+                  PropertyMap::iterator pIt = mPropertyMap.find(prevPropIt->id);
+                  //cout << " Setting property..." << prevPropIt->id;
 
                   if (pIt != mPropertyMap.end())
                   {
@@ -342,32 +413,32 @@ void FGAIMultiplayer::update(double dt)
                        * this by only considering properties where the previous and next id are the same.
                        * It might be a better solution to search the previous and next lists to locate the matching id's
                        */
-                      if (*nextPropIt && (*nextPropIt)->id == (*prevPropIt)->id) {
-                          switch ((*prevPropIt)->type) {
+                      if (nextPropIt->id == prevPropIt->id) {
+                          switch (prevPropIt->type) {
                           case props::INT:
                           case props::BOOL:
                           case props::LONG:
                               // Jean Pellotier, 2018-01-02 : we don't want interpolation for integer values, they are mostly used 
                               // for non linearly changing values (e.g. transponder etc ...)
                               // fixes: https://sourceforge.net/p/flightgear/codetickets/1885/
-                              pIt->second->setIntValue((*nextPropIt)->int_value);
+                              pIt->second->setIntValue(nextPropIt->int_value);
                               break;
                           case props::FLOAT:
                           case props::DOUBLE:
-                              val = (1 - tau)*(*prevPropIt)->float_value +
-                                  tau*(*nextPropIt)->float_value;
+                              val = (1 - tau)*prevPropIt->float_value +
+                                  tau*nextPropIt->float_value;
                               //cout << "Flo: " << val << "\n";
                               pIt->second->setFloatValue(val);
                               break;
                           case props::STRING:
                           case props::UNSPECIFIED:
-                              //cout << "Str: " << (*nextPropIt)->string_value << "\n";
-                              pIt->second->setStringValue((*nextPropIt)->string_value);
+                              //cout << "Str: " << nextSample.stringValue(*nextPropIt) << "\n";
+                              pIt->second->setStringValue(nextSample.stringValue(*nextPropIt));
                               break;
                           default:
                               // FIXME - currently defaults to float values
-                              val = (1 - tau)*(*prevPropIt)->float_value +
-                                  tau*(*nextPropIt)->float_value;
+                              val = (1 - tau)*prevPropIt->float_value +
+                                  tau*nextPropIt->float_value;
                               //cout << "Unk: " << val << "\n";
                               pIt->second->setFloatValue(val);
                               break;
@@ -375,12 +446,12 @@ void FGAIMultiplayer::update(double dt)
                       }
                       else
                       {
-                          SG_LOG(SG_AI, SG_WARN, "MP packet mismatch during lag interpolation: " << (*prevPropIt)->id << " != " << (*nextPropIt)->id << "\n");
+                          SG_LOG(SG_AI, SG_WARN, "MP packet mismatch during lag interpolation: " << prevPropIt->id << " != " << nextPropIt->id << "\n");
                       }
                   }
                   else
                   {
-                      SG_LOG(SG_AI, SG_DEBUG, "Unable to find property: " << (*prevPropIt)->id << "\n");
+                      SG_LOG(SG_AI, SG_DEBUG, "Unable to find property: " << prevPropIt->id << "\n");
                   }
 
                   ++prevPropIt;
@@ -388,18 +459,16 @@ void FGAIMultiplayer::update(double dt)
               }
           }
 
-          // Now throw away too old data
-          if (prevIt != mMotionInfo.begin())
-          {
-              --prevIt;
-              mMotionInfo.erase(mMotionInfo.begin(), prevIt);
-          }
+          // Now throw away too old data, keeping one sample before the
+          // interpolation interval
+          if (next >= 2)
+              mMotionInfo.pop_front(next - 2);
       }
     }
   } else {
     // Ok, we need to predict the future, so, take the best data we can have
     // and do some eom computation to guess that for now.
-    FGExternalMotionData& motionInfo = it->second;
+    FGAIMotionSample& motionInfo = newest;
 
     // The time to predict, limit to 3 seconds
     double t = tInterp - motionInfo.time;
@@ -432,48 +501,8 @@ void FGAIMultiplayer::update(double dt)
 		ecPos += t*(ecVel);
 	}
 
-	std::vector<FGPropertyData*>::const_iterator firstPropIt;
-    std::vector<FGPropertyData*>::const_iterator firstPropItEnd;
     speed = norm(ecLinearVel) * SG_METER_TO_NM * 3600.0;
-    firstPropIt = it->second.properties.begin();
-    firstPropItEnd = it->second.properties.end();
-    while (firstPropIt != firstPropItEnd) {
-      PropertyMap::iterator pIt = mPropertyMap.find((*firstPropIt)->id);
-      //cout << " Setting property..." << (*firstPropIt)->id;
-      
-      if (pIt != mPropertyMap.end())
-      {
-        switch ((*firstPropIt)->type) {
-          case props::INT:
-          case props::BOOL:
-          case props::LONG:
-            pIt->second->setIntValue((*firstPropIt)->int_value);
-            //cout << "Int: " << (*firstPropIt)->int_value << "\n";
-            break;
-          case props::FLOAT:
-          case props::DOUBLE:
-            pIt->second->setFloatValue((*firstPropIt)->float_value);
-            //cout << "Flo: " << (*firstPropIt)->float_value << "\n";
-            break;
-          case props::STRING:
-          case props::UNSPECIFIED:
-            pIt->second->setStringValue((*firstPropIt)->string_value);
-            //cout << "Str: " << (*firstPropIt)->string_value << "\n";
-            break;
-          default:
-            // FIXME - currently defaults to float values
-            pIt->second->setFloatValue((*firstPropIt)->float_value);
-            //cout << "Unk: " << (*firstPropIt)->float_value << "\n";
-            break;
-        }            
-      }
-      else
-      {
-        SG_LOG(SG_AI, SG_DEBUG, "Unable to find property: " << (*firstPropIt)->id << "\n");
-      }
-      
-      ++firstPropIt;
-    }
+    applyProperties(newest);
   }
   
   // extract the position
@@ -545,13 +574,50 @@ void FGAIMultiplayer::update(double dt)
 }
 
 void
-FGAIMultiplayer::addMotionInfo(FGExternalMotionData& motionInfo,
+FGAIMultiplayer::applyProperties(const FGAIMotionSample& sample)
+{
+  using namespace simgear;
+
+  std::vector<FGAIMotionSample::Property>::const_iterator propIt;
+  for (propIt = sample.properties.begin(); propIt != sample.properties.end(); ++propIt) {
+    PropertyMap::iterator pIt = mPropertyMap.find(propIt->id);
+    if (pIt != mPropertyMap.end())
+    {
+      switch (propIt->type) {
+        case props::INT:
+        case props::BOOL:
+        case props::LONG:
+          pIt->second->setIntValue(propIt->int_value);
+          break;
+        case props::FLOAT:
+        case props::DOUBLE:
+          pIt->second->setFloatValue(propIt->float_value);
+          break;
+        case props::STRING:
+        case props::UNSPECIFIED:
+          pIt->second->setStringValue(sample.stringValue(*propIt));
+          break;
+        default:
+          // FIXME - currently defaults to float values
+          pIt->second->setFloatValue(propIt->float_value);
+          break;
+      }
+    }
+    else
+    {
+      SG_LOG(SG_AI, SG_DEBUG, "Unable to find property: " << propIt->id << "\n");
+    }
+  }
+}
+
+void
+FGAIMultiplayer::addMotionInfo(const FGExternalMotionData& motionInfo,
                                long stamp)
 {
   mLastTimestamp = stamp;
 
   if (!mMotionInfo.empty()) {
-    double diff = motionInfo.time - mMotionInfo.rbegin()->first;
+    double diff = motionInfo.time - mMotionInfo.back().time;
 
     // packet is very old -- MP has probably reset (incl. his timebase)
     if (diff < -10.0)
@@ -560,11 +626,16 @@ FGAIMultiplayer::addMotionInfo(FGExternalMotionData& motionInfo,
     // drop packets arriving out of order
     else if (diff < 0.0)
       return;
+
+    // a packet with the same time stamp replaces the previous one
+    else if (diff == 0.0) {
+      mMotionInfo.back().assign(motionInfo);
+      return;
+    }
   }
-  mMotionInfo[motionInfo.time] = motionInfo;
-  // We just copied the property (pointer) list - they are ours now. Clear the
-  // properties list in given/returned object, so former owner won't deallocate them.
-  motionInfo.properties.clear();
+  // The sample storage is recycled, the property values are copied - the
+  // caller keeps ownership of the given property list.
+  mMotionInfo.push_back().assign(motionInfo);
 }
 
 void
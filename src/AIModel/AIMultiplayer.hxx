@@ -23,10 +23,83 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include <MultiPlayer/mpmessages.hxx>
 #include "AIBase.hxx"
 
+/**
+ * A received motion sample of a multiplayer aircraft. Property values are
+ * kept inline (strings in a per sample character buffer), so the storage
+ * of a sample can be reused for later packets without any allocation.
+ */
+struct FGAIMotionSample
+{
+  struct Property
+  {
+    unsigned id;
+    simgear::props::Type type;
+    union {
+      int int_value;
+      float float_value;
+      size_t string_offset; // into strings, for STRING and UNSPECIFIED
+    };
+  };
+
+  void assign(const FGExternalMotionData& motionInfo);
+
+  const char* stringValue(const Property& prop) const
+  { return &strings[prop.string_offset]; }
+
+  double time;
+  double lag;
+  SGVec3d position;
+  SGQuatf orientation;
+  SGVec3f linearVel;
+  SGVec3f angularVel;
+  SGVec3f linearAccel;
+  SGVec3f angularAccel;
+
+  std::vector<Property> properties;
+  std::vector<char> strings;
+};
+
+/**
+ * Time ordered ring of motion samples. The ring grows up to a maximum
+ * capacity, after which the oldest samples are overwritten. Slots (and the
+ * property storage they own) are recycled rather than freed.
+ */
+class FGAIMotionHistory
+{
+public:
+  FGAIMotionHistory();
+
+  bool empty() const { return mSize == 0; }
+  size_t size() const { return mSize; }
+  void clear() { mHead = 0; mSize = 0; mCursor = 0; }
+
+  /// Sample i, counting from the oldest one.
+  FGAIMotionSample& operator[](size_t i)
+  { return mSlots[(mHead + i) & (mSlots.size() - 1)]; }
+  FGAIMotionSample& front() { return (*this)[0]; }
+  FGAIMotionSample& back() { return (*this)[mSize - 1]; }
+
+  /// Append a sample at the newest end, returns the slot to fill in.
+  FGAIMotionSample& push_back();
+  /// Drop the count oldest samples.
+  void pop_front(size_t count);
+
+  /// Index of the first sample newer than time t (size() if there is none).
+  /// Consecutive lookups for increasing times are O(1).
+  size_t upper_bound(double t);
+
+private:
+  std::vector<FGAIMotionSample> mSlots; // power of two sized
+  size_t mHead;
+  size_t mSize;
+  size_t mCursor;
+};
+
 class FGAIMultiplayer : public FGAIBase {
 public:
   FGAIMultiplayer();
@@ -36,7 +109,7 @@ public:
   virtual void bind();
   virtual void update(double dt);
 
-  void addMotionInfo(FGExternalMotionData& motionInfo, long stamp);
+  void addMotionInfo(const FGExternalMotionData& motionInfo, long stamp);
   void setDoubleProperty(const std::string& prop, double val);
 
   long getLastTimestamp(void) const
@@ -77,9 +150,10 @@ public:
 
 private:
 
-  // Automatic sorting of motion data according to its timestamp
-  typedef std::map<double,FGExternalMotionData> MotionInfo;
-  MotionInfo mMotionInfo;
+  void applyProperties(const FGAIMotionSample& sample);
+
+  // Received motion data, ordered by its timestamp
+  FGAIMotionHistory mMotionInfo;
 
   // Map between the property id's from the multiplayers network packets
   // and the property nodes
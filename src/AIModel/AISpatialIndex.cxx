@@ -0,0 +1,194 @@
+// AISpatialIndex.cxx - uniform grid over the positions of AI objects
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#include <algorithm>
+#include <cmath>
+
+#include "AISpatialIndex.hxx"
+
+// cell coordinates are stored with this offset in 21 bits each, which
+// covers the earth (and low orbit) for cell sizes down to ~10 m
+static const int CELL_COORD_OFFSET = 1 << 20;
+static const unsigned long long CELL_COORD_MASK = (1ull << 21) - 1;
+
+FGAISpatialIndex::FGAISpatialIndex(double cellSizeM) :
+    _cellSize(cellSizeM)
+{
+}
+
+int
+FGAISpatialIndex::cellCoord(double v) const
+{
+    return (int) std::floor(v / _cellSize);
+}
+
+FGAISpatialIndex::CellKey
+FGAISpatialIndex::cellKey(int ix, int iy, int iz) const
+{
+    return ((CellKey(ix + CELL_COORD_OFFSET) & CELL_COORD_MASK) << 42)
+         | ((CellKey(iy + CELL_COORD_OFFSET) & CELL_COORD_MASK) << 21)
+         |  (CellKey(iz + CELL_COORD_OFFSET) & CELL_COORD_MASK);
+}
+
+void
+FGAISpatialIndex::update(FGAIBase* object, int type, const SGVec3d& cartPos)
+{
+    CellKey cell = cellKey(cellCoord(cartPos.x()), cellCoord(cartPos.y()),
+                           cellCoord(cartPos.z()));
+
+    auto it = _entries.find(object);
+    if (it == _entries.end()) {
+        Entry& entry = _entries[object];
+        entry.cell = cell;
+        entry.type = type;
+        entry.pos = cartPos;
+        _cells[cell].push_back(Item{object, &entry});
+        return;
+    }
+
+    Entry& entry = it->second;
+    entry.pos = cartPos;
+    if (entry.cell == cell)
+        return;
+
+    // crossed a cell boundary
+    std::vector<Item>& oldCell = _cells[entry.cell];
+    for (size_t i = 0; i < oldCell.size(); ++i) {
+        if (oldCell[i].object == object) {
+            oldCell[i] = oldCell.back();
+            oldCell.pop_back();
+            break;
+        }
+    }
+    if (oldCell.empty())
+        _cells.erase(entry.cell);
+
+    entry.cell = cell;
+    _cells[cell].push_back(Item{object, &entry});
+}
+
+void
+FGAISpatialIndex::remove(FGAIBase* object)
+{
+    auto it = _entries.find(object);
+    if (it == _entries.end())
+        return;
+
+    auto cellIt = _cells.find(it->second.cell);
+    if (cellIt != _cells.end()) {
+        std::vector<Item>& items = cellIt->second;
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (items[i].object == object) {
+                items[i] = items.back();
+                items.pop_back();
+                break;
+            }
+        }
+        if (items.empty())
+            _cells.erase(cellIt);
+    }
+    _entries.erase(it);
+}
+
+void
+FGAISpatialIndex::clear()
+{
+    _cells.clear();
+    _entries.clear();
+}
+
+void
+FGAISpatialIndex::collect(const SGVec3d& center, double radius, unsigned typeMask,
+                          std::vector<Candidate>& found) const
+{
+    const double radius2 = radius * radius;
+
+    int minX = cellCoord(center.x() - radius), maxX = cellCoord(center.x() + radius);
+    int minY = cellCoord(center.y() - radius), maxY = cellCoord(center.y() + radius);
+    int minZ = cellCoord(center.z() - radius), maxZ = cellCoord(center.z() + radius);
+    double numCells = double(maxX - minX + 1) * double(maxY - minY + 1)
+                    * double(maxZ - minZ + 1);
+
+    if (numCells > double(_entries.size())) {
+        // large query (or few objects) - scanning is cheaper
+        for (const auto& e : _entries) {
+            if (!(typeMask & typeBit(e.second.type)))
+                continue;
+            double d2 = distSqr(center, e.second.pos);
+            if (d2 <= radius2)
+                found.push_back(Candidate(d2, e.first));
+        }
+        return;
+    }
+
+    for (int ix = minX; ix <= maxX; ++ix) {
+        for (int iy = minY; iy <= maxY; ++iy) {
+            for (int iz = minZ; iz <= maxZ; ++iz) {
+                auto cellIt = _cells.find(cellKey(ix, iy, iz));
+                if (cellIt == _cells.end())
+                    continue;
+                for (const Item& item : cellIt->second) {
+                    if (!(typeMask & typeBit(item.entry->type)))
+                        continue;
+                    double d2 = distSqr(center, item.entry->pos);
+                    if (d2 <= radius2)
+                        found.push_back(Candidate(d2, item.object));
+                }
+            }
+        }
+    }
+}
+
+void
+FGAISpatialIndex::findInRange(const SGVec3d& center, double radius, ResultList& result,
+                              unsigned typeMask) const
+{
+    std::vector<Candidate> found;
+    collect(center, radius, typeMask, found);
+
+    result.clear();
+    result.reserve(found.size());
+    for (const Candidate& c : found)
+        result.push_back(c.second);
+}
+
+void
+FGAISpatialIndex::findNearest(const SGVec3d& center, size_t count, double maxRange,
+                              ResultList& result, unsigned typeMask) const
+{
+    result.clear();
+    if (count == 0 || _entries.empty())
+        return;
+
+    // grow the search sphere until it holds enough objects - everything
+    // inside the sphere is found, so its nearest objects are the answer
+    std::vector<Candidate> found;
+    double radius = std::min(_cellSize, maxRange);
+    for (;;) {
+        found.clear();
+        collect(center, radius, typeMask, found);
+        if (found.size() >= count || radius >= maxRange)
+            break;
+        radius = std::min(2.0 * radius, maxRange);
+    }
+
+    size_t n = std::min(count, found.size());
+    std::partial_sort(found.begin(), found.begin() + n, found.end(),
+                      [](const Candidate& a, const Candidate& b) { return a.first < b.first; });
+    result.reserve(n);
+    for (size_t i = 0; i < n; ++i)
+        result.push_back(found[i].second);
+}
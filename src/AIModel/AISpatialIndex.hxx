@@ -0,0 +1,97 @@
+// AISpatialIndex.hxx - uniform grid over the positions of AI objects
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifndef _FG_AISPATIALINDEX_HXX
+#define _FG_AISPATIALINDEX_HXX
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include <simgear/math/SGMath.hxx>
+
+class FGAIBase;
+
+/**
+ * Spatial index over the earth centered (cartesian) positions of AI objects.
+ *
+ * Objects are hashed into cubic grid cells. Moving an object only touches
+ * the index when it crosses a cell boundary, so updating all objects every
+ * frame is cheap. Range queries visit the cells overlapping the query
+ * sphere; when that would be more cells than there are objects, they fall
+ * back to a plain scan, so a query is never worse than a linear search.
+ *
+ * Positions are those passed to the last update(), i.e. they may be up to
+ * one frame old for objects which have not been updated yet this frame.
+ */
+class FGAISpatialIndex
+{
+public:
+    typedef std::vector<FGAIBase*> ResultList;
+
+    /// Type mask matching all object types
+    static const unsigned AllTypes = ~0u;
+    /// Type mask bit for one FGAIBase::object_type
+    static unsigned typeBit(int type) { return 1u << type; }
+
+    FGAISpatialIndex(double cellSizeM = 2000.0);
+
+    /// Insert an object or move it to its new position.
+    void update(FGAIBase* object, int type, const SGVec3d& cartPos);
+    void remove(FGAIBase* object);
+    void clear();
+
+    size_t size() const { return _entries.size(); }
+
+    /// Collect all objects within radius (meters) of the given point, in no
+    /// particular order.
+    void findInRange(const SGVec3d& center, double radius, ResultList& result,
+                     unsigned typeMask = AllTypes) const;
+
+    /// Collect up to count objects closest to the given point and within
+    /// maxRange (meters), nearest first.
+    void findNearest(const SGVec3d& center, size_t count, double maxRange,
+                     ResultList& result, unsigned typeMask = AllTypes) const;
+
+private:
+    typedef unsigned long long CellKey;
+    typedef std::pair<double, FGAIBase*> Candidate; // squared distance, object
+
+    struct Entry
+    {
+        CellKey cell;
+        int type;
+        SGVec3d pos;
+    };
+
+    struct Item
+    {
+        FGAIBase* object;
+        const Entry* entry;
+    };
+
+    CellKey cellKey(int ix, int iy, int iz) const;
+    int cellCoord(double v) const;
+
+    void collect(const SGVec3d& center, double radius, unsigned typeMask,
+                 std::vector<Candidate>& found) const;
+
+    double _cellSize;
+    std::unordered_map<FGAIBase*, Entry> _entries;
+    std::unordered_map<CellKey, std::vector<Item> > _cells;
+};
+
+#endif  // _FG_AISPATIALINDEX_HXX
@@ -0,0 +1,122 @@
+// AIWorkerPool.cxx - worker threads for the parallel AI update phase
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#include <algorithm>
+
+#include <simgear/threads/SGGuard.hxx>
+
+#include "AIWorkerPool.hxx"
+
+class FGAIWorkerPool::Worker : public SGThread
+{
+public:
+    Worker(FGAIWorkerPool* pool) :
+        _pool(pool)
+    {
+    }
+
+    virtual void run()
+    {
+        unsigned seen = 0;
+        for (;;) {
+            {
+                SGGuard<SGMutex> lock(_pool->_mutex);
+                while (!_pool->_stop && _pool->_generation == seen)
+                    _pool->_startCondition.wait(_pool->_mutex);
+                if (_pool->_stop)
+                    return;
+                seen = _pool->_generation;
+            }
+
+            _pool->work();
+
+            SGGuard<SGMutex> lock(_pool->_mutex);
+            if (--_pool->_busy == 0)
+                _pool->_doneCondition.signal();
+        }
+    }
+
+private:
+    FGAIWorkerPool* _pool;
+};
+
+FGAIWorkerPool::FGAIWorkerPool(unsigned numThreads) :
+    _generation(0),
+    _busy(0),
+    _stop(false),
+    _job(nullptr),
+    _count(0),
+    _chunkSize(1),
+    _next(0)
+{
+    for (unsigned i = 0; i < numThreads; ++i) {
+        Worker* worker = new Worker(this);
+        worker->start();
+        _workers.push_back(worker);
+    }
+}
+
+FGAIWorkerPool::~FGAIWorkerPool()
+{
+    {
+        SGGuard<SGMutex> lock(_mutex);
+        _stop = true;
+        _startCondition.broadcast();
+    }
+    for (Worker* worker : _workers) {
+        worker->join();
+        delete worker;
+    }
+}
+
+void
+FGAIWorkerPool::run(size_t count, size_t chunkSize, const Job& job)
+{
+    if (count == 0)
+        return;
+
+    {
+        SGGuard<SGMutex> lock(_mutex);
+        _job = &job;
+        _count = count;
+        _chunkSize = std::max<size_t>(chunkSize, 1);
+        _next = 0;
+        _busy = _workers.size();
+        ++_generation;
+        _startCondition.broadcast();
+    }
+
+    work();
+
+    // wait until no worker touches the job any more
+    SGGuard<SGMutex> lock(_mutex);
+    while (_busy > 0)
+        _doneCondition.wait(_mutex);
+    _job = nullptr;
+}
+
+void
+FGAIWorkerPool::work()
+{
+    for (;;) {
+        size_t begin = _next.fetch_add(_chunkSize);
+        if (begin >= _count)
+            return;
+        size_t end = std::min(begin + _chunkSize, _count);
+        for (size_t i = begin; i < end; ++i)
+            (*_job)(i);
+    }
+}
@@ -0,0 +1,68 @@
+// AIWorkerPool.hxx - worker threads for the parallel AI update phase
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifndef _FG_AIWORKERPOOL_HXX
+#define _FG_AIWORKERPOOL_HXX
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include <simgear/threads/SGThread.hxx>
+
+/**
+ * A fixed set of worker threads running one batch of independent jobs at a
+ * time. The calling thread takes part in the batch and run() only returns
+ * once every job has completed, so jobs may safely refer to the caller's
+ * data.
+ */
+class FGAIWorkerPool
+{
+public:
+    typedef std::function<void(size_t)> Job;
+
+    /// Create a pool with the given number of threads besides the caller.
+    FGAIWorkerPool(unsigned numThreads);
+    ~FGAIWorkerPool();
+
+    /// Call job(i) for all i in [0, count), handing out chunkSize indices
+    /// at a time. Jobs must not throw.
+    void run(size_t count, size_t chunkSize, const Job& job);
+
+    unsigned size() const { return _workers.size(); }
+
+private:
+    class Worker;
+
+    void work();
+
+    SGMutex _mutex;
+    SGWaitCondition _startCondition;
+    SGWaitCondition _doneCondition;
+    unsigned _generation; // batch counter, guarded by _mutex
+    unsigned _busy;       // workers still in the current batch, guarded by _mutex
+    bool _stop;
+
+    const Job* _job;
+    size_t _count;
+    size_t _chunkSize;
+    std::atomic<size_t> _next;
+
+    std::vector<Worker*> _workers;
+};
+
+#endif  // _FG_AIWORKERPOOL_HXX
@@ -26,6 +26,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stddef.h>
 #include <assert.h>
 
 #include <simgear/debug/logstream.hxx>
@@ -40,16 +41,61 @@
 using namespace FlightRecorder;
 using std::string;
 
+/** Layout of an encoded record.
+ * Contains the XOR difference to its key frame, packed in groups of 8 bytes:
+ * a mask byte flags the non-zero bytes of a group, followed by these bytes.
+ * A zero mask is followed by the number of consecutive unchanged groups.
+ * sim_time must come first, so encoded lists can be searched just like raw ones. */
+typedef struct
+{
+    double          sim_time;
+    TKeyFrame*      pKeyFrame;
+    unsigned int    Size;
+    unsigned char   Payload[1];
+} FGReplayEncodedData;
+
 FGFlightRecorder::FGFlightRecorder(const char* pConfigName) :
     m_RecorderNode(fgGetNode("/sim/flight-recorder", true)),
     m_TotalRecordSize(0),
     m_ConfigName(pConfigName),
-    m_usingDefaultConfig(false)
+    m_usingDefaultConfig(false),
+    m_Encoding(false),
+    m_KeyFrameInterval(32),
+    m_EncodedSize(0),
+    m_pCaptureBuffer(NULL)
 {
+    memset(m_Encoder, 0, sizeof(m_Encoder));
+    m_pDecodeBuffer[0] = m_pDecodeBuffer[1] = NULL;
 }
 
 FGFlightRecorder::~FGFlightRecorder()
 {
+    resetEncoder();
+    deleteBuffers();
+}
+
+/** Enable/disable encoded record mode.
+ * Must only be called while no records exist (i.e. replay buffers are empty). */
+void
+FGFlightRecorder::setEncoding(bool Enable, unsigned int KeyFrameInterval)
+{
+    resetEncoder();
+    m_Encoding = Enable;
+    m_KeyFrameInterval = (KeyFrameInterval > 0) ? KeyFrameInterval : 1;
+    m_EncodedSize = 0;
+    SG_LOG(SG_SYSTEMS, SG_INFO, "FlightRecorder: encoded records " << (Enable ? "enabled" : "disabled")
+           << ", key frame interval " << m_KeyFrameInterval);
+}
+
+/** Free internal scratch buffers (size depends on recorder configuration). */
+void
+FGFlightRecorder::deleteBuffers(void)
+{
+    delete[] (unsigned char*) m_pCaptureBuffer;
+    delete[] (unsigned char*) m_pDecodeBuffer[0];
+    delete[] (unsigned char*) m_pDecodeBuffer[1];
+    m_pCaptureBuffer = NULL;
+    m_pDecodeBuffer[0] = m_pDecodeBuffer[1] = NULL;
 }
 
 void
@@ -73,6 +119,10 @@ FGFlightRecorder::reinit(void)
 void
 FGFlightRecorder::reinit(SGPropertyNode_ptr ConfigNode)
 {
+    // key frames and scratch buffers no longer match the new configuration
+    resetEncoder();
+    deleteBuffers();
+
     m_TotalRecordSize = 0;
 
     m_CaptureDouble.clear();
@@ -322,7 +372,161 @@ FGFlightRecorder::createEmptyRecord(void)
 void
 FGFlightRecorder::deleteRecord(FGReplayData* pRecord)
 {
-    delete[] pRecord;
+    if (m_Encoding && pRecord)
+    {
+        FGReplayEncodedData* pEncoded = (FGReplayEncodedData*) pRecord;
+        m_EncodedSize -= offsetof(FGReplayEncodedData, Payload) + pEncoded->Size;
+        releaseKeyFrame(pEncoded->pKeyFrame);
+    }
+    delete[] (unsigned char*) pRecord;
+}
+
+void
+FGFlightRecorder::releaseKeyFrame(TKeyFrame* pKeyFrame)
+{
+    if (pKeyFrame && (--pKeyFrame->RefCount == 0))
+    {
+        m_EncodedSize -= m_TotalRecordSize;
+        delete[] (unsigned char*) pKeyFrame->pRecord;
+        delete pKeyFrame;
+    }
+}
+
+/** Release the key frames of all encoder channels. */
+void
+FGFlightRecorder::resetEncoder(void)
+{
+    for (unsigned int i=0; i<MaxEncoderChannels; i++)
+    {
+        releaseKeyFrame(m_Encoder[i].pKeyFrame);
+        m_Encoder[i].pKeyFrame = NULL;
+        m_Encoder[i].FrameCount = 0;
+    }
+}
+
+/** Encode a raw record for the given encoder channel.
+ * Every m_KeyFrameInterval records a new key frame is created. All other
+ * records are stored as XOR difference to the channel's current key frame,
+ * so each record can be decoded independently of its neighbours. */
+FGReplayData*
+FGFlightRecorder::encode(const FGReplayData* pRecord, unsigned int Channel)
+{
+    assert(Channel < MaxEncoderChannels);
+    TEncoderState& State = m_Encoder[Channel];
+    if ((!State.pKeyFrame)||(State.FrameCount >= m_KeyFrameInterval))
+    {
+        FGReplayData* pKeyRecord = createEmptyRecord();
+        if (!pKeyRecord)
+            return NULL;
+        memcpy(pKeyRecord, pRecord, m_TotalRecordSize);
+        releaseKeyFrame(State.pKeyFrame);
+        State.pKeyFrame = new TKeyFrame;
+        State.pKeyFrame->RefCount = 1; // reference held by the channel
+        State.pKeyFrame->pRecord = pKeyRecord;
+        State.FrameCount = 0;
+        m_EncodedSize += m_TotalRecordSize;
+    }
+    State.FrameCount++;
+
+    const unsigned char* pData = (const unsigned char*) pRecord;
+    const unsigned char* pKey  = (const unsigned char*) State.pKeyFrame->pRecord;
+    m_EncodeBuffer.clear();
+
+    int Offset = sizeof(double); // sim_time is stored separately
+    while (Offset < m_TotalRecordSize)
+    {
+        int Count = m_TotalRecordSize - Offset;
+        if (Count > 8)
+            Count = 8;
+
+        unsigned char Mask = 0;
+        unsigned char Bytes[8];
+        int ByteCount = 0;
+        for (int j=0; j<Count; j++)
+        {
+            unsigned char x = pData[Offset+j] ^ pKey[Offset+j];
+            if (x)
+            {
+                Mask |= 1 << j;
+                Bytes[ByteCount++] = x;
+            }
+        }
+
+        if (Mask)
+        {
+            m_EncodeBuffer.push_back(Mask);
+            m_EncodeBuffer.insert(m_EncodeBuffer.end(), Bytes, Bytes+ByteCount);
+        }
+        else
+        {
+            // run of unchanged groups
+            size_t n = m_EncodeBuffer.size();
+            if ((n >= 2)&&(m_EncodeBuffer[n-2] == 0)&&(m_EncodeBuffer[n-1] < 255))
+                m_EncodeBuffer[n-1]++;
+            else
+            {
+                m_EncodeBuffer.push_back(0);
+                m_EncodeBuffer.push_back(1);
+            }
+        }
+        Offset += Count;
+    }
+
+    size_t Size = m_EncodeBuffer.size();
+    size_t TotalSize = offsetof(FGReplayEncodedData, Payload) + Size;
+    FGReplayEncodedData* pEncoded = (FGReplayEncodedData*) new unsigned char[TotalSize];
+    pEncoded->sim_time = pRecord->sim_time;
+    pEncoded->pKeyFrame = State.pKeyFrame;
+    pEncoded->Size = Size;
+    if (Size)
+        memcpy(pEncoded->Payload, &m_EncodeBuffer[0], Size);
+    State.pKeyFrame->RefCount++;
+    m_EncodedSize += TotalSize;
+
+    return (FGReplayData*) pEncoded;
+}
+
+/** Restore the raw record from an encoded record. */
+void
+FGFlightRecorder::decode(const FGReplayData* _pEncoded, FGReplayData* pRecord)
+{
+    const FGReplayEncodedData* pEncoded = (const FGReplayEncodedData*) _pEncoded;
+    unsigned char* pData = (unsigned char*) pRecord;
+    memcpy(pData, pEncoded->pKeyFrame->pRecord, m_TotalRecordSize);
+    pRecord->sim_time = pEncoded->sim_time;
+
+    const unsigned char* pPayload = pEncoded->Payload;
+    const unsigned char* pEnd = pPayload + pEncoded->Size;
+    int Offset = sizeof(double);
+    while ((pPayload < pEnd)&&(Offset < m_TotalRecordSize))
+    {
+        unsigned char Mask = *pPayload++;
+        if (!Mask)
+        {
+            // skip unchanged groups
+            Offset += 8 * (*pPayload++);
+            continue;
+        }
+        for (int j=0; j<8; j++)
+        {
+            if (Mask & (1 << j))
+                pData[Offset+j] ^= *pPayload++;
+        }
+        Offset += 8;
+    }
+}
+
+/** Capture data and encode it for the given encoder channel. */
+FGReplayData*
+FGFlightRecorder::captureEncoded(double SimTime, unsigned int Channel)
+{
+    if (!m_pCaptureBuffer)
+    {
+        m_pCaptureBuffer = createEmptyRecord();
+        if (!m_pCaptureBuffer)
+            return NULL;
+    }
+    return encode(capture(SimTime, m_pCaptureBuffer), Channel);
 }
 
 /** Capture data.
@@ -461,10 +665,28 @@ weighting(TInterpolation interpolation, double ratio, double v1,double v2)
 }
 
 /** Replay.
- * Restore all properties with data from given buffer. */
+ * Restore all properties with data from given buffer.
+ * Encoded buffers are decoded first. */
 void
-FGFlightRecorder::replay(double SimTime, const FGReplayData* _pNextBuffer, const FGReplayData* _pLastBuffer)
+FGFlightRecorder::replay(double SimTime, const FGReplayData* _pNextBuffer, const FGReplayData* _pLastBuffer,
+                         bool Encoded)
 {
+    if (Encoded && _pNextBuffer)
+    {
+        if (!m_pDecodeBuffer[0])
+        {
+            m_pDecodeBuffer[0] = createEmptyRecord();
+            m_pDecodeBuffer[1] = createEmptyRecord();
+        }
+        decode(_pNextBuffer, m_pDecodeBuffer[0]);
+        _pNextBuffer = m_pDecodeBuffer[0];
+        if (_pLastBuffer)
+        {
+            decode(_pLastBuffer, m_pDecodeBuffer[1]);
+            _pLastBuffer = m_pDecodeBuffer[1];
+        }
+    }
+
     const char* pLastBuffer = (const char*) _pLastBuffer;
     const char* pBuffer = (const char*) _pNextBuffer;
     if (!pBuffer)
@@ -45,6 +45,22 @@ namespace FlightRecorder
 
     typedef std::vector<TCapture> TSignalList;
 
+    /** Reference record for encoded records. Shared by all records encoded
+     * against it, freed when the last one is deleted. */
+    typedef struct
+    {
+        int           RefCount;
+        FGReplayData* pRecord;
+    } TKeyFrame;
+
+    /** State of an encoder channel (one per replay buffer list). */
+    typedef struct
+    {
+        TKeyFrame*    pKeyFrame;
+        unsigned int  FrameCount;
+    } TEncoderState;
+
+    enum { MaxEncoderChannels = 3 };
 }
 
 class FGFlightRecorder
@@ -57,11 +73,19 @@ public:
     void            reinit              (SGPropertyNode_ptr ConfigNode);
     FGReplayData*   createEmptyRecord   (void);
     FGReplayData*   capture             (double SimTime, FGReplayData* pRecycledBuffer);
+    FGReplayData*   captureEncoded      (double SimTime, unsigned int Channel);
+    FGReplayData*   encode              (const FGReplayData* pRecord, unsigned int Channel);
+    void            decode              (const FGReplayData* pEncoded, FGReplayData* pRecord);
+    void            resetEncoder        (void);
+    void            setEncoding         (bool Enable, unsigned int KeyFrameInterval);
     void            replay              (double SimTime, const FGReplayData* pNextBuffer,
-                                         const FGReplayData* pLastBuffer = NULL);
+                                         const FGReplayData* pLastBuffer = NULL,
+                                         bool Encoded = false);
     void            deleteRecord        (FGReplayData* pRecord);
 
     int             getRecordSize       (void) { return m_TotalRecordSize;}
+    bool            isEncoding          (void) { return m_Encoding;}
+    size_t          getEncodedSize      (void) { return m_EncodedSize;}
     void            getConfig           (SGPropertyNode* root);
 
 private:
@@ -75,6 +99,8 @@ private:
     bool haveProperty(SGPropertyNode* pProperty);
 
     int  getConfig(SGPropertyNode* root, const char* typeStr, const FlightRecorder::TSignalList& SignalList);
+    void releaseKeyFrame(FlightRecorder::TKeyFrame* pKeyFrame);
+    void deleteBuffers(void);
 
     SGPropertyNode_ptr m_RecorderNode;
     SGPropertyNode_ptr m_ConfigNode;
@@ -89,6 +115,15 @@ private:
     int m_TotalRecordSize;
     std::string m_ConfigName;
     bool m_usingDefaultConfig;
+
+    // encoded record mode: key frames plus XOR/bit-packed intermediate frames
+    bool m_Encoding;
+    unsigned int m_KeyFrameInterval;
+    size_t m_EncodedSize;
+    FlightRecorder::TEncoderState m_Encoder[FlightRecorder::MaxEncoderChannels];
+    std::vector<unsigned char> m_EncodeBuffer;
+    FGReplayData* m_pCaptureBuffer;
+    FGReplayData* m_pDecodeBuffer[2];
 };
 
 #endif /* FLIGHTRECORDER_HXX_ */
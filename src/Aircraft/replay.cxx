@@ -26,6 +26,7 @@
 #endif
 
 #include <cstdio>
+#include <cstring>
 #include <float.h>
 
 #include <simgear/constants.h>
@@ -35,11 +36,14 @@
 #include <simgear/misc/sg_dir.hxx>
 #include <simgear/misc/stdint.hxx>
 #include <simgear/misc/strutils.hxx>
+#include <simgear/threads/SGGuard.hxx>
 
 #include <Main/fg_props.hxx>
 
 #include "replay.hxx"
 #include "flightrecorder.hxx"
+#include "replaytape.hxx"
+#include "replaycapture.hxx"
 
 using std::deque;
 using std::vector;
@@ -70,6 +74,17 @@ namespace ReplayContainer
     };
 }
 
+namespace ReplayBuffer
+{
+    /** Encoder channels used for the replay buffer lists. */
+    enum Channel
+    {
+        ShortTerm  = 0,
+        MediumTerm = 1,
+        LongTerm   = 2
+    };
+}
+
 /**
  * Constructor
  */
@@ -85,7 +100,11 @@ FGReplay::FGReplay() :
     m_low_res_time(3600.0),
     m_medium_sample_rate(0.5), // medium term sample rate (sec)
     m_long_sample_rate(5.0),   // long term sample rate (sec)
-    m_pRecorder(new FGFlightRecorder("replay-config"))
+    m_pRecorder(new FGFlightRecorder("replay-config")),
+    m_pTapeReader(NULL),
+    m_pCaptureRing(NULL),
+    m_pCaptureThread(NULL),
+    m_pBlackBox(NULL)
 {
 }
 
@@ -107,6 +126,8 @@ FGReplay::~FGReplay()
 void
 FGReplay::clear()
 {
+    shutdownCapture();
+
     while ( !short_term.empty() )
     {
         m_pRecorder->deleteRecord(short_term.front());
@@ -127,6 +148,11 @@ FGReplay::clear()
         m_pRecorder->deleteRecord(recycler.front());
         recycler.pop_front();
     }
+    m_pRecorder->resetEncoder();
+
+    // close tape which was loaded from disk
+    delete m_pTapeReader;
+    m_pTapeReader = NULL;
 
     // clear messages belonging to old replay session
     fgGetNode("/sim/replay/messages", 0, true)->removeChildren("msg");
@@ -166,6 +192,8 @@ FGReplay::reinit()
 
     // Flush queues
     clear();
+    m_pRecorder->setEncoding(fgGetBool("/sim/replay/buffer/encoded-records", false),
+                             fgGetInt("/sim/replay/buffer/key-frame-interval", 32));
     m_pRecorder->reinit();
 
     m_high_res_time   = fgGetDouble("/sim/replay/buffer/high-res-time",    60.0);
@@ -176,6 +204,7 @@ FGReplay::reinit()
     m_long_sample_rate   = fgGetDouble("/sim/replay/buffer/low-res-sample-dt",    5.0); // long term sample rate (sec)
 
     fillRecycler();
+    initCapture();
     loadMessages();
 
     replay_master->setIntValue(0);
@@ -206,6 +235,10 @@ FGReplay::unbind()
 void
 FGReplay::fillRecycler()
 {
+    // encoded records vary in size and are allocated on demand
+    if (m_pRecorder->isEncoding())
+        return;
+
     // Create an estimated nr of required ReplayData objects
     // 120 is an estimated maximum frame rate.
     int estNrObjects = (int) ((m_high_res_time*120) + (m_medium_res_time*m_medium_sample_rate) +
@@ -222,6 +255,107 @@ FGReplay::fillRecycler()
     }
 }
 
+/**
+ * Start the capture thread when background capture is enabled.
+ */
+void
+FGReplay::initCapture()
+{
+    shutdownCapture();
+
+    if (fgGetBool("/sim/replay/black-box/enabled", false))
+    {
+        // continuously stream all recorded data to disk
+        SGPath Directory(fgGetString("/sim/replay/black-box/directory",
+                                     fgGetString("/sim/replay/tape-directory", "")));
+        std::string Prefix = std::string(fgGetString("/sim/aircraft", "unknown")) + "-blackbox-";
+        double SegmentDuration = fgGetDouble("/sim/replay/black-box/segment-duration", 600.0);
+        double FlushInterval   = fgGetDouble("/sim/replay/black-box/flush-interval", 2.0);
+        double MaxDiskSize     = fgGetDouble("/sim/replay/black-box/max-disk-mbyte", 1024.0);
+
+        m_pBlackBox = new FGReplayTapeStream(Directory, Prefix, SegmentDuration, FlushInterval,
+                                             (uint64_t) (MaxDiskSize*1024*1024));
+        SGPropertyNode_ptr Config = new SGPropertyNode();
+        m_pRecorder->getConfig(Config.get());
+        // duration is unknown while streaming - use the index instead
+        m_pBlackBox->start(createMetaData(0.0), Config, m_pRecorder->getRecordSize());
+    }
+
+    if (!fgGetBool("/sim/replay/buffer/background-capture", false))
+        return;
+
+    int RingSize = fgGetInt("/sim/replay/buffer/capture-ring-size", 256);
+    m_pCaptureRing = new FGReplayCaptureRing(m_pRecorder, (RingSize > 0) ? RingSize : 256);
+    m_pCaptureThread = new FGReplayCaptureThread(this);
+    m_pCaptureThread->start();
+}
+
+/**
+ * Stop the capture thread. Records still waiting in the ring are dropped.
+ */
+void
+FGReplay::shutdownCapture()
+{
+    if (m_pCaptureThread)
+    {
+        m_pCaptureThread->stop();
+        delete m_pCaptureThread;
+        m_pCaptureThread = NULL;
+    }
+    delete m_pCaptureRing;
+    m_pCaptureRing = NULL;
+
+    // closes the current black box segment
+    delete m_pBlackBox;
+    m_pBlackBox = NULL;
+}
+
+/**
+ * Move all captured raw records from the ring into the replay buffers.
+ * Runs on the capture thread - and on the main loop to make sure the
+ * buffers are up to date before they are accessed (replay, saving tapes).
+ * Since only the main loop adds records, the buffers are stable after
+ * this returns, until recording resumes.
+ */
+void
+FGReplay::processCapturedRecords()
+{
+    SGGuard<SGMutex> guard(m_ListMutex);
+    if (!m_pCaptureRing)
+        return;
+
+    size_t RecordSize = m_pRecorder->getRecordSize();
+    FGReplayData* pRaw;
+    while ((pRaw = m_pCaptureRing->front()) != NULL)
+    {
+        FGReplayData* r = NULL;
+        if (m_pRecorder->isEncoding())
+        {
+            r = m_pRecorder->encode(pRaw, ReplayBuffer::ShortTerm);
+        }
+        else
+        {
+            if (!recycler.empty())
+            {
+                r = recycler.front();
+                recycler.pop_front();
+            }
+            else
+                r = m_pRecorder->createEmptyRecord();
+            if (r)
+                memcpy(r, pRaw, RecordSize);
+        }
+        m_pCaptureRing->pop();
+
+        if (!r)
+        {
+            SG_LOG(SG_SYSTEMS, SG_ALERT, "ReplaySystem: Out of memory!");
+            continue;
+        }
+        storeRecord(r);
+    }
+}
+
 static void
 printTimeStr(char* pStrBuffer,double _Time, bool ShowDecimal=true)
 {
@@ -307,6 +441,8 @@ bool
 FGReplay::start(bool NewTape)
 {
     // freeze the fdm, resume from sim pause
+    processCapturedRecords();
+
     double StartTime = get_start_time();
     double EndTime = get_end_time();
     was_finished_already = false;
@@ -319,8 +455,12 @@ FGReplay::start(bool NewTape)
     fgSetString("/sim/replay/end-time-str",   StrBuffer);
 
     unsigned long buffer_elements =  short_term.size()+medium_term.size()+long_term.size();
-    fgSetDouble("/sim/replay/buffer-size-mbyte",
-                buffer_elements*m_pRecorder->getRecordSize() / (1024*1024.0));
+    if (m_pTapeReader)
+        buffer_elements += m_pTapeReader->getRecordCount();
+    double buffer_size = buffer_elements*m_pRecorder->getRecordSize();
+    if (m_pRecorder->isEncoding())
+        buffer_size = m_pRecorder->getEncodedSize();
+    fgSetDouble("/sim/replay/buffer-size-mbyte", buffer_size / (1024*1024.0));
     if ((fgGetBool("/sim/freeze/master"))||
         (0 == replay_master->getIntValue()))
         guiMessage("Replay active. 'Esc' to stop.");
@@ -389,6 +529,12 @@ FGReplay::update( double dt )
     }
 
     int replay_state = replay_master->getIntValue();
+    if ((replay_state != 0)||(last_replay_state > 0))
+    {
+        // about to access the replay buffers
+        processCapturedRecords();
+    }
+
     if ((replay_state == 0)&&
         (last_replay_state > 0))
     {
@@ -488,6 +634,22 @@ FGReplay::update( double dt )
         sim_time = new_sim_time;
     }
 
+    if (m_pCaptureRing)
+    {
+        // background capture: only take the snapshot here, the capture
+        // thread takes care of the buffers
+        FGReplayData* pSlot = m_pCaptureRing->beginWrite();
+        if (!pSlot)
+        {
+            SG_LOG(SG_SYSTEMS, SG_WARN, "ReplaySystem: Capture buffer overrun. Dropping frame.");
+            return;
+        }
+        m_pRecorder->capture(sim_time, pSlot);
+        m_pCaptureRing->endWrite();
+        m_pCaptureThread->notify();
+        return;
+    }
+
     FGReplayData* r = record(sim_time);
     if (!r)
     {
@@ -495,6 +657,32 @@ FGReplay::update( double dt )
         return;
     }
 
+    storeRecord(r);
+}
+
+/**
+ * Add a new record to the replay buffers and downsample older records
+ * to the medium and long term buffers.
+ */
+void
+FGReplay::storeRecord(FGReplayData* r)
+{
+    // the record's time - the main loop may be ahead when using the capture thread
+    double now = r->sim_time;
+
+    if (m_pBlackBox)
+    {
+        if (m_pRecorder->isEncoding())
+        {
+            vector<double> Buffer(m_pRecorder->getRecordSize()/sizeof(double) + 1);
+            FGReplayData* pRaw = (FGReplayData*) &Buffer[0];
+            m_pRecorder->decode(r, pRaw);
+            m_pBlackBox->append(pRaw);
+        }
+        else
+            m_pBlackBox->append(r);
+    }
+
     // update the short term list
     short_term.push_back( r );
     FGReplayData *st_front = short_term.front();
@@ -504,48 +692,55 @@ FGReplay::update( double dt )
         SG_LOG(SG_SYSTEMS, SG_ALERT, "ReplaySystem: Inconsistent data!");
     }
 
-    if ( sim_time - st_front->sim_time > m_high_res_time )
+    // note: recycled records may be deleted (encoded mode), so remember their time
+    double front_time = st_front->sim_time;
+    if ( now - front_time > m_high_res_time )
     {
-        while ( sim_time - st_front->sim_time > m_high_res_time )
+        while ( now - front_time > m_high_res_time )
         {
             st_front = short_term.front();
-            recycler.push_back(st_front);
+            front_time = st_front->sim_time;
             short_term.pop_front();
+            recycle(st_front);
         }
 
         // update the medium term list
-        if ( sim_time - last_mt_time > m_medium_sample_rate )
+        if ( now - last_mt_time > m_medium_sample_rate )
         {
-            last_mt_time = sim_time;
+            last_mt_time = now;
             st_front = short_term.front();
-            medium_term.push_back( st_front );
+            medium_term.push_back( migrate(st_front, ReplayBuffer::MediumTerm) );
             short_term.pop_front();
 
             FGReplayData *mt_front = medium_term.front();
-            if ( sim_time - mt_front->sim_time > m_medium_res_time )
+            front_time = mt_front->sim_time;
+            if ( now - front_time > m_medium_res_time )
             {
-                while ( sim_time - mt_front->sim_time > m_medium_res_time )
+                while ( now - front_time > m_medium_res_time )
                 {
                     mt_front = medium_term.front();
-                    recycler.push_back(mt_front);
+                    front_time = mt_front->sim_time;
                     medium_term.pop_front();
+                    recycle(mt_front);
                 }
                 // update the long term list
-                if ( sim_time - last_lt_time > m_long_sample_rate )
+                if ( now - last_lt_time > m_long_sample_rate )
                 {
-                    last_lt_time = sim_time;
+                    last_lt_time = now;
                     mt_front = medium_term.front();
-                    long_term.push_back( mt_front );
+                    long_term.push_back( migrate(mt_front, ReplayBuffer::LongTerm) );
                     medium_term.pop_front();
 
                     FGReplayData *lt_front = long_term.front();
-                    if ( sim_time - lt_front->sim_time > m_low_res_time )
+                    front_time = lt_front->sim_time;
+                    if ( now - front_time > m_low_res_time )
                     {
-                        while ( sim_time - lt_front->sim_time > m_low_res_time )
+                        while ( now - front_time > m_low_res_time )
                         {
                             lt_front = long_term.front();
-                            recycler.push_back(lt_front);
+                            front_time = lt_front->sim_time;
                             long_term.pop_front();
+                            recycle(lt_front);
                         }
                     }
                 }
@@ -570,6 +765,9 @@ FGReplay::update( double dt )
 FGReplayData*
 FGReplay::record(double time)
 {
+    if (m_pRecorder->isEncoding())
+        return m_pRecorder->captureEncoded(time, ReplayBuffer::ShortTerm);
+
     FGReplayData* r = NULL;
 
     if (! recycler.empty())
@@ -581,6 +779,36 @@ FGReplay::record(double time)
     return m_pRecorder->capture(time, r);
 }
 
+/**
+ * Release a record which dropped out of the replay buffer.
+ */
+void
+FGReplay::recycle(FGReplayData* pRecord)
+{
+    if (m_pRecorder->isEncoding())
+        m_pRecorder->deleteRecord(pRecord);
+    else
+        recycler.push_back(pRecord);
+}
+
+/**
+ * Prepare a record for moving to another (lower resolution) buffer list.
+ * Encoded records are re-encoded against the key frames of the target list,
+ * so the short term key frames can be released.
+ */
+FGReplayData*
+FGReplay::migrate(FGReplayData* pRecord, int Channel)
+{
+    if (!m_pRecorder->isEncoding())
+        return pRecord;
+
+    vector<double> Buffer(m_pRecorder->getRecordSize()/sizeof(double) + 1);
+    FGReplayData* pRaw = (FGReplayData*) &Buffer[0];
+    m_pRecorder->decode(pRecord, pRaw);
+    m_pRecorder->deleteRecord(pRecord);
+    return m_pRecorder->encode(pRaw, Channel);
+}
+
 /** 
  * interpolate a specific time from a specific list
  */
@@ -639,6 +867,19 @@ FGReplay::replay( double time ) {
 
     replayMessage(time);
 
+    if ((m_pTapeReader)&&
+        ((short_term.empty())||(time <= m_pTapeReader->getEndTime())))
+    {
+        // replay from an indexed tape. Records taken after the tape was
+        // loaded follow its end time in the in-memory buffers.
+        const FGReplayData* pNext = NULL;
+        const FGReplayData* pLast = NULL;
+        if (!m_pTapeReader->getFrames(time, pNext, pLast))
+            return true;
+        m_pRecorder->replay(time, pNext, pLast);
+        return ((time > m_pTapeReader->getEndTime())&&(short_term.empty()));
+    }
+
     if ( ! short_term.empty() ) {
         t1 = short_term.back()->sim_time;
         t2 = short_term.front()->sim_time;
@@ -698,13 +939,16 @@ FGReplay::replay( double time ) {
 void
 FGReplay::replay(double time, FGReplayData* pCurrentFrame, FGReplayData* pOldFrame)
 {
-    m_pRecorder->replay(time,pCurrentFrame,pOldFrame);
+    m_pRecorder->replay(time, pCurrentFrame, pOldFrame, m_pRecorder->isEncoding());
 }
 
 double
 FGReplay::get_start_time()
 {
-    if ( ! long_term.empty() )
+    if (m_pTapeReader)
+    {
+        return m_pTapeReader->getStartTime();
+    } else if ( ! long_term.empty() )
     {
         return long_term.front()->sim_time;
     } else if ( ! medium_term.empty() )
@@ -725,6 +969,9 @@ FGReplay::get_end_time()
     if ( ! short_term.empty() )
     {
         return short_term.back()->sim_time;
+    } else if (m_pTapeReader)
+    {
+        return m_pTapeReader->getEndTime();
     } else
     {
         return 0.0;
@@ -733,8 +980,12 @@ FGReplay::get_end_time()
 
 /** Save raw replay data in a separate container */
 static bool
-saveRawReplayData(gzContainerWriter& output, const replay_list_type& ReplayData, size_t RecordSize)
+saveRawReplayData(gzContainerWriter& output, FGFlightRecorder* pRecorder, const replay_list_type& ReplayData, size_t RecordSize)
 {
+    // decode buffer for encoded records
+    vector<double> Buffer(RecordSize/sizeof(double) + 1);
+    FGReplayData* pRaw = (FGReplayData*) &Buffer[0];
+
     // get number of records in this stream
     size_t Count = ReplayData.size();
 
@@ -752,6 +1003,11 @@ saveRawReplayData(gzContainerWriter& output, const replay_list_type& ReplayData,
            !output.fail())
     {
         const FGReplayData* pRecord = *it++;
+        if (pRecorder->isEncoding())
+        {
+            pRecorder->decode(pRecord, pRaw);
+            pRecord = pRaw;
+        }
         output.write((char*)pRecord, RecordSize);
         CheckCount++;
     }
@@ -769,7 +1025,8 @@ saveRawReplayData(gzContainerWriter& output, const replay_list_type& ReplayData,
 
 /** Load raw replay data from a separate container */
 static bool
-loadRawReplayData(gzContainerReader& input, FGFlightRecorder* pRecorder, replay_list_type& ReplayData, size_t RecordSize)
+loadRawReplayData(gzContainerReader& input, FGFlightRecorder* pRecorder, replay_list_type& ReplayData, size_t RecordSize,
+                  int Channel)
 {
     size_t Size = 0;
     simgear::ContainerType Type = ReplayContainer::Invalid;
@@ -797,6 +1054,12 @@ loadRawReplayData(gzContainerReader& input, FGFlightRecorder* pRecorder, replay_
     {
         FGReplayData* pBuffer = pRecorder->createEmptyRecord();
         input.read((char*) pBuffer, RecordSize);
+        if (pRecorder->isEncoding())
+        {
+            FGReplayData* pRaw = pBuffer;
+            pBuffer = pRecorder->encode(pRaw, Channel);
+            delete[] (unsigned char*) pRaw;
+        }
         ReplayData.push_back(pBuffer);
     }
 
@@ -815,10 +1078,73 @@ loadRawReplayData(gzContainerReader& input, FGFlightRecorder* pRecorder, replay_
     return true;
 }
 
+namespace
+{
+    /** Copy all records of a loaded tape to a tape writer. */
+    struct TapeCopier
+    {
+        TapeCopier(FGReplayTapeWriter& Writer) : m_Writer(Writer), ok(true) {}
+        void operator()(const FGReplayData* pRecord) { ok &= m_Writer.append(pRecord); }
+
+        FGReplayTapeWriter& m_Writer;
+        bool ok;
+    };
+}
+
+/** Write indexed flight recorder tape with given filename and meta properties to disk */
+bool
+FGReplay::saveIndexedTape(const SGPath& Filename, SGPropertyNode* MetaDataProps)
+{
+    SGPropertyNode_ptr Config = new SGPropertyNode();
+    m_pRecorder->getConfig(Config.get());
+    size_t RecordSize = Config->getIntValue("recorder/record-size", 0);
+
+    FGReplayTapeWriter writer(fgGetDouble("/sim/replay/tape-block-duration", 60.0));
+    if (!writer.open(Filename, MetaDataProps, Config.get(), RecordSize))
+        return false;
+
+    bool ok = true;
+    if (m_pTapeReader)
+    {
+        TapeCopier copy(writer);
+        ok = m_pTapeReader->forEachRecord(copy) && copy.ok;
+    }
+
+    // decode buffer for encoded records
+    vector<double> Buffer(RecordSize/sizeof(double) + 1);
+    FGReplayData* pRaw = (FGReplayData*) &Buffer[0];
+
+    // oldest data first
+    const replay_list_type* Lists[] = {&long_term, &medium_term, &short_term};
+    for (int i=0; (i<3)&&ok; i++)
+    {
+        replay_list_type::const_iterator it = Lists[i]->begin();
+        while ((it != Lists[i]->end())&&ok)
+        {
+            const FGReplayData* pRecord = *it++;
+            if (m_pRecorder->isEncoding())
+            {
+                m_pRecorder->decode(pRecord, pRaw);
+                pRecord = pRaw;
+            }
+            ok &= writer.append(pRecord);
+        }
+    }
+
+    ok &= writer.close();
+    SG_LOG(SG_SYSTEMS, MY_SG_DEBUG, "Saved indexed tape, " << writer.getFileSize() << " bytes");
+    return ok;
+}
+
 /** Write flight recorder tape with given filename and meta properties to disk */
 bool
 FGReplay::saveTape(const SGPath& Filename, SGPropertyNode* MetaDataProps)
 {
+    // indexed tapes are the default. Tapes loaded from disk are also
+    // always saved as indexed tapes, since their data is not kept in memory.
+    if (fgGetBool("/sim/replay/indexed-tapes", true) || m_pTapeReader)
+        return saveIndexedTape(Filename, MetaDataProps);
+
     bool ok = true;
 
     /* open output stream *******************************************/
@@ -848,11 +1174,11 @@ FGReplay::saveTape(const SGPath& Filename, SGPropertyNode* MetaDataProps)
         SG_LOG(SG_SYSTEMS, MY_SG_DEBUG, "Total signal count: " <<  Config->getIntValue("recorder/signal-count", 0)
                << ", record size: " << RecordSize);
         if (ok)
-            ok &= saveRawReplayData(output, short_term,  RecordSize);
+            ok &= saveRawReplayData(output, m_pRecorder, short_term,  RecordSize);
         if (ok)
-            ok &= saveRawReplayData(output, medium_term, RecordSize);
+            ok &= saveRawReplayData(output, m_pRecorder, medium_term, RecordSize);
         if (ok)
-            ok &= saveRawReplayData(output, long_term,   RecordSize);
+            ok &= saveRawReplayData(output, m_pRecorder, long_term,   RecordSize);
         Config = 0;
     }
 
@@ -862,18 +1188,15 @@ FGReplay::saveTape(const SGPath& Filename, SGPropertyNode* MetaDataProps)
     return ok;
 }
 
-/** Write flight recorder tape to disk. User/script command. */
-bool
-FGReplay::saveTape(const SGPropertyNode* ConfigData)
+/** Create the meta data stored with a tape. */
+SGPropertyNode_ptr
+FGReplay::createMetaData(double Duration)
 {
-    const char* tapeDirectory = fgGetString("/sim/replay/tape-directory", "");
-    const char* aircraftType  = fgGetString("/sim/aircraft", "unknown");
-
     SGPropertyNode_ptr myMetaData = new SGPropertyNode();
     SGPropertyNode* meta = myMetaData->getNode("meta", 0, true);
 
     // add some data to the file - so we know for which aircraft/version it was recorded
-    meta->setStringValue("aircraft-type",           aircraftType);
+    meta->setStringValue("aircraft-type",           fgGetString("/sim/aircraft", "unknown"));
     meta->setStringValue("aircraft-description",    fgGetString("/sim/description", ""));
     meta->setStringValue("aircraft-fdm",            fgGetString("/sim/flight-model", ""));
     meta->setStringValue("closest-airport-id",      fgGetString("/sim/airport/closest-airport-id", ""));
@@ -883,7 +1206,6 @@ FGReplay::saveTape(const SGPropertyNode* ConfigData)
     meta->setStringValue("aircraft-version", aircraft_version);
 
     // add information on the tape's recording duration
-    double Duration = get_end_time()-get_start_time();
     meta->setDoubleValue("tape-duration", Duration);
     char StrBuffer[30];
     printTimeStr(StrBuffer, Duration, false);
@@ -891,14 +1213,29 @@ FGReplay::saveTape(const SGPropertyNode* ConfigData)
 
     // add simulator version
     copyProperties(fgGetNode("/sim/version", 0, true), meta->getNode("version", 0, true));
+
+    // store replay messages
+    copyProperties(fgGetNode("/sim/replay/messages", 0, true), myMetaData->getNode("messages", 0, true));
+
+    return myMetaData;
+}
+
+/** Write flight recorder tape to disk. User/script command. */
+bool
+FGReplay::saveTape(const SGPropertyNode* ConfigData)
+{
+    processCapturedRecords();
+
+    const char* tapeDirectory = fgGetString("/sim/replay/tape-directory", "");
+    const char* aircraftType  = fgGetString("/sim/aircraft", "unknown");
+
+    SGPropertyNode_ptr myMetaData = createMetaData(get_end_time()-get_start_time());
+    SGPropertyNode* meta = myMetaData->getNode("meta", 0, true);
     if (ConfigData->getNode("user-data"))
     {
         copyProperties(ConfigData->getNode("user-data"), meta->getNode("user-data", 0, true));
     }
 
-    // store replay messages
-    copyProperties(fgGetNode("/sim/replay/messages", 0, true), myMetaData->getNode("messages", 0, true));
-
     // generate file name (directory + aircraft type + date + time + suffix)
     SGPath p(tapeDirectory);
     p.append(aircraftType);
@@ -931,12 +1268,75 @@ FGReplay::saveTape(const SGPropertyNode* ConfigData)
     return ok;
 }
 
+/** Open an indexed flight recorder tape. Data blocks are loaded lazily
+ * during replay, so opening even very long tapes is quick.
+ * Actual data and signal configuration is not read when in "Preview" mode.
+ */
+bool
+FGReplay::loadIndexedTape(const SGPath& Filename, bool Preview, SGPropertyNode* UserData)
+{
+    SGPropertyNode_ptr MetaDataProps = new SGPropertyNode();
+    SGPropertyNode_ptr Config;
+    if (!Preview)
+        Config = new SGPropertyNode();
+
+    FGReplayTapeReader* pReader = new FGReplayTapeReader();
+    bool ok = pReader->open(Filename, MetaDataProps.get(), Config.get());
+    if (ok)
+        copyProperties(MetaDataProps->getNode("meta", 0, true), UserData);
+
+    if ((ok)&&(!Preview))
+    {
+        // wipe old data (no longer matches the new configuration) - and reconfigure the recorder
+        clear();
+        m_pRecorder->reinit(Config);
+        fillRecycler();
+        initCapture();
+
+        size_t RecordSize = m_pRecorder->getRecordSize();
+        if (pReader->getRecordSize() != RecordSize)
+        {
+            ok = false;
+            SG_LOG(SG_SYSTEMS, SG_ALERT, "Error: Data inconsistency. Flight recorder tape has record size " << pReader->getRecordSize()
+                   << ", expected size was " << RecordSize << ".");
+        }
+        else
+        {
+            m_pTapeReader = pReader;
+            pReader = NULL;
+
+            // restore replay messages
+            copyProperties(MetaDataProps->getNode("messages", 0, true),
+                           fgGetNode("/sim/replay/messages", 0, true));
+            sim_time = get_end_time();
+            last_mt_time = last_lt_time = sim_time;
+        }
+    }
+    delete pReader;
+
+    if (!Preview)
+    {
+        if (ok)
+        {
+            guiMessage("Flight recorder tape loaded successfully!");
+            start(true);
+        }
+        else
+            guiMessage("Failed to load tape. See log output.");
+    }
+
+    return ok;
+}
+
 /** Read a flight recorder tape with given filename from disk and return meta properties.
  * Actual data and signal configuration is not read when in "Preview" mode.
  */
 bool
 FGReplay::loadTape(const SGPath& Filename, bool Preview, SGPropertyNode* UserData)
 {
+    if (ReplayTape::isIndexedTape(Filename))
+        return loadIndexedTape(Filename, Preview, UserData);
+
     bool ok = true;
 
     /* open input stream ********************************************/
@@ -1025,10 +1425,11 @@ FGReplay::loadTape(const SGPath& Filename, bool Preview, SGPropertyNode* UserDat
             }
             if (ok)
             {
-                // reconfigure the recorder - and wipe old data (no longer matches the current recorder)
-                m_pRecorder->reinit(Config);
+                // wipe old data (no longer matches the new configuration) - and reconfigure the recorder
                 clear();
+                m_pRecorder->reinit(Config);
                 fillRecycler();
+                initCapture();
             }
         }
 
@@ -1053,11 +1454,11 @@ FGReplay::loadTape(const SGPath& Filename, bool Preview, SGPropertyNode* UserDat
             }
 
             if (ok)
-                ok &= loadRawReplayData(input, m_pRecorder, short_term,  RecordSize);
+                ok &= loadRawReplayData(input, m_pRecorder, short_term,  RecordSize, ReplayBuffer::ShortTerm);
             if (ok)
-                ok &= loadRawReplayData(input, m_pRecorder, medium_term, RecordSize);
+                ok &= loadRawReplayData(input, m_pRecorder, medium_term, RecordSize, ReplayBuffer::MediumTerm);
             if (ok)
-                ok &= loadRawReplayData(input, m_pRecorder, long_term,   RecordSize);
+                ok &= loadRawReplayData(input, m_pRecorder, long_term,   RecordSize, ReplayBuffer::LongTerm);
 
             // restore replay messages
             if (ok)
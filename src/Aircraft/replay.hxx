@@ -33,11 +33,16 @@
 #include <simgear/math/sg_types.hxx>
 #include <simgear/props/props.hxx>
 #include <simgear/structure/subsystem_mgr.hxx>
+#include <simgear/threads/SGThread.hxx>
 
 #include <deque>
 #include <vector>
 
 class FGFlightRecorder;
+class FGReplayTapeReader;
+class FGReplayCaptureRing;
+class FGReplayCaptureThread;
+class FGReplayTapeStream;
 
 typedef struct {
     double sim_time;
@@ -76,8 +81,17 @@ public:
     bool loadTape(const SGPropertyNode* ConfigData);
 
 private:
+    friend class FGReplayCaptureThread;
+
     void clear();
     FGReplayData* record(double time);
+    void storeRecord(FGReplayData* pRecord);
+    void initCapture();
+    void shutdownCapture();
+    void processCapturedRecords();
+    SGPropertyNode_ptr createMetaData(double Duration);
+    void recycle(FGReplayData* pRecord);
+    FGReplayData* migrate(FGReplayData* pRecord, int Channel);
     void interpolate(double time, const replay_list_type &list);
     void replay(double time, FGReplayData* pCurrentFrame, FGReplayData* pOldFrame=NULL);
     void guiMessage(const char* message);
@@ -92,7 +106,9 @@ private:
 
     bool listTapes(bool SameAircraftFilter, const SGPath& tapeDirectory);
     bool saveTape(const SGPath& Filename, SGPropertyNode* MetaData);
+    bool saveIndexedTape(const SGPath& Filename, SGPropertyNode* MetaData);
     bool loadTape(const SGPath& Filename, bool Preview, SGPropertyNode* UserData);
+    bool loadIndexedTape(const SGPath& Filename, bool Preview, SGPropertyNode* UserData);
 
     double sim_time;
     double last_mt_time;
@@ -123,6 +139,15 @@ private:
     double m_long_sample_rate;   // long term sample rate (sec)
 
     FGFlightRecorder* m_pRecorder;
+    FGReplayTapeReader* m_pTapeReader; // lazily loaded indexed tape (or NULL)
+
+    // background capture (optional): main loop -> ring -> capture thread -> buffers
+    FGReplayCaptureRing* m_pCaptureRing;
+    FGReplayCaptureThread* m_pCaptureThread;
+    SGMutex m_ListMutex;
+
+    // black box mode: continuous streaming to disk (or NULL)
+    FGReplayTapeStream* m_pBlackBox;
 };
 
 #endif // _FG_REPLAY_HXX
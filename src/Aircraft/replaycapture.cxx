@@ -0,0 +1,134 @@
+// replaycapture.cxx - background processing of flight recorder captures
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <simgear/threads/SGGuard.hxx>
+
+#include "replaycapture.hxx"
+#include "flightrecorder.hxx"
+
+///////////////////////////////////////////////////////////////////////////////
+// FGReplayCaptureRing
+///////////////////////////////////////////////////////////////////////////////
+
+FGReplayCaptureRing::FGReplayCaptureRing(FGFlightRecorder* pRecorder, unsigned int Size) :
+    m_Head(0),
+    m_Tail(0)
+{
+    // one slot always stays empty to tell "full" from "empty"
+    m_Slots.resize(Size+1, NULL);
+    for (size_t i=0; i<m_Slots.size(); i++)
+        m_Slots[i] = pRecorder->createEmptyRecord();
+}
+
+FGReplayCaptureRing::~FGReplayCaptureRing()
+{
+    for (size_t i=0; i<m_Slots.size(); i++)
+        delete[] (unsigned char*) m_Slots[i];
+}
+
+FGReplayData*
+FGReplayCaptureRing::beginWrite(void)
+{
+    unsigned int Head = m_Head.load(std::memory_order_relaxed);
+    unsigned int Next = (Head + 1) % m_Slots.size();
+    if (Next == m_Tail.load(std::memory_order_acquire))
+        return NULL; // full
+    return m_Slots[Head];
+}
+
+void
+FGReplayCaptureRing::endWrite(void)
+{
+    unsigned int Head = m_Head.load(std::memory_order_relaxed);
+    m_Head.store((Head + 1) % m_Slots.size(), std::memory_order_release);
+}
+
+FGReplayData*
+FGReplayCaptureRing::front(void)
+{
+    unsigned int Tail = m_Tail.load(std::memory_order_relaxed);
+    if (Tail == m_Head.load(std::memory_order_acquire))
+        return NULL; // empty
+    return m_Slots[Tail];
+}
+
+void
+FGReplayCaptureRing::pop(void)
+{
+    unsigned int Tail = m_Tail.load(std::memory_order_relaxed);
+    m_Tail.store((Tail + 1) % m_Slots.size(), std::memory_order_release);
+}
+
+bool
+FGReplayCaptureRing::empty(void) const
+{
+    return m_Tail.load(std::memory_order_acquire) == m_Head.load(std::memory_order_acquire);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// FGReplayCaptureThread
+///////////////////////////////////////////////////////////////////////////////
+
+FGReplayCaptureThread::FGReplayCaptureThread(FGReplay* pReplay) :
+    m_pReplay(pReplay),
+    m_Stop(false)
+{
+}
+
+FGReplayCaptureThread::~FGReplayCaptureThread()
+{
+    stop();
+}
+
+void
+FGReplayCaptureThread::notify(void)
+{
+    m_WakeCondition.signal();
+}
+
+void
+FGReplayCaptureThread::stop(void)
+{
+    if (m_Stop.exchange(true))
+        return;
+    {
+        SGGuard<SGMutex> g(m_WakeMutex);
+        m_WakeCondition.signal();
+    }
+    join();
+}
+
+void
+FGReplayCaptureThread::run()
+{
+    while (!m_Stop)
+    {
+        m_pReplay->processCapturedRecords();
+
+        SGGuard<SGMutex> g(m_WakeMutex);
+        if (!m_Stop)
+        {
+            // the timeout only covers missed notifications
+            m_WakeCondition.wait(m_WakeMutex, 50);
+        }
+    }
+}
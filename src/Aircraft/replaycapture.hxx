@@ -0,0 +1,85 @@
+// replaycapture.hxx - background processing of flight recorder captures
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef FG_AIRCRAFT_REPLAYCAPTURE_HXX
+#define FG_AIRCRAFT_REPLAYCAPTURE_HXX
+
+#include <simgear/threads/SGThread.hxx>
+
+#include <atomic>
+#include <vector>
+
+#include "replay.hxx"
+
+class FGFlightRecorder;
+
+/**
+ * Single-producer/single-consumer ring of preallocated raw records.
+ * The main loop captures straight into the next free slot, the capture
+ * thread consumes them. No locks are involved on either side.
+ */
+class FGReplayCaptureRing
+{
+public:
+    FGReplayCaptureRing(FGFlightRecorder* pRecorder, unsigned int Size);
+    ~FGReplayCaptureRing();
+
+    /** Producer: get the next free slot, or NULL when the ring is full. */
+    FGReplayData* beginWrite(void);
+    /** Producer: publish the slot obtained by beginWrite. */
+    void endWrite(void);
+
+    /** Consumer: get the oldest published slot, or NULL when empty. */
+    FGReplayData* front(void);
+    /** Consumer: release the slot obtained by front. */
+    void pop(void);
+
+    bool empty(void) const;
+
+private:
+    std::vector<FGReplayData*> m_Slots;
+    std::atomic<unsigned int> m_Head; // next slot to write
+    std::atomic<unsigned int> m_Tail; // next slot to read
+};
+
+/**
+ * Worker thread moving captured records into the replay buffers, doing
+ * all the buffer housekeeping (downsampling, short -> medium -> long term
+ * migration, recycling) off the main loop.
+ */
+class FGReplayCaptureThread : public SGThread
+{
+public:
+    FGReplayCaptureThread(FGReplay* pReplay);
+    ~FGReplayCaptureThread();
+
+    /** Wake the thread (new records are available). */
+    void notify(void);
+    /** Terminate and join the thread. */
+    void stop(void);
+
+    virtual void run();
+
+private:
+    FGReplay* m_pReplay;
+    std::atomic<bool> m_Stop;
+    SGMutex m_WakeMutex;
+    SGWaitCondition m_WakeCondition;
+};
+
+#endif // FG_AIRCRAFT_REPLAYCAPTURE_HXX
@@ -0,0 +1,806 @@
+// replaytape.cxx - indexed, block compressed flight recorder tapes
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <sstream>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/io/iostreams/sgstream.hxx>
+#include <simgear/misc/sg_dir.hxx>
+#include <simgear/props/props_io.hxx>
+#include <simgear/structure/exception.hxx>
+
+#include "replaytape.hxx"
+
+using std::string;
+using std::vector;
+using namespace ReplayTape;
+
+/** Magic string to verify indexed FG flight recorder tapes.
+ * Deliberately differs from the classic tape magic, so older versions
+ * reject indexed tapes instead of misinterpreting them. */
+static const char IndexedTapeMagic[40] = "FlightGear Indexed Flight Recorder Tape";
+
+static const uint32_t IndexedTapeVersion = 1;
+static const uint32_t BlockMagic         = 0x42524746; // "FGRB"
+static const uint32_t IndexMagic         = 0x49524746; // "FGRI"
+
+/** File position of the index offset within the tape header. */
+static const std::streamoff IndexOffsetPos = sizeof(IndexedTapeMagic) + 2*sizeof(uint32_t);
+
+template<typename T>
+static void
+writeValue(std::ostream& output, const T& Value)
+{
+    output.write((const char*) &Value, sizeof(T));
+}
+
+template<typename T>
+static bool
+readValue(std::istream& input, T& Value)
+{
+    input.read((char*) &Value, sizeof(T));
+    return input.good();
+}
+
+/** Compress and write a chunk of data. Returns number of bytes written (0 on error). */
+static uint64_t
+writeChunk(std::ostream& output, const char* pData, size_t Size)
+{
+    uLongf CompressedSize = compressBound(Size);
+    vector<Bytef> Compressed(CompressedSize+1);
+    if (Z_OK != compress2(&Compressed[0], &CompressedSize, (const Bytef*) pData, Size, Z_DEFAULT_COMPRESSION))
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "ReplayTape: Failed to compress " << Size << " bytes of data.");
+        return 0;
+    }
+    writeValue(output, (uint32_t) Size);
+    writeValue(output, (uint32_t) CompressedSize);
+    output.write((const char*) &Compressed[0], CompressedSize);
+    return output.good() ? 2*sizeof(uint32_t) + CompressedSize : 0;
+}
+
+/** Number of bytes between the current position and the end of the input. */
+static uint64_t
+remainingBytes(std::istream& input)
+{
+    std::streampos Pos = input.tellg();
+    input.seekg(0, std::ios::end);
+    std::streampos End = input.tellg();
+    input.seekg(Pos);
+    if ((!input.good())||(End < Pos))
+        return 0;
+    return (uint64_t) (End - Pos);
+}
+
+/** zlib cannot compress data by more than about 1:1032. */
+static const uint64_t MaxCompressionRatio = 1032;
+
+/** Read and uncompress a chunk of data. When ExpectedSize is not zero, the
+ * chunk must uncompress to exactly that many bytes. */
+static bool
+readChunk(std::istream& input, vector<char>& Data, uint64_t ExpectedSize = 0)
+{
+    uint32_t Size = 0, CompressedSize = 0;
+    if (!readValue(input, Size) || !readValue(input, CompressedSize))
+        return false;
+
+    // don't trust the sizes of a truncated or corrupted tape before allocating
+    if ((CompressedSize > remainingBytes(input))||
+        (Size > CompressedSize * MaxCompressionRatio)||
+        ((ExpectedSize)&&(Size != ExpectedSize)))
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "ReplayTape: Invalid data chunk size.");
+        return false;
+    }
+
+    vector<Bytef> Compressed(CompressedSize+1);
+    input.read((char*) &Compressed[0], CompressedSize);
+    if (!input.good())
+        return false;
+
+    Data.resize(Size+1);
+    uLongf UncompressedSize = Size;
+    if ((Z_OK != uncompress((Bytef*) &Data[0], &UncompressedSize, &Compressed[0], CompressedSize))||
+        (UncompressedSize != Size))
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "ReplayTape: Corrupted data chunk.");
+        return false;
+    }
+    Data.resize(Size);
+    return true;
+}
+
+static uint64_t
+writePropertyChunk(std::ostream& output, const SGPropertyNode* pNode)
+{
+    std::stringstream Xml;
+    if (pNode)
+        writeProperties(Xml, pNode, true);
+    string s = Xml.str();
+    return writeChunk(output, s.c_str(), s.size());
+}
+
+static bool
+readPropertyChunk(std::istream& input, SGPropertyNode* pNode, bool Parse)
+{
+    vector<char> Xml;
+    if (!readChunk(input, Xml))
+        return false;
+    if ((!Parse)||(!pNode)||Xml.empty())
+        return true;
+    try
+    {
+        readProperties(&Xml[0], Xml.size(), pNode);
+    } catch (const sg_exception &e)
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "ReplayTape: XML parser message: " << e.getFormattedMessage());
+        return false;
+    }
+    return true;
+}
+
+bool
+ReplayTape::isIndexedTape(const SGPath& Filename)
+{
+    sg_ifstream input(Filename, std::ios::in | std::ios::binary);
+    char Magic[sizeof(IndexedTapeMagic)];
+    input.read(Magic, sizeof(Magic));
+    return input.good() &&
+           (0 == memcmp(Magic, IndexedTapeMagic, sizeof(Magic)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// FGReplayTapeWriter
+///////////////////////////////////////////////////////////////////////////////
+
+FGReplayTapeWriter::FGReplayTapeWriter(double BlockDuration) :
+    m_BlockDuration(BlockDuration),
+    m_RecordSize(0),
+    m_FileSize(0),
+    m_PendingCount(0),
+    m_PendingStart(0.0),
+    m_PendingEnd(0.0)
+{
+}
+
+FGReplayTapeWriter::~FGReplayTapeWriter()
+{
+    close();
+}
+
+bool
+FGReplayTapeWriter::open(const SGPath& Filename, const SGPropertyNode* MetaData,
+                         const SGPropertyNode* Config, size_t RecordSize)
+{
+    close();
+
+    m_RecordSize = RecordSize;
+    m_FileSize = 0;
+    m_PendingCount = 0;
+    m_Pending.clear();
+    m_Index.clear();
+
+    m_Output.reset(new sg_ofstream(Filename, std::ios::out | std::ios::binary | std::ios::trunc));
+    if (!m_Output->good())
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "ReplayTape: Cannot open file " << Filename);
+        m_Output.reset();
+        return false;
+    }
+
+    sg_ofstream& output = *m_Output;
+    output.write(IndexedTapeMagic, sizeof(IndexedTapeMagic));
+    writeValue(output, IndexedTapeVersion);
+    writeValue(output, (uint32_t) m_RecordSize);
+    writeValue(output, (uint64_t) 0); // index offset, patched on close
+    m_FileSize = IndexOffsetPos + sizeof(uint64_t);
+
+    uint64_t Size = writePropertyChunk(output, MetaData);
+    if (Size)
+    {
+        m_FileSize += Size;
+        Size = writePropertyChunk(output, Config);
+        m_FileSize += Size;
+    }
+
+    if (!Size)
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "ReplayTape: Failed to write tape header. Disk full?");
+        m_Output.reset();
+        return false;
+    }
+
+    output.flush();
+    return true;
+}
+
+bool
+FGReplayTapeWriter::append(const FGReplayData* pRecord)
+{
+    if (!isOpen())
+        return false;
+
+    if ((m_PendingCount > 0)&&
+        (pRecord->sim_time - m_PendingStart >= m_BlockDuration))
+    {
+        if (!flush())
+            return false;
+    }
+
+    if (m_PendingCount == 0)
+        m_PendingStart = pRecord->sim_time;
+    m_PendingEnd = pRecord->sim_time;
+
+    const char* p = (const char*) pRecord;
+    m_Pending.insert(m_Pending.end(), p, p + m_RecordSize);
+    m_PendingCount++;
+    return true;
+}
+
+/** Compress and write all pending records as a new block. */
+bool
+FGReplayTapeWriter::flush(void)
+{
+    if ((!isOpen())||(m_PendingCount == 0))
+        return isOpen();
+
+    sg_ofstream& output = *m_Output;
+
+    BlockInfo Info;
+    Info.StartTime   = m_PendingStart;
+    Info.EndTime     = m_PendingEnd;
+    Info.Offset      = m_FileSize;
+    Info.RecordCount = m_PendingCount;
+
+    writeValue(output, BlockMagic);
+    writeValue(output, Info.RecordCount);
+    writeValue(output, Info.StartTime);
+    writeValue(output, Info.EndTime);
+    uint64_t Size = writeChunk(output, &m_Pending[0], m_Pending.size());
+    if (!Size)
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "ReplayTape: Failed to write data block. Disk full?");
+        return false;
+    }
+
+    // make sure the block hits the disk, so it survives a crash
+    output.flush();
+
+    m_FileSize += 2*sizeof(uint32_t) + 2*sizeof(double) + Size;
+    m_Index.push_back(Info);
+    m_Pending.clear();
+    m_PendingCount = 0;
+    return true;
+}
+
+bool
+FGReplayTapeWriter::writeIndex(void)
+{
+    sg_ofstream& output = *m_Output;
+    uint64_t IndexOffset = m_FileSize;
+
+    writeValue(output, IndexMagic);
+    writeValue(output, (uint32_t) m_Index.size());
+    for (size_t i=0; i<m_Index.size(); ++i)
+    {
+        writeValue(output, m_Index[i].StartTime);
+        writeValue(output, m_Index[i].EndTime);
+        writeValue(output, m_Index[i].Offset);
+        writeValue(output, m_Index[i].RecordCount);
+    }
+    if (!output.good())
+        return false;
+
+    // finally point the header to the index
+    output.seekp(IndexOffsetPos);
+    writeValue(output, IndexOffset);
+    output.seekp(0, std::ios::end);
+    return output.good();
+}
+
+bool
+FGReplayTapeWriter::close(void)
+{
+    if (!isOpen())
+        return true;
+
+    bool ok = flush();
+    if (ok)
+        ok = writeIndex();
+    if (!ok)
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "ReplayTape: Failed to write tape index. Disk full?");
+
+    m_Output->close();
+    m_Output.reset();
+    return ok;
+}
+
+double
+FGReplayTapeWriter::getStartTime(void) const
+{
+    if (!m_Index.empty())
+        return m_Index.front().StartTime;
+    return (m_PendingCount) ? m_PendingStart : 0.0;
+}
+
+double
+FGReplayTapeWriter::getEndTime(void) const
+{
+    if (m_PendingCount)
+        return m_PendingEnd;
+    return (m_Index.empty()) ? 0.0 : m_Index.back().EndTime;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// FGReplayTapeStream
+///////////////////////////////////////////////////////////////////////////////
+
+static bool
+olderFile(const SGPath& a, const SGPath& b)
+{
+    return a.modTime() < b.modTime();
+}
+
+FGReplayTapeStream::FGReplayTapeStream(const SGPath& Directory, const string& Prefix,
+                                       double SegmentDuration, double FlushInterval, uint64_t MaxDiskSize) :
+    m_Directory(Directory),
+    m_Prefix(Prefix),
+    m_SegmentDuration(SegmentDuration),
+    m_MaxDiskSize(MaxDiskSize),
+    m_RecordSize(0),
+    m_SegmentCount(0),
+    m_Writer(FlushInterval)
+{
+}
+
+FGReplayTapeStream::~FGReplayTapeStream()
+{
+    stop();
+}
+
+bool
+FGReplayTapeStream::start(const SGPropertyNode* MetaData, const SGPropertyNode* Config, size_t RecordSize)
+{
+    stop();
+
+    simgear::Dir dir(m_Directory);
+    if (!dir.exists())
+        dir.create(0755);
+
+    // segments of earlier sessions count against the quota as well
+    m_Segments.clear();
+    simgear::PathList list = dir.children(simgear::Dir::TYPE_FILE, ".fgtape");
+    for (simgear::PathList::iterator it = list.begin(); it != list.end(); ++it)
+    {
+        if (it->file().compare(0, m_Prefix.size(), m_Prefix) == 0)
+            m_Segments.push_back(*it);
+    }
+    std::sort(m_Segments.begin(), m_Segments.end(), olderFile);
+
+    m_MetaData = new SGPropertyNode();
+    copyProperties(MetaData, m_MetaData);
+    m_Config = new SGPropertyNode();
+    copyProperties(Config, m_Config);
+    m_RecordSize = RecordSize;
+    m_SegmentCount = 0;
+
+    enforceQuota();
+    return true;
+}
+
+void
+FGReplayTapeStream::stop(void)
+{
+    closeSegment();
+    m_MetaData = 0;
+    m_Config = 0;
+}
+
+bool
+FGReplayTapeStream::openSegment(void)
+{
+    time_t calendar_time = time(NULL);
+    char time_str[256];
+    strftime(time_str, 256, "%Y%m%d-%H%M%S", localtime(&calendar_time));
+
+    std::ostringstream name;
+    name << m_Prefix << time_str << "-" << m_SegmentCount++ << ".fgtape";
+    m_CurrentSegment = m_Directory;
+    m_CurrentSegment.append(name.str());
+
+    SG_LOG(SG_SYSTEMS, SG_INFO, "ReplayTape: Opening black box segment " << m_CurrentSegment);
+    return m_Writer.open(m_CurrentSegment, m_MetaData, m_Config, m_RecordSize);
+}
+
+void
+FGReplayTapeStream::closeSegment(void)
+{
+    if (!m_Writer.isOpen())
+        return;
+    m_Writer.close();
+    m_Segments.push_back(m_CurrentSegment);
+    enforceQuota();
+}
+
+/** Delete oldest segments until total disk usage is within the quota.
+ * Checked whenever a segment is closed, so the quota may temporarily be
+ * exceeded by up to one segment. */
+void
+FGReplayTapeStream::enforceQuota(void)
+{
+    // a closed segment is already in m_Segments, and the writer keeps
+    // reporting its size until the next one is opened
+    uint64_t TotalSize = (m_Writer.isOpen()) ? m_Writer.getFileSize() : 0;
+    for (size_t i=0; i<m_Segments.size(); ++i)
+        TotalSize += m_Segments[i].sizeInBytes();
+
+    while ((TotalSize > m_MaxDiskSize)&&(!m_Segments.empty()))
+    {
+        SGPath Oldest = m_Segments.front();
+        m_Segments.pop_front();
+        TotalSize -= std::min<uint64_t>(TotalSize, Oldest.sizeInBytes());
+        SG_LOG(SG_SYSTEMS, SG_INFO, "ReplayTape: Disk quota exceeded, removing black box segment " << Oldest);
+        Oldest.remove();
+    }
+}
+
+bool
+FGReplayTapeStream::append(const FGReplayData* pRecord)
+{
+    if (!m_Config.valid())
+        return false;
+
+    if ((m_Writer.isOpen())&&
+        (pRecord->sim_time - m_Writer.getStartTime() >= m_SegmentDuration))
+    {
+        closeSegment();
+    }
+
+    if ((!m_Writer.isOpen())&&(!openSegment()))
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "ReplayTape: Cannot write black box segment. Black box stopped.");
+        stop();
+        return false;
+    }
+
+    return m_Writer.append(pRecord);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// FGReplayTapeReader
+///////////////////////////////////////////////////////////////////////////////
+
+FGReplayTapeReader::FGReplayTapeReader(size_t MaxCachedBlocks) :
+    m_RecordSize(0),
+    // at least two blocks, since we interpolate across block boundaries
+    m_MaxCachedBlocks(std::max<size_t>(MaxCachedBlocks, 2))
+{
+}
+
+FGReplayTapeReader::~FGReplayTapeReader()
+{
+    close();
+}
+
+void
+FGReplayTapeReader::close(void)
+{
+    m_Cache.clear();
+    m_Index.clear();
+    m_Input.reset();
+    m_RecordSize = 0;
+}
+
+/** Open an indexed tape. Only reads meta data when Config is NULL. */
+bool
+FGReplayTapeReader::open(const SGPath& Filename, SGPropertyNode* MetaData, SGPropertyNode* Config)
+{
+    close();
+
+    m_Input.reset(new sg_ifstream(Filename, std::ios::in | std::ios::binary));
+    sg_ifstream& input = *m_Input;
+
+    char Magic[sizeof(IndexedTapeMagic)];
+    uint32_t Version = 0, RecordSize = 0;
+    uint64_t IndexOffset = 0;
+    input.read(Magic, sizeof(Magic));
+    if ((!input.good())||
+        (0 != memcmp(Magic, IndexedTapeMagic, sizeof(Magic)))||
+        (!readValue(input, Version))||
+        (!readValue(input, RecordSize))||
+        (!readValue(input, IndexOffset)))
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "File not recognized. This is not a valid FlightGear flight recorder tape: " << Filename);
+        close();
+        return false;
+    }
+
+    if (Version > IndexedTapeVersion)
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "Flight recorder tape " << Filename << " has unsupported version " << Version);
+        close();
+        return false;
+    }
+
+    if ((!readPropertyChunk(input, MetaData, true))||
+        (!readPropertyChunk(input, Config, Config != NULL)))
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "Error reading flight recorder tape: " << Filename << ". Invalid meta data.");
+        close();
+        return false;
+    }
+
+    if (!Config)
+    {
+        // preview mode: meta data only
+        return true;
+    }
+
+    if (RecordSize < sizeof(FGReplayData))
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "Flight recorder tape " << Filename << " has invalid record size " << RecordSize);
+        close();
+        return false;
+    }
+
+    m_RecordSize = RecordSize;
+    uint64_t FirstBlock = input.tellg();
+    bool ok = (IndexOffset) ? readIndex(IndexOffset) : false;
+    if (!ok)
+    {
+        SG_LOG(SG_SYSTEMS, SG_WARN, "Flight recorder tape " << Filename << " has no index (not closed properly?). Scanning data blocks.");
+        ok = scanBlocks(FirstBlock);
+    }
+
+    if (!ok)
+        close();
+    else
+        SG_LOG(SG_SYSTEMS, SG_DEBUG, "ReplayTape: " << m_Index.size() << " blocks, record size " << m_RecordSize);
+
+    return ok;
+}
+
+bool
+FGReplayTapeReader::readIndex(uint64_t IndexOffset)
+{
+    sg_ifstream& input = *m_Input;
+    input.clear();
+    input.seekg(IndexOffset);
+
+    uint32_t Magic = 0, Count = 0;
+    if ((!readValue(input, Magic))||(Magic != IndexMagic)||
+        (!readValue(input, Count)))
+    {
+        return false;
+    }
+
+    const uint64_t EntrySize = 2*sizeof(double) + sizeof(uint64_t) + sizeof(uint32_t);
+    if ((uint64_t) Count * EntrySize > remainingBytes(input))
+    {
+        SG_LOG(SG_SYSTEMS, SG_WARN, "ReplayTape: Index size exceeds the file size.");
+        return false;
+    }
+
+    m_Index.resize(Count);
+    for (uint32_t i=0; i<Count; ++i)
+    {
+        BlockInfo& Info = m_Index[i];
+        if ((!readValue(input, Info.StartTime))||
+            (!readValue(input, Info.EndTime))||
+            (!readValue(input, Info.Offset))||
+            (!readValue(input, Info.RecordCount)))
+        {
+            m_Index.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Rebuild the block index from the self-describing block headers.
+ * A truncated trailing block (e.g. after a crash) is ignored. */
+bool
+FGReplayTapeReader::scanBlocks(uint64_t FirstBlock)
+{
+    sg_ifstream& input = *m_Input;
+    input.clear();
+    input.seekg(0, std::ios::end);
+    uint64_t FileSize = input.tellg();
+
+    m_Index.clear();
+    uint64_t Offset = FirstBlock;
+    while (Offset < FileSize)
+    {
+        input.clear();
+        input.seekg(Offset);
+        BlockInfo Info;
+        uint32_t Magic = 0, Size = 0, CompressedSize = 0;
+        Info.Offset = Offset;
+        if ((!readValue(input, Magic))||(Magic != BlockMagic)||
+            (!readValue(input, Info.RecordCount))||
+            (!readValue(input, Info.StartTime))||
+            (!readValue(input, Info.EndTime))||
+            (!readValue(input, Size))||
+            (!readValue(input, CompressedSize)))
+        {
+            break;
+        }
+        Offset = (uint64_t) input.tellg() + CompressedSize;
+        if (Offset > FileSize)
+        {
+            SG_LOG(SG_SYSTEMS, SG_WARN, "ReplayTape: Ignoring truncated data block.");
+            break;
+        }
+        m_Index.push_back(Info);
+    }
+
+    return !m_Index.empty();
+}
+
+size_t
+FGReplayTapeReader::getRecordCount(void) const
+{
+    size_t Count = 0;
+    for (size_t i=0; i<m_Index.size(); ++i)
+        Count += m_Index[i].RecordCount;
+    return Count;
+}
+
+double
+FGReplayTapeReader::getStartTime(void) const
+{
+    return (m_Index.empty()) ? 0.0 : m_Index.front().StartTime;
+}
+
+double
+FGReplayTapeReader::getEndTime(void) const
+{
+    return (m_Index.empty()) ? 0.0 : m_Index.back().EndTime;
+}
+
+/** Get the decompressed block. Keeps a small LRU cache of blocks. */
+const FGReplayTapeReader::Block*
+FGReplayTapeReader::getBlock(size_t BlockIndex)
+{
+    for (std::list<Block>::iterator it = m_Cache.begin(); it != m_Cache.end(); ++it)
+    {
+        if (it->Index == BlockIndex)
+        {
+            m_Cache.splice(m_Cache.begin(), m_Cache, it);
+            return &m_Cache.front();
+        }
+    }
+
+    const BlockInfo& Info = m_Index[BlockIndex];
+    sg_ifstream& input = *m_Input;
+    input.clear();
+    input.seekg(Info.Offset + 2*sizeof(uint32_t) + 2*sizeof(double));
+
+    vector<char> Raw;
+    uint64_t BlockSize = (uint64_t) Info.RecordCount * m_RecordSize;
+    if ((!BlockSize)||
+        (!readChunk(input, Raw, BlockSize)))
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "ReplayTape: Failed to read data block " << BlockIndex);
+        return NULL;
+    }
+
+    if (m_Cache.size() >= m_MaxCachedBlocks)
+        m_Cache.pop_back();
+
+    m_Cache.push_front(Block());
+    Block& block = m_Cache.front();
+    block.Index = BlockIndex;
+    block.Stride = (m_RecordSize + sizeof(double) - 1) & ~(sizeof(double) - 1);
+    block.RecordCount = Info.RecordCount;
+    block.Data.resize(block.Stride * block.RecordCount / sizeof(double) + 1);
+    char* pData = (char*) &block.Data[0];
+    for (uint32_t i=0; i<block.RecordCount; ++i)
+        memcpy(pData + i*block.Stride, &Raw[i*m_RecordSize], m_RecordSize);
+
+    return &block;
+}
+
+/** Find first record in block with sim_time >= Time. */
+const FGReplayData*
+FGReplayTapeReader::findRecord(const Block* pBlock, double Time, size_t& Pos)
+{
+    size_t first = 0;
+    size_t last = pBlock->RecordCount;
+    while (first < last)
+    {
+        size_t mid = (first + last) / 2;
+        if (pBlock->record(mid)->sim_time < Time)
+            first = mid + 1;
+        else
+            last = mid;
+    }
+    if (first >= pBlock->RecordCount)
+        first = pBlock->RecordCount - 1;
+    Pos = first;
+    return pBlock->record(first);
+}
+
+bool
+FGReplayTapeReader::getFrames(double Time, const FGReplayData*& pNext, const FGReplayData*& pLast)
+{
+    pNext = pLast = NULL;
+    if (m_Index.empty())
+        return false;
+
+    if (Time <= m_Index.front().StartTime)
+    {
+        // replay the oldest frame
+        const Block* pBlock = getBlock(0);
+        if (pBlock)
+            pNext = pBlock->record(0);
+        return pNext != NULL;
+    }
+
+    if (Time >= m_Index.back().EndTime)
+    {
+        // replay the most recent frame
+        const Block* pBlock = getBlock(m_Index.size()-1);
+        if (pBlock)
+            pNext = pBlock->record(pBlock->RecordCount-1);
+        return pNext != NULL;
+    }
+
+    // binary search for the last block starting before the given time
+    size_t first = 0;
+    size_t last = m_Index.size();
+    while (last - first > 1)
+    {
+        size_t mid = (first + last) / 2;
+        if (m_Index[mid].StartTime <= Time)
+            first = mid;
+        else
+            last = mid;
+    }
+
+    const Block* pBlock = getBlock(first);
+    if (!pBlock)
+        return false;
+
+    if (Time > m_Index[first].EndTime)
+    {
+        // between two blocks: interpolate last frame of this block with
+        // first frame of the next one
+        const Block* pNextBlock = getBlock(first+1);
+        if (!pNextBlock)
+            return false;
+        pLast = pBlock->record(pBlock->RecordCount-1);
+        pNext = pNextBlock->record(0);
+        return true;
+    }
+
+    size_t Pos = 0;
+    pNext = findRecord(pBlock, Time, Pos);
+    if (Pos > 0)
+        pLast = pBlock->record(Pos-1);
+    return true;
+}
@@ -0,0 +1,213 @@
+// replaytape.hxx - indexed, block compressed flight recorder tapes
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef FG_AIRCRAFT_REPLAYTAPE_HXX
+#define FG_AIRCRAFT_REPLAYTAPE_HXX
+
+#include <simgear/misc/sg_path.hxx>
+#include <simgear/misc/stdint.hxx>
+#include <simgear/props/props.hxx>
+
+#include <deque>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "replay.hxx"
+
+class sg_ofstream;
+class sg_ifstream;
+
+/**
+ * Indexed flight recorder tapes.
+ *
+ * Unlike the classic tape format (a single gzContainer stream holding the
+ * complete short/medium/long term buffers), an indexed tape is made of
+ * independently compressed blocks, each covering a fixed duration of
+ * simulation time. The file header points to a time index, so a reader can
+ * jump straight to the block containing any given time and only needs to
+ * keep the blocks around the replay cursor in memory.
+ *
+ * File layout (native byte order, like the raw records themselves):
+ *
+ *   magic string, version, record size, index offset
+ *   compressed meta data XML
+ *   compressed recorder configuration XML
+ *   block 0 .. block n-1    (header + zlib compressed records)
+ *   index                   (start/end time, offset, record count per block)
+ *
+ * The index offset is patched into the header when the tape is closed. A
+ * tape without index (i.e. the writer never closed it) is still readable:
+ * each block is self-describing, so the reader rebuilds the index by
+ * scanning the block headers.
+ */
+namespace ReplayTape
+{
+    struct BlockInfo
+    {
+        double   StartTime;
+        double   EndTime;
+        uint64_t Offset;
+        uint32_t RecordCount;
+    };
+
+    typedef std::vector<BlockInfo> BlockIndex;
+
+    /** Check whether the given file is an indexed flight recorder tape. */
+    bool isIndexedTape(const SGPath& Filename);
+}
+
+/**
+ * Writes an indexed tape. Records must be appended in chronological order.
+ */
+class FGReplayTapeWriter
+{
+public:
+    FGReplayTapeWriter(double BlockDuration = 60.0);
+    ~FGReplayTapeWriter();
+
+    bool open(const SGPath& Filename, const SGPropertyNode* MetaData,
+              const SGPropertyNode* Config, size_t RecordSize);
+    bool append(const FGReplayData* pRecord);
+    bool flush(void);
+    bool close(void);
+
+    bool isOpen(void) const { return m_Output.get() != NULL; }
+    uint64_t getFileSize(void) const { return m_FileSize; }
+    double getStartTime(void) const;
+    double getEndTime(void) const;
+
+private:
+    bool writeIndex(void);
+
+    std::unique_ptr<sg_ofstream> m_Output;
+    double m_BlockDuration;
+    size_t m_RecordSize;
+    uint64_t m_FileSize;
+    std::vector<char> m_Pending;
+    uint32_t m_PendingCount;
+    double m_PendingStart;
+    double m_PendingEnd;
+    ReplayTape::BlockIndex m_Index;
+};
+
+/**
+ * Continuously streams records to a rolling set of indexed tape segments
+ * ("black box" mode). Each segment is a regular indexed tape, so it can be
+ * loaded like any other tape. Blocks are flushed to disk at least every
+ * FlushInterval seconds, so a crash loses no more than that - segments
+ * which were never closed are recovered by scanning their blocks.
+ * The oldest segments are deleted when the disk quota is exceeded.
+ */
+class FGReplayTapeStream
+{
+public:
+    FGReplayTapeStream(const SGPath& Directory, const std::string& Prefix,
+                       double SegmentDuration, double FlushInterval, uint64_t MaxDiskSize);
+    ~FGReplayTapeStream();
+
+    bool start(const SGPropertyNode* MetaData, const SGPropertyNode* Config, size_t RecordSize);
+    bool append(const FGReplayData* pRecord);
+    void stop(void);
+
+private:
+    bool openSegment(void);
+    void closeSegment(void);
+    void enforceQuota(void);
+
+    SGPath m_Directory;
+    std::string m_Prefix;
+    double m_SegmentDuration;
+    uint64_t m_MaxDiskSize;
+    size_t m_RecordSize;
+    unsigned int m_SegmentCount;
+    SGPropertyNode_ptr m_MetaData;
+    SGPropertyNode_ptr m_Config;
+    FGReplayTapeWriter m_Writer;
+    SGPath m_CurrentSegment;
+    std::deque<SGPath> m_Segments; // closed segments, oldest first
+};
+
+/**
+ * Provides lazy, random access to the records of an indexed tape.
+ * Only a few decompressed blocks are kept in memory at any time.
+ */
+class FGReplayTapeReader
+{
+public:
+    FGReplayTapeReader(size_t MaxCachedBlocks = 3);
+    ~FGReplayTapeReader();
+
+    bool open(const SGPath& Filename, SGPropertyNode* MetaData, SGPropertyNode* Config);
+    void close(void);
+
+    size_t getRecordSize(void) const { return m_RecordSize; }
+    size_t getRecordCount(void) const;
+    double getStartTime(void) const;
+    double getEndTime(void) const;
+
+    /** Find the two records bracketing the given time.
+     * pLast is NULL when time is outside of the recorded range, in
+     * which case pNext is the nearest record. Returns false when the
+     * tape has no records (or data could not be read). */
+    bool getFrames(double Time, const FGReplayData*& pNext, const FGReplayData*& pLast);
+
+    /** Iterate all records in chronological order (used to restore
+     * in-memory buffers from a tape). */
+    template<class Visitor>
+    bool forEachRecord(Visitor& visit)
+    {
+        for (size_t b=0; b<m_Index.size(); ++b)
+        {
+            const Block* pBlock = getBlock(b);
+            if (!pBlock)
+                return false;
+            for (uint32_t r=0; r<pBlock->RecordCount; ++r)
+                visit(pBlock->record(r));
+        }
+        return true;
+    }
+
+private:
+    struct Block
+    {
+        size_t Index;
+        size_t Stride;
+        uint32_t RecordCount;
+        std::vector<double> Data; // double based, to keep records 64bit aligned
+
+        const FGReplayData* record(size_t i) const
+        {
+            return (const FGReplayData*) (((const char*) &Data[0]) + i*Stride);
+        }
+    };
+
+    bool readIndex(uint64_t IndexOffset);
+    bool scanBlocks(uint64_t FirstBlock);
+    const Block* getBlock(size_t BlockIndex);
+    const FGReplayData* findRecord(const Block* pBlock, double Time, size_t& Pos);
+
+    std::unique_ptr<sg_ifstream> m_Input;
+    size_t m_RecordSize;
+    size_t m_MaxCachedBlocks;
+    ReplayTape::BlockIndex m_Index;
+    std::list<Block> m_Cache; // most recently used first
+};
+
+#endif // FG_AIRCRAFT_REPLAYTAPE_HXX
@@ -189,15 +189,12 @@ private:
 #if !defined(FG_TESTLIB)
         SGVec3d cartAirportPos = m_airport->cart();
         FGAIManager* aiManager = globals->get_subsystem<FGAIManager>();
-        for (auto ai : aiManager->get_ai_list()) {
-            const auto cart = ai->getCartPos();
 
-            // 20km cutoff from airport centre
-            if (dist(cartAirportPos, cart) > 20000) {
-                continue;
-            }
-
-            m_cache.push_back(cart);
+        // 20km cutoff from airport centre
+        FGAISpatialIndex::ResultList nearby;
+        aiManager->findObjectsInRange(cartAirportPos, 20000, nearby);
+        for (auto ai : nearby) {
+            m_cache.push_back(ai->getCartPos());
         }
 #endif
         m_populated = true;
@@ -98,6 +98,7 @@ private:
     SGPropertyNode_ptr _positionLongitudeNode;
 
     deque<double> _elevations;
+    FGElevationService::RequestRef _request; // samples being computed
     simgear::TiedPropertyList _tiedProperties;
 };
 
@@ -172,6 +173,7 @@ void AreaSampler::init()
 {
    _signalNode->setBoolValue(false);
    _elevations.clear();
+   _request.clear();
    _altOffset = 0.0;
    _altMedian = 0.0;
    _altMin = 0.0;
@@ -220,28 +222,43 @@ void AreaSampler::update( double dt )
     if( _signalNode->getBoolValue() )
         return; // nothing to do.
 
-    FGScenery * scenery = globals->get_scenery();
+    if( _request ) {
+        // wait for the scenery to compute the last batch of samples
+        if( !_request->isDone() )
+            return;
 
-    SGTimeStamp start = SGTimeStamp::now();
-    while( (SGTimeStamp::now() - start).toSecs() < dt * _max_computation_time_norm ) {
-        // sample until we used up all our configured time
-        double distance = sg_random();
-        distance = _radius * (1-distance*distance);
-        double course = sg_random() * 2.0 * SG_PI;
-        SGGeod probe = SGGeod::fromGeoc(center.advanceRadM( course, distance ));
-        double elevation_m = 0.0;
+        const FGElevationService::ResultList& results = _request->getResults();
+        for( FGElevationService::ResultList::size_type i = 0; i < results.size(); i++ ) {
+            if( results[i].valid )
+                _elevations.push_front(results[i].elevationM * SG_METER_TO_FEET);
+        }
+        _request.clear();
 
-        if (scenery->get_elevation_m( probe, elevation_m, NULL )) 
-            _elevations.push_front(elevation_m *= SG_METER_TO_FEET);
-        
         if( _elevations.size() >= (deque<unsigned>::size_type)_max_samples ) {
-            // sampling complete? 
+            // sampling complete
             analyse();
             _outputPosition = _inputPosition;
             _signalNode->setBoolValue( true );
-            break;
+            return;
         }
     }
+
+    // the scenery answers the batch during its next update while the main
+    // thread waits, so only queue as many samples as fit into our share of
+    // the frame. Start small until the cost of a sample is known.
+    FGScenery * scenery = globals->get_scenery();
+    double queryTime = scenery->get_elevation_query_time_sec();
+    int count = queryTime > 0.0 ? (int)(dt * _max_computation_time_norm / queryTime) : 16;
+    count = SGMisc<int>::clip( count, 1, _max_samples - (int)_elevations.size() );
+
+    vector<SGGeod> probes;
+    for( int i = 0; i < count; i++ ) {
+        double distance = sg_random();
+        distance = _radius * (1-distance*distance);
+        double course = sg_random() * 2.0 * SG_PI;
+        probes.push_back(SGGeod::fromGeoc(center.advanceRadM( course, distance )));
+    }
+    _request = scenery->get_elevations_m( probes );
 }
 
 void AreaSampler::analyse()
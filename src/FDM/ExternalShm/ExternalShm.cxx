@@ -0,0 +1,251 @@
+// ExternalShm.cxx -- a shared memory interface to an external flight
+//                    dynamics model on the same host
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#ifdef HAVE_SHM_OPEN
+#  include <sys/mman.h>         // shm_open(), mmap()
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>           // ftruncate(), close()
+#endif
+
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <new>
+
+#include <simgear/debug/logstream.hxx>
+
+#include <Main/fg_props.hxx>
+#include <Network/native_ctrls.hxx>
+#include <Network/native_fdm.hxx>
+
+#include "ExternalShm.hxx"
+
+// give up waiting for the answer of the FDM after this
+static const long FDM_TIMEOUT_USEC = 1000000;
+
+FGExternalShm::FGExternalShm( double dt, std::string name, long spin_usec ) :
+    _name( name ),
+    _spin_usec( spin_usec ),
+    _segment( NULL ),
+    _pending( 0 ),
+    _timed_out( false ),
+    _last_weight( 0.0 ),
+    _last_cg_offset( -9999.9 )
+{
+    memset( &_msg, 0, sizeof(_msg) );
+    memset( &_fdm, 0, sizeof(_fdm) );
+
+#ifdef HAVE_SHM_OPEN
+    SG_LOG( SG_IO, SG_INFO, "ExternalShm inited with " << _name );
+
+    int fd = shm_open( _name.c_str(), O_CREAT | O_RDWR, 0644 );
+    if ( fd == -1 ) {
+        SG_LOG( SG_IO, SG_ALERT, "Unable to open shared memory object: "
+                << _name << ": " << strerror(errno) );
+        return;
+    }
+    if ( ftruncate( fd, sizeof(FGShmFDMSegment) ) == -1 ) {
+        SG_LOG( SG_IO, SG_ALERT, "Unable to size shared memory object: "
+                << _name << ": " << strerror(errno) );
+        close( fd );
+        return;
+    }
+    void *mem = mmap( NULL, sizeof(FGShmFDMSegment), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( mem == MAP_FAILED ) {
+        SG_LOG( SG_IO, SG_ALERT, "Unable to map shared memory object: "
+                << _name << ": " << strerror(errno) );
+        return;
+    }
+
+    // the FDM may already be attached, it waits for the magic number
+    _segment = new (mem) FGShmFDMSegment;
+    _segment->magic.store( 0 );
+    _segment->version = FG_SHM_FDM_VERSION;
+    _segment->ctrls.init();
+    _segment->fdm.init();
+    _segment->magic.store( FG_SHM_FDM_MAGIC );
+#else
+    SG_LOG( SG_IO, SG_ALERT, "ExternalShm: shared memory is not supported"
+            " on this platform" );
+#endif
+}
+
+
+FGExternalShm::~FGExternalShm() {
+#ifdef HAVE_SHM_OPEN
+    if ( _segment ) {
+        _segment->magic.store( 0 );
+        munmap( _segment, sizeof(FGShmFDMSegment) );
+    }
+#endif
+}
+
+
+bool FGExternalShm::send_command( const char *cmd ) {
+    FGShmFDMMessage msg;
+    msg.type = FGShmFDMMessage::FG_SHM_COMMAND;
+    msg.iterations = 0;
+    strncpy( msg.command, cmd, sizeof(msg.command) - 1 );
+    msg.command[sizeof(msg.command) - 1] = '\0';
+
+    if ( !_segment->ctrls.push( msg ) ) {
+        SG_LOG( SG_IO, SG_ALERT, "ExternalShm: controls ring full, dropped "
+                << cmd );
+        return false;
+    }
+    return true;
+}
+
+
+// Initialize the ExternalShm flight model, dt is the time increment
+// for each subsequent iteration through the EOM
+void FGExternalShm::init() {
+    // Explicitly call the superclass's
+    // init method first.
+    common_init();
+
+    if ( !_segment ) {
+        return;
+    }
+
+    double lon = fgGetDouble( "/sim/presets/longitude-deg" );
+    double lat = fgGetDouble( "/sim/presets/latitude-deg" );
+    double alt = fgGetDouble( "/sim/presets/altitude-ft" );
+    double ground = get_Runway_altitude_m();
+    double heading = fgGetDouble("/sim/presets/heading-deg");
+    double speed = fgGetDouble( "/sim/presets/airspeed-kt" );
+    double weight = fgGetDouble( "/sim/aircraft-weight-lbs" );
+    double cg_offset = fgGetDouble( "/sim/aircraft-cg-offset-inches" );
+
+    char cmd[256];
+
+    snprintf( cmd, sizeof(cmd), "longitude-deg=%.8f", lon );
+    send_command( cmd );
+
+    snprintf( cmd, sizeof(cmd), "latitude-deg=%.8f", lat );
+    send_command( cmd );
+
+    snprintf( cmd, sizeof(cmd), "altitude-ft=%.8f", alt );
+    send_command( cmd );
+
+    snprintf( cmd, sizeof(cmd), "ground-m=%.8f", ground );
+    send_command( cmd );
+
+    snprintf( cmd, sizeof(cmd), "speed-kts=%.8f", speed );
+    send_command( cmd );
+
+    snprintf( cmd, sizeof(cmd), "heading-deg=%.8f", heading );
+    send_command( cmd );
+
+    if ( weight > 1000.0 ) {
+        snprintf( cmd, sizeof(cmd), "aircraft-weight-lbs=%.2f", weight );
+        send_command( cmd );
+    }
+    _last_weight = weight;
+
+    snprintf( cmd, sizeof(cmd), "aircraft-cg-offset-inches=%.2f", cg_offset );
+    send_command( cmd );
+    _last_cg_offset = cg_offset;
+
+    if( fgGetBool("/sim/presets/onground") ) {
+        send_command( "reset=ground" );
+    } else {
+        send_command( "reset=air" );
+    }
+
+    SG_LOG( SG_IO, SG_INFO, "Remote FDM init() finished." );
+}
+
+
+// Run an iteration of the EOM.
+void FGExternalShm::update( double dt ) {
+    if ( !_segment || is_suspended() ) {
+        return;
+    }
+
+    // Late answers to frames which timed out.  Don't queue more controls
+    // while the FDM is still behind, it would have to catch up on them.
+    bool have_fdm = false;
+    while ( _segment->fdm.pop( _fdm ) ) {
+        have_fdm = true;
+        if ( _pending > 0 ) {
+            --_pending;
+        }
+    }
+    if ( _pending > 0 ) {
+        if ( have_fdm ) {
+            FGNetFDM2Props( &_fdm, false );
+        }
+        return;
+    }
+
+    int iterations = _calc_multiloop(dt);
+
+    char cmd[256];
+    double weight = fgGetDouble( "/sim/aircraft-weight-lbs" );
+    if ( fabs( weight - _last_weight ) > 0.01 ) {
+        snprintf( cmd, sizeof(cmd), "aircraft-weight-lbs=%.2f", weight );
+        send_command( cmd );
+    }
+    _last_weight = weight;
+
+    double cg_offset = fgGetDouble( "/sim/aircraft-cg-offset-inches" );
+    if ( fabs( cg_offset - _last_cg_offset ) > 0.01 ) {
+        snprintf( cmd, sizeof(cmd), "aircraft-cg-offset-inches=%.2f", cg_offset );
+        send_command( cmd );
+    }
+    _last_cg_offset = cg_offset;
+
+    // Send control positions to remote fdm
+    _msg.type = FGShmFDMMessage::FG_SHM_CTRLS;
+    _msg.iterations = iterations;
+    FGProps2NetCtrls( &_msg.ctrls, true, false );
+    if ( !_segment->ctrls.push( _msg ) ) {
+        SG_LOG( SG_IO, SG_DEBUG, "ExternalShm: controls ring full" );
+        return;
+    }
+    ++_pending;
+
+    // Wait for the answer
+    if ( !_segment->fdm.wait( _spin_usec, FDM_TIMEOUT_USEC ) ) {
+        if ( !_timed_out ) {
+            SG_LOG( SG_IO, SG_ALERT, "ExternalShm: no answer from the FDM on "
+                    << _name );
+            _timed_out = true;
+        }
+        return;
+    }
+    if ( _timed_out ) {
+        SG_LOG( SG_IO, SG_ALERT, "ExternalShm: the FDM answers again" );
+        _timed_out = false;
+    }
+
+    while ( _segment->fdm.pop( _fdm ) ) {
+        if ( _pending > 0 ) {
+            --_pending;
+        }
+    }
+    FGNetFDM2Props( &_fdm, false );
+}
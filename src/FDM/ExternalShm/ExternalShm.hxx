@@ -0,0 +1,66 @@
+// ExternalShm.hxx -- a shared memory interface to an external flight
+//                    dynamics model on the same host
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifndef _EXTERNAL_SHM_HXX
+#define _EXTERNAL_SHM_HXX
+
+#include <Network/shm_fdm.hxx>
+#include <FDM/flight.hxx>
+
+
+// Exchanges FGNetCtrls and FGNetFDM with the external FDM through the
+// rings of a shared memory segment (see Network/shm_fdm.hxx), which avoids
+// the system calls and copies of ExternalPipe and ExternalNet when the
+// FDM runs on the same host.  Selected with --fdm=shm,<name>[,<spin-usec>]
+// where name is the shared memory object name, e.g. /fgfs-fdm, and
+// spin-usec how long to spin for the answer of the FDM before blocking.
+class FGExternalShm: public FGInterface {
+
+private:
+
+    std::string _name;
+    long _spin_usec;
+    FGShmFDMSegment *_segment;
+
+    FGShmFDMMessage _msg;
+    FGNetFDM _fdm;
+    int _pending;               // controls sent but not answered yet
+    bool _timed_out;
+
+    double _last_weight;
+    double _last_cg_offset;
+
+    bool send_command( const char *cmd );
+
+public:
+
+    // Constructor
+    FGExternalShm( double dt, std::string name, long spin_usec );
+
+    // Destructor
+    ~FGExternalShm();
+
+    // Reset flight params to a specific position
+    void init();
+
+    // update the fdm
+    void update( double dt );
+
+};
+
+
+#endif // _EXTERNAL_SHM_HXX
@@ -490,6 +490,11 @@ public:
       different name.
       @param mode Sets the reset mode.*/
   void ResetToInitialConditions(int mode);
+  /** Resets the models and the script events like ResetToInitialConditions()
+      but does not run the initial conditions. Properties can then be set
+      as for a freshly loaded model before RunIC() is called.
+      @param mode Sets the reset mode, see ResetToInitialConditions().*/
+  void ResetModels(int mode);
   /// Sets the debug level.
   void SetDebugLevel(int level) {debug_lvl = level;}
 
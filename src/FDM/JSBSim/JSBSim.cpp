@@ -64,10 +64,19 @@ INCLUDES
 #  include <sys/timeb.h>
 #else
 #  include <sys/time.h>
+#  include <sys/mman.h>
+#  include <sys/wait.h>
+#  include <unistd.h>
 #endif
 
 #include <iostream>
+#include <sstream>
 #include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <thread>
+#include "simgear/io/iostreams/sgstream.hxx"
 
 using namespace std;
 using JSBSim::FGXMLFileRead;
@@ -91,6 +100,8 @@ vector <string> LogOutputName;
 vector <SGPath> LogDirectiveName;
 vector <string> CommandLineProperties;
 vector <double> CommandLinePropertyValues;
+SGPath BatchName;
+unsigned int batch_jobs = 0;
 JSBSim::FGFDMExec* FDMExec;
 JSBSim::FGTrim* trimmer;
 
@@ -111,6 +122,7 @@ FORWARD DECLARATIONS
 
 bool options(int, char**);
 int real_main(int argc, char* argv[]);
+int RunBatch(void);
 void PrintHelp(void);
 
 #if defined(__BORLANDC__) || defined(_MSC_VER) || defined(__MINGW32__)
@@ -292,7 +304,7 @@ int main(int argc, char* argv[])
 #endif
 
   try {
-    real_main(argc, argv);
+    if (real_main(argc, argv) != 0) return 1;
   } catch (string& msg) {
     std::cerr << "FATAL ERROR: JSBSim terminated with an exception."
               << std::endl << "The message was: " << msg << std::endl;
@@ -453,6 +465,13 @@ int real_main(int argc, char* argv[])
     }
   }
 
+  // *** OPTION C: RUN A BATCH OF VARIATIONS OF THE LOADED SIMULATION *** //
+  if (!BatchName.isNull()) {
+    int batch_result = RunBatch();
+    delete FDMExec;
+    return batch_result;
+  }
+
   FDMExec->RunIC();
 
   // PRINT SIMULATION CONFIGURATION
@@ -562,6 +581,306 @@ quit:
   return 0;
 }
 
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Batch runs.
+//
+// The aircraft (or script) is loaded once and then run once for each line of
+// the batch file, with the properties, output files and end time given on
+// that line. Between two runs the models are reset to their state after
+// loading, like a reset from a script, which is much cheaper than parsing
+// and loading everything again.
+//
+// Several runs are made in parallel by worker processes forked after
+// loading, each with its own copy of the loaded simulation. Processes rather
+// than threads, because JSBSim keeps some state in static members (message
+// queue, random number generator, ground callback). The workers take the
+// next run from a counter in shared memory until all runs are done.
+// Output files which a run doesn't name with --outputlogfile get the name
+// from the configuration prefixed with the run name, so that no two runs
+// write to the same file. Run names must therefore be unique.
+
+struct BatchRun {
+  string name;
+  vector <string> properties;
+  vector <double> property_values;
+  vector <string> output_names;
+  double end_time;
+};
+
+enum {eBatchPending=0, eBatchRunning, eBatchDone, eBatchFailed};
+
+struct BatchState {
+  atomic <unsigned int> next_run;
+  unsigned char* status;
+};
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+bool ReadBatchFile(const SGPath& filename, vector <BatchRun>& runs)
+{
+  sg_ifstream file(filename);
+  if (!file.is_open()) {
+    cerr << "Could not open the batch file " << filename << endl;
+    return false;
+  }
+
+  string line;
+  unsigned int line_number = 0;
+  while (getline(file, line)) {
+    line_number++;
+    string::size_type comment = line.find('#');
+    if (comment != string::npos) line.erase(comment);
+
+    istringstream tokens(line);
+    string token;
+    if (!(tokens >> token)) continue; // empty line
+
+    for (unsigned int i=0; i<runs.size(); i++) {
+      if (runs[i].name == token) {
+        cerr << filename << ":" << line_number << ": The run name \"" << token
+             << "\" is already used." << endl;
+        return false;
+      }
+    }
+
+    BatchRun run;
+    run.name = token;
+    run.end_time = end_time;
+
+    while (tokens >> token) {
+      string::size_type n = token.find("=");
+      string keyword = token.substr(0, n);
+      string value = (n == string::npos) ? string("") : token.substr(n+1);
+      string::size_type m = value.find("=");
+
+      if (keyword == "--property" && m != string::npos) {
+        run.properties.push_back(value.substr(0, m));
+        run.property_values.push_back(atof(value.substr(m+1).c_str()));
+      } else if (keyword == "--outputlogfile" && !value.empty()) {
+        run.output_names.push_back(value);
+      } else if (keyword == "--end" && !value.empty()) {
+        run.end_time = atof(value.c_str());
+      } else {
+        cerr << filename << ":" << line_number << ": The argument \"" << token
+             << "\" cannot be interpreted as a batch run option." << endl;
+        return false;
+      }
+    }
+
+    runs.push_back(run);
+  }
+
+  return true;
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+bool RunBatchCase(const BatchRun& run, bool reset,
+                  const vector <string>& initial_properties,
+                  const vector <double>& initial_values,
+                  const vector <string>& output_files)
+{
+  // Closes the output files of the previous run.
+  if (reset) FDMExec->ResetModels(1);
+
+  // Undo the settings of the previous run, then apply the command line and
+  // the run settings as for a single run.
+  for (unsigned int i=0; i<initial_properties.size(); i++)
+    FDMExec->SetPropertyValue(initial_properties[i], initial_values[i]);
+  for (unsigned int i=0; i<CommandLineProperties.size(); i++)
+    FDMExec->SetPropertyValue(CommandLineProperties[i], CommandLinePropertyValues[i]);
+  for (unsigned int i=0; i<run.properties.size(); i++)
+    FDMExec->SetPropertyValue(run.properties[i], run.property_values[i]);
+  FDMExec->SetPropertyValue("simulation/terminate", 0.0);
+
+  for (unsigned int i=0; i<run.output_names.size(); i++) {
+    if (!FDMExec->SetOutputFileName(i, run.output_names[i])) {
+      cerr << "Run " << run.name << ": output " << i << " does not exist" << endl;
+      return false;
+    }
+  }
+  for (unsigned int i=run.output_names.size(); i<output_files.size(); i++) {
+    if (output_files[i].empty()) continue;
+    SGPath path = SGPath::fromUtf8(output_files[i]);
+    string name = run.name + "_" + path.file();
+    if (!path.dir().empty()) name = path.dir() + "/" + name;
+    FDMExec->SetOutputFileName(i, name);
+  }
+
+  if (!FDMExec->RunIC()) return false;
+
+  if (FDMExec->GetIC()->NeedTrim()) {
+    JSBSim::FGTrim trim(FDMExec);
+    trim.DoTrim();
+  }
+
+  bool result = FDMExec->Run();
+  while (result && FDMExec->GetSimTime() <= run.end_time) {
+    FDMExec->ProcessMessage();
+    FDMExec->CheckIncrementalHold();
+    result = FDMExec->Run();
+  }
+
+  return true;
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void RunBatchWorker(const vector <BatchRun>& runs, BatchState* state,
+                    const vector <string>& initial_properties,
+                    const vector <double>& initial_values,
+                    const vector <string>& output_files)
+{
+  bool reset = false;
+
+  for (;;) {
+    unsigned int i = state->next_run++;
+    if (i >= runs.size()) break;
+
+    state->status[i] = eBatchRunning;
+    bool success = false;
+    try {
+      success = RunBatchCase(runs[i], reset, initial_properties, initial_values,
+                             output_files);
+    } catch (string& msg) {
+      cerr << "Run " << runs[i].name << ": " << msg << endl;
+    } catch (const char* msg) {
+      cerr << "Run " << runs[i].name << ": " << msg << endl;
+    } catch (...) {
+      cerr << "Run " << runs[i].name << ": unknown exception" << endl;
+    }
+    reset = true;
+    state->status[i] = success ? eBatchDone : eBatchFailed;
+
+    cout << "Run " << runs[i].name << (success ? " finished" : " failed")
+         << " at time " << FDMExec->GetSimTime() << endl;
+  }
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+int RunBatch(void)
+{
+  vector <BatchRun> runs;
+  if (!ReadBatchFile(BatchName, runs)) return 1;
+  if (runs.empty()) {
+    cerr << "No runs in the batch file " << BatchName << endl;
+    return 1;
+  }
+
+  // Values after loading of all the properties set by any run, restored
+  // before each run so that a run does not depend on the runs before it.
+  vector <string> initial_properties;
+  vector <double> initial_values;
+  for (unsigned int r=0; r<runs.size(); r++) {
+    for (unsigned int i=0; i<runs[r].properties.size(); i++) {
+      const string& name = runs[r].properties[i];
+      if (find(initial_properties.begin(), initial_properties.end(), name)
+          != initial_properties.end()) continue;
+      if (!FDMExec->GetPropertyManager()->GetNode(name)) {
+        cerr << endl << "  No property by the name " << name << endl;
+        return 1;
+      }
+      initial_properties.push_back(name);
+      initial_values.push_back(FDMExec->GetPropertyValue(name));
+    }
+  }
+
+  // The configured names of the output files, relative to the root
+  // directory, and empty for the outputs which are not files.
+  vector <string> output_files;
+  string root = FDMExec->GetRootDir().utf8Str();
+  if (!root.empty() && root[root.size()-1] != '/') root += "/";
+  for (unsigned int i=0; ; i++) {
+    string name = FDMExec->GetOutputFileName(i);
+    if (name.empty()) break;
+    if (!FDMExec->GetOutput()->IsFileOutput(i))
+      name.clear();
+    else if (name.compare(0, root.size(), root) == 0)
+      name.erase(0, root.size());
+    output_files.push_back(name);
+  }
+
+  unsigned int jobs = batch_jobs;
+  if (jobs == 0) jobs = max(thread::hardware_concurrency(), 1u);
+#if defined(__BORLANDC__) || defined(_MSC_VER) || defined(__MINGW32__)
+  jobs = 1; // no fork()
+#endif
+  jobs = min(jobs, (unsigned int)runs.size());
+
+  // The run counter and the run results are shared with the workers.
+  size_t shared_size = sizeof(BatchState) + runs.size();
+#if defined(__BORLANDC__) || defined(_MSC_VER) || defined(__MINGW32__)
+  void* shared = new char[shared_size];
+#else
+  void* shared = mmap(0, shared_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (shared == MAP_FAILED) {
+    cerr << "Could not allocate the batch state" << endl;
+    return 1;
+  }
+#endif
+  BatchState* state = new (shared) BatchState;
+  state->next_run = 0;
+  state->status = (unsigned char*)shared + sizeof(BatchState);
+  for (unsigned int i=0; i<runs.size(); i++) state->status[i] = eBatchPending;
+
+  double start_seconds = getcurrentseconds();
+
+#if defined(__BORLANDC__) || defined(_MSC_VER) || defined(__MINGW32__)
+  RunBatchWorker(runs, state, initial_properties, initial_values, output_files);
+#else
+  if (jobs == 1) {
+    RunBatchWorker(runs, state, initial_properties, initial_values, output_files);
+  } else {
+    cout.flush();
+    cerr.flush();
+
+    vector <pid_t> workers;
+    for (unsigned int j=0; j<jobs; j++) {
+      pid_t pid = fork();
+      if (pid == 0) {
+        RunBatchWorker(runs, state, initial_properties, initial_values, output_files);
+        delete FDMExec; // flushes and closes the output files
+        cout.flush();
+        cerr.flush();
+        _exit(0);
+      } else if (pid < 0) {
+        cerr << "Could not start batch worker " << j << endl;
+        break;
+      }
+      workers.push_back(pid);
+    }
+
+    if (workers.empty())
+      RunBatchWorker(runs, state, initial_properties, initial_values, output_files);
+    for (unsigned int j=0; j<workers.size(); j++) waitpid(workers[j], 0, 0);
+  }
+#endif
+
+  unsigned int failed = 0;
+  for (unsigned int i=0; i<runs.size(); i++) {
+    if (state->status[i] == eBatchDone) continue;
+    failed++;
+    cerr << "Run " << runs[i].name
+         << (state->status[i] == eBatchFailed ? " failed" : " did not complete")
+         << endl;
+  }
+
+  cout << endl << runs.size() << " runs (" << failed << " failed) with "
+       << jobs << " worker(s) in " << getcurrentseconds() - start_seconds
+       << " seconds" << endl;
+
+  state->~BatchState();
+#if defined(__BORLANDC__) || defined(_MSC_VER) || defined(__MINGW32__)
+  delete[] (char*)shared;
+#else
+  munmap(shared, shared_size);
+#endif
+
+  return failed > 0 ? 1 : 0;
+}
+
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
 #define gripe cerr << "Option '" << keyword     \
@@ -694,6 +1013,22 @@ bool options(int count, char **arg)
         exit(1);
       }
 
+    } else if (keyword == "--batch") {
+      if (n != string::npos) {
+        BatchName = SGPath::fromLocal8Bit(value.c_str());
+      } else {
+        gripe;
+        exit(1);
+      }
+
+    } else if (keyword == "--jobs") {
+      if (n != string::npos) {
+        batch_jobs = atoi( value.c_str() );
+      } else {
+        gripe;
+        exit(1);
+      }
+
     } else if (keyword == "--catalog") {
         catalog = true;
         if (value.size() > 0) AircraftName=value;
@@ -737,6 +1072,10 @@ bool options(int count, char **arg)
     cerr << "You cannot specify an aircraft file with a script." << endl;
     result = false;
   }
+  if (!BatchName.isNull() && (realtime || suspend || catalog)) {
+    cerr << "A batch cannot be run in realtime, suspended or with catalog." << endl;
+    result = false;
+  }
 
   return result;
 
@@ -768,7 +1107,13 @@ void PrintHelp(void)
     cout << "    --simulation-rate=<rate (double)> specifies the sim dT time or frequency" << endl;
     cout << "                      If rate specified is less than 1, it is interpreted as" << endl;
     cout << "                      a time step size, otherwise it is assumed to be a rate in Hertz." << endl;
-    cout << "    --end=<time (double)> specifies the sim end time" << endl << endl;
+    cout << "    --end=<time (double)> specifies the sim end time" << endl;
+    cout << "    --batch=<filename> runs the simulation once for each line of the file. A line" << endl;
+    cout << "                       is a run name followed by --property, --outputlogfile and" << endl;
+    cout << "                       --end options for that run. Outputs not named on the line" << endl;
+    cout << "                       write to the configured file, prefixed with <run name>_" << endl;
+    cout << "    --jobs=<n> specifies the number of batch runs made in parallel" << endl;
+    cout << "               (default: one per processor)" << endl << endl;
 
     cout << "  NOTE: There can be no spaces around the = sign when" << endl;
     cout << "        an option is followed by a filename" << endl << endl;
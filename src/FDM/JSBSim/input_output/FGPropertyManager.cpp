@@ -58,6 +58,7 @@ void FGPropertyManager::Unbind(void)
         (*it)->untie();
 
     tied_properties.clear();
+    tied_doubles.clear();
 }
 
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
@@ -316,6 +317,7 @@ void FGPropertyManager::Untie (const string &name)
     if (*it == property) {
       property->untie();
       tied_properties.erase(it);
+      tied_doubles.erase(property);
       if (FGJSBBase::debug_lvl & 0x20) cout << "Untied " << name << endl;
       return;
     }
@@ -414,8 +416,18 @@ void FGPropertyManager::Tie (const string &name, double *pointer, bool useDefaul
     cerr << "Failed to tie property " << name << " to a pointer" << endl;
   else {
     tied_properties.push_back(property);
+    tied_doubles[property] = pointer;
     if (FGJSBBase::debug_lvl & 0x20) cout << name << endl;
   }
 }
 
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+const double* FGPropertyManager::GetTiedDouble(const SGPropertyNode* node) const
+{
+  map<const SGPropertyNode*, double*>::const_iterator it = tied_doubles.find(node);
+  if (it == tied_doubles.end()) return 0L;
+  return it->second;
+}
+
 } // namespace JSBSim
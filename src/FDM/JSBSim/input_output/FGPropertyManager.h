@@ -41,6 +41,7 @@ INCLUDES
 # include <config.h>
 #endif
 
+#include <map>
 #include <string>
 #include "simgear/props/propertyObject.hxx"
 #if !PROPS_STANDALONE
@@ -510,6 +511,18 @@ class FGPropertyManager
     void
     Tie (const std::string &name, double *pointer, bool useDefault = true);
 
+    /**
+     * Get the variable a property has been tied to by the above method.
+     *
+     * Reading the variable directly is equivalent to reading the property
+     * as long as the property stays tied.
+     *
+     * @param node The property node.
+     * @return The pointer given to Tie(), or 0 if the property is not
+     *         tied to a double variable by this manager.
+     */
+    const double* GetTiedDouble(const SGPropertyNode* node) const;
+
 //============================================================================
 //
 //  All of the following functions *must* be inlined, otherwise linker
@@ -693,6 +706,7 @@ class FGPropertyManager
 
   private:
     std::vector<SGPropertyNode_ptr> tied_properties;
+    std::map<const SGPropertyNode*, double*> tied_doubles;
     FGPropertyNode_ptr root;
 };
 }
@@ -117,6 +117,7 @@ FGFunction::FGFunction(FGPropertyManager* propMan, Element* el, const string& pr
   cachedValue = -HUGE_VAL;
   invlog2val = 1.0/log10(2.0);
   pCopyTo = 0L;
+  compiled = false;
 
   Name = el->GetAttributeValue("name");
   operation = el->GetName();
@@ -349,6 +350,22 @@ void FGFunction::cacheValue(bool cache)
 
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
+void FGFunction::compile(bool shouldCompile)
+{
+  // Without code, GetValue() falls back to Interpret() once compiled is set
+  compiled = !shouldCompile;
+  Code.clear();
+  CodeTable.clear();
+  CodeNodes.clear();
+
+  for (unsigned int i=0; i<Parameters.size(); i++) {
+    FGFunction* f = dynamic_cast<FGFunction*>(Parameters[i]);
+    if (f) f->compile(shouldCompile);
+  }
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
 unsigned int FGFunction::GetBinary(double val) const
 {
   val = fabs(val);
@@ -362,13 +379,25 @@ unsigned int FGFunction::GetBinary(double val) const
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
 double FGFunction::GetValue(void) const
+{
+  if (cached) return cachedValue;
+
+  if (!compiled) Compile();
+  if (Code.empty()) return Interpret();
+
+  double temp = Execute();
+  if (pCopyTo) pCopyTo->setDoubleValue(temp);
+  return temp;
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+double FGFunction::Interpret(void) const
 {
   unsigned int i;
   double scratch;
   double temp=0;
 
-  if (cached) return cachedValue;
-
   if (   Type != eRandom
       && Type != eUrandom
       && Type != ePi      ) temp = Parameters[0]->GetValue();
@@ -393,8 +422,9 @@ double FGFunction::GetValue(void) const
     }
     break;
   case eQuotient:
-    if (Parameters[1]->GetValue() != 0.0)
-      temp /= Parameters[1]->GetValue();
+    scratch = Parameters[1]->GetValue();
+    if (scratch != 0.0)
+      temp /= scratch;
     else
       temp = HUGE_VAL;
     break;
@@ -457,12 +487,14 @@ double FGFunction::GetValue(void) const
     break;
   case eMin:
     for (i=1;i<Parameters.size();i++) {
-      if (Parameters[i]->GetValue() < temp) temp = Parameters[i]->GetValue();
+      scratch = Parameters[i]->GetValue();
+      if (scratch < temp) temp = scratch;
     }    
     break;
   case eMax:
     for (i=1;i<Parameters.size();i++) {
-      if (Parameters[i]->GetValue() > temp) temp = Parameters[i]->GetValue();
+      scratch = Parameters[i]->GetValue();
+      if (scratch > temp) temp = scratch;
     }    
     break;
   case eAvg:
@@ -774,6 +806,415 @@ double FGFunction::GetValue(void) const
 
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
+bool FGFunction::IsConstant(void) const
+{
+  if (Type == eRandom || Type == eUrandom || pCopyTo) return false;
+
+  for (unsigned int i=0; i<Parameters.size(); i++) {
+    const FGParameter* p = Parameters[i];
+    const FGFunction* f = dynamic_cast<const FGFunction*>(p);
+    if (f) {
+      if (!f->IsConstant()) return false;
+    } else if (!dynamic_cast<const FGRealValue*>(p)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+FGFunction::Instruction& FGFunction::Emit(CodeBuffer& buf, OpCode op,
+                                          int stackChange) const
+{
+  Instruction ins;
+  ins.op = op;
+  ins.arg = 0;
+  ins.value = 0.0;
+  buf.code.push_back(ins);
+  buf.depth += stackChange;
+  if (buf.depth > buf.maxDepth) buf.maxDepth = buf.depth;
+  return buf.code.back();
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Emits the code pushing the value of p on the stack.
+
+void FGFunction::EmitParameter(const FGParameter* p, CodeBuffer& buf) const
+{
+  const FGFunction* f = dynamic_cast<const FGFunction*>(p);
+  if (f) {
+    if (f->IsConstant()) {
+      try {
+        Emit(buf, opConst, 1).value = f->Interpret();
+        return;
+      } catch (...) {
+        // Malformed, let it throw at run time as before
+      }
+    } else if (!f->pCopyTo) {
+      // Functions with a copyto are left to their GetValue(), which stores
+      // the value
+      unsigned int start = buf.code.size(), depth = buf.depth;
+      if (EmitOperation(f, buf)) return;
+      buf.code.resize(start);
+      buf.depth = depth;
+    }
+  } else if (dynamic_cast<const FGRealValue*>(p)) {
+    Emit(buf, opConst, 1).value = p->GetValue();
+    return;
+  } else {
+    const FGPropertyValue* v = dynamic_cast<const FGPropertyValue*>(p);
+    FGPropertyNode* node = v ? v->GetNode() : 0L;
+    if (node) {
+      buf.nodes.push_back(node);
+      const double* pointer = PropertyManager->GetTiedDouble(node);
+      if (pointer)
+        Emit(buf, opPointer, 1).pointer = pointer;
+      else
+        Emit(buf, opNode, 1).node = node;
+      if (v->GetSign() < 0) Emit(buf, opNegate, 0);
+      return;
+    }
+  }
+
+  // Tables, properties which don't exist yet and operations which are
+  // not compiled.
+  Emit(buf, opParameter, 1).parameter = p;
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Emits the code for the operation of f, leaving its value on the stack.
+// Returns false if the operation is not compiled. The code only evaluates
+// the arguments the tree would evaluate, in the same order, so errors are
+// thrown and random numbers are drawn as before.
+
+bool FGFunction::EmitOperation(const FGFunction* f, CodeBuffer& buf) const
+{
+  const vector<FGParameter*>& p = f->Parameters;
+  unsigned int n = p.size();
+  unsigned int args = 0; // number of arguments used, 0 for all of them
+  OpCode op;
+
+  switch (f->Type) {
+  case eTopLevel:
+    if (n < 1) return false;
+    EmitParameter(p[0], buf);
+    return true;
+  case eRandom:
+    Emit(buf, opRandom, 1);
+    return true;
+  case eUrandom:
+    Emit(buf, opUrandom, 1);
+    return true;
+
+  case eAND:
+  case eOR:
+    {
+      // Stop at the first false (true) argument, leaving 0 (1) on the stack
+      if (n < 1) return false;
+      vector<unsigned int> jumps;
+      EmitParameter(p[0], buf);
+      Emit(buf, opBinary, 0);
+      for (unsigned int i=1; i<n; i++) {
+        jumps.push_back(buf.code.size());
+        Emit(buf, f->Type == eAND ? opAndJump : opOrJump, -1);
+        EmitParameter(p[i], buf);
+        Emit(buf, opBinary, 0);
+      }
+      for (unsigned int i=0; i<jumps.size(); i++)
+        buf.code[jumps[i]].arg = buf.code.size();
+    }
+    return true;
+
+  case eIfThen:
+    {
+      if (n != 3) return false;
+      EmitParameter(p[0], buf);
+      unsigned int ifNot = buf.code.size();
+      Emit(buf, opIfNotJump, -1);
+      EmitParameter(p[1], buf);
+      unsigned int jump = buf.code.size();
+      Emit(buf, opJump, -1);
+      buf.code[ifNot].arg = buf.code.size();
+      EmitParameter(p[2], buf);
+      buf.code[jump].arg = buf.code.size();
+    }
+    return true;
+
+  case eSwitch:
+    {
+      // opSwitch is followed by one jump per case
+      if (n < 2) return false;
+      EmitParameter(p[0], buf);
+      Emit(buf, opSwitch, -1).arg = n-1;
+      unsigned int cases = buf.code.size();
+      for (unsigned int i=1; i<n; i++) Emit(buf, opJump, 0);
+      vector<unsigned int> jumps;
+      for (unsigned int i=1; i<n; i++) {
+        buf.code[cases+i-1].arg = buf.code.size();
+        EmitParameter(p[i], buf);
+        jumps.push_back(buf.code.size());
+        Emit(buf, opJump, -1);
+      }
+      buf.depth++;
+      for (unsigned int i=0; i<jumps.size(); i++)
+        buf.code[jumps[i]].arg = buf.code.size();
+    }
+    return true;
+
+  case eInterpolate1D:
+    {
+      // Only tables of constants, stored as their number of rows followed
+      // by the rows
+      if (n < 3 || n % 2 == 0) return false;
+      vector<double> table(1, (n-1)/2);
+      for (unsigned int i=1; i<n; i++) {
+        const FGFunction* fi = dynamic_cast<const FGFunction*>(p[i]);
+        if (!(fi && fi->IsConstant()) && !dynamic_cast<const FGRealValue*>(p[i]))
+          return false;
+        try {
+          table.push_back(p[i]->GetValue());
+        } catch (...) {
+          return false;
+        }
+      }
+      unsigned int offset = buf.table.size();
+      buf.table.insert(buf.table.end(), table.begin(), table.end());
+      EmitParameter(p[0], buf);
+      Emit(buf, opInterpolate1D, 0).arg = offset;
+    }
+    return true;
+
+  // Operations on n arguments
+  case eSum:        op = opSum;        break;
+  case eDifference: op = opDifference; break;
+  case eProduct:    op = opProduct;    break;
+  case eMin:        op = opMin;        break;
+  case eMax:        op = opMax;        break;
+  case eAvg:        op = opAvg;        break;
+
+  // Operations on 2 arguments, any further ones are ignored
+  case eQuotient:   op = opQuotient;   args = 2; break;
+  case ePow:        op = opPow;        args = 2; break;
+  case eATan2:      op = opATan2;      args = 2; break;
+  case eMod:        op = opMod;        args = 2; break;
+  case eLT:         op = opLT;         args = 2; break;
+  case eLE:         op = opLE;         args = 2; break;
+  case eGT:         op = opGT;         args = 2; break;
+  case eGE:         op = opGE;         args = 2; break;
+  case eEQ:         op = opEQ;         args = 2; break;
+  case eNE:         op = opNE;         args = 2; break;
+
+  // Operations on 1 argument, any further ones are ignored
+  case eSqrt:       op = opSqrt;       args = 1; break;
+  case eToRadians:  op = opToRadians;  args = 1; break;
+  case eToDegrees:  op = opToDegrees;  args = 1; break;
+  case eExp:        op = opExp;        args = 1; break;
+  case eLog2:       op = opLog2;       args = 1; break;
+  case eLn:         op = opLn;         args = 1; break;
+  case eLog10:      op = opLog10;      args = 1; break;
+  case eAbs:        op = opAbs;        args = 1; break;
+  case eSign:       op = opSign;       args = 1; break;
+  case eSin:        op = opSin;        args = 1; break;
+  case eCos:        op = opCos;        args = 1; break;
+  case eTan:        op = opTan;        args = 1; break;
+  case eASin:       op = opASin;       args = 1; break;
+  case eACos:       op = opACos;       args = 1; break;
+  case eATan:       op = opATan;       args = 1; break;
+  case eFrac:       op = opFrac;       args = 1; break;
+  case eInteger:    op = opInteger;    args = 1; break;
+  case eNOT:        op = opNot;        args = 1; break;
+
+  default:
+    return false;
+  }
+
+  if (args == 0) args = n;
+  if (args == 0 || n < args) return false;
+
+  for (unsigned int i=0; i<args; i++) EmitParameter(p[i], buf);
+  Emit(buf, op, 1-(int)args).arg = args;
+  return true;
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void FGFunction::Compile(void) const
+{
+  compiled = true;
+
+  CodeBuffer buf;
+  buf.depth = buf.maxDepth = 0;
+
+  if (IsConstant()) {
+    try {
+      Emit(buf, opConst, 1).value = Interpret();
+    } catch (...) {
+      return;
+    }
+  } else if (!EmitOperation(this, buf)) {
+    return;
+  }
+
+  if (buf.maxDepth > MaxStackDepth) return;
+
+  Code.swap(buf.code);
+  CodeTable.swap(buf.table);
+  CodeNodes.swap(buf.nodes);
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+// Runs the compiled code, each operation does what Interpret() does for it.
+
+double FGFunction::Execute(void) const
+{
+  double stack[MaxStackDepth];
+  double* sp = stack; // next free entry
+  double scratch;
+  const Instruction* code = &Code[0];
+  const Instruction* end = code + Code.size();
+
+  for (const Instruction* pc = code; pc != end; ++pc) {
+    switch (pc->op) {
+    case opConst:     *sp++ = pc->value; break;
+    case opPointer:   *sp++ = *pc->pointer; break;
+    case opNode:      *sp++ = pc->node->getDoubleValue(); break;
+    case opParameter: *sp++ = pc->parameter->GetValue(); break;
+    case opNegate:    sp[-1] *= -1; break;
+
+    case opSum:
+      sp -= pc->arg;
+      for (unsigned int i=1; i<pc->arg; i++) sp[0] += sp[i];
+      sp++;
+      break;
+    case opDifference:
+      sp -= pc->arg;
+      for (unsigned int i=1; i<pc->arg; i++) sp[0] -= sp[i];
+      sp++;
+      break;
+    case opProduct:
+      sp -= pc->arg;
+      for (unsigned int i=1; i<pc->arg; i++) sp[0] *= sp[i];
+      sp++;
+      break;
+    case opMin:
+      sp -= pc->arg;
+      for (unsigned int i=1; i<pc->arg; i++) if (sp[i] < sp[0]) sp[0] = sp[i];
+      sp++;
+      break;
+    case opMax:
+      sp -= pc->arg;
+      for (unsigned int i=1; i<pc->arg; i++) if (sp[i] > sp[0]) sp[0] = sp[i];
+      sp++;
+      break;
+    case opAvg:
+      sp -= pc->arg;
+      for (unsigned int i=1; i<pc->arg; i++) sp[0] += sp[i];
+      sp[0] /= pc->arg;
+      sp++;
+      break;
+
+    case opQuotient:
+      sp--;
+      if (sp[0] != 0.0) sp[-1] /= sp[0];
+      else sp[-1] = HUGE_VAL;
+      break;
+    case opPow:   sp--; sp[-1] = pow(sp[-1], sp[0]); break;
+    case opATan2: sp--; sp[-1] = atan2(sp[-1], sp[0]); break;
+    case opMod:   sp--; sp[-1] = ((int)sp[-1]) % ((int)sp[0]); break;
+    case opLT:    sp--; sp[-1] = (sp[-1] <  sp[0])?1:0; break;
+    case opLE:    sp--; sp[-1] = (sp[-1] <= sp[0])?1:0; break;
+    case opGT:    sp--; sp[-1] = (sp[-1] >  sp[0])?1:0; break;
+    case opGE:    sp--; sp[-1] = (sp[-1] >= sp[0])?1:0; break;
+    case opEQ:    sp--; sp[-1] = (sp[-1] == sp[0])?1:0; break;
+    case opNE:    sp--; sp[-1] = (sp[-1] != sp[0])?1:0; break;
+
+    case opSqrt:      sp[-1] = sqrt(sp[-1]); break;
+    case opToRadians: sp[-1] *= M_PI/180.0; break;
+    case opToDegrees: sp[-1] *= 180.0/M_PI; break;
+    case opExp:       sp[-1] = exp(sp[-1]); break;
+    case opLog2:
+      if (sp[-1] > 0.00) sp[-1] = log10(sp[-1])*invlog2val;
+      else sp[-1] = -HUGE_VAL;
+      break;
+    case opLn:
+      if (sp[-1] > 0.00) sp[-1] = log(sp[-1]);
+      else sp[-1] = -HUGE_VAL;
+      break;
+    case opLog10:
+      if (sp[-1] > 0.00) sp[-1] = log10(sp[-1]);
+      else sp[-1] = -HUGE_VAL;
+      break;
+    case opAbs:     sp[-1] = fabs(sp[-1]); break;
+    case opSign:    sp[-1] = sp[-1] < 0 ? -1:1; break;
+    case opSin:     sp[-1] = sin(sp[-1]); break;
+    case opCos:     sp[-1] = cos(sp[-1]); break;
+    case opTan:     sp[-1] = tan(sp[-1]); break;
+    case opASin:    sp[-1] = asin(sp[-1]); break;
+    case opACos:    sp[-1] = acos(sp[-1]); break;
+    case opATan:    sp[-1] = atan(sp[-1]); break;
+    case opFrac:    sp[-1] = modf(sp[-1], &scratch); break;
+    case opInteger: modf(sp[-1], &scratch); sp[-1] = scratch; break;
+    case opRandom:  *sp++ = GaussianRandomNumber(); break;
+    case opUrandom: *sp++ = -1.0 + (((double)rand()/double(RAND_MAX))*2.0); break;
+
+    case opBinary: sp[-1] = GetBinary(sp[-1]); break;
+    case opNot:    sp[-1] = (GetBinary(sp[-1]) != 0) ? 0 : 1; break;
+    case opAndJump:
+      if (sp[-1] == 0) pc = code + pc->arg - 1;
+      else sp--;
+      break;
+    case opOrJump:
+      if (sp[-1] != 0) pc = code + pc->arg - 1;
+      else sp--;
+      break;
+    case opIfNotJump:
+      sp--;
+      if (GetBinary(*sp) != 1) pc = code + pc->arg - 1;
+      break;
+    case opJump:
+      pc = code + pc->arg - 1;
+      break;
+    case opSwitch:
+      {
+        unsigned int i = int(*--sp + 0.5);
+        if (i >= pc->arg)
+          throw(string("The switch function index selected a value above the range of supplied values"
+                       " - not enough values were supplied."));
+        pc += i; // to the jump of case i, the loop moves on to it
+      }
+      break;
+    case opInterpolate1D:
+      {
+        const double* table = &CodeTable[pc->arg];
+        unsigned int rows = (unsigned int)table[0];
+        const double* row = table + 1;
+        double x = sp[-1];
+        if (x <= row[0]) {
+          sp[-1] = row[1];
+        } else if (x >= row[2*rows-2]) {
+          sp[-1] = row[2*rows-1];
+        } else {
+          for (unsigned int i=0; i+1<rows; i++, row+=2) {
+            if (x < row[2]) {
+              double factor = (x - row[0]) / (row[2] - row[0]);
+              double span = row[3] - row[1];
+              double val = factor*span;
+              sp[-1] = row[1] + val;
+              break;
+            }
+          }
+        }
+      }
+      break;
+    }
+  }
+
+  return stack[0];
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
 string FGFunction::GetValueAsString(void) const
 {
   ostringstream buffer;
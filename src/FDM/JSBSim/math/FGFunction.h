@@ -687,6 +687,14 @@ of the three words refers to one or more instances of a property, value, or tabl
        <v> 0.90 </v>  <v> 0.60 </v>
      </interpolate1d>
      @endcode
+
+The first time its value is requested, a function is compiled into a flat
+sequence of instructions for a small stack machine. Constant subtrees are
+folded into a single value, interpolation tables with constant breakpoints
+are copied into the code and properties are read directly, from the tied
+variable if there is one. Operations which are not compiled (the rotation
+functions), tables and properties which do not exist yet at that time are
+evaluated through the function tree as before.
 @author Jon Berndt
 */
 
@@ -738,6 +746,14 @@ public:
     @param shouldCache specifies whether the function should cache the computed value. */
   void cacheValue(bool shouldCache);
 
+/** Specifies whether to compile the function to flat code on its first
+    evaluation, which is the default, or to walk the function tree each time.
+    This applies to the nested functions as well. Both evaluate each argument
+    at most once and in the same order, so they also draw the same random
+    numbers.
+    @param shouldCompile specifies whether the function should be compiled. */
+  void compile(bool shouldCompile);
+
 private:
   std::vector <FGParameter*> Parameters;
   FGPropertyManager* const PropertyManager;
@@ -814,6 +830,54 @@ private:
   unsigned int GetBinary(double) const;
   void bind(Element*);
   void Debug(int from);
+
+  // Evaluates the function tree, the compiled code is run by Execute()
+  double Interpret(void) const;
+
+  enum OpCode {opConst, opPointer, opNode, opParameter, opNegate,
+               opSum, opDifference, opProduct, opMin, opMax, opAvg,
+               opQuotient, opPow, opATan2, opMod,
+               opLT, opLE, opGT, opGE, opEQ, opNE,
+               opSqrt, opToRadians, opToDegrees, opExp, opLog2, opLn, opLog10,
+               opAbs, opSign, opSin, opCos, opTan, opASin, opACos, opATan,
+               opFrac, opInteger, opRandom, opUrandom,
+               opBinary, opNot, opAndJump, opOrJump, opIfNotJump, opJump,
+               opSwitch, opInterpolate1D};
+
+  struct Instruction {
+    OpCode op;
+    unsigned int arg;   // argument count, jump target or table offset
+    union {
+      double value;
+      const double* pointer;
+      FGPropertyNode* node;
+      const FGParameter* parameter;
+    };
+  };
+
+  struct CodeBuffer {
+    std::vector<Instruction> code;
+    std::vector<double> table;
+    std::vector<FGPropertyNode_ptr> nodes;
+    unsigned int depth, maxDepth;
+  };
+
+  // The evaluation stack lives on the C++ stack, functions needing a
+  // deeper one are not compiled.
+  static const unsigned int MaxStackDepth = 64;
+
+  void Compile(void) const;
+  bool IsConstant(void) const;
+  void EmitParameter(const FGParameter* p, CodeBuffer& buf) const;
+  bool EmitOperation(const FGFunction* f, CodeBuffer& buf) const;
+  Instruction& Emit(CodeBuffer& buf, OpCode op, int stackChange) const;
+  double Execute(void) const;
+
+  // Compiled form of the function, set up by the first GetValue()
+  mutable bool compiled;
+  mutable std::vector<Instruction> Code;
+  mutable std::vector<double> CodeTable;
+  mutable std::vector<FGPropertyNode_ptr> CodeNodes;
 };
 
 } // namespace JSBSim
@@ -81,6 +81,14 @@ double FGPropertyValue::GetValue(void) const
 
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
+FGPropertyNode* FGPropertyValue::GetNode(void) const
+{
+  if (PropertyNode) return PropertyNode;
+  return PropertyManager->GetNode(PropertyName);
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
 std::string FGPropertyValue::GetName(void) const
 {
   if (PropertyNode) {
@@ -72,6 +72,11 @@ public:
 
   double GetValue(void) const;
   void SetNode(FGPropertyNode* node) {PropertyNode = node;}
+  /** The property node. If it was not known on construction it is looked
+      up by name, 0 is returned if it does not exist yet. */
+  FGPropertyNode* GetNode(void) const;
+  /// -1 if the property name was given with a leading minus sign, else 1.
+  int GetSign(void) const {return Sign;}
 
   std::string GetName(void) const;
 
@@ -42,6 +42,8 @@ INCLUDES
 #include <iostream>
 #include <sstream>
 #include <cstdlib>
+#include <algorithm>
+#include <cmath>
 
 using namespace std;
 
@@ -63,7 +65,8 @@ FGTable::FGTable(int NRows) : nRows(NRows), nCols(1), PropertyManager(0)
 
   Data = Allocate();
   Debug(0);
-  lastRowIndex=lastColumnIndex=2;
+  lastRowIndex=lastColumnIndex=1;
+  packed = false;
 }
 
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
@@ -77,7 +80,8 @@ FGTable::FGTable(int NRows, int NCols) : nRows(NRows), nCols(NCols), PropertyMan
 
   Data = Allocate();
   Debug(0);
-  lastRowIndex=lastColumnIndex=2;
+  lastRowIndex=lastColumnIndex=1;
+  packed = false;
 }
 
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
@@ -108,6 +112,7 @@ FGTable::FGTable(const FGTable& t) : PropertyManager(t.PropertyManager)
   lastRowIndex = t.lastRowIndex;
   lastColumnIndex = t.lastColumnIndex;
   lastTableIndex = t.lastTableIndex;
+  packed = false;
 }
 
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
@@ -132,6 +137,7 @@ FGTable::FGTable(FGPropertyManager* propMan, Element* el,
                            "pow, abs, sin, cos, asin, acos, tan, atan, table";
 
   nTables = 0;
+  packed = false;
 
   // Is this an internal lookup table?
 
@@ -249,7 +255,7 @@ FGTable::FGTable(FGPropertyManager* propMan, Element* el,
     rowCounter = 1;
     Data = Allocate();
     Debug(0);
-    lastRowIndex = lastColumnIndex = 2;
+    lastRowIndex = lastColumnIndex = 1;
     *this << buf;
     break;
   case 2:
@@ -267,7 +273,7 @@ FGTable::FGTable(FGPropertyManager* propMan, Element* el,
     rowCounter = 0;
 
     Data = Allocate();
-    lastRowIndex = lastColumnIndex = 2;
+    lastRowIndex = lastColumnIndex = 1;
     *this << buf;
     break;
   case 3:
@@ -277,7 +283,7 @@ FGTable::FGTable(FGPropertyManager* propMan, Element* el,
     Type = tt3D;
     colCounter = 1;
     rowCounter = 1;
-    lastRowIndex = lastColumnIndex = 2;
+    lastRowIndex = lastColumnIndex = 1;
 
     Data = Allocate(); // this data array will contain the keys for the associated tables
     Tables.reserve(nTables); // necessary?
@@ -428,66 +434,240 @@ double FGTable::GetValue(void) const
 
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
+void FGTable::Breakpoints::Init(const double* k, unsigned int nKeys)
+{
+  keys = k;
+  n = nKeys;
+  invStep = 0.0;
+
+  monotonic = true;
+  for (unsigned int i=1; i<n; i++) {
+    if (!(k[i] > k[i-1])) monotonic = false;
+  }
+
+  // Evenly spaced breakpoints are common (Mach, altitude, deflection
+  // tables). Find() only uses the spacing for a first guess, so it does not
+  // need to be exact.
+  if (monotonic && n > 2) {
+    double step = (k[n-1] - k[0]) / (n-1);
+    bool uniform = step > 0.0;
+    for (unsigned int i=1; uniform && i<n; i++) {
+      if (fabs(k[i] - k[i-1] - step) > 1e-6*step) uniform = false;
+    }
+    if (uniform) invStep = 1.0/step;
+  }
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+unsigned int FGTable::Breakpoints::Find(double key, unsigned int i) const
+{
+  if (!monotonic) {
+    while (i > 1   && keys[i-1] > key) i--;
+    while (i < n-1 && keys[i]   < key) i++;
+    return i;
+  }
+
+  // A linear walk would move down to the first breakpoint above the key,
+  // or up to the first breakpoint at or above it. Jump there instead, to a
+  // guess from the spacing or by a binary search.
+  if (key < keys[i-1]) {
+    if (invStep > 0.0) {
+      double g = (key - keys[0]) * invStep;
+      if (!(g > 0.0)) g = 0.0;
+      i = (unsigned int)g + 1;
+      while (i > 1   && keys[i-1] > key)  i--;
+      while (i < n-1 && keys[i]   <= key) i++;
+    } else {
+      i = upper_bound(keys, keys + i, key) - keys;
+      if (i < 1) i = 1;
+    }
+  } else if (key > keys[i] && i < n-1) {
+    if (invStep > 0.0) {
+      double g = (key - keys[0]) * invStep;
+      if (g > n-2) g = n-2;
+      i = (unsigned int)g + 1;
+      while (i > 1   && keys[i-1] >= key) i--;
+      while (i < n-1 && keys[i]   <  key) i++;
+    } else {
+      i = lower_bound(keys + i + 1, keys + n - 1, key) - keys;
+    }
+  }
+
+  return i;
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void FGTable::Pack(void) const
+{
+  unsigned int r, c;
+
+  switch (Type) {
+  case tt1D:
+    Packed.resize(2*nRows);
+    for (r=0; r<nRows; r++) {
+      Packed[r] = Data[r+1][0];
+      Packed[nRows+r] = Data[r+1][1];
+    }
+    RowKeys.Init(&Packed[0], nRows);
+    ColumnKeys.Init(0, 0);
+    Values = &Packed[nRows];
+    break;
+  case tt2D:
+    Packed.resize(nRows + nCols + nRows*nCols);
+    for (r=0; r<nRows; r++) Packed[r] = Data[r+1][0];
+    for (c=0; c<nCols; c++) Packed[nRows+c] = Data[0][c+1];
+    for (r=0; r<nRows; r++) {
+      for (c=0; c<nCols; c++) {
+        Packed[nRows + nCols + r*nCols + c] = Data[r+1][c+1];
+      }
+    }
+    RowKeys.Init(&Packed[0], nRows);
+    ColumnKeys.Init(&Packed[nRows], nCols);
+    Values = &Packed[nRows + nCols];
+    break;
+  case tt3D:
+    Packed.resize(nRows);
+    for (r=0; r<nRows; r++) Packed[r] = Data[r+1][1];
+    RowKeys.Init(&Packed[0], nRows);
+    ColumnKeys.Init(0, 0);
+    Values = 0;
+    break;
+  }
+
+  packed = true;
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
 double FGTable::GetValue(double key) const
 {
-  double Factor, Value, Span;
+  if (!packed) Pack();
+
+  unsigned int r = lastRowIndex;
+  double Value = Lookup(key, r);
+  lastRowIndex = r;
+
+  return Value;
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+double FGTable::GetValue(double rowKey, double colKey) const
+{
+  if (!packed) Pack();
+
   unsigned int r = lastRowIndex;
+  unsigned int c = lastColumnIndex;
+  double Value = Lookup(rowKey, colKey, r, c);
+  lastRowIndex = r;
+  lastColumnIndex = c;
+
+  return Value;
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+double FGTable::GetValue(double rowKey, double colKey, double tableKey) const
+{
+  if (!packed) Pack();
+
+  unsigned int r = lastRowIndex;
+  double Value = Lookup(rowKey, colKey, tableKey, r);
+  lastRowIndex = r;
+
+  return Value;
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void FGTable::GetValues(const double* keys, double* values, unsigned int n) const
+{
+  if (!packed) Pack();
+
+  unsigned int r = lastRowIndex;
+  for (unsigned int i=0; i<n; i++) values[i] = Lookup(keys[i], r);
+  lastRowIndex = r;
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void FGTable::GetValues(const double* rowKeys, const double* colKeys,
+                        double* values, unsigned int n) const
+{
+  if (!packed) Pack();
+
+  unsigned int r = lastRowIndex;
+  unsigned int c = lastColumnIndex;
+  for (unsigned int i=0; i<n; i++) {
+    values[i] = Lookup(rowKeys[i], colKeys[i], r, c);
+  }
+  lastRowIndex = r;
+  lastColumnIndex = c;
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+void FGTable::GetValues(const double* rowKeys, const double* colKeys,
+                        const double* tableKeys, double* values,
+                        unsigned int n) const
+{
+  if (!packed) Pack();
+
+  unsigned int r = lastRowIndex;
+  for (unsigned int i=0; i<n; i++) {
+    values[i] = Lookup(rowKeys[i], colKeys[i], tableKeys[i], r);
+  }
+  lastRowIndex = r;
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+double FGTable::Lookup(double key, unsigned int& r) const
+{
+  const double* k = RowKeys.keys;
+  double Factor, Span;
 
   //if the key is off the end of the table, just return the
   //end-of-table value, do not extrapolate
-  if( key <= Data[1][0] ) {
-    lastRowIndex=2;
-    //cout << "Key underneath table: " << key << endl;
-    return Data[1][1];
-  } else if ( key >= Data[nRows][0] ) {
-    lastRowIndex=nRows;
-    //cout << "Key over table: " << key << endl;
-    return Data[nRows][1];
+  if( key <= k[0] || nRows < 2 ) {
+    r = 1;
+    return Values[0];
+  } else if ( key >= k[nRows-1] ) {
+    r = nRows-1;
+    return Values[nRows-1];
   }
 
   // the key is somewhere in the middle, search for the right breakpoint
-  // The search is particularly efficient if 
-  // the correct breakpoint has not changed since last frame or
-  // has only changed very little
-
-  while (r > 2     && Data[r-1][0] > key) { r--; }
-  while (r < nRows && Data[r][0]   < key) { r++; }
+  r = RowKeys.Find(key, r);
 
-  lastRowIndex=r;
   // make sure denominator below does not go to zero.
-
-  Span = Data[r][0] - Data[r-1][0];
+  Span = k[r] - k[r-1];
   if (Span != 0.0) {
-    Factor = (key - Data[r-1][0]) / Span;
+    Factor = (key - k[r-1]) / Span;
     if (Factor > 1.0) Factor = 1.0;
   } else {
     Factor = 1.0;
   }
 
-  Value = Factor*(Data[r][1] - Data[r-1][1]) + Data[r-1][1];
-
-  return Value;
+  return Factor*(Values[r] - Values[r-1]) + Values[r-1];
 }
 
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
-double FGTable::GetValue(double rowKey, double colKey) const
+double FGTable::Lookup(double rowKey, double colKey, unsigned int& r,
+                       unsigned int& c) const
 {
-  double rFactor, cFactor, col1temp, col2temp, Value;
-  unsigned int r = lastRowIndex;
-  unsigned int c = lastColumnIndex;
-
-  while(r > 2     && Data[r-1][0] > rowKey) { r--; }
-  while(r < nRows && Data[r]  [0] < rowKey) { r++; }
+  const double* rk = RowKeys.keys;
+  const double* ck = ColumnKeys.keys;
+  double rFactor, cFactor, col1temp, col2temp;
 
-  while(c > 2     && Data[0][c-1] > colKey) { c--; }
-  while(c < nCols && Data[0][c]   < colKey) { c++; }
+  r = RowKeys.Find(rowKey, r);
+  c = ColumnKeys.Find(colKey, c);
 
-  lastRowIndex=r;
-  lastColumnIndex=c;
-
-  rFactor = (rowKey - Data[r-1][0]) / (Data[r][0] - Data[r-1][0]);
-  cFactor = (colKey - Data[0][c-1]) / (Data[0][c] - Data[0][c-1]);
+  rFactor = (rowKey - rk[r-1]) / (rk[r] - rk[r-1]);
+  cFactor = (colKey - ck[c-1]) / (ck[c] - ck[c-1]);
 
   if (rFactor > 1.0) rFactor = 1.0;
   else if (rFactor < 0.0) rFactor = 0.0;
@@ -495,61 +675,57 @@ double FGTable::GetValue(double rowKey, double colKey) const
   if (cFactor > 1.0) cFactor = 1.0;
   else if (cFactor < 0.0) cFactor = 0.0;
 
-  col1temp = rFactor*(Data[r][c-1] - Data[r-1][c-1]) + Data[r-1][c-1];
-  col2temp = rFactor*(Data[r][c] - Data[r-1][c]) + Data[r-1][c];
+  const double* v0 = Values + (r-1)*nCols; // row r-1
+  const double* v1 = v0 + nCols;           // row r
 
-  Value = col1temp + cFactor*(col2temp - col1temp);
+  col1temp = rFactor*(v1[c-1] - v0[c-1]) + v0[c-1];
+  col2temp = rFactor*(v1[c] - v0[c]) + v0[c];
 
-  return Value;
+  return col1temp + cFactor*(col2temp - col1temp);
 }
 
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
-double FGTable::GetValue(double rowKey, double colKey, double tableKey) const
+double FGTable::Lookup(double rowKey, double colKey, double tableKey,
+                       unsigned int& r) const
 {
-  double Factor, Value, Span;
-  unsigned int r = lastRowIndex;
+  const double* k = RowKeys.keys;
+  double Factor, Span;
 
   //if the key is off the end  (or before the beginning) of the table,
   // just return the boundary-table value, do not extrapolate
 
-  if( tableKey <= Data[1][1] ) {
-    lastRowIndex=2;
+  if( tableKey <= k[0] ) {
+    r = 1;
     return Tables[0]->GetValue(rowKey, colKey);
-  } else if ( tableKey >= Data[nRows][1] ) {
-    lastRowIndex=nRows;
+  } else if ( tableKey >= k[nRows-1] ) {
+    r = nRows-1;
     return Tables[nRows-1]->GetValue(rowKey, colKey);
   }
 
-  // the key is somewhere in the middle, search for the right breakpoint
-  // The search is particularly efficient if 
-  // the correct breakpoint has not changed since last frame or
-  // has only changed very little
-
-  while(r > 2     && Data[r-1][1] > tableKey) { r--; }
-  while(r < nRows && Data[r]  [1] < tableKey) { r++; }
+  r = RowKeys.Find(tableKey, r);
 
-  lastRowIndex=r;
   // make sure denominator below does not go to zero.
-
-  Span = Data[r][1] - Data[r-1][1];
+  Span = k[r] - k[r-1];
   if (Span != 0.0) {
-    Factor = (tableKey - Data[r-1][1]) / Span;
+    Factor = (tableKey - k[r-1]) / Span;
     if (Factor > 1.0) Factor = 1.0;
   } else {
     Factor = 1.0;
   }
 
-  Value = Factor*(Tables[r-1]->GetValue(rowKey, colKey) - Tables[r-2]->GetValue(rowKey, colKey))
-                              + Tables[r-2]->GetValue(rowKey, colKey);
+  double Value1 = Tables[r]->GetValue(rowKey, colKey);
+  double Value0 = Tables[r-1]->GetValue(rowKey, colKey);
 
-  return Value;
+  return Factor*(Value1 - Value0) + Value0;
 }
 
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
 void FGTable::operator<<(istream& in_stream)
 {
+  packed = false;
+
   int startRow=0;
   int startCol=0;
 
@@ -571,6 +747,7 @@ void FGTable::operator<<(istream& in_stream)
 
 FGTable& FGTable::operator<<(const double n)
 {
+  packed = false;
   Data[rowCounter][colCounter] = n;
   if (colCounter == (int)nCols) {
     colCounter = 0;
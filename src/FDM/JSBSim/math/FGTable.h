@@ -258,6 +258,19 @@ public:
   double GetValue(double key) const;
   double GetValue(double rowKey, double colKey) const;
   double GetValue(double rowKey, double colKey, double TableKey) const;
+
+  /** Look up many keys at once, e.g. for a trim sweep. The results are
+      the same as for n calls of GetValue() with the same keys, but the
+      table is searched without the call overhead per key. Consecutive keys
+      close to each other are the fastest.
+      @param keys the n (row) keys
+      @param values the n results */
+  void GetValues(const double* keys, double* values, unsigned int n) const;
+  void GetValues(const double* rowKeys, const double* colKeys,
+                 double* values, unsigned int n) const;
+  void GetValues(const double* rowKeys, const double* colKeys,
+                 const double* tableKeys, double* values, unsigned int n) const;
+
   /** Read the table in.
       Data in the config file should be in matrix format with the row
       independents as the first column and the column independents in
@@ -302,6 +315,20 @@ public:
 private:
   enum type {tt1D, tt2D, tt3D} Type;
   enum axis {eRow=0, eColumn, eTable};
+
+  /** Breakpoints of one axis of the packed table. Find() returns the index
+      of the upper breakpoint of the interval holding the key, starting at
+      the interval of the previous lookup. It gives the same index as the
+      linear walk from that interval, also for keys on a breakpoint. */
+  struct Breakpoints {
+    const double* keys;
+    unsigned int n;
+    bool monotonic;  // strictly increasing, else Find() walks
+    double invStep;  // 1/spacing if the breakpoints are evenly spaced, else 0
+    unsigned int Find(double key, unsigned int i) const;
+    void Init(const double* k, unsigned int nKeys);
+  };
+
   bool internal;
   FGPropertyNode_ptr lookupProperty[3];
   double** Data;
@@ -310,6 +337,21 @@ private:
   int colCounter, rowCounter, tableCounter;
   mutable int lastRowIndex, lastColumnIndex, lastTableIndex;
   double** Allocate(void);
+
+  // Data repacked for the lookups: the row keys (or table keys of a 3D
+  // table), the column keys and the values by row, in one buffer. Built on
+  // the first lookup after the data has changed.
+  mutable std::vector<double> Packed;
+  mutable Breakpoints RowKeys, ColumnKeys;
+  mutable const double* Values;
+  mutable bool packed;
+  void Pack(void) const;
+  double Lookup(double key, unsigned int& r) const;
+  double Lookup(double rowKey, double colKey, unsigned int& r,
+                unsigned int& c) const;
+  double Lookup(double rowKey, double colKey, double tableKey,
+                unsigned int& r) const;
+
   FGPropertyManager* const PropertyManager;
   std::string Prefix;
   std::string Name;
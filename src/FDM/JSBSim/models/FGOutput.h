@@ -221,6 +221,11 @@ public:
                  be obtained
       @result the name identifier.*/
   std::string GetOutputName(unsigned int idx) const;
+  /** Tells whether an output instance writes to a file, in which case its
+      name identifier is a file name.
+      @param idx ID of the output instance
+      @result false if the instance does not exist or is not a file output.*/
+  bool IsFileOutput(unsigned int idx) const;
 
 private:
   std::vector<FGOutputType*> OutputTypes;
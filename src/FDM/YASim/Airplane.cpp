@@ -623,7 +623,10 @@ void Airplane::compile(bool verbose)
     solveGear();
     calculateCGHardLimits();
     
-    if(_wing && _tail) solveAirplane(verbose);
+    if(_wing && _tail) {
+        if(_haveCachedSolution) applySolution(_cachedSolution);
+        else solveAirplane(verbose);
+    }
     else
     {
        // The rotor(s) mass:
@@ -892,14 +895,9 @@ float Airplane::_checkConvergence(float prev, float current)
     return current;
 }
 
-void Airplane::solveAirplane(bool verbose)
+/// Helper for solveAirplane() and applySolution()
+void Airplane::initSolverControls()
 {
-    static const float ARCMIN = 0.0002909f;
-
-    float tmp[3];
-    _solutionIterations = 0;
-    _failureMsg = 0;
-
     if (_approachElevator == nullptr) {        
         setElevatorControl(DEF_PROP_ELEVATOR_TRIM);
     }
@@ -910,6 +908,17 @@ void Airplane::solveAirplane(bool verbose)
         _tailIncidence = new ControlSetting;
         _tailIncidenceCopy = new ControlSetting;
     }
+}
+
+void Airplane::solveAirplane(bool verbose)
+{
+    static const float ARCMIN = 0.0002909f;
+
+    float tmp[3];
+    _solutionIterations = 0;
+    _failureMsg = 0;
+
+    initSolverControls();
     if (verbose) {
         fprintf(stdout,"i\tdAoa\tdTail\tcl0\tcp1\n");
     }
@@ -1037,7 +1046,42 @@ void Airplane::solveAirplane(bool verbose)
             }
         }
     }
+    checkSolution();
+}
+
+/// Sets up the airplane as solveAirplane() would have done, without
+/// iterating. The result of runConfig() only depends on the input
+/// values of the solver, so one run of the approach configuration
+/// leaves the model in the same state.
+void Airplane::applySolution(const Solution& s)
+{
+    _solutionIterations = 0;
+    _failureMsg = 0;
+
+    initSolverControls();
+    // applyDragFactor() and applyLiftRatio() apply factor^_solverDelta
+    applyDragFactor(Math::pow(s.dragFactor, 1/_solverDelta));
+    applyLiftRatio(Math::pow(s.liftRatio, 1/_solverDelta));
+    _config[CRUISE].aoa = s.cruiseAoA;
+    _tailIncidenceCopy->val = _tailIncidence->val = s.tailIncidence;
+    _tail->setIncidence(_tailIncidence->val);
+    _approachElevator->val = s.approachElevator;
+    runConfig(_config[APPROACH]);
+    checkSolution();
+}
 
+void Airplane::getSolution(Solution& s) const
+{
+    s.dragFactor = _dragFactor;
+    s.liftRatio = _liftRatio;
+    s.cruiseAoA = _config[CRUISE].aoa;
+    s.tailIncidence = getTailIncidence();
+    s.approachElevator = getApproachElevator();
+}
+
+/// Helper for solveAirplane() and applySolution()
+void Airplane::checkSolution()
+{
     if(_dragFactor < 1e-06 || _dragFactor > 1e6) {
         _failureMsg = "Drag factor beyond reasonable bounds.";
         return;
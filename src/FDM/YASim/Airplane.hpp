@@ -108,6 +108,20 @@ public:
     float getApproachElevator() const;
     const char* getFailureMsg() const { return _failureMsg; }
     float getMass() const { return _model.getMass(); };
+
+    /// The values found by solveAirplane(), enough to skip it next time
+    struct Solution {
+        float dragFactor {1};
+        float liftRatio {1};
+        float cruiseAoA {0};
+        float tailIncidence {0};
+        float approachElevator {0};
+    };
+    void getSolution(Solution& s) const;
+    /// use a previously found solution in compile() instead of running
+    /// the solver, must be called before compile()
+    void setCachedSolution(const Solution& s) { _cachedSolution = s; _haveCachedSolution = true; }
+    bool usedCachedSolution() const { return _haveCachedSolution; }
     
     // next two are used only in yasim CLI tool
     void setApproachControls() { setControlValues(_config[APPROACH].controls); }
@@ -202,6 +216,9 @@ private:
     float _checkConvergence(float prev, float current);
     void solveAirplane(bool verbose = false);
     void solveHelicopter(bool verbose = false);
+    void initSolverControls();
+    void applySolution(const Solution& s);
+    void checkSolution();
     float compileWing(Wing* w);
     void compileRotorgear();
     float compileFuselage(Fuselage* f);
@@ -263,6 +280,8 @@ private:
     ControlSetting* _tailIncidenceCopy {nullptr}; 
     ControlSetting* _approachElevator {nullptr};
     const char* _failureMsg {0};
+    Solution _cachedSolution;
+    bool _haveCachedSolution {false};
     /// hard limits for cg from gear position
     float _cgMax {-1e6};         
     /// hard limits for cg from gear position
@@ -210,12 +210,30 @@ void FGFDM::init()
     _airplane.getModel()->setTurbulence(_turb);
 }
 
+// FNV-1a, including the terminating 0 so "ab","c" != "a","bc"
+void FGFDM::hashString(const char* s)
+{
+    do {
+        _parseHash ^= (unsigned char)*s;
+        _parseHash *= 1099511628211ULL;
+    } while(*s++);
+}
+
 // Not the worlds safest parser.  But it's short & sweet.
 void FGFDM::startElement(const char* name, const XMLAttributes &a)
 {
     //XMLAttributes* a = (XMLAttributes*)&atts;
     float v[3] {0,0,0};
     
+    // Element names can't be "=" or "/", so the markers keep
+    // attributes, child elements and closing tags apart.
+    hashString(name);
+    for(int i=0; i<a.size(); i++) {
+        hashString("=");
+        hashString(a.getName(i));
+        hashString(a.getValue(i));
+    }
+
     if(!strcmp(name, "airplane")) { parseAirplane(&a); }
     else if(!strcmp(name, "approach") || !strcmp(name, "cruise")) { 
         parseApproachCruise(&a, name);         
@@ -264,6 +282,11 @@ void FGFDM::startElement(const char* name, const XMLAttributes &a)
     }
 } // startElement
 
+void FGFDM::endElement(const char* name)
+{
+    hashString("/");
+}
+
 void FGFDM::parseAirplane(const XMLAttributes* a)
 {
     float f {0};
@@ -1,6 +1,8 @@
 #ifndef _FGFDM_HPP
 #define _FGFDM_HPP
 
+#include <cstdint>
+
 #include <simgear/xml/easyxml.hxx>
 #include <simgear/props/props.hxx>
 
@@ -25,11 +27,17 @@ public:
 
     Airplane* getAirplane();
 
-    // XML parsing callback from XMLVisitor
+    // XML parsing callbacks from XMLVisitor
     virtual void startElement(const char* name, const XMLAttributes &atts);
+    virtual void endElement(const char* name);
 
     float getVehicleRadius(void) const { return _vehicle_radius; }
 
+    // Hash of all elements, attributes and their nesting parsed so
+    // far. The compiled airplane depends on nothing else, so this
+    // identifies it e.g. for caching the solver results.
+    uint64_t getParseHash() const { return _parseHash; }
+
 private:
     struct EngRec { 
         char* prefix {nullptr}; 
@@ -113,6 +121,8 @@ private:
     float _vehicle_radius {0};
 
     // Parsing temporaries
+    void hashString(const char* s);
+    uint64_t _parseHash {14695981039346656037ULL};
     void* _currObj {nullptr};
     Airplane::Configuration _airplaneCfg;
     int _nextEngine {0};
@@ -51,6 +51,26 @@ void FGGround::getGroundPlane(const double pos[3],
     for(int i=0; i<3; i++) vel[i] = dvel[i];
 }
 
+void FGGround::getGroundPlanes(int count, const double* pos,
+                               double* plane, float* vel,
+                               const simgear::BVHMaterial **material)
+{
+    // One query for all points, so the ground cache is walked only once.
+    _results.resize(count);
+    _iface->get_agl_m(_toff, count, (const double (*)[3])pos, 2,
+                      _results.data());
+
+    for(int i=0; i<count; i++) {
+        const FGGroundCache::AglResult& r = _results[i];
+        double* p = plane + 4*i;
+        for(int j=0; j<3; j++) p[j] = r.normal[j];
+        // The plane below the actual contact point.
+        p[3] = dot(r.normal, r.contact);
+        for(int j=0; j<3; j++) vel[3*i+j] = r.linearVel[j];
+        material[i] = r.material;
+    }
+}
+
 bool FGGround::caughtWire(const double pos[4][3])
 {
     return _iface->caught_wire_m(_toff, pos);
@@ -40,6 +40,16 @@ void Ground::getGroundPlane(const double pos[3],
     getGroundPlane(pos,plane,vel);
 }
 
+void Ground::getGroundPlanes(int count, const double* pos,
+                             double* plane, float* vel,
+                             const simgear::BVHMaterial **material)
+{
+    for(int i=0; i<count; i++) {
+        material[i] = 0;
+        getGroundPlane(pos+3*i, plane+4*i, vel+3*i, material+i);
+    }
+}
+
 bool Ground::caughtWire(const double pos[4][3])
 {
     return false;
@@ -18,6 +18,13 @@ public:
                                 double plane[4], float vel[3],
                                 const simgear::BVHMaterial **material);
 
+    // The ground planes under count points at once, pos, plane and vel
+    // hold 3, 4 and 3 values per point. The default asks
+    // getGroundPlane() for each point in turn.
+    virtual void getGroundPlanes(int count, const double* pos,
+                                 double* plane, float* vel,
+                                 const simgear::BVHMaterial **material);
+
     virtual bool caughtWire(const double pos[4][3]);
 
     virtual bool getWire(double end[2][3], float vel[2][3]);
@@ -141,6 +141,10 @@ void Model::initIteration()
         Hitch* h = (Hitch*)_hitches.get(i);
         h->integrate(_integrator.getInterval());
     }
+
+    // Controls and coefficients are constant over the iteration
+    if(_compiledSurfaces)
+        _surfaceSet.load(_surfaces);
 }
 
 // This function initializes some variables for the rotor calculation
@@ -196,7 +200,12 @@ void Model::updateGround(State* s)
 
     int i;
     // The landing gear
-    for(i=0; i<_gears.size(); i++) {
+    int ngear = _gears.size();
+    _gearPos.resize(3*ngear);
+    _gearPlane.resize(4*ngear);
+    _gearVel.resize(3*ngear);
+    _gearMaterial.resize(ngear);
+    for(i=0; i<ngear; i++) {
 	Gear* g = (Gear*)_gears.get(i);
 
 	// Get the point of ground contact
@@ -208,15 +217,19 @@ void Model::updateGround(State* s)
 	Math::add3(cmpr, pos, pos);
         // Transform the local coordinates of the contact point to
         // global coordinates.
-        double pt[3];
-        s->posLocalToGlobal(pos, pt);
+        s->posLocalToGlobal(pos, &_gearPos[3*i]);
+    }
 
-        // Ask for the ground plane in the global coordinate system
-        double global_ground[4];
-        float global_vel[3];
-        const simgear::BVHMaterial* material;
-        _ground_cb->getGroundPlane(pt, global_ground, global_vel, &material);
-        g->setGlobalGround(global_ground, global_vel, pt[0], pt[1], material);
+    // Ask for the ground planes in the global coordinate system, all
+    // gear at once
+    if(ngear > 0)
+        _ground_cb->getGroundPlanes(ngear, _gearPos.data(), _gearPlane.data(),
+                                    _gearVel.data(), _gearMaterial.data());
+    for(i=0; i<ngear; i++) {
+	Gear* g = (Gear*)_gears.get(i);
+        const double* pt = &_gearPos[3*i];
+        g->setGlobalGround(&_gearPlane[4*i], &_gearVel[3*i], pt[0], pt[1],
+                           _gearMaterial[i]);
     }
 
     for(i=0; i<_hitches.size(); i++) {
@@ -298,20 +311,44 @@ void Model::calcForces(State* s)
     // Do each surface, remembering that the local velocity at each
     // point is different due to rotation.
     float faero[3] {0,0,0};    
-    for(i=0; i<_surfaces.size(); i++) {
-      Surface* sf = (Surface*)_surfaces.get(i);
+    if(_compiledSurfaces && _surfaceSet.size() == _surfaces.size()) {
+      float cg[3];
+      _body.getCG(cg);
+      if(!_turb && !_rotorgear.isInUse()) {
+        float lwind[3], lrot[3], lv[3];
+        Math::vmul33(s->orient, _wind, lwind);
+        Math::vmul33(s->orient, s->rot, lrot);
+        Math::vmul33(s->orient, s->v, lv);
+        _surfaceSet.calcWind(lwind, lrot, lv, cg);
+      } else {
+        for(i=0; i<_surfaceSet.size(); i++) {
+          float vs[3], pos[3];
+          _surfaceSet.getPosition(i, pos);
+          localWind(pos, s, vs, alt);
+          _surfaceSet.setWind(i, vs);
+        }
+      }
 
-      // Vsurf = wind - velocity + (rot cross (cg - pos))
-      float vs[3], pos[3];
-      sf->getPosition(pos);
-      localWind(pos, s, vs, alt);
+      float torque[3];
+      _surfaceSet.calcForces(_atmo.getDensity(), cg, faero, torque);
+      _body.addForce(faero);
+      _body.addTorque(torque);
+    } else {
+      for(i=0; i<_surfaces.size(); i++) {
+        Surface* sf = (Surface*)_surfaces.get(i);
 
-      float force[3], torque[3];
-      sf->calcForce(vs, _atmo.getDensity(), force, torque);
-      Math::add3(faero, force, faero);
+        // Vsurf = wind - velocity + (rot cross (cg - pos))
+        float vs[3], pos[3];
+        sf->getPosition(pos);
+        localWind(pos, s, vs, alt);
 
-      _body.addForce(pos, force);
-      _body.addTorque(torque);
+        float force[3], torque[3];
+        sf->calcForce(vs, _atmo.getDensity(), force, torque);
+        Math::add3(faero, force, faero);
+
+        _body.addForce(pos, force);
+        _body.addTorque(torque);
+      }
     }
 
     for (j=0; j<_rotorgear.getRotors()->size();j++)
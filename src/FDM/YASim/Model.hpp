@@ -8,7 +8,13 @@
 #include "Turbulence.hpp"
 #include "Rotor.hpp"
 #include "Atmosphere.hpp"
+#include "SurfaceSet.hpp"
 #include <simgear/props/props.hxx>
+#include <vector>
+
+namespace simgear {
+class BVHMaterial;
+}
 
 namespace yasim {
 
@@ -35,6 +41,10 @@ public:
 
     void setTurbulence(Turbulence* turb) { _turb = turb; }
 
+    // Evaluate all surfaces at once through a SurfaceSet instead of
+    // one Surface::calcForce() call each.
+    void setCompiledSurfaces(bool enabled) { _compiledSurfaces = enabled; }
+
     State* getState() const { return _s; }
     void setState(State* s);
 
@@ -93,6 +103,8 @@ private:
 
     Vector _thrusters;
     Vector _surfaces;
+    SurfaceSet _surfaceSet;
+    bool _compiledSurfaces {false};
     Rotorgear _rotorgear;
     Vector _gears;
     Hook* _hook {nullptr};
@@ -105,6 +117,11 @@ private:
 
     Ground* _ground_cb;
     double _global_ground[4] {0,0,1, -1e5};
+    // gear contact points and their ground, queried together
+    std::vector<double> _gearPos;
+    std::vector<double> _gearPlane;
+    std::vector<float> _gearVel;
+    std::vector<const simgear::BVHMaterial*> _gearMaterial;
     Atmosphere _atmo;
     float _wind[3] {0,0,0};
     
@@ -209,7 +209,12 @@ void Surface::calcForce(const float* v, const float rho, float* out, float* torq
     float scale = 0.5f*rho*vel*vel*_c0;
     Math::mul3(scale, out, out);
     Math::mul3(scale, torque, torque);
-    // if we have a property tree, export info
+    exportForce(out);
+}
+
+// if we have a property tree, export info
+void Surface::exportForce(const float* out)
+{
     if (_surfN != 0) {
       _fabsN->setFloatValue(Math::mag3(out));
       _fxN->setFloatValue(out[0]);
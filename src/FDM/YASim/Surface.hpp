@@ -12,6 +12,8 @@ namespace yasim {
 // front, and flaps act (in both lift and drag) toward the back.
 class Surface
 {
+    friend class SurfaceSet;
+
     static int s_idGenerator;
     int _id;        //index for property tree
 
@@ -95,6 +97,7 @@ private:
     float stallFunc(float* v);
     float flapLift(float alpha);
     float controlDrag(float lift, float drag);
+    void exportForce(const float* out);
 
     float _chord {0};     // X-axis size
     float _c0 {1};        // total force coefficient
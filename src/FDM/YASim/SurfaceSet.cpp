@@ -0,0 +1,278 @@
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "Math.hpp"
+#include "Surface.hpp"
+
+#include "SurfaceSet.hpp"
+
+// The arrays of a SurfaceSet never overlap. Telling the compiler so
+// lets it vectorize the loops below, there are too many arrays for
+// runtime overlap checks.
+#if defined(__clang__)
+#  define SURFACESET_IVDEP _Pragma("clang loop vectorize(assume_safety)")
+#elif defined(__GNUC__)
+#  define SURFACESET_IVDEP _Pragma("GCC ivdep")
+#elif defined(_MSC_VER)
+#  define SURFACESET_IVDEP __pragma(loop(ivdep))
+#else
+#  define SURFACESET_IVDEP
+#endif
+
+namespace yasim {
+
+// 1 if c, else 0
+static inline float mask(bool c) { return c ? 1.f : 0.f; }
+
+// m ? a : b for a mask m, without a branch. Exact as long as a and b
+// are finite.
+static inline float blend(float m, float a, float b) { return m*a + (1-m)*b; }
+
+// Clamp to [0:1], keeps the smoothstep below finite.
+static inline float clamp01(float f)
+{
+    f = f < 0 ? 0 : f;
+    return f > 1 ? 1 : f;
+}
+
+void SurfaceSet::load(const Vector& surfaces)
+{
+    int n = surfaces.size();
+    if(n != size()) {
+        _surfaces.resize(n);
+        std::vector<float>* arrays[] = {
+            &_px, &_py, &_pz,
+            &_active, &_c0, &_cx, &_cy, &_cz, &_czcz0, &_incidence,
+            &_stall0, &_scaleFwd, &_scaleBack, &_spoilerMul, &_flapLift,
+            &_dragFd, &_inducedDrag, &_torqueArm,
+            &_vx, &_vy, &_vz, &_fx, &_fy, &_fz, &_tx, &_ty, &_tz,
+            &_on, &_alpha, &_stallAlpha, &_v32 };
+        for(std::vector<float>* a : arrays) a->resize(n);
+        for(int j=0; j<9; j++) _m[j].resize(n);
+        for(int j=0; j<4; j++) {
+            _stall[j].resize(n);
+            _width[j].resize(n);
+        }
+        for(int j=0; j<3; j++) _dragMul[j].resize(n);
+    }
+
+    for(int i=0; i<n; i++) {
+        Surface* s = (Surface*)surfaces.get(i);
+        _surfaces[i] = s;
+
+        _px[i] = s->_pos[0];
+        _py[i] = s->_pos[1];
+        _pz[i] = s->_pos[2];
+        for(int j=0; j<9; j++) _m[j][i] = s->_orient[j];
+
+        _active[i] = (s->_cx == 0 && s->_cy == 0 && s->_cz == 0) ? 0 : 1;
+        _c0[i] = s->_c0;
+        _cx[i] = s->_cx;
+        _cy[i] = s->_cy;
+        _cz[i] = s->_cz;
+        _czcz0[i] = s->_cz*s->_cz0;
+        _incidence[i] = s->_incidence + s->_twist;
+        _v32[i] = s->_version->isVersionOrNewer(Version::YASIM_VERSION_32) ? 1 : 0;
+
+        // Surface::stallFunc()
+        for(int j=0; j<4; j++) {
+            _stall[j][i] = s->_stalls[j];
+            _width[j][i] = s->_widths[j];
+        }
+        _stall0[i] = s->_stalls[0];
+        _stall0[i] += _v32[i] != 0 ? s->_slatPos * s->_slatAlpha : s->_slatAlpha;
+        _scaleFwd[i] = s->_stalls[0] != 0 ? 0.5f*s->_peaks[0]/s->_stalls[0] : 0;
+        _scaleBack[i] = s->_stalls[2] != 0 ? 0.5f*s->_peaks[1]/s->_stalls[2] : 0;
+        _spoilerMul[i] = 1 + s->_spoilerPos * (s->_spoilerLift - 1);
+
+        // Surface::flapLift()
+        _flapLift[i] = 0;
+        if(s->_stalls[0] != 0)
+            _flapLift[i] = s->_cz * s->_flapPos * (s->_flapLift-1) * s->_flapEffectiveness;
+
+        // Surface::controlDrag()
+        float fp = s->_flapPos;
+        if(fp < 0) {
+            fp = -fp;
+            fp -= s->_cz0/(s->_flapLift-1);
+            if(fp < 0) fp = 0;
+        }
+        float flapDragAoA = (s->_flapLift - 1 - s->_cz0) * s->_stalls[0];
+        _dragFd[i] = flapDragAoA * fp;
+        _dragMul[0][i] = 1 + fp * (s->_flapDrag - 1);
+        _dragMul[1][i] = 1 + s->_spoilerPos * (s->_spoilerDrag - 1);
+        _dragMul[2][i] = 1 + s->_slatPos * (s->_slatDrag - 1);
+
+        _inducedDrag[i] = -1*s->_inducedDrag;
+        _torqueArm[i] = 0.1667f * s->_chord;
+    }
+}
+
+void SurfaceSet::calcWind(const float* wind, const float* lrot,
+                          const float* lv, const float* cg)
+{
+    // local copies, so the compiler knows the stores below don't
+    // change them
+    const float w[3] = { wind[0], wind[1], wind[2] };
+    const float r[3] = { lrot[0], lrot[1], lrot[2] };
+    const float v[3] = { lv[0], lv[1], lv[2] };
+    const float c[3] = { cg[0], cg[1], cg[2] };
+
+    const int n = size();
+    SURFACESET_IVDEP
+    for(int i=0; i<n; i++) {
+        // Same steps as Model::localWind()
+        float dx = _px[i] - c[0], dy = _py[i] - c[1], dz = _pz[i] - c[2];
+        _vx[i] = w[0] + -(r[1]*dz - r[2]*dy) - v[0];
+        _vy[i] = w[1] + -(r[2]*dx - r[0]*dz) - v[1];
+        _vz[i] = w[2] + -(r[0]*dy - r[1]*dx) - v[2];
+    }
+}
+
+void SurfaceSet::setWind(int i, const float* v)
+{
+    _vx[i] = v[0];
+    _vy[i] = v[1];
+    _vz[i] = v[2];
+}
+
+void SurfaceSet::getPosition(int i, float* pos) const
+{
+    pos[0] = _px[i];
+    pos[1] = _py[i];
+    pos[2] = _pz[i];
+}
+
+// Surface::calcForce() for all surfaces. Early returns and ifs are
+// replaced by masks and blends between values which are all computed
+// and kept finite. Otherwise the compiler moves the computations into
+// branches again, and it can't vectorize loops with branches.
+void SurfaceSet::calcForces(float rho, const float* cg, float* force,
+                            float* torque)
+{
+    const int n = size();
+    SURFACESET_IVDEP
+    for(int i=0; i<n; i++) {
+        float vx = _vx[i], vy = _vy[i], vz = _vz[i];
+        float vel = Math::sqrt(vx*vx + vy*vy + vz*vz);
+        float on = _active[i] * mask(vel > 0);
+        float ivel = 1 / (vel + mask(vel == 0));
+
+        // Normalized wind in surface coordinates, rotated by the
+        // incidence angle
+        vx *= ivel; vy *= ivel; vz *= ivel;
+        float ox = vx*_m[0][i] + vy*_m[1][i] + vz*_m[2][i];
+        float oy = vx*_m[3][i] + vy*_m[4][i] + vz*_m[5][i];
+        float oz = vx*_m[6][i] + vy*_m[7][i] + vz*_m[8][i];
+        float incidence = _incidence[i];
+        oz += incidence * ox;
+
+        // stallFunc()
+        float stall0 = _stall[0][i], stall1 = _stall[1][i];
+        float stall2 = _stall[2][i], stall3 = _stall[3][i];
+        float width0 = _width[0][i], width1 = _width[1][i];
+        float width2 = _width[2][i], width3 = _width[3][i];
+        float slatStall = _stall0[i];
+        float scaleFwd = _scaleFwd[i], scaleBack = _scaleBack[i];
+
+        float back = mask(ox > 0);
+        float neg = mask(oz < 0);
+        float alpha = Math::abs(oz / (ox + mask(ox == 0)));
+        float stall = blend(back, blend(neg, stall3, stall2), blend(neg, stall1, stall0));
+        float stallAlpha = blend(mask(back + neg > 0), stall, slatStall);
+        stallAlpha *= mask(stall != 0);
+        float width = blend(back, blend(neg, width3, width2), blend(neg, width1, width0));
+        float scale = blend(back, scaleBack, scaleFwd);
+        float frac = clamp01((alpha - stallAlpha) / (width + mask(width == 0)));
+        frac = frac*frac*(3-2*frac);
+        float stallMul = blend(mask(alpha <= stallAlpha), scale, scale*(1-frac) + frac);
+        float beyond = mask((ox == 0) | (stall == 0) | (alpha > stallAlpha + width));
+        stallMul = blend(beyond, 1, stallMul);
+        _on[i] = on;
+        _alpha[i] = (ox != 0) ? alpha : -1;
+        _stallAlpha[i] = stallAlpha;
+
+        stallMul *= _spoilerMul[i];
+        float cz = _cz[i];
+        float stallLift = (stallMul - 1) * cz * oz;
+
+        // flapLift()
+        float fl = _flapLift[i];
+        float a = Math::abs(oz);
+        float ffrac = clamp01((a - stall0) / (width0 + mask(width0 == 0)));
+        ffrac = ffrac*ffrac*(3-2*ffrac);
+        float flaplift = blend(mask(a < stall0), fl,
+                               blend(mask(a > stall0 + width0), 0, fl * (1-ffrac)));
+
+        float fz = oz * cz;
+        fz += _czcz0[i];
+        fz += stallLift;
+        fz += flaplift;
+
+        float ty = _torqueArm[i] * (flaplift - (_czcz0[i] + stallLift));
+
+        // controlDrag()
+        float drag = _cx[i] * ox;
+        float fd = Math::abs(fz * _dragFd[i]);
+        drag += (1 - 2*mask(drag < 0)) * fd;
+        drag *= _dragMul[0][i];
+        drag *= _dragMul[1][i];
+        drag *= _dragMul[2][i];
+        float fx = drag;
+        float fy = oy * _cy[i];
+
+        // induced drag
+        float k = _inducedDrag[i] * fz * oz;
+        fx += k * ox;
+        fy += k * oy;
+        fz += k * oz;
+
+        // reverse the incidence rotation
+        float v32 = _v32[i];
+        float rx = fx + v32 * incidence * fz;
+        float rz = fz - (1 - v32) * incidence * fx;
+
+        // back to local coordinates and to a real force
+        float q = 0.5f*rho*vel*vel*_c0[i] * on;
+        _fx[i] = (rx*_m[0][i] + fy*_m[3][i] + rz*_m[6][i]) * q;
+        _fy[i] = (rx*_m[1][i] + fy*_m[4][i] + rz*_m[7][i]) * q;
+        _fz[i] = (rx*_m[2][i] + fy*_m[5][i] + rz*_m[8][i]) * q;
+        _tx[i] = ty*_m[3][i] * q;
+        _ty[i] = ty*_m[4][i] * q;
+        _tz[i] = ty*_m[5][i] * q;
+    }
+
+    // Sum up. A force applied at pos also adds the torque
+    // force cross (cg - pos), see RigidBody::addForce().
+    float f[3] = {0, 0, 0}, t[3] = {0, 0, 0};
+    for(int i=0; i<n; i++) {
+        float fx = _fx[i], fy = _fy[i], fz = _fz[i];
+        float dx = cg[0] - _px[i], dy = cg[1] - _py[i], dz = cg[2] - _pz[i];
+        f[0] += fx;
+        f[1] += fy;
+        f[2] += fz;
+        t[0] += _tx[i] + fy*dz - fz*dy;
+        t[1] += _ty[i] + fz*dx - fx*dz;
+        t[2] += _tz[i] + fx*dy - fy*dx;
+    }
+    Math::set3(f, force);
+    Math::set3(t, torque);
+
+    // State and debug properties of the individual surfaces
+    for(int i=0; i<n; i++) {
+        if(_on[i] == 0)
+            continue;
+        // stallFunc() returns early for wind along the surface
+        // normal, but calcForce() still exports the force
+        Surface* s = _surfaces[i];
+        if(_alpha[i] >= 0) {
+            s->_alpha = _alpha[i];
+            s->_stallAlpha = _stallAlpha[i];
+        }
+        float out[3] = { _fx[i], _fy[i], _fz[i] };
+        s->exportForce(out);
+    }
+}
+
+}; // namespace yasim
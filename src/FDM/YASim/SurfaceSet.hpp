@@ -0,0 +1,76 @@
+#ifndef _SURFACESET_HPP
+#define _SURFACESET_HPP
+
+#include <vector>
+
+#include "Vector.hpp"
+
+namespace yasim {
+
+class Surface;
+
+// A "compiled" copy of all surfaces of a model, kept as one array per
+// parameter (structure of arrays) so the aerodynamic force of all
+// surfaces can be computed in a few straight loops without branches the
+// compiler could not turn into selects, i.e. loops it can vectorize.
+//
+// The results match Surface::calcForce() up to rounding: everything
+// which does not depend on the wind is precomputed in load(), which
+// must be called whenever coefficients or control positions may have
+// changed (Model does so in initIteration(), so once per iteration
+// rather than once for each of the four RK4 force evaluations).
+class SurfaceSet
+{
+public:
+    // Copy the geometry, coefficients and control state of the surfaces.
+    void load(const Vector& surfaces);
+
+    int size() const { return (int)_surfaces.size(); }
+
+    // Wind at each surface, for the common case without turbulence or
+    // rotor downwash: wind - velocity - (rot cross (pos - cg)), all in
+    // local coordinates.
+    void calcWind(const float* wind, const float* lrot, const float* lv,
+                  const float* cg);
+    // Set the wind at a single surface, e.g. from Model::localWind().
+    void setWind(int i, const float* v);
+    void getPosition(int i, float* pos) const;
+
+    // Compute the force of all surfaces in the current wind. Returns
+    // the total force and the total torque about the c.g., and updates
+    // the surfaces' debug properties as calcForce() does.
+    void calcForces(float rho, const float* cg, float* force, float* torque);
+
+private:
+    std::vector<Surface*> _surfaces;
+
+    // geometry
+    std::vector<float> _px, _py, _pz;
+    std::vector<float> _m[9];        // local -> surface matrix
+
+    // coefficients, with the control state folded in
+    std::vector<float> _active;      // 0 for surfaces without any force
+    std::vector<float> _c0, _cx, _cy, _cz, _czcz0;
+    std::vector<float> _incidence;   // incidence + twist
+    std::vector<float> _v32;         // 1 for YASim version 32 or newer
+    std::vector<float> _stall[4], _stall0; // stall angles, [0] incl. slats
+    std::vector<float> _width[4];
+    std::vector<float> _scaleFwd, _scaleBack;
+    std::vector<float> _spoilerMul;
+    std::vector<float> _flapLift;
+    std::vector<float> _dragFd;      // flap drag per unit of lift
+    std::vector<float> _dragMul[3];
+    std::vector<float> _inducedDrag;
+    std::vector<float> _torqueArm;   // 1/6 chord
+
+    // per evaluation input and results
+    std::vector<float> _vx, _vy, _vz;
+    std::vector<float> _fx, _fy, _fz;
+    std::vector<float> _tx, _ty, _tz;
+    std::vector<float> _on;          // 0 where calcForce() exports nothing
+    std::vector<float> _alpha;       // -1 where stallFunc() leaves it alone
+    std::vector<float> _stallAlpha;
+};
+
+}; // namespace yasim
+#endif // _SURFACESET_HPP
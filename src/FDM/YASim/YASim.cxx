@@ -5,8 +5,11 @@
 
 #include <cstdlib>
 #include <cstdio>
+#include <iomanip>
+#include <sstream>
 
 #include <simgear/debug/logstream.hxx>
+#include <simgear/io/iostreams/sgstream.hxx>
 #include <simgear/math/sg_geodesy.hxx>
 #include <simgear/misc/sg_path.hxx>
 #include <simgear/scene/model/placement.hxx>
@@ -35,6 +38,51 @@
 using namespace yasim;
 using std::string;
 
+// Solver results are cached in FG_HOME, one file per parse hash (see
+// FGFDM::getParseHash()). Increment this whenever a change to YASim
+// changes the solution for the same XML.
+static const int SOLUTION_CACHE_VERSION = 1;
+
+static SGPath solutionCachePath(uint64_t hash)
+{
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << hash << ".txt";
+    SGPath path = globals->get_fg_home();
+    path.append("cache/yasim");
+    path.append(name.str());
+    return path;
+}
+
+static bool readSolution(const SGPath& path, Airplane::Solution& s)
+{
+    if (!path.exists())
+        return false;
+
+    sg_ifstream in(path);
+    int version = 0, yasimVersion = -1;
+    in >> version >> yasimVersion;
+    if (version != SOLUTION_CACHE_VERSION
+        || yasimVersion != Version::YASIM_VERSION_CURRENT)
+        return false;
+
+    in >> s.dragFactor >> s.liftRatio >> s.cruiseAoA
+       >> s.tailIncidence >> s.approachElevator;
+    return !in.fail();
+}
+
+static void writeSolution(const SGPath& path, const Airplane::Solution& s)
+{
+    SGPath(path).create_dir(0755);
+    sg_ofstream out(path);
+    // 9 digits restore a float exactly
+    out << std::setprecision(9)
+        << SOLUTION_CACHE_VERSION << " " << Version::YASIM_VERSION_CURRENT << "\n"
+        << s.dragFactor << " " << s.liftRatio << " " << s.cruiseAoA << " "
+        << s.tailIncidence << " " << s.approachElevator << "\n";
+    if (!out)
+        SG_LOG(SG_FLIGHT, SG_WARN, "YASim: failed to write solution cache " << path);
+}
+
 YASim::YASim(double dt) :
     _simTime(0)
 {
@@ -162,8 +210,24 @@ void YASim::init()
         throw e;
     }
 
-    // Compile it into a real airplane, and tell the user what they got
+    // Compile it into a real airplane, and tell the user what they got.
+    // The solver takes a while for some aircraft, so reuse its results
+    // as long as the XML doesn't change.
+    bool useCache = fgGetBool("/fdm/yasim/solution-cache", true);
+    SGPath solutionPath = solutionCachePath(_fdm->getParseHash());
+    Airplane::Solution solution;
+    if (useCache && readSolution(solutionPath, solution))
+        airplane->setCachedSolution(solution);
+
     airplane->compile();
+    if (airplane->usedCachedSolution()) {
+        SG_LOG(SG_FLIGHT, SG_INFO, "YASim: using cached solution " << solutionPath);
+    } else if (useCache && airplane->getSolutionIterations() > 0
+               && !airplane->getFailureMsg()) {
+        airplane->getSolution(solution);
+        writeSolution(solutionPath, solution);
+    }
+    model->setCompiledSurfaces(fgGetBool("/fdm/yasim/compiled-surfaces", false));
     report();
 
     _fdm->init();
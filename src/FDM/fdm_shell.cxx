@@ -47,6 +47,7 @@
 #endif
 #include <FDM/ExternalNet/ExternalNet.hxx>
 #include <FDM/ExternalPipe/ExternalPipe.hxx>
+#include <FDM/ExternalShm/ExternalShm.hxx>
 
 #ifdef ENABLE_JSBSIM
 #include <FDM/JSBSim/JSBSim.hxx>
@@ -199,17 +200,15 @@ void FDMShell::update(double dt)
 
   // AI aerodynamic wake interaction
   if (_ai_wake_enabled->getBoolValue()) {
-      for (FGAIBase* base : _ai_mgr->get_ai_list()) {
+      SGVec3d pos = _impl->getCartPosition();
+      FGAISpatialIndex::ResultList nearby;
+      _ai_mgr->findObjectsInRange(pos, _max_radius_nm->getDoubleValue()*SG_NM_TO_METER,
+                                  nearby, FGAISpatialIndex::typeBit(FGAIBase::otAircraft));
+      for (FGAIBase* base : nearby) {
           try {
-              if (base->isa(FGAIBase::otAircraft) ) {
-                  SGVec3d pos = _impl->getCartPosition();
-                  const SGSharedPtr<FGAIAircraft> aircraft = dynamic_cast<FGAIAircraft*>(base);
-                  double range = _ai_mgr->calcRangeFt(pos, aircraft)*SG_FEET_TO_METER;
-
-                  if (!aircraft->onGround() && aircraft->getSpeed() > 0.0
-                      && range < _max_radius_nm->getDoubleValue()*SG_NM_TO_METER) {
-                      _impl->add_ai_wake(aircraft);
-                  }
+              const SGSharedPtr<FGAIAircraft> aircraft = dynamic_cast<FGAIAircraft*>(base);
+              if (!aircraft->onGround() && aircraft->getSpeed() > 0.0) {
+                  _impl->add_ai_wake(aircraft);
               }
           } catch (sg_exception& e) {
               SG_LOG(SG_FLIGHT, SG_WARN, "caught exception updating AI model:"
@@ -330,6 +329,20 @@ void FDMShell::createImplementation()
     // protocol (last option)
     pipe_protocol = pipe_options.substr(begin);
     _impl = new FGExternalPipe( dt, pipe_path, pipe_protocol );
+  } else if ( model.find("shm") == 0 ) {
+    // shm[,<name>[,<spin-usec>]]
+    string shm_name = "/fgfs-fdm";
+    long spin_usec = 100;
+    string shm_options = model.size() > 4 ? model.substr(4) : string("");
+    string::size_type end = shm_options.find( "," );
+    if ( end != string::npos ) {
+      spin_usec = atol( shm_options.substr(end + 1).c_str() );
+      shm_options = shm_options.substr(0, end);
+    }
+    if ( !shm_options.empty() ) {
+      shm_name = shm_options;
+    }
+    _impl = new FGExternalShm( dt, shm_name, spin_usec );
   } else if ( model == "null" ) {
     _impl = new FGNullFDM( dt );
   }
@@ -141,6 +141,7 @@ FGInterface::common_init ()
     set_inited( true );
 
     ground_cache.set_cache_time_offset(globals->get_sim_time_sec());
+    ground_cache.set_background_build(fgGetBool("/fdm/groundcache-background-build", false));
 
     // Set initial position
     SG_LOG( SG_FLIGHT, SG_INFO, "...initializing position..." );
@@ -778,6 +779,21 @@ FGInterface::get_agl_ft(double t, const double pt[3], double max_altoff,
   return ret;
 }
 
+void
+FGInterface::get_agl_m(double t, size_t count, const double pt[][3],
+                       double max_altoff, FGGroundCache::AglResult* results)
+{
+  _aglPoints.resize(count);
+  for (size_t i = 0; i < count; ++i)
+    _aglPoints[i] = SGVec3d(pt[i]) - max_altoff*ground_cache.get_down();
+  ground_cache.get_agl(t, count, _aglPoints.data(), results);
+  // velocities at the contact point, as above
+  for (size_t i = 0; i < count; ++i) {
+    FGGroundCache::AglResult& result = results[i];
+    result.linearVel += cross(result.angularVel, result.contact - _aglPoints[i]);
+  }
+}
+
 bool
 FGInterface::get_nearest_m(double t, const double pt[3], double maxDist,
                            double contact[3], double normal[3],
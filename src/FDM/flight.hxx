@@ -74,6 +74,7 @@
 
 
 #include <cmath>
+#include <vector>
 
 #include <simgear/compiler.h>
 #include <simgear/constants.h>
@@ -209,6 +210,8 @@ class FGInterface : public SGSubsystem {
 
     // the ground cache object itself.
     FGGroundCache ground_cache;
+    // query points of the batched get_agl_m
+    std::vector<SGVec3d> _aglPoints;
 
     AIWakeGroup wake_group;
 
@@ -720,6 +723,10 @@ public:
                     double contact[3], double normal[3], double linearVel[3],
                     double angularVel[3], simgear::BVHMaterial const*& material,
                     simgear::BVHNode::Id& id);
+    // Same as get_agl_m for count points at once, which is much cheaper
+    // than one call per gear or contact point.
+    void get_agl_m(double t, size_t count, const double pt[][3],
+                   double max_altoff, FGGroundCache::AglResult* results);
     double get_groundlevel_m(double lat, double lon, double alt);
     double get_groundlevel_m(const SGGeod& geod);
 
@@ -27,6 +27,7 @@
 #include "groundcache.hxx"
 
 #include <utility>
+#include <vector>
 
 #include <osg/Drawable>
 #include <osg/Geode>
@@ -41,6 +42,8 @@
 #include <simgear/constants.h>
 #include <simgear/debug/logstream.hxx>
 #include <simgear/math/SGMisc.hxx>
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/threads/SGGuard.hxx>
 #include <simgear/scene/material/mat.hxx>
 #include <simgear/scene/util/SGNodeMasks.hxx>
 #include <simgear/scene/util/SGSceneUserData.hxx>
@@ -72,16 +75,86 @@
 
 using namespace simgear;
 
+// time window a background build covers beyond the current request
+static const double BACKGROUND_LOOKAHEAD_SEC = 1.0;
+// extra radius of a background build for unpredicted movement
+static const double BACKGROUND_MARGIN_M = 10.0;
+
+class FGGroundCache::BuildThread : public SGThread {
+public:
+    BuildThread() :
+        _build(0),
+        _stop(false)
+    { }
+
+    // Start collecting the snapshot of build in this thread. The build must
+    // stay untouched until isDone() returns true.
+    void request(Build* build)
+    {
+        SGGuard<SGMutex> lock(_mutex);
+        _build = build;
+        _condition.broadcast();
+    }
+
+    bool isDone()
+    {
+        SGGuard<SGMutex> lock(_mutex);
+        return !_build;
+    }
+
+    void wait()
+    {
+        SGGuard<SGMutex> lock(_mutex);
+        while (_build)
+            _condition.wait(_mutex);
+    }
+
+    void stop()
+    {
+        SGGuard<SGMutex> lock(_mutex);
+        _stop = true;
+        _condition.broadcast();
+    }
+
+    virtual void run()
+    {
+        SGGuard<SGMutex> lock(_mutex);
+        for (;;) {
+            while (!_stop && !_build)
+                _condition.wait(_mutex);
+            if (_stop)
+                return;
+
+            _mutex.unlock();
+            FGGroundCache::collect(*_build);
+            _mutex.lock();
+
+            _build = 0;
+            _condition.broadcast();
+        }
+    }
+
+private:
+    Build* _build;
+    bool _stop;
+    SGMutex _mutex;
+    SGWaitCondition _condition;
+};
+
 class FGGroundCache::CacheFill : public osg::NodeVisitor {
 public:
+    // A snapshot references the whole bounding volume trees of the nodes
+    // found, instead of copying the parts within the sphere.
     CacheFill(const SGVec3d& center, const SGVec3d& down, const double& radius,
-              const double& startTime, const double& endTime) :
+              const double& startTime, const double& endTime,
+              bool snapshot = false) :
         osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN),
         _center(center),
         _down(down),
         _radius(radius),
         _startTime(startTime),
         _endTime(endTime),
+        _snapshot(snapshot),
         _sceneryHit(0, 0, 0),
         _maxDown(SGGeod::fromCart(center).getElevationM() + 9999),
         _material(0),
@@ -251,6 +324,11 @@ public:
             _haveHit = true;
         }
 
+        if (_snapshot) {
+            mSubTreeCollector.addNode(bvNode);
+            return;
+        }
+
         // Get that part of the local bv tree that intersects our sphere
         // of interrest.
         mSubTreeCollector.setSphere(SGSphered(_center, _radius));
@@ -284,6 +362,7 @@ private:
     double _radius;
     double _startTime;
     double _endTime;
+    bool _snapshot;
 
     simgear::BVHSubTreeCollector mSubTreeCollector;
     SGVec3d _sceneryHit;
@@ -292,6 +371,246 @@ private:
     bool _haveHit;
 };
 
+class FGGroundCache::MultiLineSegmentVisitor : public BVHVisitor {
+public:
+    // Same results as one BVHLineSegmentVisitor per segment, but all
+    // segments walk the tree together. Each node's bounds are tested once
+    // against the segments still reaching it, and only that subset is
+    // carried on to the children.
+    MultiLineSegmentVisitor() :
+        _depth(0),
+        _time(0)
+    { }
+
+    void reset(double t, size_t count, const SGVec3d* start,
+               const SGVec3d& offset)
+    {
+        _time = t;
+        _segments.resize(count);
+        _active.resize(1);
+        _active[0].resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            Segment& segment = _segments[i];
+            segment.lineSegment.set(start[i], start[i] + offset);
+            segment.normal = SGVec3d::zeros();
+            segment.linearVelocity = SGVec3d::zeros();
+            segment.angularVelocity = SGVec3d::zeros();
+            segment.material = 0;
+            segment.id = 0;
+            segment.haveHit = false;
+            _active[0][i] = i;
+        }
+        _depth = 0;
+    }
+
+    virtual void apply(BVHGroup& group)
+    {
+        if (!push(group.getBoundingSphere()))
+            return;
+        group.traverse(*this);
+        pop();
+    }
+    virtual void apply(BVHPageNode& node)
+    {
+        if (!push(node.getBoundingSphere()))
+            return;
+        node.traverse(*this);
+        pop();
+    }
+    virtual void apply(BVHTransform& transform)
+    {
+        if (!push(transform.getBoundingSphere()))
+            return;
+
+        for (const Saved& s : save()) {
+            Segment& segment = _segments[s.index];
+            segment.lineSegment = transform.lineSegmentToLocal(s.lineSegment);
+            segment.haveHit = false;
+        }
+
+        transform.traverse(*this);
+
+        for (const Saved& s : _saved[_depth]) {
+            Segment& segment = _segments[s.index];
+            if (segment.haveHit) {
+                segment.linearVelocity = transform.vecToWorld(segment.linearVelocity);
+                segment.angularVelocity = transform.vecToWorld(segment.angularVelocity);
+                SGVec3d point(transform.ptToWorld(segment.lineSegment.getEnd()));
+                segment.lineSegment.set(s.lineSegment.getStart(), point);
+                segment.normal = transform.vecToWorld(segment.normal);
+            } else {
+                segment.lineSegment = s.lineSegment;
+                segment.haveHit = s.haveHit;
+            }
+        }
+        pop();
+    }
+    virtual void apply(BVHMotionTransform& transform)
+    {
+        if (!push(transform.getBoundingSphere()))
+            return;
+
+        SGMatrixd toLocal = transform.getToLocalTransform(_time);
+        for (const Saved& s : save()) {
+            Segment& segment = _segments[s.index];
+            segment.lineSegment = s.lineSegment.transform(toLocal);
+            segment.haveHit = false;
+        }
+
+        transform.traverse(*this);
+
+        SGMatrixd toWorld = transform.getToWorldTransform(_time);
+        for (const Saved& s : _saved[_depth]) {
+            Segment& segment = _segments[s.index];
+            if (segment.haveHit) {
+                SGVec3d localStart = segment.lineSegment.getStart();
+                segment.linearVelocity += transform.getLinearVelocityAt(localStart);
+                segment.angularVelocity += transform.getAngularVelocity();
+                segment.linearVelocity = toWorld.xformVec(segment.linearVelocity);
+                segment.angularVelocity = toWorld.xformVec(segment.angularVelocity);
+                SGVec3d localEnd = segment.lineSegment.getEnd();
+                segment.lineSegment.set(s.lineSegment.getStart(),
+                                        toWorld.xformPt(localEnd));
+                segment.normal = toWorld.xformVec(segment.normal);
+                if (!segment.id)
+                    segment.id = transform.getId();
+            } else {
+                segment.lineSegment = s.lineSegment;
+                segment.haveHit = s.haveHit;
+            }
+        }
+        pop();
+    }
+    virtual void apply(BVHLineGeometry&) { }
+    virtual void apply(BVHStaticGeometry& node)
+    {
+        if (!push(node.getBoundingSphere()))
+            return;
+        node.traverse(*this);
+        pop();
+    }
+
+    virtual void apply(const BVHStaticBinary& node, const BVHStaticData& data)
+    {
+        const SGBoxf& box = node.getBoundingBox();
+        std::vector<unsigned>& next = next_active();
+        for (unsigned i : _active[_depth]) {
+            if (intersects(SGLineSegmentf(_segments[i].lineSegment), box))
+                next.push_back(i);
+        }
+        if (next.empty())
+            return;
+        ++_depth;
+        // Enter the box holding the first segment's start first, as the
+        // single segment visitor does; hits there shorten the segments so
+        // the other box is often culled right away.
+        SGVec3f start(_segments[next.front()].lineSegment.getStart());
+        node.traverse(*this, data, start);
+        pop();
+    }
+    virtual void apply(const BVHStaticTriangle& triangle, const BVHStaticData& data)
+    {
+        SGTrianglef tri = triangle.getTriangle(data);
+        for (unsigned i : _active[_depth]) {
+            Segment& segment = _segments[i];
+            SGVec3f point;
+            if (!intersects(point, tri, SGLineSegmentf(segment.lineSegment), 1e-4f))
+                continue;
+            segment.lineSegment.set(segment.lineSegment.getStart(), SGVec3d(point));
+            segment.normal = SGVec3d(tri.getNormal());
+            segment.linearVelocity = SGVec3d::zeros();
+            segment.angularVelocity = SGVec3d::zeros();
+            segment.material = data.getMaterial(triangle.getMaterialIndex());
+            segment.id = 0;
+            segment.haveHit = true;
+        }
+    }
+
+    bool empty(size_t i) const
+    { return !_segments[i].haveHit; }
+    const SGVec3d& getPoint(size_t i) const
+    { return _segments[i].lineSegment.getEnd(); }
+    const SGVec3d& getNormal(size_t i) const
+    { return _segments[i].normal; }
+    const SGVec3d& getLinearVelocity(size_t i) const
+    { return _segments[i].linearVelocity; }
+    const SGVec3d& getAngularVelocity(size_t i) const
+    { return _segments[i].angularVelocity; }
+    const BVHMaterial* getMaterial(size_t i) const
+    { return _segments[i].material; }
+    BVHNode::Id getId(size_t i) const
+    { return _segments[i].id; }
+
+private:
+    struct Segment {
+        SGLineSegmentd lineSegment;
+        SGVec3d normal;
+        SGVec3d linearVelocity;
+        SGVec3d angularVelocity;
+        const BVHMaterial* material;
+        BVHNode::Id id;
+        bool haveHit;
+    };
+    // state of a segment outside of the transform it is inside of
+    struct Saved {
+        unsigned index;
+        SGLineSegmentd lineSegment;
+        bool haveHit;
+    };
+
+    // the (empty) list of active segments one level down, storage is kept
+    // between nodes and queries
+    std::vector<unsigned>& next_active()
+    {
+        if (_active.size() <= _depth + 1)
+            _active.resize(_depth + 2);
+        std::vector<unsigned>& next = _active[_depth + 1];
+        next.clear();
+        return next;
+    }
+
+    // Narrow the active segments down to those hitting the sphere, false
+    // if there are none left. Each successful push is matched by a pop.
+    bool push(const SGSphered& sphere)
+    {
+        std::vector<unsigned>& next = next_active();
+        for (unsigned i : _active[_depth]) {
+            if (intersects(_segments[i].lineSegment, sphere))
+                next.push_back(i);
+        }
+        if (next.empty())
+            return false;
+        ++_depth;
+        return true;
+    }
+    void pop()
+    { --_depth; }
+
+    // Remember the active segments before they are moved into a
+    // transform. Nested transforms may grow _saved, so callers index it
+    // again after the traversal.
+    std::vector<Saved>& save()
+    {
+        if (_saved.size() <= _depth)
+            _saved.resize(_depth + 1);
+        std::vector<Saved>& saved = _saved[_depth];
+        saved.clear();
+        for (unsigned i : _active[_depth]) {
+            const Segment& segment = _segments[i];
+            saved.push_back(Saved{i, segment.lineSegment, segment.haveHit});
+        }
+        return saved;
+    }
+
+    std::vector<Segment> _segments;
+    // indices of the segments reaching the node at each depth
+    std::vector<std::vector<unsigned> > _active;
+    std::vector<std::vector<Saved> > _saved;
+    size_t _depth;
+
+    double _time;
+};
+
 FGGroundCache::FGGroundCache() :
     _altitude(0),
     _material(0),
@@ -301,8 +620,22 @@ FGGroundCache::FGGroundCache() :
     reference_wgs84_point(SGVec3d(0, 0, 0)),
     reference_vehicle_radius(0),
     down(0.0, 0.0, 0.0),
-    found_ground(false)
+    found_ground(false),
+    _backgroundBuild(false),
+    _buildThread(0),
+    _building(false),
+    _haveNext(false),
+    _discardNext(false),
+    _lastPoint(SGVec3d::zeros()),
+    _lastTime(0),
+    _haveLast(false),
+    _aglVisitor(0)
 {
+    _current.radius = 0;
+    _current.startTime = 0;
+    _current.endTime = 0;
+    _current.foundGround = false;
+
 #ifdef GROUNDCACHE_DEBUG
     _lookupTime = SGTimeStamp::fromSec(0.0);
     _lookupCount = 0;
@@ -313,8 +646,206 @@ FGGroundCache::FGGroundCache() :
 
 FGGroundCache::~FGGroundCache()
 {
+    set_background_build(false);
+    delete _aglVisitor;
+}
+
+void
+FGGroundCache::set_background_build(bool enabled)
+{
+    if (enabled == _backgroundBuild)
+        return;
+
+    _backgroundBuild = enabled;
+    if (!enabled && _buildThread) {
+        _buildThread->wait();
+        _buildThread->stop();
+        _buildThread->join();
+        delete _buildThread;
+        _buildThread = 0;
+        _building = false;
+        _haveNext = false;
+        _next.tree = 0;
+    }
+}
+
+void
+FGGroundCache::poll_background_build(bool wait)
+{
+    if (!_building)
+        return;
+
+    if (wait)
+        _buildThread->wait();
+    else if (!_buildThread->isDone())
+        return;
+
+    _building = false;
+    _haveNext = _next.foundGround && !_discardNext;
+    if (!_haveNext)
+        _next.tree = 0;
+}
+
+void
+FGGroundCache::fill(Build& build, bool snapshot) const
+{
+    // Get a normalized down vector valid for the whole cache
+    SGGeod geodPt = SGGeod::fromCart(build.point);
+    SGQuatd hlToEc = SGQuatd::fromLonLat(geodPt);
+    build.down = hlToEc.rotate(SGVec3d(0, 0, 1));
+    build.material = 0;
+    build.altitude = 0;
+    build.foundGround = false;
+
+    // Get the ground cache, that is a local collision tree of the environment
+    build.sceneTime = build.startTime + cache_time_offset;
+    double endSimTime = build.endTime + cache_time_offset;
+    CacheFill subtreeCollector(build.point, build.down, build.radius,
+                               build.sceneTime, endSimTime, snapshot);
+    globals->get_scenery()->get_scene_graph()->accept(subtreeCollector);
+    build.tree = subtreeCollector.getBVHNode();
+
+    if (subtreeCollector.getHaveElevationBelowCache()) {
+        // Use the altitude value below the cache that we gathered during
+        // cache collection
+        build.altitude = subtreeCollector.getElevationBelowCache();
+        build.material = subtreeCollector.getMaterialBelowCache();
+        build.foundGround = true;
+    } else if (!snapshot) {
+        find_ground(build);
+    }
+}
+
+// Runs in the build thread. The snapshot holds references to the bounding
+// volume trees, which are not modified once built, so this neither needs
+// the scene graph nor cares about the pager unloading tiles meanwhile.
+void
+FGGroundCache::collect(Build& build)
+{
+    if (build.tree) {
+        simgear::BVHSubTreeCollector subtreeCollector;
+        subtreeCollector.setSphere(SGSphered(build.point, build.radius));
+        build.tree->accept(subtreeCollector);
+        build.tree = subtreeCollector.getNode();
+    }
+
+    if (!build.foundGround)
+        find_ground(build);
+}
+
+void
+FGGroundCache::find_ground(Build& build)
+{
+    if (!build.tree)
+        return;
+
+    // We have nothing below us, so try starting with the lowest point
+    // upwards for a croase altitude value
+    SGLineSegmentd line(build.point + build.radius*build.down,
+                        build.point - 1e3*build.down);
+    simgear::BVHLineSegmentVisitor lineSegmentVisitor(line, build.sceneTime);
+    build.tree->accept(lineSegmentVisitor);
+
+    if (!lineSegmentVisitor.empty()) {
+        SGGeod geodPt = SGGeod::fromCart(lineSegmentVisitor.getPoint());
+        build.altitude = geodPt.getElevationM();
+        build.material = lineSegmentVisitor.getMaterial();
+        build.foundGround = true;
+    }
+}
+
+void
+FGGroundCache::use(const Build& build)
+{
+    _current = build;
+    _current.tree = 0;
+
+    _localBvhTree = build.tree;
+    _altitude = build.altitude;
+    _material = build.material;
+    down = build.down;
+    found_ground = build.foundGround;
+}
+
+bool
+FGGroundCache::within(const Build& build, double startSimTime, double endSimTime,
+                      const SGVec3d& pt, double rad)
+{
+    if (startSimTime < build.startTime || build.endTime < endSimTime)
+        return false;
+    double maxDist = build.radius - rad;
+    return 0 <= maxDist && distSqr(pt, build.point) <= maxDist*maxDist;
+}
+
+bool
+FGGroundCache::covers(const Build& build, double startSimTime, double endSimTime,
+                      const SGVec3d& pt, double rad)
+{
+    return build.foundGround && within(build, startSimTime, endSimTime, pt, rad);
+}
+
+// Build a cache for the next BACKGROUND_LOOKAHEAD_SEC seconds around the
+// position extrapolated from the last requests, while the FDM keeps using
+// the current one. Only the scene graph traversal runs here, the build
+// thread collects the triangles, which may take several frames.
+void
+FGGroundCache::start_background_build(double startSimTime, double endSimTime,
+                                      const SGVec3d& pt, double rad)
+{
+    SGVec3d velocity = SGVec3d::zeros();
+    if (_haveLast && _lastTime < startSimTime)
+        velocity = (pt - _lastPoint)/(startSimTime - _lastTime);
+
+    _next.point = pt + (0.5*BACKGROUND_LOOKAHEAD_SEC)*velocity;
+    _next.radius = rad + 0.5*BACKGROUND_LOOKAHEAD_SEC*norm(velocity)
+        + BACKGROUND_MARGIN_M;
+    if (_wire)
+        _next.radius = SGMiscd::max(200, _next.radius);
+    _next.radius = SGMiscd::min(_next.radius, 10000);
+    _next.startTime = startSimTime;
+    _next.endTime = endSimTime + BACKGROUND_LOOKAHEAD_SEC;
+
+    // the tile manager and the scene graph must be used in the main thread
+    SGGeod geodPt = SGGeod::fromCart(_next.point);
+    if (!globals->get_scenery()->schedule_scenery(geodPt, _next.radius, 1.0))
+        return;
+    fill(_next, true);
+    request_background_build();
+}
+
+void
+FGGroundCache::request_background_build()
+{
+    if (!_buildThread) {
+        _buildThread = new BuildThread;
+        _buildThread->start();
+    }
+    _haveNext = false;
+    _discardNext = false;
+    _building = true;
+    _buildThread->request(&_next);
+}
+
+bool
+FGGroundCache::use_next(double startSimTime, double endSimTime,
+                        const SGVec3d& pt, double rad)
+{
+    if (_building && !_discardNext &&
+        within(_next, startSimTime, endSimTime, pt, rad)) {
+        // the current cache does not cover the request, but the running
+        // build will, and is closer to done than a new one
+        poll_background_build(true);
+    }
+    if (!_haveNext || !covers(_next, startSimTime, endSimTime, pt, rad))
+        return false;
+
+    use(_next);
+    _next.tree = 0;
+    _haveNext = false;
+    return true;
 }
 
+
 bool
 FGGroundCache::prepare_ground_cache(double startSimTime, double endSimTime,
                                     const SGVec3d& pt, double rad)
@@ -323,6 +854,39 @@ FGGroundCache::prepare_ground_cache(double startSimTime, double endSimTime,
         SG_LOG(SG_FLIGHT, SG_DEV_WARN, "FGGroundCache::prepare_ground_cache passed an excessive radius");
         rad = 10000.0;
     }
+
+    if (_backgroundBuild) {
+        poll_background_build(false);
+
+        bool valid = covers(_current, startSimTime, endSimTime, pt, rad) ||
+            use_next(startSimTime, endSimTime, pt, rad);
+
+        if (valid) {
+            reference_wgs84_point = pt;
+            reference_vehicle_radius = rad;
+            cache_ref_time = startSimTime;
+
+            // drop a next cache that no longer covers the vehicle, the
+            // prediction was off
+            if (_haveNext && !within(_next, startSimTime, endSimTime, pt, rad)) {
+                _next.tree = 0;
+                _haveNext = false;
+            }
+
+            // start on the next cache once half of this one is used up
+            double spareRadius = _current.radius - rad - dist(pt, _current.point);
+            double spareTime = _current.endTime - endSimTime;
+            if (!_building && !_haveNext &&
+                (spareRadius < 0.5*(_current.radius - rad) ||
+                 spareTime < 0.5*BACKGROUND_LOOKAHEAD_SEC))
+                start_background_build(startSimTime, endSimTime, pt, rad);
+
+            _lastPoint = pt;
+            _lastTime = startSimTime;
+            _haveLast = true;
+            return found_ground;
+        }
+    }
     
 #ifdef GROUNDCACHE_DEBUG
     SGTimeStamp t0 = SGTimeStamp::now();
@@ -330,6 +894,7 @@ FGGroundCache::prepare_ground_cache(double startSimTime, double endSimTime,
 
     // Empty cache.
     found_ground = false;
+    _current.foundGround = false;
 
     SGGeod geodPt = SGGeod::fromCart(pt);
     // Don't blow away the cache ground_radius and stuff if there's no
@@ -351,37 +916,21 @@ FGGroundCache::prepare_ground_cache(double startSimTime, double endSimTime,
     // Store the time reference used to compute movements of moving triangles.
     cache_ref_time = startSimTime;
     
-    // Get a normalized down vector valid for the whole cache
-    SGQuatd hlToEc = SGQuatd::fromLonLat(geodPt);
-    down = hlToEc.rotate(SGVec3d(0, 0, 1));
-    
-    // Get the ground cache, that is a local collision tree of the environment
-    startSimTime += cache_time_offset;
-    endSimTime += cache_time_offset;
-    CacheFill subtreeCollector(pt, down, rad, startSimTime, endSimTime);
-    globals->get_scenery()->get_scene_graph()->accept(subtreeCollector);
-    _localBvhTree = subtreeCollector.getBVHNode();
-
-    if (subtreeCollector.getHaveElevationBelowCache()) {
-        // Use the altitude value below the cache that we gathered during
-        // cache collection
-        _altitude = subtreeCollector.getElevationBelowCache();
-        _material = subtreeCollector.getMaterialBelowCache();
-        found_ground = true;
-    } else if (_localBvhTree) {
-        // We have nothing below us, so try starting with the lowest point
-        // upwards for a croase altitude value
-        SGLineSegmentd line(pt + reference_vehicle_radius*down, pt - 1e3*down);
-        simgear::BVHLineSegmentVisitor lineSegmentVisitor(line, startSimTime);
-        _localBvhTree->accept(lineSegmentVisitor);
-
-        if (!lineSegmentVisitor.empty()) {
-            SGGeod geodPt = SGGeod::fromCart(lineSegmentVisitor.getPoint());
-            _altitude = geodPt.getElevationM();
-            _material = lineSegmentVisitor.getMaterial();
-            found_ground = true;
-        }
-    }
+    // a running background build is of no use anymore, it is dropped
+    // once done
+    if (_building)
+        _discardNext = true;
+    else
+        _next.tree = 0;
+    _haveNext = false;
+
+    Build build;
+    build.point = pt;
+    build.radius = rad;
+    build.startTime = startSimTime;
+    build.endTime = endSimTime;
+    fill(build, false);
+    use(build);
     
     if (!found_ground) {
         // Ok, still nothing here?? Last resort ...
@@ -392,6 +941,15 @@ FGGroundCache::prepare_ground_cache(double startSimTime, double endSimTime,
         if (found_ground)
             _altitude = alt;
     }
+
+    if (_backgroundBuild) {
+        // prepare the next cache right away, this one is only just big enough
+        _lastPoint = pt;
+        _lastTime = startSimTime;
+        _haveLast = true;
+        if (found_ground && !_building)
+            start_background_build(startSimTime, endSimTime, pt, rad);
+    }
     
     // Still not sucessful??
     if (!found_ground)
@@ -427,7 +985,7 @@ FGGroundCache::prepare_ground_cache(double startSimTime, double endSimTime,
     if (_localBvhTree) {
         int level = fgGetInt("/fdm/groundcache-debug-level");
         if (-2 <= level) {
-            simgear::BVHDebugCollectVisitor debug(endSimTime, level);
+            simgear::BVHDebugCollectVisitor debug(endSimTime + cache_time_offset, level);
             _localBvhTree->accept(debug);
             _group->addChild(debug.getNode());
         }
@@ -745,6 +1303,59 @@ FGGroundCache::get_agl(double t, const SGVec3d& pt, SGVec3d& contact,
 }
 
 
+void
+FGGroundCache::get_agl(double t, size_t count, const SGVec3d* pt,
+                       AglResult* results)
+{
+    if (count == 0)
+        return;
+
+#ifdef GROUNDCACHE_DEBUG
+    SGTimeStamp t0 = SGTimeStamp::now();
+#endif
+
+    t += cache_time_offset;
+    if (!_aglVisitor)
+        _aglVisitor = new MultiLineSegmentVisitor;
+    MultiLineSegmentVisitor& visitor = *_aglVisitor;
+    visitor.reset(t, count, pt, 10*reference_vehicle_radius*down);
+    if (_localBvhTree)
+        _localBvhTree->accept(visitor);
+
+#ifdef GROUNDCACHE_DEBUG
+    t0 = SGTimeStamp::now() - t0;
+    _lookupTime += t0;
+    _lookupCount += count;
+#endif
+
+    for (size_t i = 0; i < count; ++i) {
+        AglResult& result = results[i];
+        if (!visitor.empty(i)) {
+            result.contact = visitor.getPoint(i);
+            result.normal = visitor.getNormal(i);
+            if (0 < dot(result.normal, down))
+                result.normal = -result.normal;
+            result.linearVel = visitor.getLinearVelocity(i);
+            result.angularVel = visitor.getAngularVelocity(i);
+            result.material = visitor.getMaterial(i);
+            result.id = visitor.getId(i);
+            result.found = true;
+        } else {
+            // same fallback as for a single query
+            SGGeod geodPt = SGGeod::fromCart(pt[i]);
+            geodPt.setElevationM(_altitude);
+            result.contact = SGVec3d::fromGeod(geodPt);
+            result.normal = -down;
+            result.linearVel = SGVec3d(0, 0, 0);
+            result.angularVel = SGVec3d(0, 0, 0);
+            result.material = _material;
+            result.id = 0;
+            result.found = found_ground;
+        }
+    }
+}
+
+
 bool
 FGGroundCache::get_nearest(double t, const SGVec3d& pt, double maxDist,
                            SGVec3d& contact, SGVec3d& linearVel,
@@ -54,9 +54,15 @@ public:
     // Prepare the ground cache for the wgs84 position pt_*.
     // That is take all vertices in the ball with radius rad around the
     // position given by the pt_* and store them in a local scene graph.
+    // With background builds enabled, a cache still covering that ball and
+    // time window is reused, and the next one is built in the background
+    // before the vehicle leaves it. That build may take several frames.
     bool prepare_ground_cache(double startSimTime, double endSimTime,
                               const SGVec3d& pt, double rad);
 
+    // Enable building the next cache in a worker thread.
+    void set_background_build(bool enabled);
+
     // Returns true if the cache is valid.
     // Also the reference time, point and radius values where the cache
     // is valid for are returned.
@@ -92,6 +98,23 @@ public:
                  simgear::BVHNode::Id& id,
                  const simgear::BVHMaterial*& material);
 
+    // Result of one point of the batched get_agl() below.
+    struct AglResult {
+        SGVec3d contact;
+        SGVec3d normal;
+        SGVec3d linearVel;
+        SGVec3d angularVel;
+        simgear::BVHNode::Id id;
+        const simgear::BVHMaterial* material;
+        bool found;
+    };
+
+    // Same as calling the above for count points, but all line segments
+    // walk the cache together, so nodes shared by the queries are only
+    // visited once. Meant for the gear and contact points of a vehicle.
+    void get_agl(double t, size_t count, const SGVec3d* pt,
+                 AglResult* results);
+
     bool get_nearest(double t, const SGVec3d& pt, double maxDist,
                      SGVec3d& contact, SGVec3d& linearVel, SGVec3d& angularVel,
                      simgear::BVHNode::Id& id,
@@ -112,9 +135,14 @@ public:
     void release_wire(void);
 
 private:
+    // white box unit tests, run on synthetic trees without a scene graph
+    friend class GroundCacheTests;
+
+    class BuildThread;
     class CacheFill;
     class BodyFinder;
     class CatapultFinder;
+    class MultiLineSegmentVisitor;
     class WireIntersector;
     class WireFinder;
 
@@ -140,6 +168,61 @@ private:
 
     SGSharedPtr<simgear::BVHNode> _localBvhTree;
 
+    // One cache build: the ball and time window it covers and what was
+    // found there.
+    struct Build {
+        SGVec3d point;
+        double radius;
+        double startTime;
+        double endTime;
+        double sceneTime;   // startTime in scene graph time
+        SGVec3d down;
+        SGSharedPtr<simgear::BVHNode> tree;
+        double altitude;
+        const simgear::BVHMaterial* material;
+        bool foundGround;
+    };
+
+    // Traverse the scene graph for the ball and time window in build. A
+    // snapshot only references the BVH trees found there, collect() then
+    // extracts the ball from those without touching the scene graph.
+    void fill(Build& build, bool snapshot) const;
+    static void collect(Build& build);
+    static void find_ground(Build& build);
+    void use(const Build& build);
+    static bool within(const Build& build, double startSimTime, double endSimTime,
+                       const SGVec3d& pt, double rad);
+    static bool covers(const Build& build, double startSimTime, double endSimTime,
+                       const SGVec3d& pt, double rad);
+    void start_background_build(double startSimTime, double endSimTime,
+                                const SGVec3d& pt, double rad);
+    // hand the snapshot in _next to the build thread
+    void request_background_build();
+    // install _next if it covers the request, waiting for it if it is
+    // still being built but will
+    bool use_next(double startSimTime, double endSimTime,
+                  const SGVec3d& pt, double rad);
+    // take over a finished background build, optionally waiting for it
+    void poll_background_build(bool wait);
+
+    // the ball and time window the current cache covers
+    Build _current;     // without the tree, that is _localBvhTree
+
+    bool _backgroundBuild;
+    BuildThread* _buildThread;
+    bool _building;      // _next is being built
+    bool _haveNext;      // _next is complete
+    bool _discardNext;   // drop _next once built, it is of no use anymore
+    Build _next;
+
+    // the last requested position, to predict where the vehicle goes
+    SGVec3d _lastPoint;
+    double _lastTime;
+    bool _haveLast;
+
+    // scratch space of the batched get_agl(), kept between queries
+    MultiLineSegmentVisitor* _aglVisitor;
+
 #ifdef GROUNDCACHE_DEBUG
     SGTimeStamp _lookupTime;
     unsigned _lookupCount;
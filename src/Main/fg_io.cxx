@@ -70,12 +70,14 @@
 
 #include "globals.hxx"
 #include "fg_io.hxx"
+#include "fg_io_thread.hxx"
 
 using std::atoi;
 using std::string;
 
 
-FGIO::FGIO()
+FGIO::FGIO() :
+    _thread(NULL)
 {
 }
 
@@ -315,7 +317,11 @@ FGIO::parse_port_config( const string& config )
         SG_LOG( SG_IO, SG_INFO, "  port = " << port );
         SG_LOG( SG_IO, SG_INFO, "  style = " << style );
 
-        io->set_io_channel( new SGSocket( hostname, port, style ) );
+        SGSocket* ch = new SGSocket( hostname, port, style );
+        if ( style == "udp" ) {
+            _datagramChannels.insert( ch );
+        }
+        io->set_io_channel( ch );
     }
     else
     {
@@ -347,6 +353,10 @@ FGIO::init()
     for (; i != end; ++i ) {
         add_channel( *i );
     } // of channel options iteration
+
+    if ( fgGetBool("/sim/io/threaded", false) ) {
+        start_thread();
+    }
 }
 
 // add another I/O channel
@@ -363,11 +373,41 @@ void FGIO::add_channel(const string& config)
     p->open();
     if ( !p->is_enabled() ) {
         SG_LOG( SG_IO, SG_ALERT, "I/O Channel config failed." );
+        _datagramChannels.erase( p->get_io_channel() );
         delete p;
         return;
     }
 
     io_channels.push_back( p );
+    _threadChannels.push_back( NULL );
+}
+
+// hand the socket and serial channels over to the I/O thread, files don't
+// block and stay in the main loop
+void FGIO::start_thread()
+{
+    for ( size_t i = 0; i < io_channels.size(); ++i ) {
+        FGProtocol* p = io_channels[i];
+        SGIOChannel* ch = p->get_io_channel();
+        if ( !ch || ch->get_type() == sgFileType ) {
+            continue;
+        }
+
+        if ( !_thread ) {
+            _thread = new FGIOThread;
+        }
+        FGIOThreadChannel* tch =
+            new FGIOThreadChannel( ch, p->get_direction(), p->get_hz(),
+                                   _datagramChannels.count( ch ) > 0 );
+        p->set_io_channel( tch );
+        _thread->add_channel( tch );
+        _threadChannels[i] = tch;
+    }
+
+    if ( _thread ) {
+        SG_LOG( SG_IO, SG_INFO, "Starting the I/O thread" );
+        _thread->start();
+    }
 }
 
 void
@@ -384,14 +424,26 @@ FGIO::update( double /* delta_time_sec */ )
     // see http://code.google.com/p/flightgear-bugs/issues/detail?id=125
     double delta_time_sec = _realDeltaTime->getDoubleValue();
 
-    ProtocolVec::iterator i = io_channels.begin();
-    ProtocolVec::iterator end = io_channels.end();
-    for (; i != end; ++i ) {
-        FGProtocol* p = *i;
+    double now = _thread ? SGTimeStamp::now().toSecs() : 0.0;
+
+    for ( size_t i = 0; i < io_channels.size(); ++i ) {
+        FGProtocol* p = io_channels[i];
         if (!p->is_enabled()) {
             continue;
         }
 
+        // the I/O thread keeps the rate, parse its input and take a
+        // snapshot of the output when it will be sent before next frame
+        FGIOThreadChannel* tch = _threadChannels[i];
+        if ( tch ) {
+            if ( tch->is_due( now, delta_time_sec ) ) {
+                p->process();
+                p->inc_count();
+                tch->commit();
+            }
+            continue;
+        }
+
         p->dec_count_down( delta_time_sec );
         double dt = 1 / p->get_hz();
         if ( p->get_count_down() < 0.33 * dt ) {
@@ -407,6 +459,28 @@ FGIO::update( double /* delta_time_sec */ )
 void
 FGIO::shutdown()
 {
+    if ( _thread ) {
+        _thread->stop();
+        delete _thread;
+        _thread = NULL;
+    }
+
+    // give the protocols their real channels back
+    for ( size_t j = 0; j < _threadChannels.size(); ++j ) {
+        FGIOThreadChannel* tch = _threadChannels[j];
+        if ( !tch ) {
+            continue;
+        }
+        SGIOChannel* ch = tch->get_channel();
+        io_channels[j]->set_io_channel( ch );
+        if ( tch->is_closed() ) {
+            ch->close();
+        }
+        delete tch;
+    }
+    _threadChannels.clear();
+    _datagramChannels.clear();
+
     ProtocolVec::iterator i = io_channels.begin();
     ProtocolVec::iterator end = io_channels.end();
     for (; i != end; ++i )
@@ -29,10 +29,14 @@
 #include <simgear/structure/subsystem_mgr.hxx>
 #include <simgear/props/props.hxx>
 
+#include <set>
 #include <vector>
 #include <string>
 
 class FGProtocol;
+class SGIOChannel;
+class FGIOThread;
+class FGIOThreadChannel;
 
 class FGIO : public SGSubsystem
 {
@@ -52,6 +56,7 @@ private:
 
     void add_channel(const std::string& config);
     FGProtocol* parse_port_config( const std::string& cfgstr );
+    void start_thread();
 
 private:
 
@@ -60,6 +65,15 @@ private:
     
     typedef std::vector< FGProtocol* > ProtocolVec;
     ProtocolVec io_channels;
+
+    // with /sim/io/threaded, the stand-in channels of the protocols
+    // serviced by the I/O thread, NULL for the others
+    typedef std::vector< FGIOThreadChannel* > ThreadChannelVec;
+    ThreadChannelVec _threadChannels;
+    FGIOThread* _thread;
+
+    // the udp socket channels, reading them gives one datagram at a time
+    std::set< SGIOChannel* > _datagramChannels;
     
     SGPropertyNode_ptr _realDeltaTime;
 };
@@ -0,0 +1,297 @@
+// fg_io_thread.cxx -- service I/O channels on a thread of their own
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/threads/SGGuard.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <Network/protocol.hxx>         // FG_MAX_MSG_SIZE
+
+#include "fg_io_thread.hxx"
+
+// input kept for a protocol which doesn't read it
+static const size_t MAX_RECEIVED = 64 * FG_MAX_MSG_SIZE;
+
+// longest sleep of the I/O thread, also when no channel is due
+static const double MAX_IDLE_SEC = 0.1;
+
+
+FGIOThreadChannel::FGIOThreadChannel( SGIOChannel* channel, SGProtocolDir dir,
+                                      double hz, bool datagrams ) :
+    _channel( channel ),
+    _output( dir == SG_IO_OUT || dir == SG_IO_BI ),
+    _input( dir == SG_IO_IN || dir == SG_IO_BI ),
+    _datagrams( datagrams ),
+    _interval( hz > 0 ? 1 / hz : 1 ),
+    _closed( false ),
+    _fresh( false ),
+    _eof( false ),
+    _next( SGTimeStamp::now().toSecs() )
+{
+    set_type( channel->get_type() );
+}
+
+
+FGIOThreadChannel::~FGIOThreadChannel()
+{
+}
+
+
+bool FGIOThreadChannel::open( const SGProtocolDir /* d */ )
+{
+    return true;
+}
+
+
+// remove n bytes of input, and the datagrams they belong to (lock held)
+void FGIOThreadChannel::consume( size_t n )
+{
+    _received.erase( 0, n );
+    while ( n > 0 && !_lengths.empty() ) {
+        size_t d = std::min( n, _lengths.front() );
+        _lengths.front() -= d;
+        n -= d;
+        if ( _lengths.front() == 0 ) {
+            _lengths.pop_front();
+        }
+    }
+}
+
+
+int FGIOThreadChannel::read( char* buf, int length )
+{
+    SGGuard<SGMutex> lock( _mutex );
+    int n = std::min( length, (int)_received.size() );
+    size_t used = n;
+    if ( _datagrams && !_lengths.empty() ) {
+        // one datagram, the part not fitting into buf is lost as with
+        // the socket
+        n = std::min( length, (int)_lengths.front() );
+        used = _lengths.front();
+    }
+    if ( n > 0 ) {
+        memcpy( buf, _received.data(), n );
+        consume( used );
+    }
+    return n;
+}
+
+
+int FGIOThreadChannel::readline( char* buf, int length )
+{
+    if ( length <= 0 ) {
+        return 0;
+    }
+
+    SGGuard<SGMutex> lock( _mutex );
+    std::string::size_type eol = _received.find( '\n' );
+    int n;
+    if ( eol != std::string::npos ) {
+        n = std::min( length - 1, (int)eol + 1 );
+    } else if ( (int)_received.size() >= length - 1 ) {
+        n = length - 1;         // a line longer than buf
+    } else {
+        return 0;               // wait for the rest of the line
+    }
+
+    memcpy( buf, _received.data(), n );
+    buf[n] = '\0';
+    consume( n );
+    return n;
+}
+
+
+int FGIOThreadChannel::write( const char* buf, const int length )
+{
+    _writing.append( buf, length );
+    if ( _datagrams ) {
+        _writeLengths.push_back( length );
+    }
+    return length;
+}
+
+
+int FGIOThreadChannel::writestring( const char* str )
+{
+    return write( str, strlen( str ) );
+}
+
+
+bool FGIOThreadChannel::close()
+{
+    _closed = true;
+    return true;
+}
+
+
+bool FGIOThreadChannel::eof() const
+{
+    SGGuard<SGMutex> lock( _mutex );
+    return _eof && _received.empty();
+}
+
+
+bool FGIOThreadChannel::is_due( double now, double frame_dt )
+{
+    SGGuard<SGMutex> lock( _mutex );
+    if ( !_received.empty() ) {
+        return true;
+    }
+    return _output && _next - now < 1.5 * frame_dt;
+}
+
+
+void FGIOThreadChannel::commit()
+{
+    if ( !_output || _writing.empty() ) {
+        _writing.clear();
+        _writeLengths.clear();
+        return;
+    }
+
+    SGGuard<SGMutex> lock( _mutex );
+    _snapshot.swap( _writing );
+    _snapshotLengths.swap( _writeLengths );
+    _fresh = true;
+    _writing.clear();
+    _writeLengths.clear();
+}
+
+
+double FGIOThreadChannel::service( double now )
+{
+    std::string out;
+    std::vector<size_t> outLengths;
+    double next;
+    {
+        SGGuard<SGMutex> lock( _mutex );
+        if ( now < _next ) {
+            return _next;
+        }
+        if ( _fresh ) {
+            out.swap( _snapshot );
+            outLengths.swap( _snapshotLengths );
+            _fresh = false;
+        }
+        // stay on the grid of ticks, but don't catch up on missed ones
+        _next += _interval;
+        if ( _next <= now ) {
+            _next = now + _interval;
+        }
+        next = _next;
+    }
+
+    if ( !out.empty() && outLengths.empty() ) {
+        outLengths.push_back( out.size() );
+    }
+    for ( size_t i = 0, pos = 0; i < outLengths.size(); pos += outLengths[i++] ) {
+        if ( _channel->write( out.data() + pos, outLengths[i] ) != (int)outLengths[i] ) {
+            SG_LOG( SG_IO, SG_WARN, "I/O thread: error writing data." );
+            break;
+        }
+    }
+
+    if ( _input ) {
+        std::string in;
+        std::vector<size_t> lengths;
+        char buf[ FG_MAX_MSG_SIZE ];
+        int n;
+        while ( in.size() < MAX_RECEIVED &&
+                (n = _channel->read( buf, sizeof(buf) )) > 0 ) {
+            in.append( buf, n );
+            if ( _datagrams ) {
+                lengths.push_back( n );
+            }
+        }
+        bool eof = _channel->eof();
+
+        SGGuard<SGMutex> lock( _mutex );
+        _received.append( in );
+        _lengths.insert( _lengths.end(), lengths.begin(), lengths.end() );
+        if ( _received.size() > MAX_RECEIVED ) {
+            SG_LOG( SG_IO, SG_WARN, "I/O thread: dropping unread input." );
+            size_t drop = _received.size() - MAX_RECEIVED;
+            // whole datagrams only
+            if ( _datagrams ) {
+                size_t whole = 0;
+                for ( size_t i = 0; whole < drop && i < _lengths.size(); ++i ) {
+                    whole += _lengths[i];
+                }
+                drop = whole;
+            }
+            consume( drop );
+        }
+        _eof = eof;
+    }
+
+    return next;
+}
+
+
+FGIOThread::FGIOThread() :
+    _stop( false )
+{
+}
+
+
+void FGIOThread::add_channel( FGIOThreadChannel* channel )
+{
+    _channels.push_back( channel );
+}
+
+
+void FGIOThread::stop()
+{
+    {
+        SGGuard<SGMutex> lock( _mutex );
+        _stop = true;
+        _wakeup.signal();
+    }
+    join();
+}
+
+
+void FGIOThread::run()
+{
+    for (;;) {
+        double now = SGTimeStamp::now().toSecs();
+        double next = now + MAX_IDLE_SEC;
+        for ( size_t i = 0; i < _channels.size(); ++i ) {
+            next = std::min( next, _channels[i]->service( now ) );
+        }
+
+        SGGuard<SGMutex> lock( _mutex );
+        if ( _stop ) {
+            return;
+        }
+        double wait = next - SGTimeStamp::now().toSecs();
+        if ( wait > 0 ) {
+            // round up, waking up early would only spin
+            _wakeup.wait( _mutex, (unsigned)ceil( wait * 1000 ) );
+            if ( _stop ) {
+                return;
+            }
+        }
+    }
+}
@@ -0,0 +1,119 @@
+// fg_io_thread.hxx -- service I/O channels on a thread of their own
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifndef _FG_IO_THREAD_HXX
+#define _FG_IO_THREAD_HXX
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <simgear/io/iochannel.hxx>
+#include <simgear/threads/SGThread.hxx>
+
+/**
+ * Stands in for the socket or serial channel of a protocol while the I/O
+ * thread owns the real one. The protocol still runs in the main loop, as
+ * it reads and writes properties, but this channel only copies to and from
+ * buffers, so a slow or blocking peer can't stall the frame.
+ *
+ * What the protocol writes during one process() call is the snapshot the
+ * I/O thread sends at the next tick of the channel's rate, a newer snapshot
+ * replaces one not sent yet. The I/O thread reads at the same ticks and the
+ * protocol gets the data at its next process() call. For datagram
+ * channels, each write() is sent and each read() returns one datagram, as
+ * with the real channel.
+ */
+class FGIOThreadChannel : public SGIOChannel
+{
+public:
+    FGIOThreadChannel(SGIOChannel* channel, SGProtocolDir dir, double hz,
+                      bool datagrams);
+    virtual ~FGIOThreadChannel();
+
+    // SGIOChannel, used by the protocol in the main loop. The real channel
+    // is opened before and closed after the I/O thread runs.
+    virtual bool open(const SGProtocolDir d);
+    virtual int read(char* buf, int length);
+    virtual int readline(char* buf, int length);
+    virtual int write(const char* buf, const int length);
+    virtual int writestring(const char* str);
+    virtual bool close();
+    virtual bool eof() const;
+
+    SGIOChannel* get_channel() const { return _channel; }
+    bool is_closed() const { return _closed; }
+
+    /// Whether the protocol should run this frame: there is input, or the
+    /// channel sends before the next frame is likely to end.
+    bool is_due(double now, double frame_dt);
+
+    /// Publish what the protocol wrote since the last call.
+    void commit();
+
+    /// I/O thread: send and receive if the channel is due. Returns the
+    /// time it is due next.
+    double service(double now);
+
+private:
+    void consume(size_t n);
+
+    SGIOChannel* _channel;     // not owned
+    bool _output;
+    bool _input;
+    bool _datagrams;           // keep the message boundaries of reads
+    double _interval;
+    bool _closed;
+
+    std::string _writing;      // main loop only
+    std::vector<size_t> _writeLengths; // of the datagrams in _writing
+
+    mutable SGMutex _mutex;    // guards the members below
+    std::string _snapshot;     // newest output, not sent yet
+    std::vector<size_t> _snapshotLengths;
+    bool _fresh;
+    std::string _received;     // input the protocol didn't read yet
+    std::deque<size_t> _lengths; // of the datagrams in _received
+    bool _eof;
+    double _next;              // time the channel is due
+};
+
+/**
+ * The thread sending and receiving for all FGIOThreadChannels, each at the
+ * rate of its protocol, independent of the frame rate.
+ */
+class FGIOThread : public SGThread
+{
+public:
+    FGIOThread();
+
+    /// Add a channel, only before start().
+    void add_channel(FGIOThreadChannel* channel);
+
+    /// Stop the thread and wait for it to finish.
+    void stop();
+
+    virtual void run();
+
+private:
+    std::vector<FGIOThreadChannel*> _channels;
+
+    SGMutex _mutex;
+    SGWaitCondition _wakeup;
+    bool _stop;
+};
+
+#endif // _FG_IO_THREAD_HXX
@@ -42,6 +42,7 @@
 #include <simgear/props/props.hxx>
 #include <simgear/structure/commands.hxx>
 #include <simgear/structure/event_mgr.hxx>
+#include <simgear/threads/SGGuard.hxx>
 
 #include <AIModel/AIManager.hxx>
 #include <AIModel/AIMultiplayer.hxx>
@@ -55,6 +56,9 @@
 #if defined(_MSC_VER) || defined(__MINGW32__)
 #include <WS2tcpip.h>
 #endif
+#if defined(__linux__)
+#include <sys/socket.h>
+#endif
 using namespace std;
 
 #define MAX_PACKET_SIZE 1200
@@ -933,6 +937,178 @@ do_multiplayer_refreshserverlist (const SGPropertyNode * arg, SGPropertyNode * r
   return true;
 }
 
+/**
+ * The buffer that holds a multi-player message, suitably aligned.
+ */
+union FGMultiplayMgr::MsgBuf
+{
+    MsgBuf()
+    {
+        memset(&Msg, 0, sizeof(Msg));
+    }
+
+    T_MsgHdr* msgHdr()
+    {
+        return &Header;
+    }
+
+    const T_MsgHdr* msgHdr() const
+    {
+        return reinterpret_cast<const T_MsgHdr*>(&Header);
+    }
+
+    T_PositionMsg* posMsg()
+    {
+        return reinterpret_cast<T_PositionMsg*>(Msg + sizeof(T_MsgHdr));
+    }
+
+    const T_PositionMsg* posMsg() const
+    {
+        return reinterpret_cast<const T_PositionMsg*>(Msg + sizeof(T_MsgHdr));
+    }
+
+    xdr_data_t* properties()
+    {
+        return reinterpret_cast<xdr_data_t*>(Msg + sizeof(T_MsgHdr)
+                                             + sizeof(T_PositionMsg));
+    }
+
+    const xdr_data_t* properties() const
+    {
+        return reinterpret_cast<const xdr_data_t*>(Msg + sizeof(T_MsgHdr)
+                                                   + sizeof(T_PositionMsg));
+    }
+    /**
+     * The end of the properties buffer.
+     */
+    xdr_data_t* propsEnd()
+    {
+        return reinterpret_cast<xdr_data_t*>(Msg + MAX_PACKET_SIZE);
+    };
+
+    const xdr_data_t* propsEnd() const
+    {
+        return reinterpret_cast<const xdr_data_t*>(Msg + MAX_PACKET_SIZE);
+    };
+    /**
+     * The end of properties actually in the buffer. This assumes that
+     * the message header is valid.
+     */
+    xdr_data_t* propsRecvdEnd()
+    {
+        return reinterpret_cast<xdr_data_t*>(Msg + Header.MsgLen);
+    }
+
+    const xdr_data_t* propsRecvdEnd() const
+    {
+        return reinterpret_cast<const xdr_data_t*>(Msg + Header.MsgLen);
+    }
+    
+    xdr_data2_t double_val;
+    char Msg[MAX_PACKET_SIZE];
+    T_MsgHdr Header;
+};
+
+/**
+ * Reusable set of receive buffers, filled by one batch receive.
+ */
+struct FGMultiplayMgr::RecvPool
+{
+    RecvPool(size_t Size) :
+        Bufs(Size),
+        Lengths(Size, 0)
+    {
+#if defined(__linux__)
+        Vectors.resize(Size);
+        Headers.resize(Size);
+        for (size_t i = 0; i < Size; ++i) {
+            Vectors[i].iov_base = Bufs[i].Msg;
+            Vectors[i].iov_len = sizeof(Bufs[i].Msg);
+            memset(&Headers[i], 0, sizeof(Headers[i]));
+            Headers[i].msg_hdr.msg_iov = &Vectors[i];
+            Headers[i].msg_hdr.msg_iovlen = 1;
+        }
+#endif
+    }
+
+    std::vector<MsgBuf> Bufs;
+    std::vector<int> Lengths;
+#if defined(__linux__)
+    std::vector<struct iovec> Vectors;
+    std::vector<struct mmsghdr> Headers;
+#endif
+};
+
+/**
+ * A validated and decoded message, ready to be applied on the main loop.
+ */
+struct FGMultiplayMgr::DecodedMsg
+{
+    DecodedMsg() : MsgId(0) {}
+
+    unsigned MsgId;
+    std::string Callsign;
+    std::string Model;  // position messages
+    std::string Text;   // chat messages
+    FGExternalMotionData MotionInfo;
+};
+
+// Upper limit of decoded messages waiting for the main loop. When the main
+// loop stalls (e.g. while loading scenery), the oldest updates are dropped.
+static const size_t MAX_QUEUED_MSGS = 4096;
+
+/**
+ * Worker draining and decoding the receive socket off the main loop.
+ */
+class FGMultiplayMgr::ReceiveThread : public SGThread
+{
+public:
+    ReceiveThread(FGMultiplayMgr* pMgr) :
+        mMgr(pMgr),
+        mStop(false)
+    {
+    }
+
+    ~ReceiveThread()
+    {
+        stop();
+    }
+
+    void stop()
+    {
+        if (mStop.exchange(true))
+            return;
+        join();
+    }
+
+    virtual void run()
+    {
+        DecodedMsgList decoded;
+        while (!mStop) {
+            mMgr->ReceiveMessages(decoded);
+            if (!decoded.empty()) {
+                SGGuard<SGMutex> lock(mMgr->mReceivedMutex);
+                DecodedMsgList& queue = mMgr->mReceivedMsgs;
+                queue.insert(queue.end(), decoded.begin(), decoded.end());
+                decoded.clear();
+                if (queue.size() > MAX_QUEUED_MSGS) {
+                    size_t excess = queue.size() - MAX_QUEUED_MSGS;
+                    for (size_t i = 0; i < excess; ++i)
+                        delete queue[i];
+                    queue.erase(queue.begin(), queue.begin() + excess);
+                }
+            }
+            // wait for more data; the timeout bounds the shutdown latency
+            simgear::Socket* reads[2] = { mMgr->mSocket.get(), NULL };
+            simgear::Socket::select(reads, NULL, 20);
+        }
+    }
+
+private:
+    FGMultiplayMgr* mMgr;
+    std::atomic<bool> mStop;
+};
+
 //////////////////////////////////////////////////////////////////////
 //
 //  MultiplayMgr constructor
@@ -943,6 +1119,7 @@ FGMultiplayMgr::FGMultiplayMgr()
   mInitialised   = false;
   mHaveServer    = false;
   mListener = NULL;
+  mRecvDebugLevel = 0;
   globals->get_commands()->addCommand("multiplayer-connect", do_multiplayer_connect);
   globals->get_commands()->addCommand("multiplayer-disconnect", do_multiplayer_disconnect);
   globals->get_commands()->addCommand("multiplayer-refreshserverlist", do_multiplayer_refreshserverlist);
@@ -962,6 +1139,7 @@ FGMultiplayMgr::FGMultiplayMgr()
 //////////////////////////////////////////////////////////////////////
 FGMultiplayMgr::~FGMultiplayMgr() 
 {
+   StopReceiving();
    globals->get_commands()->removeCommand("multiplayer-connect");
    globals->get_commands()->removeCommand("multiplayer-disconnect");
    globals->get_commands()->removeCommand("multiplayer-refreshserverlist");
@@ -1052,6 +1230,20 @@ FGMultiplayMgr::init (void)
             << strerror(errno) << "(errno " << errno << ")");
     return;
   }
+
+  // Datagrams are received in batches into a reusable buffer pool and
+  // decoded in bulk - optionally on a separate thread, in which case the
+  // main loop only applies the decoded updates.
+  int batchSize = fgGetInt("/sim/multiplay/receive-batch-size", 64);
+  if (batchSize < 1)
+    batchSize = 1;
+  mRecvPool.reset(new RecvPool(batchSize));
+  mRecvDebugLevel = pMultiPlayDebugLevel->getIntValue();
+  if (fgGetBool("/sim/multiplay/threaded-receive", false)) {
+    mReceiveThread.reset(new ReceiveThread(this));
+    mReceiveThread->start();
+    SG_LOG(SG_NETWORK, SG_INFO, "FGMultiplayMgr - receiving on separate thread");
+  }
   
   mPropertiesChanged = true;
   mListener = new MPPropertyListener(this);
@@ -1080,6 +1272,8 @@ void
 FGMultiplayMgr::shutdown (void) 
 {
   fgSetBool("/sim/multiplay/online", false);
+
+  StopReceiving();
   
   if (mSocket.get()) {
     mSocket->close();
@@ -1112,81 +1306,31 @@ FGMultiplayMgr::reinit()
 
 //////////////////////////////////////////////////////////////////////
 //
-//  Description: Sends the position data for the local position.
+//  Stops the receive thread and drops all pending decoded messages.
 //
 //////////////////////////////////////////////////////////////////////
-
-/**
- * The buffer that holds a multi-player message, suitably aligned.
- */
-union FGMultiplayMgr::MsgBuf
+void
+FGMultiplayMgr::StopReceiving()
 {
-    MsgBuf()
-    {
-        memset(&Msg, 0, sizeof(Msg));
-    }
-
-    T_MsgHdr* msgHdr()
-    {
-        return &Header;
-    }
-
-    const T_MsgHdr* msgHdr() const
-    {
-        return reinterpret_cast<const T_MsgHdr*>(&Header);
-    }
-
-    T_PositionMsg* posMsg()
-    {
-        return reinterpret_cast<T_PositionMsg*>(Msg + sizeof(T_MsgHdr));
-    }
-
-    const T_PositionMsg* posMsg() const
-    {
-        return reinterpret_cast<const T_PositionMsg*>(Msg + sizeof(T_MsgHdr));
-    }
-
-    xdr_data_t* properties()
-    {
-        return reinterpret_cast<xdr_data_t*>(Msg + sizeof(T_MsgHdr)
-                                             + sizeof(T_PositionMsg));
-    }
+  if (mReceiveThread) {
+    mReceiveThread->stop();
+    mReceiveThread.reset();
+  }
 
-    const xdr_data_t* properties() const
-    {
-        return reinterpret_cast<const xdr_data_t*>(Msg + sizeof(T_MsgHdr)
-                                                   + sizeof(T_PositionMsg));
-    }
-    /**
-     * The end of the properties buffer.
-     */
-    xdr_data_t* propsEnd()
-    {
-        return reinterpret_cast<xdr_data_t*>(Msg + MAX_PACKET_SIZE);
-    };
+  SGGuard<SGMutex> lock(mReceivedMutex);
+  for (DecodedMsgList::iterator it = mReceivedMsgs.begin();
+       it != mReceivedMsgs.end(); ++it)
+    delete *it;
+  mReceivedMsgs.clear();
+  mRecvPool.reset();
+}
 
-    const xdr_data_t* propsEnd() const
-    {
-        return reinterpret_cast<const xdr_data_t*>(Msg + MAX_PACKET_SIZE);
-    };
-    /**
-     * The end of properties actually in the buffer. This assumes that
-     * the message header is valid.
-     */
-    xdr_data_t* propsRecvdEnd()
-    {
-        return reinterpret_cast<xdr_data_t*>(Msg + Header.MsgLen);
-    }
+//////////////////////////////////////////////////////////////////////
+//
+//  Description: Sends the position data for the local position.
+//
+//////////////////////////////////////////////////////////////////////
 
-    const xdr_data_t* propsRecvdEnd() const
-    {
-        return reinterpret_cast<const xdr_data_t*>(Msg + Header.MsgLen);
-    }
-    
-    xdr_data2_t double_val;
-    char Msg[MAX_PACKET_SIZE];
-    T_MsgHdr Header;
-};
 
 bool
 FGMultiplayMgr::isSane(const FGExternalMotionData& motionInfo)
@@ -1706,17 +1850,96 @@ FGMultiplayMgr::update(double dt)
   }
 
   //////////////////////////////////////////////////
-  //  Read the receive socket and process any data
+  //  Fetch the decoded messages - either from the
+  //  receive thread or by draining the socket now -
+  //  and apply them
   //////////////////////////////////////////////////
-  ssize_t bytes;
+  mRecvDebugLevel = pMultiPlayDebugLevel->getIntValue();
+  DecodedMsgList decoded;
+  if (mReceiveThread) {
+    SGGuard<SGMutex> lock(mReceivedMutex);
+    decoded.swap(mReceivedMsgs);
+  } else {
+    ReceiveMessages(decoded);
+  }
+  for (DecodedMsgList::iterator msg = decoded.begin(); msg != decoded.end(); ++msg) {
+    ApplyMsg(**msg, stamp);
+    delete *msg;
+  }
+
+  // check for expiry
+  MultiPlayerMap::iterator it = mMultiPlayerMap.begin();
+  while (it != mMultiPlayerMap.end()) {
+    if (it->second->getLastTimestamp() + 10 < stamp) {
+      std::string name = it->first;
+      it->second->setDie(true);
+      mMultiPlayerMap.erase(it);
+      it = mMultiPlayerMap.upper_bound(name);
+    } else
+      ++it;
+  }
+} // FGMultiplayMgr::ProcessData(void)
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Drain the receive socket, decoding all valid messages.
+//  Malformed packets are dropped without affecting the rest.
+//
+//////////////////////////////////////////////////////////////////////
+void
+FGMultiplayMgr::ReceiveMessages(DecodedMsgList& Decoded)
+{
+  if (!mRecvPool)
+    return;
+
+  int count;
   do {
-    MsgBuf msgBuf;
+    count = ReceiveBatch();
+    for (int i = 0; i < count; ++i) {
+      DecodedMsg* msg = new DecodedMsg;
+      if (DecodeMsg(mRecvPool->Bufs[i], mRecvPool->Lengths[i], *msg))
+        Decoded.push_back(msg);
+      else
+        delete msg;
+    }
+  } while (count == static_cast<int>(mRecvPool->Bufs.size()));
+} // FGMultiplayMgr::ReceiveMessages()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Receive up to one pool full of datagrams. Returns the number of
+//  datagrams received.
+//
+//////////////////////////////////////////////////////////////////////
+int
+FGMultiplayMgr::ReceiveBatch()
+{
+  const int size = static_cast<int>(mRecvPool->Bufs.size());
+#if defined(__linux__)
+  // fetch all pending datagrams with a single system call
+  int count = ::recvmmsg(mSocket->getHandle(), &mRecvPool->Headers[0], size,
+                         MSG_DONTWAIT, NULL);
+  if (count < 0) {
+    if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+      SG_LOG(SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::MP_ProcessData - Unable to receive data. "
+          << strerror(errno) << "(errno " << errno << ")");
+    return 0;
+  }
+  for (int i = 0; i < count; ++i)
+    mRecvPool->Lengths[i] = static_cast<int>(mRecvPool->Headers[i].msg_len);
+  return count;
+#else
+  int count = 0;
+  while (count < size) {
     //////////////////////////////////////////////////
-    //  Although the recv call asks for 
+    //  Although the recv call asks for
     //  MAX_PACKET_SIZE of data, the number of bytes
     //  returned will only be that of the next
     //  packet waiting to be processed.
     //////////////////////////////////////////////////
+    MsgBuf& msgBuf = mRecvPool->Bufs[count];
     simgear::IPAddress SenderAddress;
     int RecvStatus = mSocket->recvfrom(msgBuf.Msg, sizeof(msgBuf.Msg), 0,
                               &SenderAddress);
@@ -1752,71 +1975,97 @@ FGMultiplayMgr::update(double dt)
     }
 
     // status is positive: bytes received
-    bytes = (ssize_t) RecvStatus;
-    if (bytes <= static_cast<ssize_t>(sizeof(T_MsgHdr))) {
-      SG_LOG( SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::MP_ProcessData - "
-              << "received message with insufficient data" );
-      break;
-    }
-    //////////////////////////////////////////////////
-    //  Read header
-    //////////////////////////////////////////////////
-    T_MsgHdr* MsgHdr = msgBuf.msgHdr();
-    MsgHdr->Magic       = XDR_decode_uint32 (MsgHdr->Magic);
-    MsgHdr->Version     = XDR_decode_uint32 (MsgHdr->Version);
-    MsgHdr->MsgId       = XDR_decode_uint32 (MsgHdr->MsgId);
-    MsgHdr->MsgLen      = XDR_decode_uint32 (MsgHdr->MsgLen);
-    MsgHdr->ReplyPort   = XDR_decode_uint32 (MsgHdr->ReplyPort);
-    MsgHdr->Callsign[MAX_CALLSIGN_LEN -1] = '\0';
-    if (MsgHdr->Magic != MSG_MAGIC) {
-      SG_LOG( SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::MP_ProcessData - "
-              << "message has invalid magic number!" );
-      break;
-    }
-    if (MsgHdr->Version != PROTO_VER) {
-      SG_LOG( SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::MP_ProcessData - "
-              << "message has invalid protocol number!" );
-      break;
-    }
-    if (static_cast<ssize_t>(MsgHdr->MsgLen) != bytes) {
-      SG_LOG(SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::MP_ProcessData - "
-             << "message from " << MsgHdr->Callsign << " has invalid length!");
-      break;
-    }
-    //////////////////////////////////////////////////
-    //  Process messages
-    //////////////////////////////////////////////////
-    switch (MsgHdr->MsgId) {
-    case CHAT_MSG_ID:
-      ProcessChatMsg(msgBuf, SenderAddress);
-      break;
-    case POS_DATA_ID:
-      ProcessPosMsg(msgBuf, SenderAddress, stamp);
-      break;
-    case UNUSABLE_POS_DATA_ID:
-    case OLD_OLD_POS_DATA_ID:
-    case OLD_PROP_MSG_ID:
-    case OLD_POS_DATA_ID:
-      break;
-    default:
-      SG_LOG( SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::MP_ProcessData - "
-              << "Unknown message Id received: " << MsgHdr->MsgId );
-      break;
-    }
-  } while (bytes > 0);
+    mRecvPool->Lengths[count++] = RecvStatus;
+  }
+  return count;
+#endif
+} // FGMultiplayMgr::ReceiveBatch()
+//////////////////////////////////////////////////////////////////////
 
-  // check for expiry
-  MultiPlayerMap::iterator it = mMultiPlayerMap.begin();
-  while (it != mMultiPlayerMap.end()) {
-    if (it->second->getLastTimestamp() + 10 < stamp) {
-      std::string name = it->first;
-      it->second->setDie(true);
-      mMultiPlayerMap.erase(it);
-      it = mMultiPlayerMap.upper_bound(name);
-    } else
-      ++it;
+//////////////////////////////////////////////////////////////////////
+//
+//  Validate the header of a received message and decode it.
+//  Returns false if the message is to be dropped.
+//
+//////////////////////////////////////////////////////////////////////
+bool
+FGMultiplayMgr::DecodeMsg(MsgBuf& msgBuf, int bytes, DecodedMsg& Decoded)
+{
+  if (bytes <= static_cast<int>(sizeof(T_MsgHdr))) {
+    SG_LOG( SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::MP_ProcessData - "
+            << "received message with insufficient data" );
+    return false;
   }
-} // FGMultiplayMgr::ProcessData(void)
+  //////////////////////////////////////////////////
+  //  Read header
+  //////////////////////////////////////////////////
+  T_MsgHdr* MsgHdr = msgBuf.msgHdr();
+  MsgHdr->Magic       = XDR_decode_uint32 (MsgHdr->Magic);
+  MsgHdr->Version     = XDR_decode_uint32 (MsgHdr->Version);
+  MsgHdr->MsgId       = XDR_decode_uint32 (MsgHdr->MsgId);
+  MsgHdr->MsgLen      = XDR_decode_uint32 (MsgHdr->MsgLen);
+  MsgHdr->ReplyPort   = XDR_decode_uint32 (MsgHdr->ReplyPort);
+  MsgHdr->Callsign[MAX_CALLSIGN_LEN -1] = '\0';
+  if (MsgHdr->Magic != MSG_MAGIC) {
+    SG_LOG( SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::MP_ProcessData - "
+            << "message has invalid magic number!" );
+    return false;
+  }
+  if (MsgHdr->Version != PROTO_VER) {
+    SG_LOG( SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::MP_ProcessData - "
+            << "message has invalid protocol number!" );
+    return false;
+  }
+  if (static_cast<int>(MsgHdr->MsgLen) != bytes) {
+    SG_LOG(SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::MP_ProcessData - "
+           << "message from " << MsgHdr->Callsign << " has invalid length!");
+    return false;
+  }
+  //////////////////////////////////////////////////
+  //  Decode messages
+  //////////////////////////////////////////////////
+  switch (MsgHdr->MsgId) {
+  case CHAT_MSG_ID:
+    return DecodeChatMsg(msgBuf, Decoded);
+  case POS_DATA_ID:
+    return DecodePosMsg(msgBuf, Decoded);
+  case UNUSABLE_POS_DATA_ID:
+  case OLD_OLD_POS_DATA_ID:
+  case OLD_PROP_MSG_ID:
+  case OLD_POS_DATA_ID:
+    return false;
+  default:
+    SG_LOG( SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::MP_ProcessData - "
+            << "Unknown message Id received: " << MsgHdr->MsgId );
+    return false;
+  }
+} // FGMultiplayMgr::DecodeMsg()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Apply a decoded message
+//
+//////////////////////////////////////////////////////////////////////
+void
+FGMultiplayMgr::ApplyMsg(DecodedMsg& Decoded, long stamp)
+{
+  switch (Decoded.MsgId) {
+  case CHAT_MSG_ID:
+    SG_LOG (SG_NETWORK, SG_WARN, "Chat [" << Decoded.Callsign << "]"
+             << " " << Decoded.Text);
+    break;
+  case POS_DATA_ID: {
+    FGAIMultiplayer* mp = getMultiplayer(Decoded.Callsign);
+    if (!mp)
+      mp = addMultiplayer(Decoded.Callsign, Decoded.Model);
+    mp->addMotionInfo(Decoded.MotionInfo, stamp);
+    break;
+  }
+  default:
+    break;
+  }
+} // FGMultiplayMgr::ApplyMsg()
 //////////////////////////////////////////////////////////////////////
 
 void
@@ -1968,15 +2217,30 @@ FGMultiplayMgr::Send()
 void
 FGMultiplayMgr::ProcessPosMsg(const FGMultiplayMgr::MsgBuf& Msg,
    const simgear::IPAddress& SenderAddress, long stamp)
+{
+   DecodedMsg Decoded;
+   if (DecodePosMsg(Msg, Decoded))
+      ApplyMsg(Decoded, stamp);
+} // FGMultiplayMgr::ProcessPosMsg()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+//
+//  decode a position message
+//
+//////////////////////////////////////////////////////////////////////
+bool
+FGMultiplayMgr::DecodePosMsg(const FGMultiplayMgr::MsgBuf& Msg,
+   DecodedMsg& Decoded)
 {
    const T_MsgHdr* MsgHdr = Msg.msgHdr();
    if (MsgHdr->MsgLen < sizeof(T_MsgHdr) + sizeof(T_PositionMsg)) {
       SG_LOG(SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::MP_ProcessData - "
          << "Position message received with insufficient data");
-      return;
+      return false;
    }
    const T_PositionMsg* PosMsg = Msg.posMsg();
-   FGExternalMotionData motionInfo;
+   FGExternalMotionData& motionInfo = Decoded.MotionInfo;
    motionInfo.time = XDR_decode_double(PosMsg->time);
    motionInfo.lag = XDR_decode_double(PosMsg->lag);
    for (unsigned i = 0; i < 3; ++i)
@@ -2001,7 +2265,7 @@ FGMultiplayMgr::ProcessPosMsg(const FGMultiplayMgr::MsgBuf& Msg,
       SG_LOG(SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::ProcessPosMsg - "
          << "Position message with invalid data (NaN) received from "
          << MsgHdr->Callsign);
-      return;
+      return false;
    }
 
    //cout << "INPUT MESSAGE\n";
@@ -2056,7 +2320,7 @@ FGMultiplayMgr::ProcessPosMsg(const FGMultiplayMgr::MsgBuf& Msg,
             short_int_encoded = true;
         }
 
-        if (pMultiPlayDebugLevel->getIntValue() & 8)
+        if (mRecvDebugLevel & 8)
             SG_LOG(SG_NETWORK, SG_INFO,
                 "[RECV] add " << std::hex << xdr
                 << std::dec <<
@@ -2236,28 +2500,27 @@ FGMultiplayMgr::ProcessPosMsg(const FGMultiplayMgr::MsgBuf& Msg,
     }
   }
  noprops:
-  FGAIMultiplayer* mp = getMultiplayer(MsgHdr->Callsign);
-  if (!mp)
-    mp = addMultiplayer(MsgHdr->Callsign, PosMsg->Model);
-  mp->addMotionInfo(motionInfo, stamp);
-} // FGMultiplayMgr::ProcessPosMsg()
+  Decoded.MsgId = POS_DATA_ID;
+  Decoded.Callsign = MsgHdr->Callsign;
+  Decoded.Model = PosMsg->Model;
+  return true;
+} // FGMultiplayMgr::DecodePosMsg()
 //////////////////////////////////////////////////////////////////////
 
 //////////////////////////////////////////////////////////////////////
 //
-//  handle a chat message
+//  decode a chat message
 //  FIXME: display chat message within flightgear
 //
 //////////////////////////////////////////////////////////////////////
-void
-FGMultiplayMgr::ProcessChatMsg(const MsgBuf& Msg,
-                               const simgear::IPAddress& SenderAddress)
+bool
+FGMultiplayMgr::DecodeChatMsg(const MsgBuf& Msg, DecodedMsg& Decoded)
 {
   const T_MsgHdr* MsgHdr = Msg.msgHdr();
   if (MsgHdr->MsgLen < sizeof(T_MsgHdr) + 1) {
     SG_LOG( SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::MP_ProcessData - "
             << "Chat message received with insufficient data" );
-    return;
+    return false;
   }
   
   char *chatStr = new char[MsgHdr->MsgLen - sizeof(T_MsgHdr)];
@@ -2266,12 +2529,14 @@ FGMultiplayMgr::ProcessChatMsg(const MsgBuf& Msg,
   strncpy(chatStr, ChatMsg->Text,
           MsgHdr->MsgLen - sizeof(T_MsgHdr));
   chatStr[MsgHdr->MsgLen - sizeof(T_MsgHdr) - 1] = '\0';
-  
-  SG_LOG (SG_NETWORK, SG_WARN, "Chat [" << MsgHdr->Callsign << "]"
-           << " " << chatStr);
+
+  Decoded.MsgId = CHAT_MSG_ID;
+  Decoded.Callsign = MsgHdr->Callsign;
+  Decoded.Text = chatStr;
 
   delete [] chatStr;
-} // FGMultiplayMgr::ProcessChatMsg ()
+  return true;
+} // FGMultiplayMgr::DecodeChatMsg ()
 //////////////////////////////////////////////////////////////////////
 
 void
@@ -37,11 +37,13 @@ const int MAX_MP_PROTOCOL_VERSION = 2;
 #include <string>
 #include <vector>
 #include <memory>
+#include <atomic>
 
 #include <simgear/compiler.h>
 #include <simgear/props/props.hxx>
 #include <simgear/io/raw_socket.hxx>
 #include <simgear/structure/subsystem_mgr.hxx>
+#include <simgear/threads/SGThread.hxx>
 
 struct FGExternalMotionData;
 class MPPropertyListener;
@@ -88,13 +90,29 @@ private:
   short get_scaled_short(double v, double scale);
 
   union MsgBuf;
+  struct RecvPool;
+  struct DecodedMsg;
+  class ReceiveThread;
+  typedef std::vector<DecodedMsg*> DecodedMsgList;
+
   FGAIMultiplayer* addMultiplayer(const std::string& callsign,
                                   const std::string& modelName);
   FGAIMultiplayer* getMultiplayer(const std::string& callsign);
   void FillMsgHdr(T_MsgHdr *MsgHdr, int iMsgId, unsigned _len = 0u);
+
+  void StopReceiving();
+
+  // receive stage - safe to run on the receive thread
+  void ReceiveMessages(DecodedMsgList& Decoded);
+  int ReceiveBatch();
+  bool DecodeMsg(MsgBuf& Msg, int Bytes, DecodedMsg& Decoded);
+  bool DecodePosMsg(const MsgBuf& Msg, DecodedMsg& Decoded);
+  bool DecodeChatMsg(const MsgBuf& Msg, DecodedMsg& Decoded);
+
+  // dispatch stage - main loop only
+  void ApplyMsg(DecodedMsg& Decoded, long stamp);
   void ProcessPosMsg(const MsgBuf& Msg, const simgear::IPAddress& SenderAddress,
                      long stamp);
-  void ProcessChatMsg(const MsgBuf& Msg, const simgear::IPAddress& SenderAddress);
   bool isSane(const FGExternalMotionData& motionInfo);
 
   /// maps from the callsign string to the FGAIMultiplayer
@@ -102,6 +120,13 @@ private:
   MultiPlayerMap mMultiPlayerMap;
 
   std::unique_ptr<simgear::Socket> mSocket;
+  std::unique_ptr<RecvPool> mRecvPool;
+  // messages decoded by the receive thread, waiting for the main loop
+  SGMutex mReceivedMutex;
+  DecodedMsgList mReceivedMsgs;
+  std::unique_ptr<ReceiveThread> mReceiveThread;
+  // copy of /sim/multiplay/debug-level for the receive stage
+  std::atomic<int> mRecvDebugLevel;
   simgear::IPAddress mServer;
   bool mHaveServer;
   bool mInitialised;
@@ -27,7 +27,9 @@
 
 // std
 #include <cstddef>  // for std::size_t
+#include <exception>
 #include <map>
+#include <vector>
 #include <cassert>
 #include <stdint.h> // for int64_t
 #include <sstream>  // for std::ostringstream
@@ -222,6 +224,61 @@ private:
   bool _isFinished;
 };
 
+/**
+ * Thread parsing the .dat files of one type into memory, while the rebuild
+ * thread loads other data into the cache. The parsing must not use the
+ * cache: the rebuild thread does all the inserts, in file order, once
+ * finish() returned.
+ */
+class DatFilesReader : public SGThread
+{
+public:
+  typedef std::function<void(std::size_t, const SGPath&)> ReadFunction;
+
+  DatFilesReader(const PathList& paths, ReadFunction read) :
+    _paths(paths),
+    _read(read),
+    _finished(false)
+  {
+    start();
+  }
+
+  ~DatFilesReader()
+  {
+    if (!_finished) {
+      join();
+    }
+  }
+
+  virtual void run()
+  {
+    try {
+      for (std::size_t i = 0; i < _paths.size(); i++) {
+        _read(i, _paths[i]);
+      }
+    } catch (...) {
+      // rethrown as it is by finish(), on the thread which inserts the data
+      _error = std::current_exception();
+    }
+  }
+
+  // wait until all files are read, and pass on an error of the reader
+  void finish()
+  {
+    join();
+    _finished = true;
+    if (_error) {
+      std::rethrow_exception(_error);
+    }
+  }
+
+private:
+  const PathList _paths;
+  ReadFunction _read;
+  std::exception_ptr _error;
+  bool _finished;
+};
+
 ////////////////////////////////////////////////////////////////////////////
 
 typedef std::map<PositionedID, FGPositionedRef> PositionedCache;
@@ -1431,6 +1488,22 @@ void NavDataCache::doRebuild()
         FixesLoader fixesLoader;
         NavLoader navLoader;
 
+        // fix.dat and nav.dat files are parsed on their own threads while
+        // apt.dat is read and the airports are loaded
+        const PathList& fixPaths = getDatFilesInfo(DATFILETYPE_FIX).paths;
+        std::vector<FixesLoader::FixesFile> fixFiles(fixPaths.size());
+        DatFilesReader fixesReader(fixPaths,
+            [&fixFiles](std::size_t i, const SGPath& path) {
+                FixesLoader::readFixes(path, fixFiles[i]);
+            });
+
+        const PathList& navPaths = getDatFilesInfo(DATFILETYPE_NAV).paths;
+        std::vector<NavLoader::NavFile> navFiles(navPaths.size());
+        DatFilesReader navReader(navPaths,
+            [&navFiles](std::size_t i, const SGPath& path) {
+                NavLoader::readNav(path, navFiles[i]);
+            });
+
         using namespace std::placeholders;  // for _1, _2, _3...
 
         loadDatFiles(DATFILETYPE_APT,
@@ -1448,10 +1521,28 @@ void NavDataCache::doRebuild()
         metarDataLoad(d->metarDatPath);
         stampCacheFile(d->metarDatPath);
 
+        // the files come in the same order as they were read
+        std::size_t fileIndex = 0;
+        fixesReader.finish();
         loadDatFiles(DATFILETYPE_FIX,
-                     std::bind(&FixesLoader::loadFixes, &fixesLoader, _1, _2, _3));
+                     [&](const SGPath& path, std::size_t bytesReadSoFar,
+                         std::size_t totalSize) {
+                         assert(fixFiles[fileIndex].path == path);
+                         fixesLoader.insertFixes(fixFiles[fileIndex++],
+                                                 bytesReadSoFar, totalSize);
+                     });
+        fixFiles.clear();
+
+        fileIndex = 0;
+        navReader.finish();
         loadDatFiles(DATFILETYPE_NAV,
-                     std::bind(&NavLoader::loadNav, &navLoader, _1, _2, _3));
+                     [&](const SGPath& path, std::size_t bytesReadSoFar,
+                         std::size_t totalSize) {
+                         assert(navFiles[fileIndex].path == path);
+                         navLoader.insertNav(navFiles[fileIndex++],
+                                             bytesReadSoFar, totalSize);
+                     });
+        navFiles.clear();
 
         setRebuildPhaseProgress(REBUILD_UNKNOWN);
         st.stamp();
@@ -67,6 +67,14 @@ FixesLoader::~FixesLoader()
 // Load fixes from the specified fix.dat (or fix.dat.gz) file
 void FixesLoader::loadFixes(const SGPath& path, std::size_t bytesReadSoFar,
                             std::size_t totalSizeOfAllDatFiles)
+{
+  FixesFile file;
+  readFixes(path, file);
+  insertFixes(file, bytesReadSoFar, totalSizeOfAllDatFiles);
+}
+
+// Parse all fixes of a fix.dat file, without touching the NavDataCache
+void FixesLoader::readFixes(const SGPath& path, FixesFile& file)
 {
   sg_gzifstream in( path );
   const std::string utf8path = path.utf8Str();
@@ -77,6 +85,10 @@ void FixesLoader::loadFixes(const SGPath& path, std::size_t bytesReadSoFar,
       sg_location(path));
   }
 
+  file.path = path;
+  file.sizeInBytes = path.sizeInBytes();
+  file.fixes.clear();
+
   // toss the first two lines of the file
   for (int i = 0; i < 2; i++) {
     in >> skipeol;
@@ -127,7 +139,22 @@ void FixesLoader::loadFixes(const SGPath& path, std::size_t bytesReadSoFar,
              " " << fields[1]);
       continue;
     }
-    SGGeod pos(SGGeod::fromDeg(lon, lat));
+    file.fixes.push_back({lineNumber, ident, SGGeod::fromDeg(lon, lat)});
+  }
+
+  throwExceptionIfStreamError(in, path);
+}
+
+// Add the fixes read by readFixes() to the NavDataCache, in file order
+void FixesLoader::insertFixes(const FixesFile& file, std::size_t bytesReadSoFar,
+                              std::size_t totalSizeOfAllDatFiles)
+{
+  const std::string utf8path = file.path.utf8Str();
+  const std::size_t nbFixes = file.fixes.size();
+
+  for (std::size_t i = 0; i < nbFixes; i++) {
+    const std::string& ident = file.fixes[i].ident;
+    const SGGeod& pos = file.fixes[i].pos;
     bool duplicate = false;
     auto range = _loadedFixes.equal_range(ident);
     for (auto it = range.first; it != range.second; ++it) {
@@ -135,8 +162,8 @@ void FixesLoader::loadFixes(const SGPath& path, std::size_t bytesReadSoFar,
                            SGVec3d::fromGeod(it->second)) * SG_METER_TO_NM;
       if (distNm < DUPLICATE_DETECTION_RADIUS_NM) {
         SG_LOG(SG_NAVAID, SG_INFO,
-               utf8path << ":"  << lineNumber << ": skipping fix " <<
-               ident << " (already defined nearby)");
+               utf8path << ":"  << file.fixes[i].lineNumber <<
+               ": skipping fix " << ident << " (already defined nearby)");
         duplicate = true;
         break;
       }
@@ -147,15 +174,13 @@ void FixesLoader::loadFixes(const SGPath& path, std::size_t bytesReadSoFar,
       _loadedFixes.insert({ident, pos});
     }
 
-    if ((lineNumber % 100) == 0) {
-      // every 100 lines
-      unsigned int percent = ((bytesReadSoFar + in.approxOffset()) * 100)
-        / totalSizeOfAllDatFiles;
+    if ((i % 100) == 0) {
+      // every 100 fixes
+      unsigned int percent = ((bytesReadSoFar + file.sizeInBytes * i / nbFixes)
+                              * 100) / totalSizeOfAllDatFiles;
       _cache->setRebuildPhaseProgress(NavDataCache::REBUILD_FIXES, percent);
     }
   }
-
-  throwExceptionIfStreamError(in, path);
 }
 
 void FixesLoader::throwExceptionIfStreamError(
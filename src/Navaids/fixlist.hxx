@@ -27,10 +27,11 @@
 
 #include <simgear/compiler.h>
 #include <simgear/math/SGGeod.hxx>
+#include <simgear/misc/sg_path.hxx>
 #include <unordered_map>
 #include <string>
+#include <vector>
 
-class SGPath;
 class sg_gzifstream;
 
 namespace flightgear
@@ -40,6 +41,19 @@ namespace flightgear
   class FixesLoader
   {
   public:
+    // A fix.dat line, parsed but not inserted into the cache yet
+    struct Fix {
+      unsigned int lineNumber;
+      std::string ident;
+      SGGeod pos;
+    };
+
+    struct FixesFile {
+      SGPath path;
+      std::size_t sizeInBytes;
+      std::vector<Fix> fixes;
+    };
+
     FixesLoader();
     ~FixesLoader();
 
@@ -47,9 +61,15 @@ namespace flightgear
     void loadFixes(const SGPath& path, std::size_t bytesReadSoFar,
                    std::size_t totalSizeOfAllDatFiles);
 
+    // The two halves of loadFixes(). readFixes() only parses the file and
+    // doesn't use the NavDataCache, so it can run on another thread.
+    static void readFixes(const SGPath& path, FixesFile& file);
+    void insertFixes(const FixesFile& file, std::size_t bytesReadSoFar,
+                     std::size_t totalSizeOfAllDatFiles);
+
   private:
-    void throwExceptionIfStreamError(const sg_gzifstream& input_stream,
-                                     const SGPath& path);
+    static void throwExceptionIfStreamError(const sg_gzifstream& input_stream,
+                                            const SGPath& path);
 
     NavDataCache* _cache;
     std::unordered_multimap<std::string, SGGeod> _loadedFixes;
@@ -157,7 +157,20 @@ PositionedID NavLoader::processNavLine(
   const string& line, const string& utf8Path, unsigned int lineNum,
   FGPositioned::Type type, unsigned long version)
 {
-  NavDataCache* cache = NavDataCache::instance();
+  NavLine navLine;
+  if (!parseNavLine(line, utf8Path, lineNum, type, version, navLine)) {
+    return 0;
+  }
+
+  return insertNavLine(navLine, utf8Path);
+}
+
+// Parse a line from a file such as nav.dat or carrier_nav.dat into
+// 'navLine'. Return false if the line doesn't define a navaid.
+bool NavLoader::parseNavLine(
+  const string& line, const string& utf8Path, unsigned int lineNum,
+  FGPositioned::Type type, unsigned long version, NavLine& navLine)
+{
   int rowCode, elev_ft, freq, range;
   // 'multiuse': different meanings depending on the record's row code
   double lat, lon, multiuse;
@@ -167,7 +180,7 @@ PositionedID NavLoader::processNavLine(
 
   if (simgear::strutils::starts_with(line, "#")) {
     // carrier_nav.dat has a comment line using this syntax...
-    return 0;
+    return false;
   }
 
   int num_splits;
@@ -184,7 +197,7 @@ PositionedID NavLoader::processNavLine(
   static const string endOfData = "99"; // special code in the nav.dat spec
 
   if (nbFields == 0) {       // blank line
-    return 0;
+    return false;
   } else if (nbFields == 1) {
     if (fields[0] != endOfData) {
       SG_LOG( SG_NAVAID, SG_WARN,
@@ -192,12 +205,12 @@ PositionedID NavLoader::processNavLine(
               "field, but it is not '99'" );
     }
 
-    return 0;
+    return false;
   } else if (nbFields < 9) {
     SG_LOG( SG_NAVAID, SG_WARN,
             utf8Path << ":"  << lineNum << ": invalid line "
             "(at least 9 fields are required)" );
-    return 0;
+    return false;
   }
 
   // When their string argument can't be properly converted, std::stoi(),
@@ -238,7 +251,7 @@ PositionedID NavLoader::processNavLine(
             utf8Path << ":"  << lineNum << ": unable to parse (" <<
             exc.what() << "): '" <<
             simgear::strutils::stripTrailingNewlines(line) << "'" );
-    return 0;
+    return false;
   }
 
   SGGeod pos(SGGeod::fromDegFt(lon, lat, static_cast<double>(elev_ft)));
@@ -255,7 +268,7 @@ PositionedID NavLoader::processNavLine(
                << rowCode << ", ignoring this line and all further lines "
                << "with the same code");
       }
-      return 0;
+      return false;
     }
   }
 
@@ -265,6 +278,33 @@ PositionedID NavLoader::processNavLine(
     freq *= 100;
   }
 
+  navLine.lineNum = lineNum;
+  navLine.type = type;
+  navLine.pos = pos;
+  navLine.elev_ft = elev_ft;
+  navLine.freq = freq;
+  navLine.range = range;
+  navLine.multiuse = multiuse;
+  navLine.ident = ident;
+  navLine.name = name;
+  return true;
+}
+
+// Load a navaid parsed by parseNavLine() into the NavDataCache.
+PositionedID NavLoader::insertNavLine(const NavLine& navLine,
+                                      const string& utf8Path)
+{
+  NavDataCache* cache = NavDataCache::instance();
+  const unsigned int lineNum = navLine.lineNum;
+  const FGPositioned::Type type = navLine.type;
+  const string& ident = navLine.ident;
+  const string& name = navLine.name;
+  SGGeod pos = navLine.pos;
+  const int elev_ft = navLine.elev_ft;
+  const int freq = navLine.freq;
+  int range = navLine.range;
+  const double multiuse = navLine.multiuse;
+
   //
   // Deduplication rules:
   //
@@ -426,7 +466,14 @@ PositionedID NavLoader::processNavLine(
 void NavLoader::loadNav(const SGPath& path, std::size_t bytesReadSoFar,
                         std::size_t totalSizeOfAllDatFiles)
 {
-  NavDataCache* cache = NavDataCache::instance();
+  NavFile file;
+  readNav(path, file);
+  insertNav(file, bytesReadSoFar, totalSizeOfAllDatFiles);
+}
+
+// Parse all navaids of a nav.dat file, without touching the NavDataCache
+void NavLoader::readNav(const SGPath& path, NavFile& file)
+{
   const string utf8Path = path.utf8Str();
   sg_gzifstream in(path);
 
@@ -436,6 +483,10 @@ void NavLoader::loadNav(const SGPath& path, std::size_t bytesReadSoFar,
       sg_location(path));
   }
 
+  file.path = path;
+  file.sizeInBytes = path.sizeInBytes();
+  file.lines.clear();
+
   string line;
 
   // Skip the first two lines
@@ -457,21 +508,37 @@ void NavLoader::loadNav(const SGPath& path, std::size_t bytesReadSoFar,
     throw sg_format_exception(errMsg, strippedLine);
   }
 
+  NavLine navLine;
   for (lineNumber = 3; std::getline(in, line); lineNumber++) {
-    processNavLine(line, utf8Path, lineNumber, FGPositioned::INVALID, version);
-
-    if ((lineNumber % 100) == 0) {
-      // every 100 lines
-      unsigned int percent = ((bytesReadSoFar + in.approxOffset()) * 100)
-        / totalSizeOfAllDatFiles;
-      cache->setRebuildPhaseProgress(NavDataCache::REBUILD_NAVAIDS, percent);
+    if (parseNavLine(line, utf8Path, lineNumber, FGPositioned::INVALID,
+                     version, navLine)) {
+      file.lines.push_back(navLine);
     }
-
   } // of stream data loop
 
   throwExceptionIfStreamError(in, path);
 }
 
+// Add the navaids read by readNav() to the NavDataCache, in file order
+void NavLoader::insertNav(const NavFile& file, std::size_t bytesReadSoFar,
+                          std::size_t totalSizeOfAllDatFiles)
+{
+  NavDataCache* cache = NavDataCache::instance();
+  const string utf8Path = file.path.utf8Str();
+  const std::size_t nbLines = file.lines.size();
+
+  for (std::size_t i = 0; i < nbLines; i++) {
+    insertNavLine(file.lines[i], utf8Path);
+
+    if ((i % 100) == 0) {
+      // every 100 navaids
+      unsigned int percent = ((bytesReadSoFar + file.sizeInBytes * i / nbLines)
+                              * 100) / totalSizeOfAllDatFiles;
+      cache->setRebuildPhaseProgress(NavDataCache::REBUILD_NAVAIDS, percent);
+    }
+  }
+}
+
 void NavLoader::loadCarrierNav(const SGPath& path)
 {
   SG_LOG( SG_NAVAID, SG_DEBUG, "Opening file: " << path );
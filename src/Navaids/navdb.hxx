@@ -27,24 +27,52 @@
 
 #include <simgear/compiler.h>
 #include <simgear/math/SGGeod.hxx>
+#include <simgear/misc/sg_path.hxx>
 #include <string>
 #include <map>
 #include <tuple>
+#include <vector>
 #include <Navaids/positioned.hxx>
 
 // forward decls
 class FGTACANList;
-class SGPath;
 
 namespace flightgear
 {
 
 class NavLoader {
   public:
+    // A nav.dat line, parsed but not inserted into the cache yet
+    struct NavLine {
+      unsigned int lineNum;
+      FGPositioned::Type type;
+      SGGeod pos;
+      int elev_ft;
+      int freq;
+      int range;
+      double multiuse;
+      std::string ident;
+      std::string name;
+    };
+
+    struct NavFile {
+      SGPath path;
+      std::size_t sizeInBytes;
+      std::vector<NavLine> lines;
+    };
+
     // load and initialize the navigational databases
     void loadNav(const SGPath& path, std::size_t bytesReadSoFar,
                  std::size_t totalSizeOfAllDatFiles);
 
+    // The two halves of loadNav(). readNav() only parses the file and
+    // doesn't use the NavDataCache, so it can run on another thread while
+    // the cache is busy with other data. insertNav() then adds the
+    // navaids of the file to the cache.
+    static void readNav(const SGPath& path, NavFile& file);
+    void insertNav(const NavFile& file, std::size_t bytesReadSoFar,
+                   std::size_t totalSizeOfAllDatFiles);
+
     void loadCarrierNav(const SGPath& path);
 
     bool loadTacan(const SGPath& path, FGTACANList *channellist);
@@ -59,6 +87,13 @@ class NavLoader {
                                 unsigned int lineNum,
                                 FGPositioned::Type type = FGPositioned::INVALID,
                                 unsigned long version = 810);
+
+    static bool parseNavLine(const std::string& line,
+                             const std::string& utf8Path,
+                             unsigned int lineNum, FGPositioned::Type type,
+                             unsigned long version, NavLine& navLine);
+    PositionedID insertNavLine(const NavLine& navLine,
+                               const std::string& utf8Path);
 };
 
 } // of namespace flightgear
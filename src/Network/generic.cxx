@@ -27,6 +27,8 @@
 #include <string.h>                // strstr()
 #include <stdlib.h>                // strtod(), atoi()
 #include <cstdio>
+#include <cstddef>
+#include <algorithm>
 
 #include <simgear/debug/logstream.hxx>
 #include <simgear/io/iochannel.hxx>
@@ -255,131 +257,172 @@ FGGeneric::~FGGeneric() {
   delete wrapper;
 }
 
-union u32 {
-    uint32_t intVal;
-    float floatVal;
-};
+// Store an integer of N bytes at p in the byte order of the protocol, if it
+// fits before end. Returns the number of bytes stored or -1.
+template<bool Swap>
+static inline int put32(uint32_t val, char *p, const char *end)
+{
+    if (end - p < (int)sizeof(val)) {
+        return -1;
+    }
+    if (Swap) {
+        val = sg_bswap_32(val);
+    }
+    memcpy(p, &val, sizeof(val));
+    return sizeof(val);
+}
 
-union u64 {
-    uint64_t longVal;
-    double doubleVal;
-};
+template<bool Swap>
+static inline int put64(uint64_t val, char *p, const char *end)
+{
+    if (end - p < (int)sizeof(val)) {
+        return -1;
+    }
+    if (Swap) {
+        val = sg_bswap_64(val);
+    }
+    memcpy(p, &val, sizeof(val));
+    return sizeof(val);
+}
 
-// generate the message
-bool FGGeneric::gen_message_binary() {
-    string generic_sentence;
-    length = 0;
+// Load an integer from p, which need not be aligned.
+template<bool Swap>
+static inline uint32_t get32(const char *p)
+{
+    uint32_t val;
+    memcpy(&val, p, sizeof(val));
+    return Swap ? sg_bswap_32(val) : val;
+}
 
-    double val;
-    for (unsigned int i = 0; i < _out_message.size(); i++) {
+template<bool Swap>
+static inline uint64_t get64(const char *p)
+{
+    uint64_t val;
+    memcpy(&val, p, sizeof(val));
+    return Swap ? sg_bswap_64(val) : val;
+}
 
-        switch (_out_message[i].type) {
-        case FG_INT:
-        {
-            val = _out_message[i].offset +
-                  _out_message[i].prop->getFloatValue() * _out_message[i].factor;
-            int32_t intVal = val;
-            if (binary_byte_order != BYTE_ORDER_MATCHES_NETWORK_ORDER) {
-                intVal = (int32_t) sg_bswap_32((uint32_t)intVal);
-            }
-            memcpy(&buf[length], &intVal, sizeof(int32_t));
-            length += sizeof(int32_t);
-            break;
-        }
+// Encode one chunk of a binary message at p. Returns the number of bytes
+// written, or -1 if they don't fit before end.
+template<bool Swap>
+int FGGeneric::encode_chunk(const _serial_prot& chunk, char *p, const char *end)
+{
+    double val;
 
-        case FG_BOOL:
-            buf[length] = (char) (_out_message[i].prop->getBoolValue() ? true : false);
-            length += 1;
-            break;
+    switch (chunk.type) {
+    case FG_INT:
+        val = chunk.offset + chunk.prop->getFloatValue() * chunk.factor;
+        return put32<Swap>((uint32_t)(int32_t)val, p, end);
 
-        case FG_FIXED:
-        {
-            val = _out_message[i].offset +
-                 _out_message[i].prop->getFloatValue() * _out_message[i].factor;
-
-            int32_t fixed = (int)(val * 65536.0f);
-            if (binary_byte_order != BYTE_ORDER_MATCHES_NETWORK_ORDER) {
-                fixed = (int32_t) sg_bswap_32((uint32_t)fixed);
-            } 
-            memcpy(&buf[length], &fixed, sizeof(int32_t));
-            length += sizeof(int32_t);
-            break;
+    case FG_BOOL:
+        if (end - p < 1) {
+            return -1;
         }
+        *p = (char) (chunk.prop->getBoolValue() ? true : false);
+        return 1;
 
-        case FG_FLOAT:
-        {
-            val = _out_message[i].offset +
-                 _out_message[i].prop->getFloatValue() * _out_message[i].factor;
-            u32 tmpun32;
-            tmpun32.floatVal = static_cast<float>(val);
+    case FG_FIXED:
+        val = chunk.offset + chunk.prop->getFloatValue() * chunk.factor;
+        return put32<Swap>((uint32_t)(int32_t)(int)(val * 65536.0f), p, end);
 
-            if (binary_byte_order != BYTE_ORDER_MATCHES_NETWORK_ORDER) {
-                tmpun32.intVal = sg_bswap_32(tmpun32.intVal);
-            }
-            memcpy(&buf[length], &tmpun32.intVal, sizeof(uint32_t));
-            length += sizeof(uint32_t);
-            break;
-        }
+    case FG_FLOAT:
+    {
+        val = chunk.offset + chunk.prop->getFloatValue() * chunk.factor;
+        float floatVal = static_cast<float>(val);
+        uint32_t intVal;
+        memcpy(&intVal, &floatVal, sizeof(intVal));
+        return put32<Swap>(intVal, p, end);
+    }
 
-        case FG_DOUBLE:
-        {
-            val = _out_message[i].offset +
-                 _out_message[i].prop->getDoubleValue() * _out_message[i].factor;
-            u64 tmpun64;
-            tmpun64.doubleVal = val;
+    case FG_DOUBLE:
+    {
+        val = chunk.offset + chunk.prop->getDoubleValue() * chunk.factor;
+        uint64_t longVal;
+        memcpy(&longVal, &val, sizeof(longVal));
+        return put64<Swap>(longVal, p, end);
+    }
 
-            if (binary_byte_order != BYTE_ORDER_MATCHES_NETWORK_ORDER) {
-                tmpun64.longVal = sg_bswap_64(tmpun64.longVal);
-            }
-            memcpy(&buf[length], &tmpun64.longVal, sizeof(uint64_t));
-            length += sizeof(uint64_t);
-            break;
+    // bytes and words are written in host byte order
+    case FG_BYTE:
+    {
+        if (end - p < (int)sizeof(int8_t)) {
+            return -1;
         }
+        val = chunk.offset + chunk.prop->getFloatValue() * chunk.factor;
+        int8_t byteVal = val;
+        memcpy(p, &byteVal, sizeof(int8_t));
+        return sizeof(int8_t);
+    }
 
-        case FG_BYTE:
-        {
-            val = _out_message[i].offset +
-                  _out_message[i].prop->getFloatValue() * _out_message[i].factor;
-            int8_t byteVal = val;
-            memcpy(&buf[length], &byteVal, sizeof(int8_t));
-            length += sizeof(int8_t);
-            break;
+    case FG_WORD:
+    {
+        if (end - p < (int)sizeof(int16_t)) {
+            return -1;
         }
+        val = chunk.offset + chunk.prop->getFloatValue() * chunk.factor;
+        int16_t wordVal = val;
+        memcpy(p, &wordVal, sizeof(int16_t));
+        return sizeof(int16_t);
+    }
 
-        case FG_WORD:
-        {
-            val = _out_message[i].offset +
-                  _out_message[i].prop->getFloatValue() * _out_message[i].factor;
-            int16_t wordVal = val;
-            memcpy(&buf[length], &wordVal, sizeof(int16_t));
-            length += sizeof(int16_t);
-            break;
+    default: // SG_STRING
+    {
+        /* Format for strings is
+         * [length as int, 4 bytes][ASCII data, length bytes]
+         */
+        const char *strdata = chunk.prop->getStringValue();
+        int32_t strlength = strlen(strdata);
+        if (end - p < (int)sizeof(int32_t) + strlength) {
+            return -1;
         }
+        put32<Swap>((uint32_t)strlength, p, end);
+        memcpy(p + sizeof(int32_t), strdata, strlength);
+        /* FIXME padding for alignment? Something like:
+         * length += (strlength % 4 > 0 ? sizeof(int32_t) - strlength % 4 : 0;
+         */
+        return sizeof(int32_t) + strlength;
+    }
+    }
+}
 
-        default: // SG_STRING
-            const char *strdata = _out_message[i].prop->getStringValue();
-            int32_t strlength = strlen(strdata);
+// Encode the output chunks into buf, returns the length or -1 if the
+// message doesn't fit. Room is left for the footer.
+template<bool Swap>
+int FGGeneric::encode_binary()
+{
+    char *p = buf;
+    const char *end = buf + FG_MAX_MSG_SIZE - sizeof(int32_t);
 
-            if (binary_byte_order == BYTE_ORDER_NEEDS_CONVERSION) {
-                SG_LOG( SG_IO, SG_ALERT, "Generic protocol: "
-                        "FG_STRING will be written in host byte order.");
+    for (unsigned int i = 0; i < _out_message.size(); i++) {
+        const _serial_prot& chunk = _out_message[i];
+        int n;
+        if (chunk.is_const) {
+            n = chunk.const_data.size();
+            if (end - p < n) {
+                return -1;
             }
-            /* Format for strings is 
-             * [length as int, 4 bytes][ASCII data, length bytes]
-             */
-            if (binary_byte_order != BYTE_ORDER_MATCHES_NETWORK_ORDER) {
-                strlength = sg_bswap_32(strlength);
+            memcpy(p, chunk.const_data.data(), n);
+        } else {
+            n = encode_chunk<Swap>(chunk, p, end);
+            if (n < 0) {
+                return -1;
             }
-            memcpy(&buf[length], &strlength, sizeof(int32_t));
-            length += sizeof(int32_t);
-            strncpy(&buf[length], strdata, strlength);
-            length += strlength; 
-            /* FIXME padding for alignment? Something like: 
-             * length += (strlength % 4 > 0 ? sizeof(int32_t) - strlength % 4 : 0;
-             */
-            break;
-
         }
+        p += n;
+    }
+
+    return p - buf;
+}
+
+// generate the message
+bool FGGeneric::gen_message_binary() {
+    bool swap = binary_byte_order != BYTE_ORDER_MATCHES_NETWORK_ORDER;
+    length = swap ? encode_binary<true>() : encode_binary<false>();
+    if (length < 0) {
+        SG_LOG( SG_IO, SG_ALERT, "Generic protocol: "
+                "message longer than " << FG_MAX_MSG_SIZE << " bytes.");
+        length = 0;
+        return false;
     }
 
     // add the footer to the packet ("line")
@@ -394,12 +437,9 @@ bool FGGeneric::gen_message_binary() {
     }
 
     if (binary_footer_type != FOOTER_NONE) {
-        int32_t intValue = binary_footer_value;
-        if (binary_byte_order != BYTE_ORDER_MATCHES_NETWORK_ORDER) {
-            intValue = sg_bswap_32(binary_footer_value);
-        }
-        memcpy(&buf[length], &intValue, sizeof(int32_t));
-        length += sizeof(int32_t);
+        length += swap ?
+            put32<true>(binary_footer_value, &buf[length], buf + FG_MAX_MSG_SIZE) :
+            put32<false>(binary_footer_value, &buf[length], buf + FG_MAX_MSG_SIZE);
     }
 
     if( wrapper ) length = wrapper->wrap( length, reinterpret_cast<uint8_t*>(buf) );
@@ -407,69 +447,89 @@ bool FGGeneric::gen_message_binary() {
     return true;
 }
 
-bool FGGeneric::gen_message_ascii() {
-    string generic_sentence;
-    char tmp[255];
-    length = 0;
-
+// Format one chunk of an ASCII message into p, returns what snprintf() does.
+int FGGeneric::format_chunk(const _serial_prot& chunk, char *p, int size)
+{
     double val;
-    for (unsigned int i = 0; i < _out_message.size(); i++) {
 
-        if (i > 0) {
-            generic_sentence += var_separator;
-        }
-        
-        string format = simgear::strutils::sanitizePrintfFormat(_out_message[i].format);
+    switch (chunk.type) {
+    case FG_BYTE:
+    case FG_WORD:
+    case FG_INT:
+        val = chunk.offset + chunk.prop->getFloatValue() * chunk.factor;
+        return snprintf(p, size, chunk.format.c_str(), (int)val);
 
-        switch (_out_message[i].type) {
-        case FG_BYTE:
-        case FG_WORD:
-        case FG_INT:
-            val = _out_message[i].offset +
-                  _out_message[i].prop->getFloatValue() * _out_message[i].factor;
-            snprintf(tmp, 255, format.c_str(), (int)val);
-            break;
+    case FG_BOOL:
+        return snprintf(p, size, chunk.format.c_str(), chunk.prop->getBoolValue());
 
-        case FG_BOOL:
-            snprintf(tmp, 255, format.c_str(),
-                               _out_message[i].prop->getBoolValue());
-            break;
+    case FG_FIXED:
+    case FG_FLOAT:
+        val = chunk.offset + chunk.prop->getFloatValue() * chunk.factor;
+        return snprintf(p, size, chunk.format.c_str(), (float)val);
 
-        case FG_FIXED:
-            val = _out_message[i].offset +
-                _out_message[i].prop->getFloatValue() * _out_message[i].factor;
-            snprintf(tmp, 255, format.c_str(), (float)val);
-            break;
+    case FG_DOUBLE:
+        val = chunk.offset + chunk.prop->getDoubleValue() * chunk.factor;
+        return snprintf(p, size, chunk.format.c_str(), (double)val);
 
-        case FG_FLOAT:
-            val = _out_message[i].offset +
-                _out_message[i].prop->getFloatValue() * _out_message[i].factor;
-            snprintf(tmp, 255, format.c_str(), (float)val);
-            break;
+    default: // SG_STRING
+        return snprintf(p, size, chunk.format.c_str(), chunk.prop->getStringValue());
+    }
+}
 
-        case FG_DOUBLE:
-            val = _out_message[i].offset +
-                _out_message[i].prop->getDoubleValue() * _out_message[i].factor;
-            snprintf(tmp, 255, format.c_str(), (double)val);
-            break;
+// Generate the message straight into buf. The formats were sanitized and
+// the constant chunks formatted when the protocol was read.
+bool FGGeneric::gen_message_ascii() {
+    char *p = buf;
+    char *end = buf + FG_MAX_MSG_SIZE;
+    length = 0;
 
-        default: // SG_STRING
-            snprintf(tmp, 255, format.c_str(),
-                                   _out_message[i].prop->getStringValue());
+    for (unsigned int i = 0; i < _out_message.size(); i++) {
+        const _serial_prot& chunk = _out_message[i];
+
+        if (i > 0) {
+            if (end - p < (int)var_separator.size()) {
+                goto overflow;
+            }
+            memcpy(p, var_separator.data(), var_separator.size());
+            p += var_separator.size();
         }
 
-        generic_sentence += tmp;
+        if (chunk.is_const) {
+            if (end - p < (int)chunk.const_data.size()) {
+                goto overflow;
+            }
+            memcpy(p, chunk.const_data.data(), chunk.const_data.size());
+            p += chunk.const_data.size();
+        } else {
+            // no field gets longer than 254 characters
+            int size = std::min(end - p, (std::ptrdiff_t)255);
+            int n = std::max(format_chunk(chunk, p, size), 0);
+            if (n >= size) {
+                if (size < 255) {
+                    goto overflow;
+                }
+                n = size - 1;
+            }
+            p += n;
+        }
     }
 
     /* After each lot of variables has been added, put the line separator
      * char/string
      */
-    generic_sentence += line_separator;
-
-    length =  generic_sentence.length();
-    strncpy( buf, generic_sentence.c_str(), length );
+    if (end - p < (int)line_separator.size()) {
+        goto overflow;
+    }
+    memcpy(p, line_separator.data(), line_separator.size());
+    p += line_separator.size();
 
+    length = p - buf;
     return true;
+
+overflow:
+    SG_LOG( SG_IO, SG_ALERT, "Generic protocol: "
+            "message longer than " << FG_MAX_MSG_SIZE << " bytes.");
+    return false;
 }
 
 bool FGGeneric::gen_message() {
@@ -480,76 +540,66 @@ bool FGGeneric::gen_message() {
     }
 }
 
-bool FGGeneric::parse_message_binary(int length) {
-    char *p2, *p1 = buf;
+template<bool Swap>
+void FGGeneric::decode_binary(int length) {
+    const char *p1 = buf;
+    const char *p2 = p1 + length;
     int32_t tmp32;
-    int i = -1;
+    uint16_t tmp16;
 
-    p2 = p1 + length;
-    while ((++i < (int)_in_message.size()) && (p1  < p2)) {
+    for (unsigned int i = 0; i < _in_message.size() && p1 < p2; i++) {
+        _serial_prot& chunk = _in_message[i];
 
-        switch (_in_message[i].type) {
+        // the chunk sizes were checked against the record length before
+        if (p2 - p1 < chunk.size) {
+            break;
+        }
+
+        switch (chunk.type) {
         case FG_INT:
-            if (binary_byte_order == BYTE_ORDER_NEEDS_CONVERSION) {
-                tmp32 = sg_bswap_32(*(int32_t *)p1);
-            } else {
-                tmp32 = *(int32_t *)p1;
-            }
-            updateValue(_in_message[i], (int)tmp32);
-            p1 += sizeof(int32_t);
+            updateValue(chunk, (int)(int32_t)get32<Swap>(p1));
             break;
 
         case FG_BOOL:
-            updateValue(_in_message[i], p1[0] != 0);
-            p1 += 1;
+            updateValue(chunk, p1[0] != 0);
             break;
 
         case FG_FIXED:
-            if (binary_byte_order == BYTE_ORDER_NEEDS_CONVERSION) {
-                tmp32 = sg_bswap_32(*(int32_t *)p1);
-            } else {
-                tmp32 = *(int32_t *)p1;
-            }
-            updateValue(_in_message[i], (float)tmp32 / 65536.0f);
-            p1 += sizeof(int32_t);
+            tmp32 = get32<Swap>(p1);
+            updateValue(chunk, (float)tmp32 / 65536.0f);
             break;
 
         case FG_FLOAT:
-            u32 tmpun32;
-            if (binary_byte_order == BYTE_ORDER_NEEDS_CONVERSION) {
-                tmpun32.intVal = sg_bswap_32(*(uint32_t *)p1);
-            } else {
-                tmpun32.floatVal = *(float *)p1;
-            }
-            updateValue(_in_message[i], tmpun32.floatVal);
-            p1 += sizeof(int32_t);
+        {
+            uint32_t intVal = get32<Swap>(p1);
+            float floatVal;
+            memcpy(&floatVal, &intVal, sizeof(floatVal));
+            updateValue(chunk, floatVal);
             break;
+        }
 
         case FG_DOUBLE:
-            u64 tmpun64;
-            if (binary_byte_order == BYTE_ORDER_NEEDS_CONVERSION) {
-                tmpun64.longVal = sg_bswap_64(*(uint64_t *)p1);
-            } else {
-                tmpun64.doubleVal = *(double *)p1;
-            }
-            updateValue(_in_message[i], tmpun64.doubleVal);
-            p1 += sizeof(int64_t);
+        {
+            uint64_t longVal = get64<Swap>(p1);
+            double doubleVal;
+            memcpy(&doubleVal, &longVal, sizeof(doubleVal));
+            updateValue(chunk, doubleVal);
             break;
+        }
 
         case FG_BYTE:
-            tmp32 = *(int8_t *)p1;
-            updateValue(_in_message[i], (int)tmp32);
-            p1 += sizeof(int8_t);
+            tmp32 = *(const int8_t *)p1;
+            updateValue(chunk, (int)tmp32);
             break;
 
         case FG_WORD:
-            if (binary_byte_order == BYTE_ORDER_NEEDS_CONVERSION) {
-                tmp32 = sg_bswap_16(*(int16_t *)p1);
+            memcpy(&tmp16, p1, sizeof(tmp16));
+            if (Swap) {
+                tmp32 = sg_bswap_16(tmp16);
             } else {
-                tmp32 = *(int16_t *)p1;
+                tmp32 = (int16_t)tmp16;
             }
-            updateValue(_in_message[i], (int)tmp32);
-            p1 += sizeof(int16_t);
+            updateValue(chunk, (int)tmp32);
             break;
 
         default: // SG_STRING
@@ -557,8 +607,17 @@ bool FGGeneric::parse_message_binary(int length) {
                     "Ignoring unsupported binary input chunk type.");
             break;
         }
+
+        p1 += chunk.size;
+    }
+}
+
+bool FGGeneric::parse_message_binary(int length) {
+    if (binary_byte_order == BYTE_ORDER_NEEDS_CONVERSION) {
+        decode_binary<true>(length);
+    } else {
+        decode_binary<false>(length);
     }
-    
     return true;
 }
 
@@ -916,7 +975,8 @@ FGGeneric::read_config(SGPropertyNode *root, vector<_serial_prot> &msg)
         _serial_prot chunk;
 
         // chunk.name = chunks[i]->getStringValue("name");
-        chunk.format = unescape(chunks[i]->getStringValue("format", "%d"));
+        chunk.format = simgear::strutils::sanitizePrintfFormat(
+            unescape(chunks[i]->getStringValue("format", "%d")));
         chunk.offset = chunks[i]->getDoubleValue("offset");
         chunk.factor = chunks[i]->getDoubleValue("factor", 1.0);
         chunk.min = chunks[i]->getDoubleValue("min");
@@ -924,7 +984,8 @@ FGGeneric::read_config(SGPropertyNode *root, vector<_serial_prot> &msg)
         chunk.wrap = chunks[i]->getBoolValue("wrap");
         chunk.rel = chunks[i]->getBoolValue("relative");
 
-        if( chunks[i]->hasChild("const") ) {
+        chunk.is_const = chunks[i]->hasChild("const");
+        if( chunk.is_const ) {
             chunk.prop = new SGPropertyNode();
             chunk.prop->setStringValue( chunks[i]->getStringValue("const", "" ) );
         } else {
@@ -938,28 +999,45 @@ FGGeneric::read_config(SGPropertyNode *root, vector<_serial_prot> &msg)
         //       compatibility 'boolean' will also be supported.
         if (type == "bool" || type == "boolean") {
             chunk.type = FG_BOOL;
-            record_length += 1;
+            chunk.size = 1;
         } else if (type == "float") {
             chunk.type = FG_FLOAT;
-            record_length += sizeof(int32_t);
+            chunk.size = sizeof(int32_t);
         } else if (type == "double") {
             chunk.type = FG_DOUBLE;
-            record_length += sizeof(int64_t);
+            chunk.size = sizeof(int64_t);
         } else if (type == "fixed") {
             chunk.type = FG_FIXED;
-            record_length += sizeof(int32_t);
+            chunk.size = sizeof(int32_t);
         } else if (type == "string") {
             chunk.type = FG_STRING;
+            chunk.size = 0;
         } else if (type == "byte") {
             chunk.type = FG_BYTE;
-            record_length += sizeof(int8_t);
+            chunk.size = sizeof(int8_t);
         } else if (type == "word") {
             chunk.type = FG_WORD;
-            record_length += sizeof(int16_t);
+            chunk.size = sizeof(int16_t);
         } else {
             chunk.type = FG_INT;
-            record_length += sizeof(int32_t);
+            chunk.size = sizeof(int32_t);
+        }
+        record_length += chunk.size;
+
+        // constants are encoded once, for output
+        if (chunk.is_const) {
+            char tmp[ FG_MAX_MSG_SIZE ];
+            int n;
+            if (!binary_mode) {
+                n = std::min(std::max(format_chunk(chunk, tmp, 255), 0), 254);
+            } else if (binary_byte_order == BYTE_ORDER_NEEDS_CONVERSION) {
+                n = encode_chunk<true>(chunk, tmp, tmp + sizeof(tmp));
+            } else {
+                n = encode_chunk<false>(chunk, tmp, tmp + sizeof(tmp));
+            }
+            chunk.const_data.assign(tmp, std::max(n, 0));
         }
+
         msg.push_back(chunk);
 
     }
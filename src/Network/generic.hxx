@@ -63,14 +63,17 @@ protected:
 
     typedef struct {
      // string name;
-        string format;
+        string format;          // sanitized
         e_type type;
+        int size;               // binary size, 0 for strings
         double offset;
         double factor;
         double min, max;
         bool wrap;
         bool rel;
         SGPropertyNode_ptr prop;
+        bool is_const;
+        string const_data;      // output of a constant chunk
     } _serial_prot;
 
 private:
@@ -100,6 +103,17 @@ private:
     bool gen_message_binary();
     bool parse_message_ascii(int length);
     bool parse_message_binary(int length);
+
+    // The message is encoded and decoded in buf directly, chunk by chunk,
+    // with the byte order known at compile time.
+    template<bool Swap>
+    static int encode_chunk(const _serial_prot& chunk, char *p, const char *end);
+    template<bool Swap>
+    int encode_binary();
+    template<bool Swap>
+    void decode_binary(int length);
+    static int format_chunk(const _serial_prot& chunk, char *p, int size);
+
     bool read_config(SGPropertyNode *root, vector<_serial_prot> &msg);
     bool exitOnError;
     bool initOk;
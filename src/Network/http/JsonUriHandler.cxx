@@ -28,6 +28,39 @@ using std::string;
 namespace flightgear {
 namespace http {
 
+static const char * SNAPSHOT_KEY = "json-snapshot";
+
+/**
+ * The requested node as prepareRequest() found it on the main loop
+ */
+class JsonSnapshot : public ConnectionData {
+public:
+  bool found;
+  double timestamp;
+  JSON::Snapshot snapshot;
+};
+
+bool JsonUriHandler::isThreadSafe( const HTTPRequest & request ) const
+{
+  return request.Method == "GET" || request.Method == "OPTIONS";
+}
+
+void JsonUriHandler::prepareRequest( const HTTPRequest & request, Connection * connection )
+{
+  if( request.Method != "GET" ) return;
+
+  // max recursion depth
+  int  depth = atoi(request.RequestVariables.get("d").c_str());
+  if( depth < 1 ) depth = 1; // at least one level 
+
+  SGSharedPtr<JsonSnapshot> s = new JsonSnapshot;
+  SGPropertyNode_ptr node = getRequestedNode(request );
+  s->found = node.valid();
+  s->timestamp = request.RequestVariables.get("t") == "y" ? fgGetDouble("/sim/time/elapsed-sec") : -1.0;
+  if( s->found ) JSON::takeSnapshot( node, depth, s->snapshot );
+  connection->put( SNAPSHOT_KEY, s );
+}
+
 bool JsonUriHandler::handleRequest( const HTTPRequest & request, HTTPResponse & response, Connection * connection )
 {
   response.Header["Content-Type"] = "application/json; charset=UTF-8";
@@ -49,6 +82,23 @@ bool JsonUriHandler::handleRequest( const HTTPRequest & request, HTTPResponse &
     bool indent = request.RequestVariables.get("i") == "y";
     bool timestamp = request.RequestVariables.get("t") == "y";
 
+    // on the httpd thread, format what prepareRequest() copied
+    SGSharedPtr<JsonSnapshot> s;
+    if( connection ) {
+      s = dynamic_cast<JsonSnapshot*>(connection->get( SNAPSHOT_KEY ).get());
+      connection->remove( SNAPSHOT_KEY );
+    }
+    if( s.valid() ) {
+      if( false == s->found ) {
+        response.StatusCode = 404;
+        response.Content = "{}";
+        return true;
+      }
+      response.Content.clear();
+      JSON::writeJson( response.Content, indent, s->snapshot, s->timestamp );
+      return true;
+    }
+
     SGPropertyNode_ptr node = getRequestedNode(request );
     if( false == node.valid() ) {
       response.StatusCode = 404;
@@ -56,7 +106,8 @@ bool JsonUriHandler::handleRequest( const HTTPRequest & request, HTTPResponse &
       return true;
     } 
 
-    response.Content = JSON::toJsonString( indent, node, depth, timestamp ? fgGetDouble("/sim/time/elapsed-sec") : -1.0 );
+    response.Content.clear();
+    JSON::writeJson( response.Content, indent, node, depth, timestamp ? fgGetDouble("/sim/time/elapsed-sec") : -1.0 );
 
     return true;
   }
@@ -31,6 +31,8 @@ class JsonUriHandler : public URIHandler {
 public:
   JsonUriHandler( const char * uri = "/json/" ) : URIHandler( uri  ) {}
   virtual bool handleRequest( const HTTPRequest & request, HTTPResponse & response, Connection * connection );
+  virtual bool isThreadSafe( const HTTPRequest & request ) const;
+  virtual void prepareRequest( const HTTPRequest & request, Connection * connection );
 private:
   SGPropertyNode_ptr getRequestedNode(const HTTPRequest & request);
 };
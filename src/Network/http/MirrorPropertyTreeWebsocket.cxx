@@ -22,12 +22,16 @@
 #include "jsonprops.hxx"
 
 #include <algorithm>
+#include <cstring>
 #include <unordered_map>
 #include <set>
 
+#include <zlib.h>
+
 #include <simgear/debug/logstream.hxx>
 #include <simgear/props/props.hxx>
 #include <simgear/structure/commands.hxx>
+#include <simgear/misc/strutils.hxx>
 
 #include <simgear/props/props_io.hxx>
 #include <Main/globals.hxx>
@@ -42,6 +46,143 @@ using std::string;
 
     typedef unsigned int PropertyId; // connection local property id
 
+    // Binary frame format, used if the client asks for one of the binary
+    // subprotocols. All integers are unsigned LEB128 varints unless noted,
+    // signed ones are zigzag encoded first.
+    //
+    // frame:    u8 flags, bit 0 set if the payload is deflated. A deflated
+    //           frame continues with the varint size of the payload and the
+    //           zlib (compress()) stream, else with the payload itself.
+    // payload:  created count, created nodes,
+    //           removed count, removed ids,
+    //           changed count, changed nodes
+    // created:  id, index, position, varint path length, path, value
+    // removed:  ids in ascending order, each as the difference to the
+    //           previous one (the first to 0)
+    // changed:  ids in ascending order as for removed, each followed by
+    //           the value
+    // value:    u8 type code in the low nibble; then for
+    //           0 none:        nothing
+    //           1 bool:        u8 0 or 1
+    //           2 int, 3 long: zigzag varint of value - base
+    //           4 float,
+    //           5 double:      the bits XOR the base bits, as the k lowest
+    //                          bytes, k in the high nibble of the type byte
+    //           6 string,
+    //           7 unspecified: varint length and the bytes
+    //           any other type is sent as a string.
+    //
+    // The base is the value last sent for the id if it had the same type
+    // code, else 0. Values of created nodes are sent with base 0, so a
+    // client can drop its state for removed ids.
+
+    const uint8_t BINARY_FLAG_DEFLATE = 1;
+
+    // Don't bother compressing smaller payloads
+    const size_t BINARY_DEFLATE_MIN_SIZE = 256;
+
+    struct SentValue
+    {
+        uint8_t code = 0;
+        uint64_t bits = 0;
+    };
+
+    static void putVarint(std::string& out, uint64_t v)
+    {
+        while (v >= 0x80) {
+            out.push_back(static_cast<char>(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<char>(v));
+    }
+
+    // zigzag encoding of the difference, wraps around like the client does
+    static void putDelta(std::string& out, uint64_t v, uint64_t base)
+    {
+        uint64_t d = v - base;
+        putVarint(out, (d << 1) ^ (0 - (d >> 63)));
+    }
+
+    static void putBits(std::string& out, uint8_t code, uint64_t x)
+    {
+        uint8_t k = 0;
+        for (uint64_t t = x; t != 0; t >>= 8) {
+            ++k;
+        }
+        out.push_back(static_cast<char>(code | (k << 4)));
+        for (; k > 0; --k, x >>= 8) {
+            out.push_back(static_cast<char>(x & 0xff));
+        }
+    }
+
+    static void putString(std::string& out, uint8_t code, const char* str)
+    {
+        size_t len = strlen(str);
+        out.push_back(static_cast<char>(code));
+        putVarint(out, len);
+        out.append(str, len);
+    }
+
+    static void putValue(std::string& out, SGPropertyNode* prop, SentValue& sent)
+    {
+        uint8_t code;
+        switch (prop->getType()) {
+        case simgear::props::NONE:        code = 0; break;
+        case simgear::props::BOOL:        code = 1; break;
+        case simgear::props::INT:         code = 2; break;
+        case simgear::props::LONG:        code = 3; break;
+        case simgear::props::FLOAT:       code = 4; break;
+        case simgear::props::DOUBLE:      code = 5; break;
+        case simgear::props::UNSPECIFIED: code = 7; break;
+        default:                          code = 6; break;
+        }
+
+        uint64_t base = (sent.code == code) ? sent.bits : 0;
+        uint64_t bits = 0;
+        switch (code) {
+        case 0:
+            out.push_back(0);
+            break;
+
+        case 1:
+            bits = prop->getBoolValue() ? 1 : 0;
+            out.push_back(1);
+            out.push_back(static_cast<char>(bits));
+            break;
+
+        case 2:
+        case 3:
+            bits = static_cast<uint64_t>(code == 2 ? prop->getIntValue()
+                                                   : prop->getLongValue());
+            out.push_back(static_cast<char>(code));
+            putDelta(out, bits, base);
+            break;
+
+        case 4: {
+            float f = prop->getFloatValue();
+            uint32_t b;
+            memcpy(&b, &f, sizeof(b));
+            bits = b;
+            putBits(out, code, bits ^ base);
+            break;
+        }
+
+        case 5: {
+            double d = prop->getDoubleValue();
+            memcpy(&bits, &d, sizeof(bits));
+            putBits(out, code, bits ^ base);
+            break;
+        }
+
+        default:
+            putString(out, code, prop->getStringValue());
+            break;
+        }
+
+        sent.code = code;
+        sent.bits = bits;
+    }
+
     struct PropertyValue
     {
         PropertyValue(SGPropertyNode* cur = nullptr) :
@@ -140,7 +281,7 @@ using std::string;
     public:
         MirrorTreeListener() : SGPropertyChangeListener(true /* recursive */)
         {
-            previousValues.resize(2);
+            previousValues.resize(1); // ids start at 1
         }
 
         virtual ~MirrorTreeListener()
@@ -190,13 +331,14 @@ using std::string;
 
             auto it = idHash.find(child);
             if (it != idHash.end()) {
-                removedNodes.insert(it->second);
+                PropertyId id = it->second;
+                removedNodes.insert(id);
                 idHash.erase(it);
 
                 // record so we can map removed+add of the same property into
                 // a simple value change (this happens commonly with the canvas
                 // due to lazy Nasal scripting)
-                recentlyRemoved.push_back(RecentlyRemovedNode(child, it->second));
+                recentlyRemoved.push_back(RecentlyRemovedNode(child, id));
             }
         }
 
@@ -287,6 +429,83 @@ using std::string;
             return result;
         }
 
+        void makeBinaryData(std::string& out, bool deflate)
+        {
+            SGTimeStamp st;
+            st.stamp();
+
+            int newSize = newNodes.size();
+            int changedSize = changedNodes.size();
+            int removedSize = removedNodes.size();
+
+            payload.clear();
+
+            putVarint(payload, newNodes.size());
+            for (auto prop : newNodes) {
+                changedNodes.erase(prop); // avoid duplicate send
+                PropertyId id = idForProperty(prop);
+                std::string path = prop->getPath(true);
+                putVarint(payload, id);
+                putVarint(payload, prop->getIndex());
+                putVarint(payload, prop->getPosition());
+                putVarint(payload, path.size());
+                payload.append(path);
+                SentValue& sent = sentValue(id);
+                sent = SentValue();
+                putValue(payload, prop, sent);
+            }
+            newNodes.clear();
+
+            PropertyId lastId = 0;
+            putVarint(payload, removedNodes.size());
+            for (auto propId : removedNodes) {
+                putVarint(payload, propId - lastId);
+                lastId = propId;
+            }
+            removedNodes.clear();
+
+            changed.clear();
+            for (auto prop : changedNodes) {
+                changed.push_back(std::make_pair(idForProperty(prop), prop));
+            }
+            changedNodes.clear();
+            std::sort(changed.begin(), changed.end());
+
+            lastId = 0;
+            putVarint(payload, changed.size());
+            for (auto& c : changed) {
+                putVarint(payload, c.first - lastId);
+                lastId = c.first;
+                putValue(payload, c.second, sentValue(c.first));
+            }
+
+            out.clear();
+            if (deflate && payload.size() >= BINARY_DEFLATE_MIN_SIZE) {
+                out.push_back(static_cast<char>(BINARY_FLAG_DEFLATE));
+                putVarint(out, payload.size());
+                size_t header = out.size();
+                uLongf len = compressBound(payload.size());
+                out.resize(header + len);
+                int result = compress2(reinterpret_cast<Bytef*>(&out[header]), &len,
+                                       reinterpret_cast<const Bytef*>(payload.data()),
+                                       payload.size(), Z_BEST_SPEED);
+                if ((result == Z_OK) && (header + len < payload.size())) {
+                    out.resize(header + len);
+                } else {
+                    out.clear();
+                }
+            }
+
+            if (out.empty()) {
+                out.push_back(0);
+                out.append(payload);
+            }
+
+            SG_LOG(SG_NETWORK, SG_DEBUG, "making binary data took:" << st.elapsedMSec() << " for " << newSize << "/" << changedSize << "/" << removedSize
+                   << ", " << payload.size() << " -> " << out.size() << " bytes");
+            recentlyRemoved.clear();
+        }
+
         bool haveChangesToSend() const
         {
             return !newNodes.empty() || !changedNodes.empty() || !removedNodes.empty();
@@ -300,6 +519,19 @@ using std::string;
         /// after with the same type, since we can make this much more efficient
         /// when sending over the wire.
         std::vector<RecentlyRemovedNode> recentlyRemoved;
+
+        SentValue& sentValue(PropertyId id)
+        {
+            if (id >= sentValues.size()) {
+                sentValues.resize(nextPropertyId);
+            }
+            return sentValues[id];
+        }
+
+        /// state of the binary format, the values last sent by id
+        std::vector<SentValue> sentValues;
+        std::string payload;
+        std::vector<std::pair<PropertyId, SGPropertyNode*> > changed;
     };
 
 #if 0
@@ -357,10 +589,42 @@ static void handleExecCommand(cJSON* json)
 }
 #endif
 
-MirrorPropertyTreeWebsocket::MirrorPropertyTreeWebsocket(const std::string& path) :
+const char* MirrorPropertyTreeWebsocket::BinaryProtocol = "flightgear-mirror-binary";
+const char* MirrorPropertyTreeWebsocket::BinaryDeflateProtocol = "flightgear-mirror-binary-deflate";
+
+const char* MirrorPropertyTreeWebsocket::selectProtocol(const std::string& offered)
+{
+    string::size_type pos = 0;
+    while (pos < offered.size()) {
+        string::size_type end = offered.find(',', pos);
+        if (end == string::npos) {
+            end = offered.size();
+        }
+
+        string protocol = simgear::strutils::strip(offered.substr(pos, end - pos));
+        if (protocol == BinaryProtocol) {
+            return BinaryProtocol;
+        } else if (protocol == BinaryDeflateProtocol) {
+            return BinaryDeflateProtocol;
+        }
+        pos = end + 1;
+    }
+
+    return NULL;
+}
+
+MirrorPropertyTreeWebsocket::MirrorPropertyTreeWebsocket(const std::string& path,
+                                                         const std::string& protocol) :
     _listener(new MirrorTreeListener),
-    _minSendInterval(100)
+    _minSendInterval(100),
+    _format(FORMAT_JSON)
 {
+    if (protocol == BinaryProtocol) {
+        _format = FORMAT_BINARY;
+    } else if (protocol == BinaryDeflateProtocol) {
+        _format = FORMAT_BINARY_DEFLATE;
+    }
+
     _subtreeRoot = globals->get_props()->getNode(path, true);
     _subtreeRoot->addChangeListener(_listener.get());
     _listener->registerSubtree(_subtreeRoot);
@@ -453,6 +717,12 @@ void MirrorPropertyTreeWebsocket::poll(WebsocketWriter & writer)
     // okay, we will send now, update the send stamp
     _lastSendTime.stamp();
 
+    if (_format != FORMAT_JSON) {
+        _listener->makeBinaryData(_frame, _format == FORMAT_BINARY_DEFLATE);
+        writer.writeBinary(_frame.data(), _frame.size());
+        return;
+    }
+
     cJSON * json = _listener->makeJSONData();
     char * jsonString = cJSON_PrintUnformatted( json );
     writer.writeText( jsonString );
@@ -37,7 +37,22 @@ namespace http {
 class MirrorPropertyTreeWebsocket : public Websocket
 {
 public:
-    MirrorPropertyTreeWebsocket(const std::string& path);
+    /**
+     * Websocket subprotocols selecting the binary frame format, without
+     * and with compression. Clients which don't ask for one of these get
+     * JSON text frames.
+     */
+    static const char* BinaryProtocol;
+    static const char* BinaryDeflateProtocol;
+
+    /**
+     * Returns the protocol to accept from the comma separated list in a
+     * Sec-WebSocket-Protocol header, or NULL if none is supported.
+     */
+    static const char* selectProtocol(const std::string& offered);
+
+    MirrorPropertyTreeWebsocket(const std::string& path,
+                                const std::string& protocol = std::string());
   virtual ~MirrorPropertyTreeWebsocket();
 
   virtual void close();
@@ -51,6 +66,14 @@ private:
     std::unique_ptr<MirrorTreeListener> _listener;
     int _minSendInterval;
     SGTimeStamp _lastSendTime;
+
+    enum Format {
+        FORMAT_JSON,
+        FORMAT_BINARY,
+        FORMAT_BINARY_DEFLATE
+    };
+    Format _format;
+    std::string _frame; // binary frame buffer, reused
 };
 
 }
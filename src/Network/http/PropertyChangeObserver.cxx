@@ -21,84 +21,139 @@
 #include "PropertyChangeObserver.hxx"
 
 #include <Main/fg_props.hxx>
+
+#include <algorithm>
+
 using std::string;
 namespace flightgear {
 namespace http {
 
 
 
-PropertyChangeObserver::PropertyChangeObserver()
+void PropertyChangeObserverEntry::valueChanged(SGPropertyNode * node)
+{
+  if (!_dirty) {
+    _dirty = true;
+    _observer->_dirtyEntries.push_back(this);
+  }
+}
+
+PropertyChangeObserver::PropertyChangeObserver() :
+  _serial(0)
 {
 }
 
 PropertyChangeObserver::~PropertyChangeObserver()
 {
-  //
+  clear();
 }
 
-void PropertyChangeObserver::check()
+static bool updateValue(PropertyChangeObserverEntry * entry, unsigned serial)
 {
+  const char * value = entry->_node->getStringValue();
+  if (entry->_prevValue == value)
+    return false;
 
-  for (Entries_t::iterator it = _entries.begin(); it != _entries.end(); ++it) {
-    if (false == (*it)->_node.isShared()) {
-      // node is no longer used but by us - remove the entry
-      it = _entries.erase(it);
+  entry->_prevValue = value;
+  entry->_changedSerial = serial;
+  return true;
+}
+
+void PropertyChangeObserver::check()
+{
+  ++_serial;
+
+  // nodes may be tied or aliased after they were first observed (the FDM
+  // binds its properties once the scenery is loaded), or be untied again
+  for (size_t i = 0; i < _entries.size(); ++i) {
+    PropertyChangeObserverEntry * entry = _entries[i].get();
+    bool polled = entry->_node->isTied() || entry->_node->isAlias();
+    if (polled == entry->_polled)
       continue;
+
+    entry->_polled = polled;
+    if (polled) {
+      entry->_node->removeChangeListener(entry);
+      _polledEntries.push_back(entry);
+    } else {
+      _polledEntries.erase(std::find(_polledEntries.begin(), _polledEntries.end(), entry));
+      entry->_node->addChangeListener(entry);
+      // the last value of the tied variable isn't polled any more
+      updateValue(entry, _serial);
     }
+  }
+
+  // the listeners may fire without a new value, compare to be sure
+  for (size_t i = 0; i < _dirtyEntries.size(); ++i) {
+    PropertyChangeObserverEntry * entry = _dirtyEntries[i];
+    entry->_dirty = false;
+    updateValue(entry, _serial);
+  }
+  _dirtyEntries.clear();
 
-    if( false == (*it)->_changed ) {
-      (*it)->_changed = (*it)->_prevValue != (*it)->_node->getStringValue();
-      if ((*it)->_changed)
-        (*it)->_prevValue = (*it)->_node->getStringValue();
+  for (size_t i = 0; i < _polledEntries.size(); ++i) {
+    updateValue(_polledEntries[i], _serial);
+  }
 
+  // remove the entries no websocket refers to any more
+  Entries_t::iterator end = _entries.end();
+  for (Entries_t::iterator it = _entries.begin(); it != end; ) {
+    if ((*it).isShared()) {
+      ++it;
+      continue;
+    }
+    if ((*it)->_polled) {
+      _polledEntries.erase(std::find(_polledEntries.begin(), _polledEntries.end(), it->get()));
     }
+    (*it)->_node->removeChangeListener(it->get());
+    std::swap(*it, *--end);
   }
+  _entries.erase(end, _entries.end());
 }
 
-void PropertyChangeObserver::uncheck()
+void PropertyChangeObserver::clear()
 {
   for (Entries_t::iterator it = _entries.begin(); it != _entries.end(); ++it) {
-    (*it)->_changed = false;
+    (*it)->_node->removeChangeListener(it->get());
   }
+  _entries.clear();
+  _polledEntries.clear();
+  _dirtyEntries.clear();
 }
 
-const SGPropertyNode_ptr PropertyChangeObserver::addObservation( const string propertyName)
+const PropertyChangeObserverEntryRef PropertyChangeObserver::addObservation( const string propertyName)
 {
-  for (Entries_t::iterator it = _entries.begin(); it != _entries.end(); ++it) {
-    if (propertyName == (*it)->_node->getPath(true) ) {
-      // if a new observer is added to a property, mark it as changed to ensure the observer
-      // gets notified on initial call. This also causes a notification for all other observers of this
-      // property.
-      (*it)->_changed = true;
-      return (*it)->_node;
-    }
-  }
-
+  SGPropertyNode_ptr node;
   try {
-    PropertyChangeObserverEntryRef entry = new PropertyChangeObserverEntry();
-    entry->_node = fgGetNode( propertyName, true );
-    _entries.push_back( entry );
-    return entry->_node;
+    node = fgGetNode( propertyName, true );
   }
   catch( string & s ) {
     SG_LOG(SG_NETWORK,SG_WARN,"httpd: can't observer '" << propertyName << "'. Invalid name." );
+    return PropertyChangeObserverEntryRef();
   }
 
-  SGPropertyNode_ptr empty;
-  return empty;
-}
-
-bool PropertyChangeObserver::isChangedValue(const SGPropertyNode_ptr node)
-{
   for (Entries_t::iterator it = _entries.begin(); it != _entries.end(); ++it) {
-    PropertyChangeObserverEntryRef entry = *it;
-
-    if( entry->_node == node && entry->_changed ) {
-      return true;
+    if (node == (*it)->_node ) {
+      // if a new observer is added to a property, mark it as changed to ensure the observer
+      // gets notified on initial call. This also causes a notification for all other observers of this
+      // property.
+      (*it)->_changedSerial = _serial + 1;
+      return *it;
     }
   }
 
-  return false;
+  PropertyChangeObserverEntryRef entry = new PropertyChangeObserverEntry();
+  entry->_observer = this;
+  entry->_node = node;
+  entry->_prevValue = node->getStringValue();
+  entry->_changedSerial = _serial + 1;
+  entry->_polled = node->isTied() || node->isAlias();
+  if (entry->_polled)
+    _polledEntries.push_back(entry.get());
+  else
+    node->addChangeListener(entry.get());
+  _entries.push_back( entry );
+  return entry;
 }
 
 }  // namespace http
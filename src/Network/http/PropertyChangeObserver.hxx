@@ -28,14 +28,30 @@
 namespace flightgear {
 namespace http {
 
-struct PropertyChangeObserverEntry : public SGReferenced {
+class PropertyChangeObserver;
+
+/**
+ * One observed property, shared by all websockets observing it. Changes
+ * are noticed by a listener, only tied properties and aliases, which
+ * don't reliably notify their listeners, are polled every frame. check()
+ * switches between the two when a node is tied or untied later on.
+ */
+struct PropertyChangeObserverEntry : public SGReferenced, public SGPropertyChangeListener {
   PropertyChangeObserverEntry()
-      : _changed(true)
+      : _observer(NULL),
+        _changedSerial(0),
+        _dirty(false),
+        _polled(false)
   {
   }
+  virtual void valueChanged(SGPropertyNode * node);
+
+  PropertyChangeObserver * _observer;
   SGPropertyNode_ptr _node;
   std::string _prevValue;
-  bool _changed;
+  unsigned _changedSerial; // check() that last saw a new value
+  bool _dirty;             // set since the last check()
+  bool _polled;
 };
 
 typedef SGSharedPtr<PropertyChangeObserverEntry> PropertyChangeObserverEntryRef;
@@ -45,17 +61,29 @@ public:
   PropertyChangeObserver();
   virtual ~PropertyChangeObserver();
 
-  const SGPropertyNode_ptr addObservation( const std::string propertyName);
-  bool isChangedValue(const SGPropertyNode_ptr node);
+  const PropertyChangeObserverEntryRef addObservation( const std::string propertyName);
+
+  // whether the value changed after the check() numbered serial
+  bool isChangedValue(const PropertyChangeObserverEntryRef& entry, unsigned serial) const
+  {
+    return entry->_changedSerial > serial;
+  }
+
+  // number of the last check()
+  unsigned getSerial() const { return _serial; }
 
   void check();
-  void uncheck();
 
-  void clear() { _entries.clear(); }
+  void clear();
 
 private:
+  friend struct PropertyChangeObserverEntry;
+
   typedef std::vector<PropertyChangeObserverEntryRef> Entries_t;
   Entries_t _entries;
+  std::vector<PropertyChangeObserverEntry*> _polledEntries;
+  std::vector<PropertyChangeObserverEntry*> _dirtyEntries;
+  unsigned _serial;
 
 };
 }  // namespace http
@@ -121,7 +121,8 @@ PropertyChangeWebsocket::PropertyChangeWebsocket(PropertyChangeObserver * proper
     : id(++nextid),
       _propertyChangeObserver(propertyChangeObserver),
       _minTriggerInterval(fgGetDouble("/sim/http/property-websocket/update-interval-secs", 0.05)), // default 20Hz
-      _lastTrigger(-1000)
+      _lastTrigger(-1000),
+      _lastSerial(propertyChangeObserver->getSerial())
 {
 }
 
@@ -218,16 +219,19 @@ void PropertyChangeWebsocket::poll(WebsocketWriter & writer)
     _lastTrigger = now;
   }
 
+  // everything that changed since the last update, also in the frames
+  // skipped because of the trigger interval
+  string out;
   for (WatchedNodesList::iterator it = _watchedNodes.begin(); it != _watchedNodes.end(); ++it) {
-    SGPropertyNode_ptr node = *it;
-
-    string newValue;
-    if (_propertyChangeObserver->isChangedValue(node)) {
-      string out = JSON::toJsonString( false, node, 0, now );
+    if (_propertyChangeObserver->isChangedValue(*it, _lastSerial)) {
+      SGPropertyNode_ptr node = (*it)->_node;
+      out.clear();
+      JSON::writeJson( out, false, node, 0, now );
       SG_LOG(SG_NETWORK, SG_DEBUG, "PropertyChangeWebsocket::poll() new Value for " << node->getPath(true) << " '" << node->getStringValue() << "' #" << id << ": " << out );
       writer.writeText( out );
     }
   }
+  _lastSerial = _propertyChangeObserver->getSerial();
 }
 
 void PropertyChangeWebsocket::WatchedNodesList::handleCommand(const string & command, const string & node,
@@ -235,18 +239,18 @@ void PropertyChangeWebsocket::WatchedNodesList::handleCommand(const string & com
 {
   if (command == "addListener") {
     for (iterator it = begin(); it != end(); ++it) {
-      if (node == (*it)->getPath(true)) {
+      if (node == (*it)->_node->getPath(true)) {
         SG_LOG(SG_NETWORK, SG_WARN, "httpd: " << command << " '" << node << "' ignored (duplicate)");
         return; // dupliate
       }
     }
-    SGPropertyNode_ptr n = propertyChangeObserver->addObservation(node);
-    if (n.valid()) push_back(n);
+    PropertyChangeObserverEntryRef entry = propertyChangeObserver->addObservation(node);
+    if (entry.valid()) push_back(entry);
     SG_LOG(SG_NETWORK, SG_INFO, "httpd: " << command << " '" << node << "' success");
 
   } else if (command == "removeListener") {
     for (iterator it = begin(); it != end(); ++it) {
-      if (node == (*it)->getPath(true)) {
+      if (node == (*it)->_node->getPath(true)) {
         this->erase(it);
         SG_LOG(SG_NETWORK, SG_INFO, "httpd: " << command << " '" << node << "' success");
         return;
@@ -22,6 +22,7 @@
 #define PROPERTYCHANGEWEBSOCKET_HXX_
 
 #include "Websocket.hxx"
+#include "PropertyChangeObserver.hxx"
 #include <simgear/props/props.hxx>
 
 #include <vector>
@@ -29,8 +30,6 @@
 namespace flightgear {
 namespace http {
 
-class PropertyChangeObserver;
-
 class PropertyChangeWebsocket: public Websocket {
 public:
   PropertyChangeWebsocket(PropertyChangeObserver * propertyChangeObserver);
@@ -45,7 +44,7 @@ private:
 
   void handleGetCommand(const string_list& nodes, WebsocketWriter &writer);
   
-  class WatchedNodesList: public std::vector<SGPropertyNode_ptr> {
+  class WatchedNodesList: public std::vector<PropertyChangeObserverEntryRef> {
   public:
     void handleCommand(const std::string & command, const std::string & node, PropertyChangeObserver * propertyChangeObserver);
   };
@@ -53,6 +52,7 @@ private:
   WatchedNodesList _watchedNodes;
   double _minTriggerInterval;
   double _lastTrigger;
+  unsigned _lastSerial; // observer check() of the last update sent
 };
 
 }
@@ -32,6 +32,8 @@
 #include "PropertyChangeObserver.hxx"
 #include <Main/fg_props.hxx>
 #include <Include/version.h>
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/threads/SGGuard.hxx>
 #include <3rdparty/mongoose/mongoose.h>
 #include <3rdparty/cjson/cJSON.h>
 
@@ -161,6 +163,51 @@ public:
 
 };
 
+/**
+ * Polls the mongoose server, so connections get accepted, requests parsed
+ * and files and replies sent independent of the frame rate. Everything
+ * touching the simulator state is passed to the main loop, see
+ * MongooseHttpd::runOnMainLoop().
+ */
+class MongooseThread: public SGThread {
+public:
+  MongooseThread(struct mg_server * server)
+      : _server(server), _stop(false)
+  {
+  }
+
+  /**
+   * Stop the thread and wait for it to finish
+   */
+  void stop()
+  {
+    {
+      SGGuard<SGMutex> lock(_mutex);
+      _stop = true;
+    }
+    mg_wakeup_server(_server);
+    join();
+  }
+
+  virtual void run()
+  {
+    for (;;) {
+      {
+        SGGuard<SGMutex> lock(_mutex);
+        if (_stop) break;
+      }
+      mg_poll_server(_server, 100);
+    }
+  }
+
+private:
+  struct mg_server * _server;
+  SGMutex _mutex;
+  bool _stop;
+};
+
+class MongooseConnection;
+
 /**
  * A FGHttpd implementation based on mongoose httpd
  *
@@ -215,12 +262,29 @@ public:
     return _uriHandler.findHandler(uri);
   }
 
-  Websocket * newWebsocket(const string & uri);
+  Websocket * newWebsocket(const string & uri, const string & protocol);
+
+  /**
+   * True if mongoose runs on its own thread (/sim/http/threaded)
+   */
+  bool isThreaded() const
+  {
+    return _thread != NULL;
+  }
+
+  /**
+   * Called from the httpd thread to have the main loop call
+   * connection->runOnMainLoop() at the next update()
+   */
+  void runOnMainLoop(MongooseConnection * connection);
 
 private:
+  void stopThread();
+
   int poll(struct mg_connection * connection);
   int auth(struct mg_connection * connection);
   int request(struct mg_connection * connection);
+  int onHandshake(struct mg_connection * connection);
   int onConnect(struct mg_connection * connection);
   void close(struct mg_connection * connection);
 
@@ -233,12 +297,16 @@ private:
   URIHandlerMap _uriHandler;
 
   PropertyChangeObserver _propertyChangeObserver;
+
+  MongooseThread * _thread;
+  SGMutex _mainLoopMutex; // guards _mainLoop
+  vector<SGSharedPtr<MongooseConnection> > _mainLoop;
 };
 
-class MongooseConnection: public Connection {
+class MongooseConnection: public Connection, public SGReferenced {
 public:
   MongooseConnection(MongooseHttpd * httpd)
-      : _httpd(httpd)
+      : _httpd(httpd), _connection(NULL), _output(NULL)
   {
   }
   virtual ~MongooseConnection();
@@ -249,10 +317,21 @@ public:
   virtual int onConnect(struct mg_connection * connection) {return 0;}
   virtual void write(const char * data, size_t len)
   {
-    if (_connection) mg_send_data(_connection, data, len);
+    // on the main loop, the httpd thread sends the buffer later
+    if (_output) _output->append(data, len);
+    else if (_connection) mg_send_data(_connection, data, len);
   }
 
+  /**
+   * With a httpd thread: do the work MongooseHttpd::runOnMainLoop() was
+   * called for.
+   *
+   * @return true to get called again at the next update()
+   */
+  virtual bool runOnMainLoop() { return false; }
+
   static MongooseConnection * getConnection(MongooseHttpd * httpd, struct mg_connection * connection);
+  static void releaseConnection(struct mg_connection * connection);
 
 protected:
   void setConnection(struct mg_connection * connection)
@@ -261,7 +340,7 @@ protected:
   }
   MongooseHttpd * _httpd;
   struct mg_connection * _connection;
-
+  std::string * _output;
 };
 
 MongooseConnection::~MongooseConnection()
@@ -271,7 +350,7 @@ MongooseConnection::~MongooseConnection()
 class RegularConnection: public MongooseConnection {
 public:
   RegularConnection(MongooseHttpd * httpd)
-      : MongooseConnection(httpd)
+      : MongooseConnection(httpd), _threadSafe(false), _task(TASK_REQUEST), _state(IDLE), _done(false)
   {
   }
   virtual ~RegularConnection()
@@ -281,15 +360,40 @@ public:
   virtual void close(struct mg_connection * connection);
   virtual int poll(struct mg_connection * connection);
   virtual int request(struct mg_connection * connection);
+  virtual bool runOnMainLoop();
 
 private:
+  void respond(struct mg_connection * connection, const HTTPResponse & response, bool done);
+  int pollThreaded(struct mg_connection * connection);
+
   SGSharedPtr<URIHandler> _handler;
+  bool _threadSafe;
+
+  // with a httpd thread: the handler call for the main loop, its arguments
+  // and results
+  enum Task {
+    TASK_PREPARE, // prepareRequest() of a thread safe handler
+    TASK_REQUEST,
+    TASK_POLL
+  };
+  enum State {
+    IDLE,
+    QUEUED,
+    FINISHED
+  };
+  Task _task;
+  SGMutex _mutex; // guards _state
+  State _state;
+  HTTPRequest _request;
+  HTTPResponse _response;
+  bool _done;
+  std::string _outputBuffer;
 };
 
 class WebsocketConnection: public MongooseConnection {
 public:
   WebsocketConnection(MongooseHttpd * httpd)
-      : MongooseConnection(httpd), _websocket(NULL)
+      : MongooseConnection(httpd), _websocket(NULL), _closed(false), _unhandled(false)
   {
   }
   virtual ~WebsocketConnection()
@@ -300,6 +404,13 @@ public:
   virtual int poll(struct mg_connection * connection);
   virtual int request(struct mg_connection * connection);
   virtual int onConnect(struct mg_connection * connection);
+  virtual bool runOnMainLoop();
+
+  // the subprotocol accepted in the handshake, if any
+  void setProtocol(const string & protocol)
+  {
+    _protocol = protocol;
+  }
 
 private:
   class MongooseWebsocketWriter: public WebsocketWriter {
@@ -316,7 +427,31 @@ private:
   private:
     struct mg_connection * _connection;
   };
-  Websocket * _websocket;
+
+  // keeps the frames written on the main loop for the httpd thread
+  class BufferedWebsocketWriter: public WebsocketWriter {
+  public:
+    typedef std::pair<int, string> Frame;
+
+    virtual int writeToWebsocket(int opcode, const char * data, size_t len)
+    {
+      frames.push_back(Frame(opcode, string(data, len)));
+      return len;
+    }
+
+    vector<Frame> frames;
+  };
+
+  Websocket * _websocket; // main loop only with a httpd thread
+  string _protocol;
+  string _uri;
+
+  // with a httpd thread: what is passed between the threads
+  SGMutex _mutex;
+  bool _closed;
+  bool _unhandled;
+  vector<HTTPRequest> _received;
+  vector<BufferedWebsocketWriter::Frame> _frames;
 };
 
 MongooseConnection * MongooseConnection::getConnection(MongooseHttpd * httpd, struct mg_connection * connection)
@@ -326,10 +461,36 @@ MongooseConnection * MongooseConnection::getConnection(MongooseHttpd * httpd, st
   if (connection->is_websocket) c = new WebsocketConnection(httpd);
   else c = new RegularConnection(httpd);
 
+  SGReferenced::get(c);
   connection->connection_param = c;
   return c;
 }
 
+void MongooseConnection::releaseConnection(struct mg_connection * connection)
+{
+  // the main loop may still hold a reference
+  MongooseConnection * c = static_cast<MongooseConnection*>(connection->connection_param);
+  connection->connection_param = NULL;
+  if (c && 0 == SGReferenced::put(c)) delete c;
+}
+
+void RegularConnection::respond(struct mg_connection * connection, const HTTPResponse & response, bool done)
+{
+  // fill in the response header
+  mg_send_status(connection, response.StatusCode);
+  for (HTTPResponse::Header_t::const_iterator it = response.Header.begin(); it != response.Header.end(); ++it) {
+    const string name = it->first;
+    const string value = it->second;
+    if (name.empty() || value.empty()) continue;
+    mg_send_header(connection, name.c_str(), value.c_str());
+  }
+  if (done || false == response.Content.empty()) {
+    SG_LOG(SG_NETWORK, SG_INFO,
+        "RegularConnection::request() responding " << response.Content.length() << " Bytes, done=" << done);
+    mg_send_data(connection, response.Content.c_str(), response.Content.length());
+  }
+}
+
 int RegularConnection::request(struct mg_connection * connection)
 {
   setConnection(connection);
@@ -355,22 +516,24 @@ int RegularConnection::request(struct mg_connection * connection)
     response.Header["Date"] = buf;
   }
 
+  if (_httpd->isThreaded()) {
+    // the handler gets called on the main loop, poll() responds once it's done
+    _threadSafe = _handler->isThreadSafe(request);
+    _task = _threadSafe ? TASK_PREPARE : TASK_REQUEST;
+    _request = request;
+    _response = response;
+    {
+      SGGuard<SGMutex> lock(_mutex);
+      _state = QUEUED;
+    }
+    _httpd->runOnMainLoop(this);
+    return MG_MORE;
+  }
+
   // hand the request over to the handler, returns true if request is finished, 
   // false the handler wants to get polled again (calling handlePoll() next time)
   bool done = _handler->handleRequest(request, response, this);
-  // fill in the response header
-  mg_send_status(connection, response.StatusCode);
-  for (HTTPResponse::Header_t::const_iterator it = response.Header.begin(); it != response.Header.end(); ++it) {
-    const string name = it->first;
-    const string value = it->second;
-    if (name.empty() || value.empty()) continue;
-    mg_send_header(connection, name.c_str(), value.c_str());
-  }
-  if (done || false == response.Content.empty()) {
-    SG_LOG(SG_NETWORK, SG_INFO,
-        "RegularConnection::request() responding " << response.Content.length() << " Bytes, done=" << done);
-    mg_send_data(connection, response.Content.c_str(), response.Content.length());
-  }
+  respond(connection, response, done);
   return done ? MG_TRUE : MG_MORE;
 }
 
@@ -378,10 +541,68 @@ int RegularConnection::poll(struct mg_connection * connection)
 {
   setConnection(connection);
   if (false == _handler.valid()) return MG_FALSE;
+  if (_httpd->isThreaded()) return pollThreaded(connection);
   // only return MG_TRUE if we handle this request
   return _handler->poll(this) ? MG_TRUE : MG_MORE;
 }
 
+int RegularConnection::pollThreaded(struct mg_connection * connection)
+{
+  if (_threadSafe && TASK_POLL == _task) return _handler->poll(this) ? MG_TRUE : MG_MORE;
+
+  {
+    SGGuard<SGMutex> lock(_mutex);
+    if (FINISHED != _state) return MG_MORE;
+    _state = IDLE;
+  }
+
+  if (TASK_PREPARE == _task) {
+    // a thread safe handler answers from what prepareRequest() copied
+    _done = _handler->handleRequest(_request, _response, this);
+  }
+  if (TASK_POLL != _task) respond(connection, _response, _done);
+
+  // what the handler wrote on the main loop
+  if (false == _outputBuffer.empty()) {
+    mg_send_data(connection, _outputBuffer.data(), _outputBuffer.size());
+    _outputBuffer.clear();
+  }
+
+  _task = TASK_POLL;
+  if (_done) return MG_TRUE;
+
+  if (false == _threadSafe) {
+    {
+      SGGuard<SGMutex> lock(_mutex);
+      _state = QUEUED;
+    }
+    _httpd->runOnMainLoop(this);
+  }
+  return MG_MORE;
+}
+
+bool RegularConnection::runOnMainLoop()
+{
+  // the httpd thread leaves everything alone until the state is FINISHED
+  _output = &_outputBuffer;
+  switch (_task) {
+    case TASK_PREPARE:
+      _handler->prepareRequest(_request, this);
+      break;
+    case TASK_REQUEST:
+      _done = _handler->handleRequest(_request, _response, this);
+      break;
+    case TASK_POLL:
+      _done = _handler->poll(this);
+      break;
+  }
+  _output = NULL;
+
+  SGGuard<SGMutex> lock(_mutex);
+  _state = FINISHED;
+  return false;
+}
+
 void RegularConnection::close(struct mg_connection * connection)
 {
   setConnection(connection);
@@ -391,6 +612,12 @@ void RegularConnection::close(struct mg_connection * connection)
 void WebsocketConnection::close(struct mg_connection * connection)
 {
   setConnection(connection);
+  if (_httpd->isThreaded()) {
+    // the websocket belongs to the main loop
+    SGGuard<SGMutex> lock(_mutex);
+    _closed = true;
+    return;
+  }
   if ( NULL != _websocket) _websocket->close();
   delete _websocket;
   _websocket = NULL;
@@ -399,6 +626,18 @@ void WebsocketConnection::close(struct mg_connection * connection)
 int WebsocketConnection::poll(struct mg_connection * connection)
 {
   setConnection(connection);
+  if (_httpd->isThreaded()) {
+    // send what the websocket wrote on the main loop
+    vector<BufferedWebsocketWriter::Frame> frames;
+    {
+      SGGuard<SGMutex> lock(_mutex);
+      frames.swap(_frames);
+    }
+    for (vector<BufferedWebsocketWriter::Frame>::const_iterator it = frames.begin(); it != frames.end(); ++it)
+      mg_websocket_write(connection, it->first, it->second.data(), it->second.size());
+    return MG_MORE;
+  }
+
   // we get polled before the first request came in but we know 
   // nothing about how to handle that before we know the URI.
   // so simply ignore that poll
@@ -414,7 +653,14 @@ int WebsocketConnection::onConnect(struct mg_connection * connection)
   setConnection(connection);
   MongooseHTTPRequest request(connection);
   SG_LOG(SG_NETWORK, SG_INFO, "WebsocketConnection::connect for " << request.Uri);
-  if ( NULL == _websocket) _websocket = _httpd->newWebsocket(request.Uri);
+  if (_httpd->isThreaded()) {
+    // the main loop creates the websocket and keeps polling it
+    _uri = request.Uri;
+    _httpd->runOnMainLoop(this);
+    return 0;
+  }
+
+  if ( NULL == _websocket) _websocket = _httpd->newWebsocket(request.Uri, _protocol);
   if ( NULL == _websocket) {
     SG_LOG(SG_NETWORK, SG_WARN, "httpd: unhandled websocket uri: " << request.Uri);
     return 0;
@@ -429,6 +675,16 @@ int WebsocketConnection::request(struct mg_connection * connection)
   MongooseHTTPRequest request(connection);
   SG_LOG(SG_NETWORK, SG_INFO, "WebsocketConnection::request for " << request.Uri);
 
+  if (_httpd->isThreaded()) {
+    SGGuard<SGMutex> lock(_mutex);
+    if (_unhandled) {
+      SG_LOG(SG_NETWORK, SG_ALERT, "httpd: unhandled websocket uri: " << request.Uri);
+      return MG_TRUE; // close connection - good bye
+    }
+    _received.push_back(request);
+    return MG_MORE;
+  }
+
   if ( NULL == _websocket) {
     SG_LOG(SG_NETWORK, SG_ALERT, "httpd: unhandled websocket uri: " << request.Uri);
     return MG_TRUE; // close connection - good bye
@@ -439,13 +695,53 @@ int WebsocketConnection::request(struct mg_connection * connection)
   return MG_MORE;
 }
 
+bool WebsocketConnection::runOnMainLoop()
+{
+  vector<HTTPRequest> received;
+  bool closed;
+  {
+    SGGuard<SGMutex> lock(_mutex);
+    received.swap(_received);
+    closed = _closed;
+  }
+
+  if (closed) {
+    if ( NULL != _websocket) _websocket->close();
+    delete _websocket;
+    _websocket = NULL;
+    return false;
+  }
+
+  if ( NULL == _websocket) {
+    _websocket = _httpd->newWebsocket(_uri, _protocol);
+    if ( NULL == _websocket) {
+      SG_LOG(SG_NETWORK, SG_WARN, "httpd: unhandled websocket uri: " << _uri);
+      SGGuard<SGMutex> lock(_mutex);
+      _unhandled = true;
+      return false;
+    }
+  }
+
+  BufferedWebsocketWriter writer;
+  for (vector<HTTPRequest>::const_iterator it = received.begin(); it != received.end(); ++it)
+    _websocket->handleRequest(*it, writer);
+  _websocket->poll(writer);
+
+  if (false == writer.frames.empty()) {
+    SGGuard<SGMutex> lock(_mutex);
+    _frames.insert(_frames.end(), writer.frames.begin(), writer.frames.end());
+  }
+  return true;
+}
+
 MongooseHttpd::MongooseHttpd(SGPropertyNode_ptr configNode)
-    : _server(NULL), _configNode(configNode)
+    : _server(NULL), _configNode(configNode), _thread(NULL)
 {
 }
 
 MongooseHttpd::~MongooseHttpd()
 {
+  stopThread();
   mg_destroy_server(&_server);
 }
 
@@ -548,6 +844,14 @@ void MongooseHttpd::init()
 
   }
 
+  // request handlers still run on the main loop, but a slow client or a
+  // large file no longer holds up the frame
+  if (_configNode->getBoolValue("threaded", true)) {
+    SG_LOG(SG_NETWORK, SG_INFO, "httpd: starting the httpd thread");
+    _thread = new MongooseThread(_server);
+    _thread->start();
+  }
+
   _configNode->setBoolValue("running",true);
 
 }
@@ -559,7 +863,10 @@ void MongooseHttpd::bind()
 void MongooseHttpd::unbind()
 {
   _configNode->setBoolValue("running",false);
+  stopThread();
+  // closes the remaining websockets, on this thread now
   mg_destroy_server(&_server);
+  _mainLoop.clear();
   _uriHandler.clear();
   _propertyChangeObserver.clear();
 }
@@ -567,15 +874,53 @@ void MongooseHttpd::unbind()
 void MongooseHttpd::update(double dt)
 {
   _propertyChangeObserver.check();
-  mg_poll_server(_server, 0);
-  _propertyChangeObserver.uncheck();
+  if (NULL == _thread) {
+    mg_poll_server(_server, 0);
+    return;
+  }
+
+  vector<SGSharedPtr<MongooseConnection> > work, again;
+  {
+    SGGuard<SGMutex> lock(_mainLoopMutex);
+    work.swap(_mainLoop);
+  }
+  if (work.empty()) return;
+
+  for (vector<SGSharedPtr<MongooseConnection> >::iterator it = work.begin(); it != work.end(); ++it) {
+    if ((*it)->runOnMainLoop()) again.push_back(*it);
+  }
+
+  {
+    SGGuard<SGMutex> lock(_mainLoopMutex);
+    _mainLoop.insert(_mainLoop.end(), again.begin(), again.end());
+  }
+
+  // have the httpd thread send the results now
+  mg_wakeup_server(_server);
+}
+
+void MongooseHttpd::runOnMainLoop(MongooseConnection * connection)
+{
+  SGGuard<SGMutex> lock(_mainLoopMutex);
+  _mainLoop.push_back(connection);
+}
+
+void MongooseHttpd::stopThread()
+{
+  if (NULL == _thread) return;
+  _thread->stop();
+  delete _thread;
+  _thread = NULL;
 }
 
 int MongooseHttpd::poll(struct mg_connection * connection)
 {
   if ( NULL == connection->connection_param) return MG_FALSE; // connection not yet set up - ignore poll
 
-  return MongooseConnection::getConnection(this, connection)->poll(connection);
+  int result = MongooseConnection::getConnection(this, connection)->poll(connection);
+  // mongoose forgets the connection of a finished request without MG_CLOSE
+  if (MG_TRUE == result && false == connection->is_websocket) MongooseConnection::releaseConnection(connection);
+  return result;
 }
 
 int MongooseHttpd::auth(struct mg_connection * connection)
@@ -590,7 +935,29 @@ int MongooseHttpd::auth(struct mg_connection * connection)
 
 int MongooseHttpd::request(struct mg_connection * connection)
 {
-  return MongooseConnection::getConnection(this, connection)->request(connection);
+  int result = MongooseConnection::getConnection(this, connection)->request(connection);
+  // mongoose forgets the connection of a finished request without MG_CLOSE
+  if (MG_TRUE == result && false == connection->is_websocket) MongooseConnection::releaseConnection(connection);
+  return result;
+}
+
+int MongooseHttpd::onHandshake(struct mg_connection * connection)
+{
+  // only the property tree mirror speaks subprotocols, let mongoose do
+  // the plain handshake for anything else
+  const char * offered = mg_get_header(connection, "Sec-WebSocket-Protocol");
+  if ( NULL == offered || string(connection->uri).find("/PropertyTreeMirror/") != 0)
+    return MG_FALSE;
+
+  const char * protocol = MirrorPropertyTreeWebsocket::selectProtocol(offered);
+  if ( NULL == protocol) return MG_FALSE;
+
+  WebsocketConnection * c = dynamic_cast<WebsocketConnection*>(MongooseConnection::getConnection(this, connection));
+  if ( NULL == c) return MG_FALSE;
+
+  c->setProtocol(protocol);
+  mg_send_websocket_handshake(connection, protocol);
+  return MG_TRUE;
 }
 
 int MongooseHttpd::onConnect(struct mg_connection * connection)
@@ -600,18 +967,17 @@ int MongooseHttpd::onConnect(struct mg_connection * connection)
 
 void MongooseHttpd::close(struct mg_connection * connection)
 {
-  MongooseConnection * c = MongooseConnection::getConnection(this, connection);
-  c->close(connection);
-  delete c;
+  MongooseConnection::getConnection(this, connection)->close(connection);
+  MongooseConnection::releaseConnection(connection);
 }
-Websocket * MongooseHttpd::newWebsocket(const string & uri)
+Websocket * MongooseHttpd::newWebsocket(const string & uri, const string & protocol)
 {
   if (uri.find("/PropertyListener") == 0) {
     SG_LOG(SG_NETWORK, SG_INFO, "new PropertyChangeWebsocket for: " << uri);
     return new PropertyChangeWebsocket(&_propertyChangeObserver);
   } else if (uri.find("/PropertyTreeMirror/") == 0) {
       SG_LOG(SG_NETWORK, SG_INFO, "new MirrorPropertyTreeWebsocket for: " << uri);
-    return new MirrorPropertyTreeWebsocket(uri.substr(20));
+    return new MirrorPropertyTreeWebsocket(uri.substr(20), protocol);
   }
   return NULL;
 }
@@ -640,6 +1006,9 @@ int MongooseHttpd::staticRequestHandler(struct mg_connection * connection, mg_ev
     case MG_REPLY:       // If callback returns MG_FALSE, Mongoose closes connection
       return MG_FALSE;
 
+    case MG_WS_HANDSHAKE: // If callback returns MG_FALSE, Mongoose does the handshake
+      return static_cast<MongooseHttpd*>(connection->server_param)->onHandshake(connection);
+
     case MG_WS_CONNECT: // New websocket connection established, return value ignored
       return static_cast<MongooseHttpd*>(connection->server_param)->onConnect(connection);
 
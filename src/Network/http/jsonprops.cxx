@@ -21,6 +21,12 @@
 #include "jsonprops.hxx"
 #include <simgear/misc/strutils.hxx>
 #include <simgear/math/SGMath.hxx>
+
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+
 namespace flightgear {
 namespace http {
 
@@ -92,6 +98,268 @@ cJSON * JSON::valueToJson(SGPropertyNode_ptr n)
 }
 
     
+namespace {
+
+/**
+ * Writes JSON text straight to a string, the same text cJSON_Print() or
+ * cJSON_PrintUnformatted() print for the equivalent cJSON tree, but
+ * without allocating that tree and the intermediate strings.
+ */
+class JSONWriter {
+public:
+  JSONWriter(std::string & out, bool indent) : _out(out), _indent(indent) {}
+
+  void beginObject()
+  {
+    value();
+    _out += '{';
+    _levels.push_back(Level(true, depth() + 1));
+  }
+
+  void endObject()
+  {
+    const Level & l = _levels.back();
+    if (_indent) {
+      _out += '\n';
+      tabs(l.first ? l.depth - 2 : l.depth - 1);
+    }
+    _out += '}';
+    _levels.pop_back();
+  }
+
+  void beginArray()
+  {
+    value();
+    _out += '[';
+    _levels.push_back(Level(false, depth() + 1));
+  }
+
+  void endArray()
+  {
+    _out += ']';
+    _levels.pop_back();
+  }
+
+  void key(const char * name)
+  {
+    Level & l = _levels.back();
+    if (!l.first) _out += ',';
+    if (_indent) {
+      _out += '\n';
+      tabs(l.depth);
+    }
+    l.first = false;
+    writeString(name);
+    _out += _indent ? ":\t" : ":";
+  }
+
+  void str(const char * s)
+  {
+    value();
+    writeString(s);
+  }
+
+  void boolean(bool b)
+  {
+    value();
+    _out += b ? "true" : "false";
+  }
+
+  void null()
+  {
+    value();
+    _out += "null";
+  }
+
+  // same formats as cJSON's print_number()
+  void number(double d)
+  {
+    value();
+    char buf[64];
+    if (d <= INT_MAX && d >= INT_MIN && fabs(static_cast<double>(static_cast<int>(d)) - d) <= DBL_EPSILON)
+      snprintf(buf, sizeof(buf), "%d", static_cast<int>(d));
+    else if (fabs(floor(d) - d) <= DBL_EPSILON && fabs(d) < 1.0e60)
+      snprintf(buf, sizeof(buf), "%.0f", d);
+    else if (fabs(d) < 1.0e-6 || fabs(d) > 1.0e9)
+      snprintf(buf, sizeof(buf), "%e", d);
+    else
+      snprintf(buf, sizeof(buf), "%f", d);
+    _out += buf;
+  }
+
+private:
+  struct Level {
+    Level(bool o, int d) : object(o), first(true), depth(d) {}
+    bool object;
+    bool first;
+    int depth; // of the values, as cJSON counts
+  };
+
+  int depth() const
+  {
+    return _levels.empty() ? 0 : _levels.back().depth;
+  }
+
+  // separator before a value in an array, objects write it with the key
+  void value()
+  {
+    if (_levels.empty() || _levels.back().object) return;
+    Level & l = _levels.back();
+    if (!l.first) _out += _indent ? ", " : ",";
+    l.first = false;
+  }
+
+  void tabs(int n)
+  {
+    if (n > 0) _out.append(n, '\t');
+  }
+
+  // same escapes as cJSON's print_string_ptr()
+  void writeString(const char * s)
+  {
+    _out += '"';
+    const char * run = s;
+    for (; *s; ++s) {
+      unsigned char c = *s;
+      if (c > 31 && c != '"' && c != '\\') continue;
+      _out.append(run, s - run);
+      run = s + 1;
+      switch (c) {
+        case '\\': _out += "\\\\"; break;
+        case '"':  _out += "\\\""; break;
+        case '\b': _out += "\\b"; break;
+        case '\f': _out += "\\f"; break;
+        case '\n': _out += "\\n"; break;
+        case '\r': _out += "\\r"; break;
+        case '\t': _out += "\\t"; break;
+        default: {
+          char buf[8];
+          snprintf(buf, sizeof(buf), "\\u%04x", c);
+          _out += buf;
+          break;
+        }
+      }
+    }
+    _out.append(run, s - run);
+    _out += '"';
+  }
+
+  std::string & _out;
+  bool _indent;
+  std::vector<Level> _levels;
+};
+
+} // anonymous namespace
+
+static void writeValue(JSONWriter & w, simgear::props::Type type, bool boolValue, double doubleValue, const char * stringValue)
+{
+  switch( type ) {
+    case simgear::props::BOOL:
+      w.boolean(boolValue);
+      break;
+    case simgear::props::INT:
+    case simgear::props::LONG:
+    case simgear::props::FLOAT:
+    case simgear::props::DOUBLE:
+      if( SGMiscd::isNaN(doubleValue) ) w.null();
+      else w.number(doubleValue);
+      break;
+    default:
+      w.str(stringValue);
+      break;
+  }
+}
+
+// the same members as toJson()
+static void writeNode(JSONWriter & w, SGPropertyNode * n, int depth, double timestamp)
+{
+  w.beginObject();
+  w.key("path");
+  w.str(n->getPath(true).c_str());
+  w.key("name");
+  w.str(n->getName());
+  if( n->hasValue() ) {
+    simgear::props::Type type = n->getType();
+    w.key("value");
+    switch( type ) {
+      case simgear::props::BOOL:
+        writeValue(w, type, n->getBoolValue(), 0.0, NULL);
+        break;
+      case simgear::props::INT:
+      case simgear::props::LONG:
+      case simgear::props::FLOAT:
+      case simgear::props::DOUBLE:
+        writeValue(w, type, false, n->getDoubleValue(), NULL);
+        break;
+      default:
+        writeValue(w, type, false, 0.0, n->getStringValue());
+        break;
+    }
+  }
+  w.key("type");
+  w.str(JSON::getPropertyTypeString(n->getType()));
+  w.key("index");
+  w.number(n->getIndex());
+  if( timestamp >= 0.0 ) {
+    w.key("ts");
+    w.number(timestamp);
+  }
+  int nChildren = n->nChildren();
+  w.key("nChildren");
+  w.number(nChildren);
+
+  if (depth > 0 && nChildren > 0) {
+    w.key("children");
+    w.beginArray();
+    for (int i = 0; i < nChildren; i++)
+      writeNode(w, n->getChild(i), depth - 1, timestamp);
+    w.endArray();
+  }
+  w.endObject();
+}
+
+// as writeNode(), the path of a child is built from the parent's like
+// SGPropertyNode::getPath(true) does
+static void writeSnapshotNode(JSONWriter & w, const JSON::Snapshot & snapshot, size_t & pos, const string & path, double timestamp)
+{
+  const JSON::Snapshot::Node & n = snapshot.nodes[pos++];
+
+  w.beginObject();
+  w.key("path");
+  w.str(path.c_str());
+  w.key("name");
+  w.str(n.name.c_str());
+  if( n.hasValue ) {
+    w.key("value");
+    writeValue(w, n.type, n.boolValue, n.doubleValue, n.stringValue.c_str());
+  }
+  w.key("type");
+  w.str(JSON::getPropertyTypeString(n.type));
+  w.key("index");
+  w.number(n.index);
+  if( timestamp >= 0.0 ) {
+    w.key("ts");
+    w.number(timestamp);
+  }
+  w.key("nChildren");
+  w.number(n.nChildren);
+
+  if (n.expanded) {
+    w.key("children");
+    w.beginArray();
+    string childPath;
+    for (int i = 0; i < n.nChildren; i++) {
+      const JSON::Snapshot::Node & child = snapshot.nodes[pos];
+      childPath.assign(path).append("/").append(child.name);
+      if (child.index != 0)
+        childPath.append("[").append(std::to_string(child.index)).append("]");
+      writeSnapshotNode(w, snapshot, pos, childPath, timestamp);
+    }
+    w.endArray();
+  }
+  w.endObject();
+}
+
 cJSON * JSON::toJson(SGPropertyNode_ptr n, int depth, double timestamp )
 {
   cJSON * json = cJSON_CreateObject();
@@ -130,6 +398,51 @@ cJSON * JSON::toJson(SGPropertyNode_ptr n, int depth, double timestamp )
   return json;
 }
 
+static void addToSnapshot(SGPropertyNode * n, int depth, JSON::Snapshot & snapshot)
+{
+  snapshot.nodes.push_back(JSON::Snapshot::Node());
+  JSON::Snapshot::Node & node = snapshot.nodes.back();
+  node.name = n->getName();
+  node.index = n->getIndex();
+  node.type = n->getType();
+  node.hasValue = n->hasValue();
+  node.boolValue = false;
+  node.doubleValue = 0.0;
+  node.nChildren = n->nChildren();
+  node.expanded = depth > 0 && node.nChildren > 0;
+
+  if( node.hasValue ) {
+    switch( node.type ) {
+      case simgear::props::BOOL:
+        node.boolValue = n->getBoolValue();
+        break;
+      case simgear::props::INT:
+      case simgear::props::LONG:
+      case simgear::props::FLOAT:
+      case simgear::props::DOUBLE:
+        node.doubleValue = n->getDoubleValue();
+        break;
+      default:
+        node.stringValue = n->getStringValue();
+        break;
+    }
+  }
+
+  // node is invalid once the vector grows
+  if (depth > 0) {
+    int nChildren = n->nChildren();
+    for (int i = 0; i < nChildren; i++)
+      addToSnapshot(n->getChild(i), depth - 1, snapshot);
+  }
+}
+
+void JSON::takeSnapshot(SGPropertyNode_ptr n, int depth, Snapshot & snapshot)
+{
+  snapshot.path = n->getPath(true);
+  snapshot.nodes.clear();
+  addToSnapshot(n, depth, snapshot);
+}
+
 void JSON::toProp(cJSON * json, SGPropertyNode_ptr base)
 {
   if (NULL == json) return;
@@ -200,13 +513,30 @@ void JSON::addChildrenToProp(cJSON * json, SGPropertyNode_ptr n)
   }
 }
 
+void JSON::writeJson(string & out, bool indent, SGPropertyNode_ptr n, int depth, double timestamp)
+{
+  JSONWriter w(out, indent);
+  writeNode(w, n, depth, timestamp);
+}
+
+void JSON::writeJson(string & out, bool indent, const Snapshot & snapshot, double timestamp)
+{
+  JSONWriter w(out, indent);
+  size_t pos = 0;
+  writeSnapshotNode(w, snapshot, pos, snapshot.path, timestamp);
+}
+
 string JSON::toJsonString(bool indent, SGPropertyNode_ptr n, int depth, double timestamp )
 {
-  cJSON * json = toJson( n, depth, timestamp );
-  char * jsonString = indent ? cJSON_Print( json ) : cJSON_PrintUnformatted( json );
-  string reply(jsonString);
-  free( jsonString );
-  cJSON_Delete( json );
+  string reply;
+  writeJson(reply, indent, n, depth, timestamp);
+  return reply;
+}
+
+string JSON::toJsonString(bool indent, const Snapshot & snapshot, double timestamp)
+{
+  string reply;
+  writeJson(reply, indent, snapshot, timestamp);
   return reply;
 }
 
@@ -24,14 +24,48 @@
 #include <simgear/props/props.hxx>
 #include <3rdparty/cjson/cJSON.h>
 #include <string>
+#include <vector>
 
 namespace flightgear {
 namespace http {
 
 class JSON {
 public:
+  /**
+   * A copy of a property subtree down to a given depth with everything
+   * toJson() reports, taken on the main loop so it can be formatted on
+   * another thread.
+   */
+  struct Snapshot {
+    struct Node {
+      std::string name;
+      int index;
+      simgear::props::Type type;
+      bool hasValue;
+      bool boolValue;
+      double doubleValue;
+      std::string stringValue;
+      int nChildren;
+      bool expanded; // the children follow this node
+    };
+    std::string path; // of the root
+    std::vector<Node> nodes; // depth first
+  };
+
+  static void takeSnapshot(SGPropertyNode_ptr n, int depth, Snapshot & snapshot);
+
   static cJSON * toJson(SGPropertyNode_ptr n, int depth, double timestamp = -1.0 );
+
+  /**
+   * Append the JSON text of toJson() to out, without building the cJSON
+   * tree. Prints the same as cJSON_Print() (indent) or
+   * cJSON_PrintUnformatted() do.
+   */
+  static void writeJson(std::string & out, bool indent, SGPropertyNode_ptr n, int depth, double timestamp = -1.0 );
+  static void writeJson(std::string & out, bool indent, const Snapshot & snapshot, double timestamp = -1.0 );
+
   static std::string toJsonString(bool indent, SGPropertyNode_ptr n, int depth, double timestamp = -1.0 );
+  static std::string toJsonString(bool indent, const Snapshot & snapshot, double timestamp = -1.0 );
 
   static const char * getPropertyTypeString(simgear::props::Type type);
   static cJSON * valueToJson(SGPropertyNode_ptr n);
@@ -110,6 +110,25 @@ public:
    */
   virtual bool poll( Connection * connection ) { return false; }
 
+  /**
+   * If the httpd runs on its own thread, all methods of a handler get called
+   * on the main loop unless this returns true for a request. Then only
+   * prepareRequest() is, and handleRequest() and poll() are called on the
+   * httpd thread and must not touch the simulator state.
+   * @param request @see handleRequest()
+   * @return true if handleRequest() can answer the request from what
+   * prepareRequest() copied
+   */
+  virtual bool isThreadSafe( const HTTPRequest & request ) const { return false; }
+
+  /**
+   * Called on the main loop for requests isThreadSafe() returned true for,
+   * copies what handleRequest() needs into the connection data.
+   * @param request @see handleRequest()
+   * @param connection @see handleRequest()
+   */
+  virtual void prepareRequest( const HTTPRequest & request, Connection * connection ) {}
+
   /**
    * Getter for the URI this handler serves
    *
@@ -0,0 +1,182 @@
+// shm_fdm.hxx -- defines a shared memory interface to an external flight
+//                dynamics model running on the same host
+//
+// This file is in the Public Domain, and comes with no warranty.
+//
+// $Id$
+
+
+#ifndef _SHM_FDM_HXX
+#define _SHM_FDM_HXX
+
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#ifdef __linux__
+#  include <linux/futex.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#  include <time.h>
+#endif
+
+#include "net_ctrls.hxx"
+#include "net_fdm.hxx"
+
+// NOTE: this file defines an external interface.  FlightGear creates a
+// POSIX shared memory object (shm_open()) holding one FGShmFDMSegment and
+// sets the magic number once the segment is initialized.  The external
+// FDM opens the same object, waits for the magic number and checks the
+// version.
+//
+// Each frame FlightGear pushes zero or more FG_SHM_COMMAND messages and
+// then one FG_SHM_CTRLS message onto the controls ring.  The commands are
+// the "name=value" commands of the binary pipe protocol (longitude-deg,
+// latitude-deg, altitude-ft, ground-m, speed-kts, heading-deg,
+// aircraft-weight-lbs, aircraft-cg-offset-inches, reset=ground|air).  The
+// FDM answers each FG_SHM_CTRLS message by running the given number of
+// iterations and pushing one FGNetFDM onto the state ring.
+//
+// All values are in host byte order.  Both sides must use the same
+// compiler ABI, the rings use std::atomic<uint32_t> which must be lock
+// free.
+
+const uint32_t FG_SHM_FDM_MAGIC = 0x4d444653; // "SFDM"
+const uint32_t FG_SHM_FDM_VERSION = 1;
+
+
+class FGShmFDMMessage {
+
+public:
+
+    enum {
+        FG_SHM_COMMAND = 1,
+        FG_SHM_CTRLS = 2
+    };
+
+    uint32_t type;
+    int32_t iterations;         // FG_SHM_CTRLS: FDM iterations to run
+    char command[256];          // FG_SHM_COMMAND: nul terminated
+    FGNetCtrls ctrls;           // FG_SHM_CTRLS
+};
+
+
+// A lock-free ring for one producer and one consumer, which may be in
+// different processes.  N must be a power of two.
+//
+// A consumer waiting in wait() first spins, which gives the lowest
+// latency, and then blocks: in a futex on Linux, woken by push() only if
+// the consumer announced that it is blocked, else in short sleeps.
+
+template <class T, uint32_t N>
+class FGShmRing {
+
+public:
+
+    void init() {
+        head.store(0);
+        tail.store(0);
+        blocked.store(0);
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) ==
+               tail.load(std::memory_order_relaxed);
+    }
+
+    // Producer only. Returns false if the ring is full.
+    bool push(const T& item) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == N)
+            return false;
+        slots[h % N] = item;
+        head.store(h + 1);      // sequentially consistent, see wait()
+        if (blocked.load())
+            wake();
+        return true;
+    }
+
+    // Consumer only. Returns false if the ring is empty.
+    bool pop(T& item) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+            return false;
+        item = slots[t % N];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Wait until the ring is not empty, spinning for at
+    // most spin_usec. Returns false on timeout.
+    bool wait(long spin_usec, long timeout_usec) {
+        using namespace std::chrono;
+        steady_clock::time_point start = steady_clock::now();
+        for (;;) {
+            uint32_t h = head.load(std::memory_order_acquire);
+            if (h != tail.load(std::memory_order_relaxed))
+                return true;
+
+            long elapsed = duration_cast<microseconds>(steady_clock::now() - start).count();
+            if (elapsed >= timeout_usec)
+                return false;
+            if (elapsed < spin_usec)
+                continue;
+
+            // Announce before the last check, push() stores head before
+            // it checks blocked, so one of us sees the other.
+            blocked.store(1);
+            if (head.load() == h)
+                block(h, timeout_usec - elapsed);
+            blocked.store(0);
+        }
+    }
+
+private:
+
+#ifdef __linux__
+    int *futex_word() { return reinterpret_cast<int *>(&head); }
+
+    void wake() {
+        syscall(SYS_futex, futex_word(), FUTEX_WAKE, 1, NULL, NULL, 0);
+    }
+
+    void block(uint32_t h, long usec) {
+        struct timespec ts;
+        ts.tv_sec = usec / 1000000;
+        ts.tv_nsec = (usec % 1000000) * 1000;
+        syscall(SYS_futex, futex_word(), FUTEX_WAIT, (int)h, &ts, NULL, 0);
+    }
+#else
+    void wake() {}
+
+    void block(uint32_t, long usec) {
+        std::this_thread::sleep_for(std::chrono::microseconds(usec < 100 ? usec : 100));
+    }
+#endif
+
+    static_assert((N & (N - 1)) == 0, "ring size must be a power of two");
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(int),
+                  "futex word must be an int");
+
+    // on separate cache lines, written by the producer resp. consumer
+    alignas(64) std::atomic<uint32_t> head;
+    alignas(64) std::atomic<uint32_t> tail;
+    std::atomic<uint32_t> blocked;
+    alignas(64) T slots[N];
+};
+
+
+class FGShmFDMSegment {
+
+public:
+
+    std::atomic<uint32_t> magic;                // FG_SHM_FDM_MAGIC when ready
+    uint32_t version;                           // FG_SHM_FDM_VERSION
+
+    FGShmRing<FGShmFDMMessage, 64> ctrls;       // FlightGear -> FDM
+    FGShmRing<FGNetFDM, 8> fdm;                 // FDM -> FlightGear
+};
+
+
+#endif // _SHM_FDM_HXX
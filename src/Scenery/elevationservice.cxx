@@ -0,0 +1,322 @@
+// elevationservice.cxx -- batched terrain elevation queries
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/threads/SGGuard.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include "elevationservice.hxx"
+#include "terrain.hxx"
+
+// cached hits older than this are dropped, so newly loaded tiles show up
+static const double CACHE_LIFETIME_SEC = 5.0;
+// cache resolution, 1e-5 degrees are about a meter
+static const double CACHE_STEPS_PER_DEG = 1e5;
+// jobs handed to a thread at a time
+static const size_t JOB_CHUNK_SIZE = 16;
+
+class FGElevationService::Worker : public SGThread
+{
+public:
+    Worker(FGElevationService* service) :
+        _service(service),
+        _seen(service->_generation)
+    {
+    }
+
+    virtual void run()
+    {
+        unsigned seen = _seen;
+        for (;;) {
+            {
+                SGGuard<SGMutex> lock(_service->_mutex);
+                while (!_service->_stop && _service->_generation == seen)
+                    _service->_startCondition.wait(_service->_mutex);
+                if (_service->_stop)
+                    return;
+                seen = _service->_generation;
+            }
+
+            _service->work();
+
+            SGGuard<SGMutex> lock(_service->_mutex);
+            if (--_service->_busy == 0)
+                _service->_doneCondition.signal();
+        }
+    }
+
+private:
+    FGElevationService* _service;
+    unsigned _seen; // last batch before this worker started
+};
+
+FGElevationService::FGElevationService() :
+    _cacheSize(4096),
+    _queryTimeSec(0.0),
+    _terrain(0),
+    _nextJob(0),
+    _generation(0),
+    _busy(0),
+    _stop(false),
+    _numThreads(0)
+{
+}
+
+FGElevationService::~FGElevationService()
+{
+    stopWorkers();
+}
+
+void
+FGElevationService::setNumThreads(int numThreads)
+{
+    if (numThreads != _numThreads)
+        stopWorkers();
+    _numThreads = numThreads;
+}
+
+void
+FGElevationService::setCacheSize(size_t size)
+{
+    _cacheSize = size;
+    while (_cache.size() > _cacheSize) {
+        _cacheIndex.erase(_cache.back().key);
+        _cache.pop_back();
+    }
+}
+
+void
+FGElevationService::clearCache()
+{
+    _cache.clear();
+    _cacheIndex.clear();
+}
+
+FGElevationService::RequestRef
+FGElevationService::query(const std::vector<SGGeod>& points,
+                          const Callback& callback)
+{
+    RequestRef request = new Request;
+    request->_points = points;
+    request->_callback = callback;
+    request->_done = false;
+
+    SGGuard<SGMutex> lock(_pendingMutex);
+    _pending.push_back(request);
+    return request;
+}
+
+FGElevationService::CacheKey
+FGElevationService::cacheKey(const SGGeod& pos)
+{
+    CacheKey lat = (CacheKey) std::floor((pos.getLatitudeDeg() + 90.0) * CACHE_STEPS_PER_DEG + 0.5);
+    CacheKey lon = (CacheKey) std::floor((pos.getLongitudeDeg() + 180.0) * CACHE_STEPS_PER_DEG + 0.5);
+    return (lat << 32) | lon;
+}
+
+bool
+FGElevationService::lookup(const SGGeod& pos, double now, Result& result)
+{
+    auto it = _cacheIndex.find(cacheKey(pos));
+    if (it == _cacheIndex.end())
+        return false;
+
+    CacheList::iterator entry = it->second;
+    if (now - entry->timeStamp > CACHE_LIFETIME_SEC) {
+        _cache.erase(entry);
+        _cacheIndex.erase(it);
+        return false;
+    }
+
+    // the cached query found nothing between its start and the hit, so the
+    // answer holds for any start in between
+    double startM = pos.getElevationM();
+    if (startM < entry->result.elevationM || startM > entry->startM)
+        return false;
+
+    _cache.splice(_cache.begin(), _cache, entry);
+    result = entry->result;
+    return true;
+}
+
+void
+FGElevationService::insert(const SGGeod& pos, double now, const Result& result)
+{
+    if (_cacheSize == 0)
+        return;
+
+    CacheKey key = cacheKey(pos);
+    auto it = _cacheIndex.find(key);
+    if (it != _cacheIndex.end()) {
+        _cache.erase(it->second);
+        _cacheIndex.erase(it);
+    }
+
+    CacheEntry entry;
+    entry.key = key;
+    entry.startM = pos.getElevationM();
+    entry.timeStamp = now;
+    entry.result = result;
+    _cache.push_front(entry);
+    _cacheIndex[key] = _cache.begin();
+
+    if (_cache.size() > _cacheSize) {
+        _cacheIndex.erase(_cache.back().key);
+        _cache.pop_back();
+    }
+}
+
+void
+FGElevationService::process(FGTerrain* terrain)
+{
+    {
+        SGGuard<SGMutex> lock(_pendingMutex);
+        _active.swap(_pending);
+    }
+    if (_active.empty())
+        return;
+
+    const double now = SGTimeStamp::now().toSecs();
+
+    // answer what we can from the cache, collect the rest
+    _jobs.clear();
+    for (const RequestRef& request : _active) {
+        request->_results.resize(request->_points.size());
+        for (size_t i = 0; i < request->_points.size(); ++i) {
+            if (!lookup(request->_points[i], now, request->_results[i]))
+                _jobs.push_back(Job{request.get(), i});
+        }
+    }
+
+    if (!_jobs.empty()) {
+        SGTimeStamp start = SGTimeStamp::now();
+        _terrain = terrain;
+        _nextJob = 0;
+
+        // not worth waking up the workers for a few points
+        if (_jobs.size() > JOB_CHUNK_SIZE) {
+            startWorkers();
+            SGGuard<SGMutex> lock(_mutex);
+            _busy = _workers.size();
+            ++_generation;
+            _startCondition.broadcast();
+        }
+
+        work();
+
+        {
+            SGGuard<SGMutex> lock(_mutex);
+            while (_busy > 0)
+                _doneCondition.wait(_mutex);
+        }
+        _terrain = 0;
+
+        // smooth over a few batches
+        double queryTimeSec = (SGTimeStamp::now() - start).toSecs() / _jobs.size();
+        _queryTimeSec = (_queryTimeSec > 0.0)
+            ? 0.8 * _queryTimeSec + 0.2 * queryTimeSec
+            : queryTimeSec;
+
+        for (const Job& job : _jobs) {
+            const Result& result = job.request->_results[job.index];
+            if (result.valid)
+                insert(job.request->_points[job.index], now, result);
+        }
+        _jobs.clear();
+    }
+
+    // callbacks may queue new requests, these are answered next time
+    std::vector<RequestRef> done;
+    done.swap(_active);
+    for (const RequestRef& request : done) {
+        request->_done = true;
+        if (request->_callback)
+            request->_callback(*request);
+    }
+}
+
+void
+FGElevationService::work()
+{
+    for (;;) {
+        size_t begin = _nextJob.fetch_add(JOB_CHUNK_SIZE);
+        if (begin >= _jobs.size())
+            return;
+        size_t end = std::min(begin + JOB_CHUNK_SIZE, _jobs.size());
+        for (size_t i = begin; i < end; ++i) {
+            const Job& job = _jobs[i];
+            Result& result = job.request->_results[job.index];
+            result.material = 0;
+            result.elevationM = 0.0;
+            result.valid = _terrain->get_elevation_m(job.request->_points[job.index],
+                                                     result.elevationM,
+                                                     &result.material);
+        }
+    }
+}
+
+void
+FGElevationService::startWorkers()
+{
+    if (!_workers.empty())
+        return;
+
+    int numThreads = _numThreads;
+    if (numThreads <= 0)
+        numThreads = std::max<int>(std::thread::hardware_concurrency(), 1) - 1;
+
+    SG_LOG(SG_TERRAIN, SG_INFO, "FGElevationService: using " << numThreads
+           << " worker threads");
+    _stop = false;
+    for (int i = 0; i < numThreads; ++i) {
+        Worker* worker = new Worker(this);
+        worker->start();
+        _workers.push_back(worker);
+    }
+}
+
+void
+FGElevationService::stopWorkers()
+{
+    {
+        SGGuard<SGMutex> lock(_mutex);
+        _stop = true;
+        _startCondition.broadcast();
+    }
+    for (Worker* worker : _workers) {
+        worker->join();
+        delete worker;
+    }
+    _workers.clear();
+}
+
+void
+FGElevationService::shutdown()
+{
+    stopWorkers();
+    clearCache();
+
+    SGGuard<SGMutex> lock(_pendingMutex);
+    _pending.clear();
+}
@@ -0,0 +1,165 @@
+// elevationservice.hxx -- batched terrain elevation queries
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifndef _ELEVATIONSERVICE_HXX
+#define _ELEVATIONSERVICE_HXX
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include <simgear/math/SGMath.hxx>
+#include <simgear/structure/SGReferenced.hxx>
+#include <simgear/structure/SGSharedPtr.hxx>
+#include <simgear/threads/SGThread.hxx>
+
+namespace simgear {
+class BVHMaterial;
+}
+
+class FGTerrain;
+
+/**
+ * Answers batches of terrain elevation queries.
+ *
+ * Callers queue a batch of points with query() at any time. All queued
+ * batches are answered together in process(), which FGScenery calls once
+ * per frame while nothing else touches the terrain scene graph; the
+ * intersections are spread over a few worker threads with the main thread
+ * helping out. Completion is signalled through the returned request
+ * (polling) and/or a callback which runs on the main thread.
+ *
+ * Hits are kept in a small LRU cache keyed by latitude/longitude (about
+ * one meter resolution) for a few seconds, so points probed repeatedly -
+ * stationary AI objects, ridge lift probes of a slow aircraft - don't cost
+ * a new intersection each frame.
+ */
+class FGElevationService
+{
+public:
+    struct Result
+    {
+        bool valid;             ///< false if no scenery was hit
+        double elevationM;
+        const simgear::BVHMaterial* material;
+    };
+    typedef std::vector<Result> ResultList;
+
+    class Request;
+    typedef SGSharedPtr<Request> RequestRef;
+    typedef std::function<void(const Request&)> Callback;
+
+    /// A batch of points. The elevation of each point is the altitude to
+    /// search down from, as with FGScenery::get_elevation_m().
+    class Request : public SGReferenced
+    {
+    public:
+        bool isDone() const { return _done; }
+        const std::vector<SGGeod>& getPoints() const { return _points; }
+        /// Only valid once isDone() returns true, one result per point.
+        const ResultList& getResults() const { return _results; }
+
+    private:
+        friend class FGElevationService;
+
+        std::vector<SGGeod> _points;
+        ResultList _results;
+        Callback _callback;
+        bool _done;
+    };
+
+    FGElevationService();
+    ~FGElevationService();
+
+    /// Number of worker threads besides the main thread, 0 for one less
+    /// than the number of cores. Takes effect with the next batch.
+    void setNumThreads(int numThreads);
+    /// Maximum number of cached results, 0 disables the cache.
+    void setCacheSize(size_t size);
+    void clearCache();
+
+    /// Average wall clock time per point of recent batches, 0 before the
+    /// first batch. Lets callers size their batches to a time budget.
+    double getQueryTimeSec() const { return _queryTimeSec; }
+
+    /// Queue a batch of points. The callback, if any, runs on the main
+    /// thread once the results are available.
+    RequestRef query(const std::vector<SGGeod>& points,
+                     const Callback& callback = Callback());
+
+    /// Answer all queued requests. Must only be called from the main
+    /// thread while the terrain isn't modified.
+    void process(FGTerrain* terrain);
+
+    /// Stop the worker threads and drop all pending requests.
+    void shutdown();
+
+private:
+    class Worker;
+
+    typedef unsigned long long CacheKey;
+    struct CacheEntry
+    {
+        CacheKey key;
+        double startM;      // elevation the query started from
+        double timeStamp;
+        Result result;
+    };
+    typedef std::list<CacheEntry> CacheList;
+
+    struct Job
+    {
+        Request* request;
+        size_t index;
+    };
+
+    static CacheKey cacheKey(const SGGeod& pos);
+    bool lookup(const SGGeod& pos, double now, Result& result);
+    void insert(const SGGeod& pos, double now, const Result& result);
+
+    void startWorkers();
+    void stopWorkers();
+    void work();
+
+    SGMutex _pendingMutex;
+    std::vector<RequestRef> _pending;
+    std::vector<RequestRef> _active;
+
+    // least recently used last
+    CacheList _cache;
+    std::unordered_map<CacheKey, CacheList::iterator> _cacheIndex;
+    size_t _cacheSize;
+
+    double _queryTimeSec;
+
+    // the current batch, shared with the workers
+    FGTerrain* _terrain;
+    std::vector<Job> _jobs;
+    std::atomic<size_t> _nextJob;
+
+    SGMutex _mutex;
+    SGWaitCondition _startCondition;
+    SGWaitCondition _doneCondition;
+    unsigned _generation; // guarded by _mutex
+    unsigned _busy;       // guarded by _mutex
+    bool _stop;           // guarded by _mutex
+    int _numThreads;
+    std::vector<Worker*> _workers;
+};
+
+#endif // _ELEVATIONSERVICE_HXX
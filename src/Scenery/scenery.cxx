@@ -363,6 +363,10 @@ void FGScenery::init() {
     }
     _terrain->init( terrain_branch.get() );
 
+    SGPropertyNode* elevationNode = fgGetNode("/sim/scenery/elevation-queries", true);
+    _elevationService.setNumThreads(elevationNode->getIntValue("threads", 0));
+    _elevationService.setCacheSize(elevationNode->getIntValue("cache-size", 4096));
+
     _listener = new ScenerySwitchListener(this);
 
     // Toggle the setup flag.
@@ -376,6 +380,7 @@ void FGScenery::reinit()
 
 void FGScenery::shutdown()
 {
+    _elevationService.shutdown();
     _terrain->shutdown();
     
     scene_graph = NULL;
@@ -392,6 +397,12 @@ void FGScenery::shutdown()
 
 void FGScenery::update(double dt)
 {    
+    // answer the queued elevation queries before the tile manager changes
+    // the terrain. Bring the bounding spheres up to date first, the worker
+    // threads must only read the scene graph.
+    terrain_branch->getBound();
+    _elevationService.process(_terrain);
+
     _terrain->update(dt);
 }
 
@@ -428,6 +439,13 @@ FGScenery::get_cart_ground_intersection(const SGVec3d& pos, const SGVec3d& dir,
     return _terrain->get_cart_ground_intersection( pos, dir, nearestHit, butNotFrom );
 }
 
+FGElevationService::RequestRef
+FGScenery::get_elevations_m(const std::vector<SGGeod>& points,
+                            const FGElevationService::Callback& callback)
+{
+    return _elevationService.query(points, callback);
+}
+
 bool FGScenery::scenery_available(const SGGeod& position, double range_m)
 {
     return _terrain->scenery_available( position, range_m );
@@ -440,6 +458,8 @@ bool FGScenery::schedule_scenery(const SGGeod& position, double range_m, double
     
 void FGScenery::materialLibChanged()
 {
+    // cached results point to materials of the old library
+    _elevationService.clearCache();
     _terrain->materialLibChanged();
 }
 
@@ -39,6 +39,7 @@
 
 #include "SceneryPager.hxx"
 #include "terrain.hxx"
+#include "elevationservice.hxx"
 
 namespace simgear {
 class BVHMaterial;
@@ -116,6 +117,19 @@ public:
                                       SGVec3d& nearestHit,
                                       const osg::Node* butNotFrom = 0);
 
+    /// Queue elevation queries for a batch of points, with the same meaning
+    /// as get_elevation_m(). They are answered on worker threads during the
+    /// next update(), the callback then runs on the main thread.
+    FGElevationService::RequestRef
+    get_elevations_m(const std::vector<SGGeod>& points,
+                     const FGElevationService::Callback& callback =
+                         FGElevationService::Callback());
+
+    /// Average time get_elevations_m() needs per point, in seconds of the
+    /// main thread's update. 0 until the first batch was answered.
+    double get_elevation_query_time_sec() const
+    { return _elevationService.getQueryTimeSec(); }
+
     osg::Group *get_scene_graph () const { return scene_graph.get(); }
     osg::Group *get_terrain_branch () const { return terrain_branch.get(); }
     osg::Group *get_models_branch () const { return models_branch.get(); }
@@ -146,6 +160,9 @@ private:
     // the terrain engine
     FGTerrain* _terrain;
 
+    // batched elevation queries
+    FGElevationService _elevationService;
+
     // The state of the scene graph.    
     bool _inited;
 };
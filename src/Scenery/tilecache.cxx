@@ -157,6 +157,9 @@ void TileCache::clear_current_view()
             // update expiry time for tiles belonging to most recent position
             e->update_time_expired( current_time );
             e->set_current_view( false );
+            // the next request sets the priority for the new position, so
+            // tiles now behind the aircraft can drop in priority
+            e->set_priority( -FLT_MAX );
         }
     }
 }
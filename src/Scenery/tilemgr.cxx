@@ -55,6 +55,17 @@
 
 using flightgear::SceneryPager;
 
+// below this ground speed the tile ring around the viewer is good enough
+static const double PREDICTION_MIN_SPEED_MPS = 50.0;
+// ...and above it we most likely switched views or repositioned
+static const double PREDICTION_MAX_SPEED_MPS = 3000.0;
+// how often the projected path is scheduled
+static const double PREDICTION_INTERVAL_SEC = 1.0;
+// predicted requests are kept this much longer than the lookahead
+static const double PREDICTION_KEEP_SEC = 10.0;
+// tiles behind the viewer load as if they were this much farther away
+static const double BEHIND_PRIORITY_FACTOR = 4.0;
+
 class FGTileMgr::TileManagerListener : public SGPropertyChangeListener
 {
 public:
@@ -121,8 +132,19 @@ FGTileMgr::FGTileMgr():
     _scenery_loaded(fgGetNode("/sim/sceneryloaded", true)),
     _scenery_override(fgGetNode("/sim/sceneryloaded-override", true)),
     _pager(FGScenery::getPagerSingleton()),
+    _predictionLookahead(fgGetNode("/sim/rendering/tile-prediction/lookahead-sec", true)),
+    _lastViewPosition(SGVec3d::zeros()),
+    _viewVelocity(SGVec3d::zeros()),
+    _haveViewPosition(false),
+    _predictionTimer(0.0),
+    _statBucketChanges(fgGetNode("/sim/rendering/tile-prediction/stats/bucket-changes", true)),
+    _statTileMisses(fgGetNode("/sim/rendering/tile-prediction/stats/tile-misses", true)),
+    _statPredictedHits(fgGetNode("/sim/rendering/tile-prediction/stats/predicted-hits", true)),
+    _statMissingFrames(fgGetNode("/sim/rendering/tile-prediction/stats/missing-tile-frames", true)),
     _enableCache(true)
 {
+    if (_predictionLookahead->getType() == simgear::props::NONE)
+        _predictionLookahead->setDoubleValue(60.0);
 }
 
 
@@ -229,6 +251,11 @@ void FGTileMgr::reinit()
     current_bucket.make_bad();
     scheduled_visibility = 100.0;
 
+    _haveViewPosition = false;
+    _viewVelocity = SGVec3d::zeros();
+    _predictionTimer = 0.0;
+    _predictedTiles.clear();
+
     // force an update now
     update(0.0);
 }
@@ -332,7 +359,7 @@ void FGTileMgr::schedule_needed(const SGBucket& curr_bucket, double vis)
                 continue;
             }
             
-            float priority = (-1.0) * (x*x+y*y);
+            float priority = (-1.0) * (x*x+y*y) * direction_factor(curr_bucket, x, y);
             sched_tile( b, priority, true, 0.0 );
             
             if (_terra_sync) {
@@ -433,10 +460,21 @@ void FGTileMgr::update_queues(bool& isDownloadingScenery)
 // given the current lon/lat (in degrees), fill in the array of local
 // chunks.  If the chunk isn't already in the cache, then read it from
 // disk.
-void FGTileMgr::update(double)
+void FGTileMgr::update(double dt)
 {
     double vis = _visibilityMeters->getDoubleValue();
-    schedule_tiles_at(globals->get_view_position(), vis);
+    SGGeod viewPosition = globals->get_view_position();
+    update_velocity(viewPosition, dt);
+    schedule_tiles_at(viewPosition, vis);
+
+    if (state == Running) {
+        _predictionTimer -= dt;
+        if (_predictionTimer <= 0.0) {
+            _predictionTimer = PREDICTION_INTERVAL_SEC;
+            schedule_predicted(viewPosition);
+        }
+        update_statistics();
+    }
 
     bool waitingOnTerrasync = false;
     update_queues(waitingOnTerrasync);
@@ -498,6 +536,16 @@ void FGTileMgr::schedule_tiles_at(const SGGeod& location, double range_m)
             SG_LOG( SG_TERRAIN, SG_DEBUG, "State == Running" );
         }
         if (current_bucket != previous_bucket) {
+            if (previous_bucket.isValid()) {
+                // record whether the tile we just entered was there in time
+                TileEntry* t = tile_cache.get_tile(current_bucket);
+                _statBucketChanges->setIntValue(_statBucketChanges->getIntValue() + 1);
+                if (!t || !t->is_loaded())
+                    _statTileMisses->setIntValue(_statTileMisses->getIntValue() + 1);
+                if (_predictedTiles.count(current_bucket.gen_index()))
+                    _statPredictedHits->setIntValue(_statPredictedHits->getIntValue() + 1);
+            }
+
             // We've moved to a new bucket, we need to schedule any
             // needed tiles for loading.
             SG_LOG( SG_TERRAIN, SG_INFO, "FGTileMgr: at " << location << ", scheduling needed for:" << current_bucket
@@ -517,6 +565,106 @@ void FGTileMgr::schedule_tiles_at(const SGGeod& location, double range_m)
     last_state = state;
 }
 
+void FGTileMgr::update_velocity(const SGGeod& location, double dt)
+{
+    SGVec3d position = SGVec3d::fromGeod(location);
+    if (!_haveViewPosition || dt <= 0.0) {
+        _lastViewPosition = position;
+        _haveViewPosition = true;
+        return;
+    }
+
+    SGVec3d velocity = (position - _lastViewPosition) / dt;
+    _lastViewPosition = position;
+
+    if (norm(velocity) > PREDICTION_MAX_SPEED_MPS) {
+        // view change or reposition, start over
+        _viewVelocity = SGVec3d::zeros();
+        return;
+    }
+
+    // smooth over about a second, frame times are noisy
+    double alpha = std::min(dt, 1.0);
+    _viewVelocity = (1.0 - alpha) * _viewVelocity + alpha * velocity;
+}
+
+/* Scale factor for the distance-based priority of tile (x, y) of the ring
+ * around curr_bucket: tiles behind a fast moving viewer are needed last. */
+double FGTileMgr::direction_factor(const SGBucket& curr_bucket, int x, int y) const
+{
+    if (_predictionLookahead->getDoubleValue() <= 0.0 ||
+        norm(_viewVelocity) < PREDICTION_MIN_SPEED_MPS)
+        return 1.0;
+
+    // velocity in the local horizontal frame, x is north, y is east
+    SGQuatd hlOr = SGQuatd::fromLonLat(curr_bucket.get_center());
+    SGVec3d localVelocity = hlOr.transform(_viewVelocity);
+    double east = localVelocity.y() / curr_bucket.get_width_m();
+    double north = localVelocity.x() / curr_bucket.get_height_m();
+
+    return (x * east + y * north < 0.0) ? BEHIND_PRIORITY_FACTOR : 1.0;
+}
+
+/* Schedule the tiles along the straight projection of the viewer's path
+ * for the next lookahead-sec seconds, plus one tile on each side so gentle
+ * turns are covered. Tiles are prioritized by the time until the viewer
+ * reaches them, on the same scale the ring around the viewer uses, and
+ * requested long enough to still be there when the viewer arrives. */
+void FGTileMgr::schedule_predicted(const SGGeod& location)
+{
+    _predictedTiles.clear();
+
+    double lookahead = _predictionLookahead->getDoubleValue();
+    double speed = norm(_viewVelocity);
+    if (lookahead <= 0.0 || speed < PREDICTION_MIN_SPEED_MPS || !current_bucket.isValid())
+        return;
+
+    double tile_size = std::min(current_bucket.get_width_m(), current_bucket.get_height_m());
+    if (tile_size <= 0.0)
+        return;
+
+    SGVec3d start = SGVec3d::fromGeod(location);
+    SGVec3d direction = _viewVelocity / speed;
+    double pathLength = speed * lookahead;
+    double step = 0.5 * tile_size;
+
+    for (double distance = step; distance <= pathLength; distance += step) {
+        SGGeod point = SGGeod::fromCart(start + distance * direction);
+        SGBucket center(point);
+        if (!center.isValid())
+            continue;
+
+        // ahead of the ring around the viewer, compare the distance in tiles
+        float priority = (-1.0) * (distance / tile_size) * (distance / tile_size);
+        for (int x = -1; x <= 1; ++x) {
+            for (int y = -1; y <= 1; ++y) {
+                SGBucket b = center.sibling(x, y);
+                if (!b.isValid() || !_predictedTiles.insert(b.gen_index()).second)
+                    continue;
+
+                double duration = distance / speed + PREDICTION_KEEP_SEC;
+                sched_tile(b, priority - (x*x + y*y), false, duration);
+                if (_terra_sync) {
+                    _terra_sync->scheduleTile(b);
+                }
+            }
+        }
+    }
+
+    SG_LOG(SG_TERRAIN, SG_DEBUG, "FGTileMgr: predicted " << _predictedTiles.size()
+           << " tiles along " << pathLength << "m of path");
+}
+
+void FGTileMgr::update_statistics()
+{
+    if (!_scenery_loaded->getBoolValue() || !current_bucket.isValid())
+        return;
+
+    TileEntry* t = tile_cache.get_tile(current_bucket);
+    if (!t || !t->is_loaded())
+        _statMissingFrames->setIntValue(_statMissingFrames->getIntValue() + 1);
+}
+
 /** Schedules scenery for given position. Load request remains valid for given duration
  * (duration=0.0 => nothing is loaded).
  * Used for FDM/AI/groundcache/... requests. Viewer uses "schedule_tiles_at" instead.
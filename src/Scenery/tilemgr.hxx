@@ -26,7 +26,10 @@
 
 #include <simgear/compiler.h>
 
+#include <set>
+
 #include <simgear/bucket/newbucket.hxx>
+#include <simgear/math/SGMath.hxx>
 #include "SceneryPager.hxx"
 #include "tilecache.hxx"
 
@@ -85,12 +88,36 @@ private:
     // schedule tiles for the viewer bucket
     void schedule_tiles_at(const SGGeod& location, double rangeM);
 
+    // estimate the viewer velocity from its movement
+    void update_velocity(const SGGeod& location, double dt);
+
+    // schedule tiles along the projected path of the viewer
+    void schedule_predicted(const SGGeod& location);
+
+    // track whether the tile below the viewer was there in time
+    void update_statistics();
+
+    // priority factor for tiles behind the viewer, see schedule_needed()
+    double direction_factor(const SGBucket& curr_bucket, int x, int y) const;
+
     SGPropertyNode_ptr _visibilityMeters;
     SGPropertyNode_ptr _maxTileRangeM, _disableNasalHooks;
     SGPropertyNode_ptr _scenery_loaded, _scenery_override;
 
     osg::ref_ptr<flightgear::SceneryPager> _pager;
 
+    // path prediction
+    SGPropertyNode_ptr _predictionLookahead;
+    SGVec3d _lastViewPosition;     // cartesian
+    SGVec3d _viewVelocity;         // cartesian, meters per second, smoothed
+    bool _haveViewPosition;
+    double _predictionTimer;
+    std::set<long> _predictedTiles; // tile indices of the last prediction
+
+    // statistics
+    SGPropertyNode_ptr _statBucketChanges, _statTileMisses,
+                       _statPredictedHits, _statMissingFrames;
+
     /// is caching of expired tiles enabled or not?
     bool _enableCache;    
 public:
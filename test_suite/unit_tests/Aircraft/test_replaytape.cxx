@@ -0,0 +1,311 @@
+#include "test_replaytape.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <simgear/props/props.hxx>
+
+#include <Aircraft/replay.hxx>
+#include <Aircraft/replaytape.hxx>
+
+
+// Records carry the sim time followed by three payload values.
+static const size_t RecordSize = 4*sizeof(double);
+static const int RecordCount = 1000;
+static const double RecordInterval = 0.1;
+
+static std::vector<double> makeRecord(int i)
+{
+    std::vector<double> record(4);
+    record[0] = i*RecordInterval;
+    record[1] = i;
+    record[2] = sin(0.01*i);
+    record[3] = -2.0*i;
+    return record;
+}
+
+static bool sameRecord(const FGReplayData* pRecord, int i)
+{
+    std::vector<double> expected = makeRecord(i);
+    return 0 == memcmp(pRecord, &expected[0], RecordSize);
+}
+
+static SGPropertyNode_ptr makeMetaData()
+{
+    SGPropertyNode_ptr meta = new SGPropertyNode;
+    meta->setStringValue("meta/aircraft-type", "c172p");
+    meta->setDoubleValue("meta/tape-duration", (RecordCount-1)*RecordInterval);
+    return meta;
+}
+
+static SGPropertyNode_ptr makeConfig()
+{
+    SGPropertyNode_ptr config = new SGPropertyNode;
+    config->setIntValue("signals/signal-count", 3);
+    return config;
+}
+
+// Write a tape with a 10s block duration. The tape is left open (and
+// thus unindexed) when close is false.
+static void writeTape(const SGPath& path, FGReplayTapeWriter& writer, bool close)
+{
+    CPPUNIT_ASSERT(writer.open(path, makeMetaData(), makeConfig(), RecordSize));
+    for (int i=0; i<RecordCount; ++i) {
+        std::vector<double> record = makeRecord(i);
+        CPPUNIT_ASSERT(writer.append((const FGReplayData*) &record[0]));
+    }
+    if (close)
+        CPPUNIT_ASSERT(writer.close());
+    else
+        CPPUNIT_ASSERT(writer.flush());
+}
+
+// Stream 30s of records into 10s black box segments. Returns the
+// remaining segments, oldest first.
+static simgear::PathList streamSegments(const SGPath& directory, uint64_t maxDiskSize)
+{
+    FGReplayTapeStream stream(directory, "blackbox-", 10.0, 1.0, maxDiskSize);
+    CPPUNIT_ASSERT(stream.start(makeMetaData(), makeConfig(), RecordSize));
+    for (int i=0; i<300; ++i) {
+        std::vector<double> record = makeRecord(i);
+        CPPUNIT_ASSERT(stream.append((const FGReplayData*) &record[0]));
+    }
+    stream.stop();
+
+    // segment names end in the segment number of the session
+    simgear::PathList segments = simgear::Dir(directory).children(simgear::Dir::TYPE_FILE, ".fgtape");
+    std::sort(segments.begin(), segments.end(), [](const SGPath& a, const SGPath& b) {
+        return a.file().size() < b.file().size() ||
+               (a.file().size() == b.file().size() && a.file() < b.file());
+    });
+    return segments;
+}
+
+// Compares each visited record with the one written.
+struct RecordChecker
+{
+    int count = 0;
+    bool ok = true;
+
+    void operator()(const FGReplayData* pRecord)
+    {
+        ok = ok && sameRecord(pRecord, count);
+        count++;
+    }
+};
+
+
+// Set up function for each test.
+void ReplayTapeTests::setUp()
+{
+    _tempDir = simgear::Dir::tempDir("fgtest-replaytape");
+}
+
+
+// Clean up after each test.
+void ReplayTapeTests::tearDown()
+{
+    _tempDir.remove(true);
+}
+
+
+void ReplayTapeTests::testRoundTrip()
+{
+    SGPath path = _tempDir.file("roundtrip.fgtape");
+    FGReplayTapeWriter writer(10.0);
+    writeTape(path, writer, true);
+    CPPUNIT_ASSERT(ReplayTape::isIndexedTape(path));
+
+    // preview mode reads the meta data only
+    FGReplayTapeReader preview;
+    SGPropertyNode_ptr meta = new SGPropertyNode;
+    CPPUNIT_ASSERT(preview.open(path, meta, NULL));
+    CPPUNIT_ASSERT_EQUAL(std::string("c172p"), std::string(meta->getStringValue("meta/aircraft-type")));
+    CPPUNIT_ASSERT_EQUAL((size_t) 0, preview.getRecordCount());
+
+    FGReplayTapeReader reader;
+    SGPropertyNode_ptr config = new SGPropertyNode;
+    meta = new SGPropertyNode;
+    CPPUNIT_ASSERT(reader.open(path, meta, config));
+    CPPUNIT_ASSERT_EQUAL(std::string("c172p"), std::string(meta->getStringValue("meta/aircraft-type")));
+    CPPUNIT_ASSERT_EQUAL(3, config->getIntValue("signals/signal-count"));
+    CPPUNIT_ASSERT_EQUAL(RecordSize, reader.getRecordSize());
+    CPPUNIT_ASSERT_EQUAL((size_t) RecordCount, reader.getRecordCount());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.0, reader.getStartTime(), 1e-9);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL((RecordCount-1)*RecordInterval, reader.getEndTime(), 1e-9);
+
+    RecordChecker checker;
+    CPPUNIT_ASSERT(reader.forEachRecord(checker));
+    CPPUNIT_ASSERT(checker.ok);
+    CPPUNIT_ASSERT_EQUAL(RecordCount, checker.count);
+
+    // before the start and after the end of the tape
+    const FGReplayData* pNext = NULL;
+    const FGReplayData* pLast = NULL;
+    CPPUNIT_ASSERT(reader.getFrames(-1.0, pNext, pLast));
+    CPPUNIT_ASSERT(pLast == NULL);
+    CPPUNIT_ASSERT(sameRecord(pNext, 0));
+    CPPUNIT_ASSERT(reader.getFrames(1000.0, pNext, pLast));
+    CPPUNIT_ASSERT(pLast == NULL);
+    CPPUNIT_ASSERT(sameRecord(pNext, RecordCount-1));
+
+    // bracketing frames, within blocks and across block boundaries, in
+    // both directions to exercise the block cache
+    for (int pass=0; pass<2; ++pass) {
+        for (int j=1; j<RecordCount; j+=7) {
+            int i = (pass == 0) ? j : RecordCount - j;
+            double time = (i - 0.5)*RecordInterval;
+            CPPUNIT_ASSERT(reader.getFrames(time, pNext, pLast));
+            CPPUNIT_ASSERT(pLast != NULL);
+            CPPUNIT_ASSERT(sameRecord(pNext, i));
+            CPPUNIT_ASSERT(sameRecord(pLast, i-1));
+        }
+    }
+}
+
+
+void ReplayTapeTests::testUnindexedTape()
+{
+    // a tape that was never closed (e.g. after a crash) has no index
+    SGPath path = _tempDir.file("unindexed.fgtape");
+    FGReplayTapeWriter writer(10.0);
+    writeTape(path, writer, false);
+
+    FGReplayTapeReader reader;
+    SGPropertyNode_ptr meta = new SGPropertyNode;
+    SGPropertyNode_ptr config = new SGPropertyNode;
+    CPPUNIT_ASSERT(reader.open(path, meta, config));
+    CPPUNIT_ASSERT_EQUAL((size_t) RecordCount, reader.getRecordCount());
+
+    RecordChecker checker;
+    CPPUNIT_ASSERT(reader.forEachRecord(checker));
+    CPPUNIT_ASSERT(checker.ok);
+    CPPUNIT_ASSERT_EQUAL(RecordCount, checker.count);
+    writer.close();
+
+    // a truncated trailing block is dropped
+    std::vector<char> data;
+    {
+        std::ifstream input(path.local8BitStr(), std::ios::in | std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    }
+    SGPath truncated = _tempDir.file("truncated.fgtape");
+    {
+        std::ofstream output(truncated.local8BitStr(), std::ios::out | std::ios::binary);
+        output.write(&data[0], data.size()/2);
+    }
+
+    CPPUNIT_ASSERT(reader.open(truncated, meta, config));
+    size_t count = reader.getRecordCount();
+    CPPUNIT_ASSERT(count > 0);
+    CPPUNIT_ASSERT(count < (size_t) RecordCount);
+
+    checker = RecordChecker();
+    CPPUNIT_ASSERT(reader.forEachRecord(checker));
+    CPPUNIT_ASSERT(checker.ok);
+    CPPUNIT_ASSERT_EQUAL(count, (size_t) checker.count);
+}
+
+
+void ReplayTapeTests::testCorruptTape()
+{
+    SGPath path = _tempDir.file("corrupt.fgtape");
+    FGReplayTapeWriter writer(10.0);
+    writeTape(path, writer, true);
+
+    std::vector<char> data;
+    {
+        std::ifstream input(path.local8BitStr(), std::ios::in | std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    }
+
+    // find the first data block: magic, record count, start and end time,
+    // followed by the uncompressed and compressed chunk sizes
+    const char blockMagic[] = {'F', 'G', 'R', 'B'};
+    std::vector<char>::iterator block = std::search(data.begin(), data.end(),
+                                                    blockMagic, blockMagic + 4);
+    CPPUNIT_ASSERT(block != data.end());
+    size_t sizePos = (block - data.begin()) + 2*sizeof(uint32_t) + 2*sizeof(double);
+
+    const uint32_t hugeSizes[] = {0xfffffff0, 0x7fffffff};
+    for (int i=0; i<2; ++i) {
+        // claim a huge uncompressed or compressed block size
+        std::vector<char> corrupt = data;
+        memcpy(&corrupt[sizePos + i*sizeof(uint32_t)], &hugeSizes[i], sizeof(uint32_t));
+        {
+            std::ofstream output(path.local8BitStr(), std::ios::out | std::ios::binary | std::ios::trunc);
+            output.write(&corrupt[0], corrupt.size());
+        }
+
+        FGReplayTapeReader reader;
+        SGPropertyNode_ptr meta = new SGPropertyNode;
+        SGPropertyNode_ptr config = new SGPropertyNode;
+        CPPUNIT_ASSERT(reader.open(path, meta, config));
+
+        // the block must be rejected, rather than allocated
+        const FGReplayData* pNext = NULL;
+        const FGReplayData* pLast = NULL;
+        CPPUNIT_ASSERT(!reader.getFrames(0.0, pNext, pLast));
+        CPPUNIT_ASSERT(pNext == NULL);
+        RecordChecker checker;
+        CPPUNIT_ASSERT(!reader.forEachRecord(checker));
+    }
+
+    // an index claiming more entries than the file holds is ignored, and
+    // the blocks are scanned instead. The header holds the 40 byte magic,
+    // the version, the record size and the index offset.
+    std::vector<char> corrupt = data;
+    uint64_t indexOffset = 0;
+    memcpy(&indexOffset, &corrupt[40 + 2*sizeof(uint32_t)], sizeof(indexOffset));
+    CPPUNIT_ASSERT(indexOffset > 0);
+    CPPUNIT_ASSERT(indexOffset < corrupt.size());
+    const uint32_t hugeCount = 0x7fffffff;
+    memcpy(&corrupt[indexOffset + sizeof(uint32_t)], &hugeCount, sizeof(hugeCount));
+    {
+        std::ofstream output(path.local8BitStr(), std::ios::out | std::ios::binary | std::ios::trunc);
+        output.write(&corrupt[0], corrupt.size());
+    }
+
+    FGReplayTapeReader reader;
+    SGPropertyNode_ptr meta = new SGPropertyNode;
+    SGPropertyNode_ptr config = new SGPropertyNode;
+    CPPUNIT_ASSERT(reader.open(path, meta, config));
+    CPPUNIT_ASSERT_EQUAL((size_t) RecordCount, reader.getRecordCount());
+}
+
+
+void ReplayTapeTests::testStreamQuota()
+{
+    // without a quota, each 10s segment is kept
+    simgear::PathList segments = streamSegments(_tempDir.file("unlimited"), 1ull << 40);
+    CPPUNIT_ASSERT_EQUAL((size_t) 3, segments.size());
+
+    uint64_t totalSize = 0;
+    for (size_t i=0; i<segments.size(); ++i) {
+        FGReplayTapeReader reader;
+        SGPropertyNode_ptr meta = new SGPropertyNode;
+        SGPropertyNode_ptr config = new SGPropertyNode;
+        CPPUNIT_ASSERT(reader.open(segments[i], meta, config));
+        CPPUNIT_ASSERT_EQUAL((size_t) 100, reader.getRecordCount());
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(i*10.0, reader.getStartTime(), 1e-9);
+        totalSize += segments[i].sizeInBytes();
+    }
+
+    // a quota matching the segments exactly must not delete any of them
+    segments = streamSegments(_tempDir.file("exact"), totalSize);
+    CPPUNIT_ASSERT_EQUAL((size_t) 3, segments.size());
+
+    // one byte less drops the oldest segment
+    segments = streamSegments(_tempDir.file("exceeded"), totalSize - 1);
+    CPPUNIT_ASSERT_EQUAL((size_t) 2, segments.size());
+    for (size_t i=0; i<segments.size(); ++i) {
+        FGReplayTapeReader reader;
+        SGPropertyNode_ptr meta = new SGPropertyNode;
+        SGPropertyNode_ptr config = new SGPropertyNode;
+        CPPUNIT_ASSERT(reader.open(segments[i], meta, config));
+        CPPUNIT_ASSERT_DOUBLES_EQUAL((i+1)*10.0, reader.getStartTime(), 1e-9);
+    }
+}
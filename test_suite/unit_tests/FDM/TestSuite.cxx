@@ -17,8 +17,26 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "config.h"
+
+#include "test_groundcache.hxx"
 #include "test_ls_matrix.hxx"
+#ifdef ENABLE_JSBSIM
+#include "test_jsbsim_function.hxx"
+#include "test_jsbsim_table.hxx"
+#endif
+#ifdef ENABLE_YASIM
+#include "test_yasim_surfaceset.hxx"
+#endif
 
 
 // Set up the unit tests.
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(GroundCacheTests, "Unit tests");
 CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(LaRCSimMatrixTests, "Unit tests");
+#ifdef ENABLE_JSBSIM
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(JSBSimFunctionTests, "Unit tests");
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(JSBSimTableTests, "Unit tests");
+#endif
+#ifdef ENABLE_YASIM
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(YASimSurfaceSetTests, "Unit tests");
+#endif
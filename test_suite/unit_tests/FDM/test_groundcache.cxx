@@ -0,0 +1,370 @@
+#include "test_groundcache.hxx"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <simgear/bvh/BVHGroup.hxx>
+#include <simgear/bvh/BVHMaterial.hxx>
+#include <simgear/bvh/BVHMotionTransform.hxx>
+#include <simgear/bvh/BVHStaticGeometryBuilder.hxx>
+#include <simgear/bvh/BVHTransform.hxx>
+#include <simgear/constants.h>
+#include <simgear/math/SGMath.hxx>
+
+#include <FDM/groundcache.hxx>
+
+using namespace simgear;
+
+
+// The transform from local coordinates with the given axes and origin to
+// the coordinates of the parent, in the memory layout of osg::Matrix.
+static SGMatrixd toParent(const SGVec3d& x, const SGVec3d& y, const SGVec3d& z,
+                          const SGVec3d& origin)
+{
+    double m[16] = { x[0], x[1], x[2], 0,
+                     y[0], y[1], y[2], 0,
+                     z[0], z[1], z[2], 0,
+                     origin[0], origin[1], origin[2], 1 };
+    return SGMatrixd(m);
+}
+
+static float terrainHeight(float x, float y)
+{
+    return 2*std::sin(0.05f*x) + 1.5f*std::cos(0.07f*y);
+}
+
+static void addQuad(BVHStaticGeometryBuilder& builder, float x0, float y0,
+                    float x1, float y1, float z)
+{
+    builder.addTriangle(SGVec3f(x0, y0, z), SGVec3f(x1, y0, z), SGVec3f(x1, y1, z));
+    builder.addTriangle(SGVec3f(x0, y0, z), SGVec3f(x1, y1, z), SGVec3f(x0, y1, z));
+}
+
+// 160m by 160m of uneven terrain around the origin, in cells of 10m split
+// along the diagonal, of two materials.
+static BVHNode* makeTerrain(BVHMaterial* a, BVHMaterial* b)
+{
+    SGSharedPtr<BVHStaticGeometryBuilder> builder = new BVHStaticGeometryBuilder;
+    for (int i = -8; i < 8; ++i) {
+        for (int j = -8; j < 8; ++j) {
+            builder->setCurrentMaterial((i + j) % 3 ? a : b);
+            float x0 = 10*i, y0 = 10*j, x1 = x0 + 10, y1 = y0 + 10;
+            SGVec3f p00(x0, y0, terrainHeight(x0, y0));
+            SGVec3f p10(x1, y0, terrainHeight(x1, y0));
+            SGVec3f p11(x1, y1, terrainHeight(x1, y1));
+            SGVec3f p01(x0, y1, terrainHeight(x0, y1));
+            builder->addTriangle(p00, p10, p11);
+            builder->addTriangle(p00, p11, p01);
+        }
+    }
+    return builder->buildTree();
+}
+
+static BVHNode* makeRoof(BVHMaterial* material, float halfX, float halfY, float z)
+{
+    SGSharedPtr<BVHStaticGeometryBuilder> builder = new BVHStaticGeometryBuilder;
+    builder->setCurrentMaterial(material);
+    addQuad(*builder, -halfX, -halfY, halfX, halfY, z);
+    return builder->buildTree();
+}
+
+// The origin and the axes of a local frame at some place on the earth.
+static void makeFrame(SGVec3d& origin, SGVec3d& east, SGVec3d& north, SGVec3d& down)
+{
+    SGGeod geod = SGGeod::fromDegM(7.5, 47.5, 300);
+    origin = SGVec3d::fromGeod(geod);
+    SGQuatd hlToEc = SGQuatd::fromLonLat(geod);
+    north = hlToEc.rotate(SGVec3d(1, 0, 0));
+    east = hlToEc.rotate(SGVec3d(0, 1, 0));
+    down = hlToEc.rotate(SGVec3d(0, 0, 1));
+}
+
+// The terrain in a tile local to its center, as in the scenery.
+static BVHTransform* makeTile(const SGVec3d& origin, const SGVec3d& east,
+                              const SGVec3d& north, const SGVec3d& down,
+                              BVHMaterial* a, BVHMaterial* b)
+{
+    BVHTransform* tile = new BVHTransform;
+    tile->setToWorldTransform(toParent(east, north, -down, origin));
+    tile->addChild(makeTerrain(a, b));
+    return tile;
+}
+
+static void checkAgl(FGGroundCache& cache, double t, const SGVec3d& pt,
+                     const FGGroundCache::AglResult& result)
+{
+    SGVec3d contact, normal, linearVel, angularVel;
+    BVHNode::Id id = 0;
+    const BVHMaterial* material = 0;
+    bool found = cache.get_agl(t, pt, contact, normal, linearVel, angularVel,
+                               id, material);
+
+    CPPUNIT_ASSERT_EQUAL(found, result.found);
+    CPPUNIT_ASSERT(material == result.material);
+    CPPUNIT_ASSERT(id == result.id);
+    // the segments may be cut short in a different order, which changes
+    // the intersection points by float rounding at most
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0, dist(contact, result.contact), 1e-3);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0, dist(normal, result.normal), 1e-6);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0, dist(linearVel, result.linearVel), 1e-6);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0, dist(angularVel, result.angularVel), 1e-9);
+}
+
+
+// The batched get_agl() must return what a get_agl() call for each point
+// returns, on a tree with nested transforms and a moving deck.
+void GroundCacheTests::testBatchedAgl()
+{
+    SGVec3d origin, east, north, down;
+    makeFrame(origin, east, north, down);
+
+    // terrain, hits report one of these
+    SGSharedPtr<BVHMaterial> grass = new BVHMaterial;
+    SGSharedPtr<BVHMaterial> rock = new BVHMaterial;
+    SGSharedPtr<BVHMaterial> roof = new BVHMaterial;
+    SGSharedPtr<BVHMaterial> deck = new BVHMaterial;
+    // below the cache, for misses
+    SGSharedPtr<BVHMaterial> below = new BVHMaterial;
+
+    SGSharedPtr<BVHTransform> tile = makeTile(origin, east, north, down, grass, rock);
+
+    // a building turned by 30 degrees within the tile
+    double c = std::cos(30*SGD_DEGREES_TO_RADIANS), s = std::sin(30*SGD_DEGREES_TO_RADIANS);
+    SGSharedPtr<BVHTransform> building = new BVHTransform;
+    building->setToWorldTransform(toParent(SGVec3d(c, s, 0), SGVec3d(-s, c, 0),
+                                           SGVec3d(0, 0, 1), SGVec3d(20, -10, 0)));
+    building->addChild(makeRoof(roof, 15, 10, 8));
+    tile->addChild(building);
+
+    // a moving and turning carrier deck
+    SGSharedPtr<BVHMotionTransform> carrier = new BVHMotionTransform;
+    carrier->setToWorldTransform(toParent(east, north, -down, origin - 40*east + 30*north));
+    carrier->setLinearVelocity(SGVec3d(3, 0, 0));
+    carrier->setAngularVelocity(SGVec3d(0, 0, 0.02));
+    carrier->setReferenceTime(0);
+    carrier->setStartTime(0);
+    carrier->setEndTime(10);
+    carrier->setId(42);
+    carrier->addChild(makeRoof(deck, 15, 25, 15));
+
+    SGSharedPtr<BVHGroup> root = new BVHGroup;
+    root->addChild(tile);
+    root->addChild(carrier);
+
+    FGGroundCache cache;
+    FGGroundCache::Build build;
+    build.point = origin;
+    build.radius = 200;
+    build.startTime = 0;
+    build.endTime = 10;
+    build.sceneTime = 0;
+    build.down = down;
+    build.tree = root;
+    build.altitude = 250;
+    build.material = below;
+    build.foundGround = true;
+    cache.use(build);
+    cache.reference_vehicle_radius = 20;   // 200m long segments
+
+    // Points inside terrain cells but away from the cell edges and the
+    // diagonals, where two triangles hit equally well. Some are beyond the
+    // terrain, too high for the segments to reach it or below it.
+    std::mt19937 rng(17);
+    std::uniform_int_distribution<int> cell(-10, 9);
+    std::uniform_real_distribution<double> lower(0.1, 0.4), upper(0.6, 0.9);
+    std::uniform_real_distribution<double> height(-5, 40), unit(0, 1);
+    std::vector<SGVec3d> points;
+    for (int i = 0; i < 1000; ++i) {
+        double x = 10*(cell(rng) + lower(rng));
+        double y = 10*(cell(rng) + upper(rng));
+        double z = unit(rng) < 0.05 ? 300 : height(rng);
+        points.push_back(origin + x*east + y*north - z*down);
+    }
+
+    const double t = 2.5;
+    std::vector<FGGroundCache::AglResult> results(points.size());
+    cache.get_agl(t, points.size(), points.data(), results.data());
+
+    size_t grassHits = 0, rockHits = 0, roofHits = 0, deckHits = 0, misses = 0;
+    for (size_t i = 0; i < points.size(); ++i) {
+        checkAgl(cache, t, points[i], results[i]);
+        const BVHMaterial* material = results[i].material;
+        grassHits += material == grass.get();
+        rockHits += material == rock.get();
+        roofHits += material == roof.get();
+        deckHits += material == deck.get();
+        misses += material == below.get();
+    }
+    // all parts of the tree were hit
+    CPPUNIT_ASSERT(grassHits > 0);
+    CPPUNIT_ASSERT(rockHits > 0);
+    CPPUNIT_ASSERT(roofHits > 0);
+    CPPUNIT_ASSERT(deckHits > 0);
+    CPPUNIT_ASSERT(misses > 0);
+    CPPUNIT_ASSERT_EQUAL(points.size(), grassHits + rockHits + roofHits + deckHits + misses);
+
+    // smaller batches reuse the scratch space of the larger one
+    for (size_t count = 1; count < 40; count += 7) {
+        size_t first = 13*count;
+        cache.get_agl(t, count, &points[first], results.data());
+        for (size_t i = 0; i < count; ++i)
+            checkAgl(cache, t, points[first + i], results[i]);
+    }
+
+    // the deck has moved on
+    cache.get_agl(t + 4, points.size(), points.data(), results.data());
+    for (size_t i = 0; i < points.size(); ++i)
+        checkAgl(cache, t + 4, points[i], results[i]);
+
+    // an empty cache only has the fallback
+    build.tree = 0;
+    cache.use(build);
+    cache.get_agl(t, points.size(), points.data(), results.data());
+    for (size_t i = 0; i < points.size(); ++i) {
+        checkAgl(cache, t, points[i], results[i]);
+        CPPUNIT_ASSERT(results[i].material == below.get());
+    }
+}
+
+
+void GroundCacheTests::testWithin()
+{
+    FGGroundCache::Build build;
+    build.point = SGVec3d(6.4e6, 0, 0);
+    build.radius = 100;
+    build.startTime = 10;
+    build.endTime = 20;
+    build.foundGround = true;
+    SGVec3d pt = build.point;
+    SGVec3d x(1, 0, 0);
+
+    // the time window
+    CPPUNIT_ASSERT(FGGroundCache::within(build, 10, 20, pt, 10));
+    CPPUNIT_ASSERT(FGGroundCache::within(build, 12, 18, pt, 10));
+    CPPUNIT_ASSERT(!FGGroundCache::within(build, 9.9, 20, pt, 10));
+    CPPUNIT_ASSERT(!FGGroundCache::within(build, 10, 20.1, pt, 10));
+    CPPUNIT_ASSERT(!FGGroundCache::within(build, 30, 31, pt, 10));
+
+    // the ball of the request must lie within the one of the build
+    CPPUNIT_ASSERT(FGGroundCache::within(build, 12, 18, pt, 100));
+    CPPUNIT_ASSERT(!FGGroundCache::within(build, 12, 18, pt, 101));
+    CPPUNIT_ASSERT(FGGroundCache::within(build, 12, 18, pt + 50*x, 50));
+    CPPUNIT_ASSERT(!FGGroundCache::within(build, 12, 18, pt + 51*x, 50));
+    CPPUNIT_ASSERT(!FGGroundCache::within(build, 12, 18, pt + 50*x, 51));
+    CPPUNIT_ASSERT(!FGGroundCache::within(build, 12, 18, pt + 200*x, 10));
+
+    // covering also needs ground
+    CPPUNIT_ASSERT(FGGroundCache::covers(build, 12, 18, pt + 50*x, 50));
+    CPPUNIT_ASSERT(!FGGroundCache::covers(build, 12, 18, pt + 51*x, 50));
+    build.foundGround = false;
+    CPPUNIT_ASSERT(FGGroundCache::within(build, 12, 18, pt + 50*x, 50));
+    CPPUNIT_ASSERT(!FGGroundCache::covers(build, 12, 18, pt + 50*x, 50));
+}
+
+
+// Feed the build thread snapshots as start_background_build() would, and
+// check which of them are swapped in. A build is only installed when it
+// covers the request, so the full rebuild, which needs the scenery, is
+// never reached here.
+void GroundCacheTests::testBackgroundBuild()
+{
+    SGVec3d origin, east, north, down;
+    makeFrame(origin, east, north, down);
+
+    SGSharedPtr<BVHMaterial> grass = new BVHMaterial;
+    SGSharedPtr<BVHMaterial> rock = new BVHMaterial;
+    SGSharedPtr<BVHNode> tile = makeTile(origin, east, north, down, grass, rock);
+
+    FGGroundCache cache;
+    cache.set_background_build(true);
+
+    auto request = [&](double startTime, double endTime, double radius,
+                       BVHNode* tree) {
+        FGGroundCache::Build& next = cache._next;
+        next.point = origin;
+        next.radius = radius;
+        next.startTime = startTime;
+        next.endTime = endTime;
+        next.sceneTime = startTime;
+        next.down = down;
+        next.tree = tree;
+        next.altitude = 0;
+        next.material = 0;
+        next.foundGround = false;
+        cache.request_background_build();
+    };
+
+    // A snapshot of the tile, the build thread finds the ground in it. It
+    // is not used for a request outside of its ball or time window.
+    request(0, 100, 500, tile);
+    CPPUNIT_ASSERT(!cache.use_next(200, 201, origin, 10));
+    cache.poll_background_build(true);
+    CPPUNIT_ASSERT(!cache._building);
+    CPPUNIT_ASSERT(cache._haveNext);
+    CPPUNIT_ASSERT(cache._next.foundGround);
+    CPPUNIT_ASSERT(!cache.use_next(200, 201, origin, 10));
+    CPPUNIT_ASSERT(!cache.use_next(-1, 1, origin, 10));
+    CPPUNIT_ASSERT(!cache.use_next(0, 1, origin, 600));
+    CPPUNIT_ASSERT(!cache.use_next(0, 1, origin + 495*east, 10));
+    CPPUNIT_ASSERT(cache._haveNext);
+    CPPUNIT_ASSERT(!cache._localBvhTree);
+
+    // It covers this one, which keeps well inside, so no new build starts.
+    SGVec3d pt = origin + 50*east - 5*down;
+    CPPUNIT_ASSERT(cache.prepare_ground_cache(1, 2, pt, 10));
+    CPPUNIT_ASSERT(!cache._haveNext);
+    CPPUNIT_ASSERT(!cache._building);
+    CPPUNIT_ASSERT(!cache._next.tree);
+    CPPUNIT_ASSERT(cache._localBvhTree);
+    CPPUNIT_ASSERT_EQUAL(500.0, cache._current.radius);
+    CPPUNIT_ASSERT_EQUAL(100.0, cache._current.endTime);
+
+    double refTime, refRad;
+    SGVec3d refPt;
+    CPPUNIT_ASSERT(cache.is_valid(refTime, refPt, refRad));
+    CPPUNIT_ASSERT_EQUAL(1.0, refTime);
+    CPPUNIT_ASSERT_EQUAL(10.0, refRad);
+
+    SGVec3d contact, normal, linearVel, angularVel;
+    BVHNode::Id id;
+    const BVHMaterial* material;
+    CPPUNIT_ASSERT(cache.get_agl(1, pt, contact, normal, linearVel, angularVel,
+                                 id, material));
+    CPPUNIT_ASSERT(material == grass.get() || material == rock.get());
+    CPPUNIT_ASSERT(dist(pt, contact) < 10);
+
+    // A build made useless by a full rebuild meanwhile is dropped.
+    SGSharedPtr<BVHNode> current = cache._localBvhTree;
+    request(0, 200, 1000, tile);
+    cache._discardNext = true;
+    CPPUNIT_ASSERT(!cache.use_next(5, 6, origin, 10));
+    cache.poll_background_build(true);
+    CPPUNIT_ASSERT(!cache._haveNext);
+    CPPUNIT_ASSERT(!cache._next.tree);
+    CPPUNIT_ASSERT(!cache.use_next(5, 6, origin, 10));
+    CPPUNIT_ASSERT(cache._localBvhTree.get() == current.get());
+
+    // A build without ground in its ball is never installed, although it
+    // covers the request otherwise.
+    SGSharedPtr<BVHTransform> far = new BVHTransform;
+    far->setToWorldTransform(toParent(east, north, -down, origin + 3000*east));
+    far->addChild(makeRoof(grass, 15, 15, 0));
+    request(0, 200, 1000, far);
+    CPPUNIT_ASSERT(!cache.use_next(5, 6, origin, 10));
+    CPPUNIT_ASSERT(!cache._building);
+    CPPUNIT_ASSERT(!cache._haveNext);
+    CPPUNIT_ASSERT(!cache._next.tree);
+    CPPUNIT_ASSERT(cache._localBvhTree.get() == current.get());
+    CPPUNIT_ASSERT_EQUAL(500.0, cache._current.radius);
+
+    // nothing at all
+    request(0, 200, 1000, 0);
+    CPPUNIT_ASSERT(!cache.use_next(5, 6, origin, 10));
+    CPPUNIT_ASSERT(!cache._haveNext);
+    CPPUNIT_ASSERT(cache._localBvhTree.get() == current.get());
+
+    // the covering cache is still the one in use
+    CPPUNIT_ASSERT(cache.prepare_ground_cache(5, 6, pt, 10));
+    CPPUNIT_ASSERT(cache._localBvhTree.get() == current.get());
+}
@@ -0,0 +1,246 @@
+#include "test_jsbsim_function.hxx"
+
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+
+#include <FGJSBBase.h>
+#include <input_output/FGPropertyManager.h>
+#include <input_output/FGXMLElement.h>
+#include <math/FGFunction.h>
+
+using namespace JSBSim;
+
+
+// Random function definitions using all compiled operations. The
+// properties are tied to a double, tied to a getter, untied, and created
+// only after the function, which may also be read negated. Random numbers
+// are drawn by <random/> and <urandom/>.
+class FunctionGenerator
+{
+public:
+    FunctionGenerator() : _rng(42) {}
+
+    int rnd(int n) { return _rng() % n; }
+
+    double rndValue() { return (rnd(400)-200)/50.0; }
+
+    Element* value(double v)
+    {
+        std::ostringstream s;
+        s.precision(17);
+        s << v;
+        Element* e = new Element("v");
+        e->AddData(s.str());
+        return e;
+    }
+
+    Element* leaf(bool constOnly)
+    {
+        static const char* props[] = {"tied", "getter", "untied", "-late", "late"};
+        if (constOnly || rnd(3) == 0)
+            return value((rnd(200)-100)/10.0);
+        if (rnd(6) == 0)
+            return new Element(rnd(2) ? "random" : "urandom");
+        Element* e = new Element("p");
+        e->AddData(props[rnd(5)]);
+        return e;
+    }
+
+    Element* condition(int depth, bool constOnly)
+    {
+        static const char* ops[] = {"lt", "le", "gt", "ge", "eq", "nq", "and", "or", "not"};
+        std::string op = ops[rnd(9)];
+        Element* e = new Element(op);
+        if (op == "and" || op == "or") {
+            int n = 1 + rnd(3);
+            for (int i=0; i<n; ++i)
+                e->AddChildElement(condition(depth-1, constOnly));
+        } else if (op == "not") {
+            e->AddChildElement(condition(depth-1, constOnly));
+        } else {
+            e->AddChildElement(operation(depth-1, constOnly));
+            e->AddChildElement(operation(depth-1, constOnly));
+        }
+        return e;
+    }
+
+    Element* operation(int depth, bool constOnly = false)
+    {
+        static const char* nary[] = {"sum", "difference", "product", "min", "max", "avg"};
+        static const char* binary[] = {"quotient", "pow", "atan2"};
+        static const char* unary[] = {"sqrt", "toradians", "todegrees", "exp", "log2",
+                                      "ln", "log10", "abs", "sign", "sin", "cos", "tan",
+                                      "asin", "acos", "atan", "fraction", "integer"};
+        if (depth <= 0 || rnd(4) == 0)
+            return leaf(constOnly);
+
+        Element* e;
+        switch (rnd(9)) {
+        case 0: case 1: case 2:
+            e = new Element(nary[rnd(6)]);
+            for (int i=0, n=1+rnd(4); i<n; ++i)
+                e->AddChildElement(operation(depth-1, constOnly));
+            break;
+        case 3:
+            e = new Element(binary[rnd(3)]);
+            e->AddChildElement(operation(depth-1, constOnly));
+            e->AddChildElement(operation(depth-1, constOnly));
+            break;
+        case 4:
+            e = new Element(unary[rnd(17)]);
+            e->AddChildElement(operation(depth-1, constOnly));
+            break;
+        case 5:
+            e = new Element("ifthen");
+            e->AddChildElement(condition(depth-1, constOnly));
+            e->AddChildElement(operation(depth-1, constOnly));
+            e->AddChildElement(operation(depth-1, constOnly));
+            break;
+        case 6:
+            {
+                // an index of 0, 1, 2 or an invalid one
+                e = new Element("switch");
+                Element* index = new Element("abs");
+                Element* min = new Element("min");
+                min->AddChildElement(operation(depth-1, constOnly));
+                min->AddChildElement(value(2));
+                index->AddChildElement(min);
+                e->AddChildElement(index);
+                for (int i=0; i<3; ++i)
+                    e->AddChildElement(operation(depth-1, constOnly));
+            }
+            break;
+        case 7:
+            {
+                e = new Element("interpolate1d");
+                e->AddChildElement(operation(depth-1, constOnly));
+                double x = -5.0;
+                for (int i=0, n=2+rnd(3); i<n; ++i) {
+                    x += 0.5 + rnd(30)/10.0;
+                    e->AddChildElement(value(x));
+                    e->AddChildElement(operation(0, true));
+                }
+            }
+            break;
+        default:
+            e = new Element("pi");
+            break;
+        }
+        return e;
+    }
+
+private:
+    std::mt19937 _rng;
+};
+
+
+class GetterObject
+{
+public:
+    GetterObject() : value(0.3) {}
+    double get() const { return value; }
+    double value;
+};
+
+
+// Restarts the numbers drawn by <random/> and <urandom/>.
+class RandomSeed : public FGJSBBase
+{
+public:
+    static void reset(unsigned int seed)
+    {
+        srand(seed);
+        gaussian_random_number_phase = 0;
+    }
+};
+
+
+static void evaluate(const FGFunction& function, unsigned int seed,
+                     double& value, bool& thrown)
+{
+    RandomSeed::reset(seed);
+    value = 0.0;
+    thrown = false;
+    try {
+        value = function.GetValue();
+    } catch (...) {
+        thrown = true;
+    }
+}
+
+
+void JSBSimFunctionTests::setUp()
+{
+    FGJSBBase::debug_lvl = 0;
+}
+
+
+void JSBSimFunctionTests::testRandomTrees()
+{
+    FunctionGenerator generator;
+
+    for (int t=0; t<20000; ++t) {
+        // the tied variables must outlive the property manager
+        double tied = 1.5;
+        GetterObject getter;
+        FGPropertyManager pm;
+        pm.Tie("tied", &tied);
+        pm.Tie("getter", &getter, &GetterObject::get);
+        pm.GetNode("untied", true)->setDoubleValue(-0.7);
+
+        Element_ptr root = new Element("function");
+        root->AddChildElement(generator.operation(5));
+        FGFunction tree(&pm, root), code(&pm, root);
+        tree.compile(false);
+        FGPropertyNode* late = pm.GetNode("late", true);
+
+        for (int s=0; s<5; ++s) {
+            tied = generator.rndValue();
+            getter.value = generator.rndValue();
+            late->setDoubleValue(generator.rndValue());
+
+            // The same value, or the same exception, as the tree, from the
+            // same random numbers
+            double expected, actual;
+            bool expectedThrown, actualThrown;
+            evaluate(tree, t, expected, expectedThrown);
+            evaluate(code, t, actual, actualThrown);
+            CPPUNIT_ASSERT_EQUAL(expectedThrown, actualThrown);
+            if (std::isnan(expected))
+                CPPUNIT_ASSERT(std::isnan(actual));
+            else
+                CPPUNIT_ASSERT_EQUAL(expected, actual);
+        }
+    }
+}
+
+
+void JSBSimFunctionTests::testCopyTo()
+{
+    FGPropertyManager pm;
+    FGPropertyNode* in = pm.GetNode("in", true);
+    FGPropertyNode* out = pm.GetNode("out", true);
+
+    Element_ptr root = new Element("function");
+    root->AddAttribute("copyto", "out");
+    Element* sum = new Element("sum");
+    Element* p = new Element("p");
+    p->AddData("in");
+    sum->AddChildElement(p);
+    Element* v = new Element("v");
+    v->AddData("1");
+    sum->AddChildElement(v);
+    root->AddChildElement(sum);
+
+    for (int compile=0; compile<2; ++compile) {
+        FGFunction function(&pm, root);
+        function.compile(compile != 0);
+        for (int i=0; i<3; ++i) {
+            in->setDoubleValue(i + 10.0*compile);
+            CPPUNIT_ASSERT_EQUAL(i + 10.0*compile + 1.0, function.GetValue());
+            CPPUNIT_ASSERT_EQUAL(i + 10.0*compile + 1.0, out->getDoubleValue());
+        }
+    }
+}
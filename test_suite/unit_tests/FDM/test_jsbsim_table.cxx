@@ -0,0 +1,372 @@
+#include "test_jsbsim_table.hxx"
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include <FGJSBBase.h>
+#include <input_output/FGPropertyManager.h>
+#include <input_output/FGXMLElement.h>
+#include <math/FGTable.h>
+
+using namespace JSBSim;
+
+
+// FGTable::GetValue() as it was before the table data was packed: a
+// linear walk from the interval of the previous lookup. Data is indexed
+// from 1 like the table's, with the column keys in row 0 and the row keys
+// in column 0.
+class LinearWalkTable
+{
+public:
+    LinearWalkTable(const std::vector<double>& rowKeys,
+                    const std::vector<double>& colKeys,
+                    const std::vector<std::vector<double> >& values)
+        : nRows(rowKeys.size()), nCols(colKeys.empty() ? 1 : colKeys.size()),
+          Data(nRows+1, std::vector<double>(nCols+1)),
+          lastRowIndex(2), lastColumnIndex(2)
+    {
+        for (unsigned int c=0; c<colKeys.size(); ++c)
+            Data[0][c+1] = colKeys[c];
+        for (unsigned int r=0; r<nRows; ++r) {
+            Data[r+1][0] = rowKeys[r];
+            for (unsigned int c=0; c<nCols; ++c)
+                Data[r+1][c+1] = values[r][c];
+        }
+    }
+
+    double GetValue(double key)
+    {
+        double Factor, Span;
+        unsigned int r = lastRowIndex;
+
+        if (key <= Data[1][0]) {
+            lastRowIndex = 2;
+            return Data[1][1];
+        } else if (key >= Data[nRows][0]) {
+            lastRowIndex = nRows;
+            return Data[nRows][1];
+        }
+
+        while (r > 2     && Data[r-1][0] > key) { r--; }
+        while (r < nRows && Data[r][0]   < key) { r++; }
+        lastRowIndex = r;
+
+        Span = Data[r][0] - Data[r-1][0];
+        if (Span != 0.0) {
+            Factor = (key - Data[r-1][0]) / Span;
+            if (Factor > 1.0) Factor = 1.0;
+        } else {
+            Factor = 1.0;
+        }
+
+        return Factor*(Data[r][1] - Data[r-1][1]) + Data[r-1][1];
+    }
+
+    double GetValue(double rowKey, double colKey)
+    {
+        double rFactor, cFactor, col1temp, col2temp;
+        unsigned int r = lastRowIndex;
+        unsigned int c = lastColumnIndex;
+
+        while (r > 2     && Data[r-1][0] > rowKey) { r--; }
+        while (r < nRows && Data[r][0]   < rowKey) { r++; }
+
+        while (c > 2     && Data[0][c-1] > colKey) { c--; }
+        while (c < nCols && Data[0][c]   < colKey) { c++; }
+
+        lastRowIndex = r;
+        lastColumnIndex = c;
+
+        rFactor = (rowKey - Data[r-1][0]) / (Data[r][0] - Data[r-1][0]);
+        cFactor = (colKey - Data[0][c-1]) / (Data[0][c] - Data[0][c-1]);
+
+        if (rFactor > 1.0) rFactor = 1.0;
+        else if (rFactor < 0.0) rFactor = 0.0;
+
+        if (cFactor > 1.0) cFactor = 1.0;
+        else if (cFactor < 0.0) cFactor = 0.0;
+
+        col1temp = rFactor*(Data[r][c-1] - Data[r-1][c-1]) + Data[r-1][c-1];
+        col2temp = rFactor*(Data[r][c] - Data[r-1][c]) + Data[r-1][c];
+
+        return col1temp + cFactor*(col2temp - col1temp);
+    }
+
+private:
+    unsigned int nRows, nCols;
+    std::vector<std::vector<double> > Data;
+    unsigned int lastRowIndex, lastColumnIndex;
+};
+
+
+// The 3D lookup of the old FGTable, over a 2D table per table key.
+class LinearWalkTable3D
+{
+public:
+    LinearWalkTable3D(const std::vector<double>& tableKeys,
+                      const std::vector<LinearWalkTable>& tables)
+        : nRows(tableKeys.size()), Keys(tableKeys), Tables(tables),
+          lastRowIndex(2) {}
+
+    double GetValue(double rowKey, double colKey, double tableKey)
+    {
+        double Factor, Span;
+        unsigned int r = lastRowIndex;
+
+        if (tableKey <= Keys[0]) {
+            lastRowIndex = 2;
+            return Tables[0].GetValue(rowKey, colKey);
+        } else if (tableKey >= Keys[nRows-1]) {
+            lastRowIndex = nRows;
+            return Tables[nRows-1].GetValue(rowKey, colKey);
+        }
+
+        while (r > 2     && Keys[r-2] > tableKey) { r--; }
+        while (r < nRows && Keys[r-1] < tableKey) { r++; }
+        lastRowIndex = r;
+
+        Span = Keys[r-1] - Keys[r-2];
+        if (Span != 0.0) {
+            Factor = (tableKey - Keys[r-2]) / Span;
+            if (Factor > 1.0) Factor = 1.0;
+        } else {
+            Factor = 1.0;
+        }
+
+        return Factor*(Tables[r-1].GetValue(rowKey, colKey) - Tables[r-2].GetValue(rowKey, colKey))
+                       + Tables[r-2].GetValue(rowKey, colKey);
+    }
+
+private:
+    unsigned int nRows;
+    std::vector<double> Keys;
+    std::vector<LinearWalkTable> Tables;
+    unsigned int lastRowIndex;
+};
+
+
+// Random breakpoints, values and keys to look up.
+class TableGenerator
+{
+public:
+    TableGenerator() : _rng(42) {}
+
+    int rnd(int n) { return _rng() % n; }
+
+    double value() { return (rnd(200)-100)/7.0; }
+
+    // Increasing breakpoints, evenly spaced or not. Tables filled with
+    // operator<< also take a repeated breakpoint, or two of them swapped.
+    std::vector<double> keys(unsigned int n, bool strict = true)
+    {
+        std::vector<double> k;
+        bool uniform = rnd(2) != 0;
+        double x = -3.0 + rnd(10)*0.25;
+        double step = 0.1 + rnd(20)*0.05;
+        for (unsigned int i=0; i<n; ++i) {
+            k.push_back(x);
+            x += uniform ? step : 0.05 + rnd(30)*0.1;
+        }
+        if (!strict && rnd(8) == 0) {
+            unsigned int i = 1 + rnd(n-1);
+            k[i] = k[i-1];
+        }
+        if (!strict && rnd(8) == 0)
+            std::swap(k[rnd(n)], k[rnd(n)]);
+        return k;
+    }
+
+    std::vector<std::vector<double> > values(unsigned int rows, unsigned int cols)
+    {
+        std::vector<std::vector<double> > v(rows, std::vector<double>(cols));
+        for (unsigned int r=0; r<rows; ++r)
+            for (unsigned int c=0; c<cols; ++c)
+                v[r][c] = value();
+        return v;
+    }
+
+    // A key on, next to, between or outside the breakpoints.
+    double key(const std::vector<double>& k)
+    {
+        switch (rnd(10)) {
+        case 0: case 1: case 2:
+            return k[rnd(k.size())];
+        case 3:
+            return std::numeric_limits<double>::quiet_NaN();
+        case 4:
+            return rnd(2) ? HUGE_VAL : -HUGE_VAL;
+        case 5:
+            return k[rnd(k.size())] + (rnd(2) ? 1e-15 : -1e-15);
+        default:
+            {
+                std::uniform_real_distribution<double> range(k.front() - 1.0, k.back() + 1.0);
+                return range(_rng);
+            }
+        }
+    }
+
+private:
+    std::mt19937 _rng;
+};
+
+
+static std::string toString(double v)
+{
+    std::ostringstream s;
+    s.precision(17);
+    s << v;
+    return s.str();
+}
+
+static void checkSame(double expected, double actual)
+{
+    if (std::isnan(expected))
+        CPPUNIT_ASSERT(std::isnan(actual));
+    else
+        CPPUNIT_ASSERT_EQUAL(expected, actual);
+}
+
+
+void JSBSimTableTests::setUp()
+{
+    FGJSBBase::debug_lvl = 0;
+}
+
+
+void JSBSimTableTests::testLookup1D()
+{
+    TableGenerator generator;
+
+    for (int t=0; t<1000; ++t) {
+        unsigned int nRows = 2 + generator.rnd(12);
+        std::vector<double> rowKeys = generator.keys(nRows, false);
+        std::vector<std::vector<double> > values = generator.values(nRows, 1);
+
+        FGTable table(nRows);
+        for (unsigned int r=0; r<nRows; ++r)
+            table << rowKeys[r] << values[r][0];
+        LinearWalkTable expected(rowKeys, std::vector<double>(), values);
+
+        for (int i=0; i<200; ++i) {
+            double key = generator.key(rowKeys);
+            checkSame(expected.GetValue(key), table.GetValue(key));
+        }
+
+        std::vector<double> keys(100), results(100);
+        for (double& key : keys)
+            key = generator.key(rowKeys);
+        table.GetValues(keys.data(), results.data(), keys.size());
+        for (unsigned int i=0; i<keys.size(); ++i)
+            checkSame(expected.GetValue(keys[i]), results[i]);
+    }
+}
+
+
+void JSBSimTableTests::testLookup2D()
+{
+    TableGenerator generator;
+
+    for (int t=0; t<1000; ++t) {
+        unsigned int nRows = 2 + generator.rnd(12), nCols = 2 + generator.rnd(8);
+        std::vector<double> rowKeys = generator.keys(nRows, false);
+        std::vector<double> colKeys = generator.keys(nCols, false);
+        std::vector<std::vector<double> > values = generator.values(nRows, nCols);
+
+        FGTable table(nRows, nCols);
+        for (unsigned int c=0; c<nCols; ++c)
+            table << colKeys[c];
+        for (unsigned int r=0; r<nRows; ++r) {
+            table << rowKeys[r];
+            for (unsigned int c=0; c<nCols; ++c)
+                table << values[r][c];
+        }
+        LinearWalkTable expected(rowKeys, colKeys, values);
+
+        for (int i=0; i<200; ++i) {
+            double rowKey = generator.key(rowKeys), colKey = generator.key(colKeys);
+            checkSame(expected.GetValue(rowKey, colKey), table.GetValue(rowKey, colKey));
+        }
+
+        std::vector<double> rows(100), cols(100), results(100);
+        for (unsigned int i=0; i<rows.size(); ++i) {
+            rows[i] = generator.key(rowKeys);
+            cols[i] = generator.key(colKeys);
+        }
+        table.GetValues(rows.data(), cols.data(), results.data(), rows.size());
+        for (unsigned int i=0; i<rows.size(); ++i)
+            checkSame(expected.GetValue(rows[i], cols[i]), results[i]);
+    }
+}
+
+
+void JSBSimTableTests::testLookup3D()
+{
+    TableGenerator generator;
+    FGPropertyManager pm;
+    const char* axes[] = {"row", "column", "table"};
+    for (const char* axis : axes)
+        pm.GetNode(axis, true);
+
+    for (int t=0; t<300; ++t) {
+        // <table>
+        //   <independentVar lookup="row">row</independentVar> ...
+        //   <tableData breakPoint="table key"> column keys, rows </tableData> ...
+        // </table>
+        Element_ptr el = new Element("table");
+        for (const char* axis : axes) {
+            Element* var = new Element("independentVar");
+            var->AddAttribute("lookup", axis);
+            var->AddData(axis);
+            el->AddChildElement(var);
+        }
+
+        unsigned int nTables = 2 + generator.rnd(4);
+        std::vector<double> tableKeys = generator.keys(nTables);
+        std::vector<std::vector<double> > allRowKeys, allColKeys;
+        std::vector<LinearWalkTable> tables;
+        for (unsigned int n=0; n<nTables; ++n) {
+            unsigned int nRows = 2 + generator.rnd(4), nCols = 2 + generator.rnd(3);
+            std::vector<double> rowKeys = generator.keys(nRows);
+            std::vector<double> colKeys = generator.keys(nCols);
+            std::vector<std::vector<double> > values = generator.values(nRows, nCols);
+
+            Element* data = new Element("tableData");
+            data->AddAttribute("breakPoint", toString(tableKeys[n]));
+            std::string line;
+            for (double key : colKeys)
+                line += toString(key) + " ";
+            data->AddData(line);
+            for (unsigned int r=0; r<nRows; ++r) {
+                line = toString(rowKeys[r]);
+                for (double value : values[r])
+                    line += " " + toString(value);
+                data->AddData(line);
+            }
+            el->AddChildElement(data);
+
+            allRowKeys.push_back(rowKeys);
+            allColKeys.push_back(colKeys);
+            tables.push_back(LinearWalkTable(rowKeys, colKeys, values));
+        }
+
+        FGTable table(&pm, el);
+        LinearWalkTable3D expected(tableKeys, tables);
+
+        std::vector<double> rows(200), cols(200), keys(200), results(200);
+        for (unsigned int i=0; i<rows.size(); ++i) {
+            unsigned int n = generator.rnd(nTables);
+            rows[i] = generator.key(allRowKeys[n]);
+            cols[i] = generator.key(allColKeys[n]);
+            keys[i] = generator.key(tableKeys);
+            checkSame(expected.GetValue(rows[i], cols[i], keys[i]),
+                      table.GetValue(rows[i], cols[i], keys[i]));
+        }
+
+        table.GetValues(rows.data(), cols.data(), keys.data(), results.data(), rows.size());
+        for (unsigned int i=0; i<rows.size(); ++i)
+            checkSame(expected.GetValue(rows[i], cols[i], keys[i]), results[i]);
+    }
+}
@@ -0,0 +1,50 @@
+/*
+ * This file is part of the program FlightGear.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _FG_JSBSIM_TABLE_UNIT_TESTS_HXX
+#define _FG_JSBSIM_TABLE_UNIT_TESTS_HXX
+
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestFixture.h>
+
+
+// The JSBSim lookup table unit tests.
+class JSBSimTableTests : public CppUnit::TestFixture
+{
+    // Set up the test suite.
+    CPPUNIT_TEST_SUITE(JSBSimTableTests);
+    CPPUNIT_TEST(testLookup1D);
+    CPPUNIT_TEST(testLookup2D);
+    CPPUNIT_TEST(testLookup3D);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    // Set up function for each test.
+    void setUp();
+
+    // Clean up after each test.
+    void tearDown() {}
+
+    // The tests.
+    void testLookup1D();
+    void testLookup2D();
+    void testLookup3D();
+};
+
+#endif  // _FG_JSBSIM_TABLE_UNIT_TESTS_HXX
@@ -0,0 +1,309 @@
+#include "test_yasim_surfaceset.hxx"
+
+#include "test_suite/helpers/globals.hxx"
+
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include <FDM/YASim/Math.hpp>
+#include <FDM/YASim/Surface.hpp>
+#include <FDM/YASim/SurfaceSet.hpp>
+#include <FDM/YASim/Vector.hpp>
+#include <FDM/YASim/Version.hpp>
+
+using namespace yasim;
+
+
+// Random surfaces with all the features calcForce() knows of. Some have
+// no force coefficients or no stall angles, some are turned such that the
+// wind comes along their normal or from behind.
+class SurfaceGenerator
+{
+public:
+    SurfaceGenerator() : _rng(42)
+    {
+        _v32.setVersion("YASIM_VERSION_32");
+    }
+
+    float uniform(float min, float max)
+    {
+        return std::uniform_real_distribution<float>(min, max)(_rng);
+    }
+
+    bool chance(float p) { return uniform(0, 1) < p; }
+
+    Surface* surface(bool identity = false)
+    {
+        float pos[3] = {uniform(-5, 5), uniform(-10, 10), uniform(-2, 2)};
+        Surface* s = new Surface(chance(0.5f) ? &_v32 : &_original, pos, uniform(0.5f, 2));
+
+        if (!identity) {
+            // rotations about Z, then Y, then X
+            float a = uniform(-3.2f, 3.2f), b = uniform(-1.6f, 1.6f), c = uniform(-3.2f, 3.2f);
+            float ca = Math::cos(a), sa = Math::sin(a), cb = Math::cos(b), sb = Math::sin(b);
+            float cc = Math::cos(c), sc = Math::sin(c);
+            float o[9] = { ca*cb, sa*cb, -sb,
+                           ca*sb*sc - sa*cc, sa*sb*sc + ca*cc, cb*sc,
+                           ca*sb*cc + sa*sc, sa*sb*cc - ca*sc, cb*cc };
+            s->setOrientation(o);
+        }
+
+        s->setChord(uniform(0.5f, 3));
+        if (chance(0.1f)) {
+            s->setDragCoefficient(0);
+            s->setYDrag(0);
+            s->setLiftCoefficient(0);
+        } else {
+            s->setDragCoefficient(uniform(0, 1));
+            s->setYDrag(uniform(0, 1));
+            s->setLiftCoefficient(uniform(0, 5));
+        }
+        s->setZeroAlphaLift(uniform(0, 0.3f));
+
+        if (!chance(0.1f)) {
+            for (int i=0; i<4; i++) {
+                s->setStall(i, chance(0.1f) ? 0 : uniform(0.1f, 0.4f));
+                s->setStallWidth(i, uniform(0.01f, 0.1f));
+            }
+            s->setStallPeak(0, uniform(1, 2));
+            s->setStallPeak(1, uniform(1, 2));
+        }
+
+        s->setFlapParams(uniform(1.1f, 2), uniform(1, 3));
+        s->setSlatParams(uniform(0, 0.1f), uniform(1, 2));
+        s->setSpoilerParams(uniform(0, 1), uniform(1, 3));
+        s->setFlapPos(chance(0.3f) ? 0 : uniform(-1, 1));
+        s->setSlatPos(chance(0.3f) ? 0 : uniform(0, 1));
+        s->setSpoilerPos(chance(0.3f) ? 0 : uniform(0, 1));
+        s->setFlapEffectiveness(uniform(0.5f, 1.5f));
+        s->setIncidence(uniform(-0.1f, 0.1f));
+        s->setTwist(chance(0.5f) ? 0 : uniform(-0.05f, 0.05f));
+        s->setInducedDrag(uniform(0.5f, 1.5f));
+        return s;
+    }
+
+    void wind(float* v)
+    {
+        float speed = uniform(1, 100);
+        do {
+            v[0] = uniform(-1, 1);
+            v[1] = uniform(-1, 1);
+            v[2] = uniform(-1, 1);
+        } while (Math::mag3(v) < 0.1f);
+        Math::mul3(speed/Math::mag3(v), v, v);
+    }
+
+private:
+    std::mt19937 _rng;
+    Version _original, _v32;
+};
+
+
+// The force and torque about cg of a surface, as Model applies them
+// without the SurfaceSet.
+static void calcForce(Surface* s, const float* v, float rho, const float* cg,
+                      float* force, float* torque)
+{
+    float pos[3], arm[3], t[3];
+    s->calcForce(v, rho, force, torque);
+    s->getPosition(pos);
+    Math::sub3(cg, pos, arm);
+    Math::cross3(force, arm, t);
+    Math::add3(t, torque, torque);
+}
+
+static void checkClose(const float* expected, const float* actual, float tolerance)
+{
+    for (int i=0; i<3; i++) {
+        if (std::fabs(expected[i] - actual[i]) > tolerance) {
+            std::ostringstream msg;
+            msg << "expected (" << expected[0] << ", " << expected[1] << ", " << expected[2]
+                << "), got (" << actual[0] << ", " << actual[1] << ", " << actual[2] << ")";
+            CPPUNIT_FAIL(msg.str());
+        }
+    }
+}
+
+// Compare a SurfaceSet of one surface with calcForce() for the wind v.
+static void checkSurface(Surface* s, const float* v, float rho, const float* cg)
+{
+    float expectedForce[3], expectedTorque[3];
+    calcForce(s, v, rho, cg, expectedForce, expectedTorque);
+    float alpha = s->getAlpha(), stallAlpha = s->getStallAlpha();
+
+    Vector surfaces;
+    surfaces.add(s);
+    SurfaceSet set;
+    set.load(surfaces);
+    set.setWind(0, v);
+    float force[3], torque[3];
+    set.calcForces(rho, cg, force, torque);
+
+    // rounding differences scale with the dynamic pressure, and the lever
+    // arm for the torque
+    float q = 0.5f*rho*Math::dot3(v, v)*s->getTotalForceCoefficient();
+    float tolerance = 1e-5f*q*(1 + s->getLiftCoefficient());
+    checkClose(expectedForce, force, tolerance);
+    checkClose(expectedTorque, torque, tolerance*20);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(alpha, s->getAlpha(), 1e-5);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(stallAlpha, s->getStallAlpha(), 1e-6);
+}
+
+
+// Set up function for each test.
+void YASimSurfaceSetTests::setUp()
+{
+    fgtest::initTestGlobals("yasim-surfaceset");
+    Surface::resetIDgen();
+}
+
+
+// Clean up after each test.
+void YASimSurfaceSetTests::tearDown()
+{
+    fgtest::shutdownTestGlobals();
+}
+
+
+void YASimSurfaceSetTests::testForces()
+{
+    SurfaceGenerator generator;
+    const float cg[3] = {0.5f, 0, -0.2f};
+    const float rho = 1.225f;
+
+    for (int t=0; t<50; t++) {
+        std::vector<Surface*> surfaces;
+        Vector all;
+        for (int i=0; i<10; i++) {
+            surfaces.push_back(generator.surface());
+            all.add(surfaces.back());
+        }
+
+        // each surface on its own
+        std::vector<float> winds;
+        for (int w=0; w<20; w++) {
+            for (Surface* s : surfaces) {
+                float v[3];
+                generator.wind(v);
+                checkSurface(s, v, rho, cg);
+                winds.insert(winds.end(), v, v+3);
+            }
+        }
+
+        // and the sum over all surfaces
+        SurfaceSet set;
+        set.load(all);
+        for (int w=0; w<20; w++) {
+            float expectedForce[3] = {0, 0, 0}, expectedTorque[3] = {0, 0, 0};
+            float scale = 0;
+            for (size_t i=0; i<surfaces.size(); i++) {
+                const float* v = &winds[3*(w*surfaces.size() + i)];
+                float force[3], torque[3];
+                calcForce(surfaces[i], v, rho, cg, force, torque);
+                Math::add3(force, expectedForce, expectedForce);
+                Math::add3(torque, expectedTorque, expectedTorque);
+                set.setWind(i, v);
+                scale += 0.5f*rho*Math::dot3(v, v)*surfaces[i]->getTotalForceCoefficient()
+                         *(1 + surfaces[i]->getLiftCoefficient());
+            }
+            float force[3], torque[3];
+            set.calcForces(rho, cg, force, torque);
+            checkClose(expectedForce, force, 1e-5f*scale);
+            checkClose(expectedTorque, torque, 2e-4f*scale);
+        }
+
+        for (Surface* s : surfaces)
+            delete s;
+    }
+}
+
+
+void YASimSurfaceSetTests::testSpecialWinds()
+{
+    SurfaceGenerator generator;
+    const float cg[3] = {0, 0, 0};
+    const float rho = 0.9f;
+
+    for (int t=0; t<50; t++) {
+        // unrotated, so that the winds below are exact in surface coordinates
+        Surface* s = generator.surface(true);
+
+        const float winds[][3] = {
+            {0, 0, 0},         // no force at all
+            {0, 0, -40},       // along the normal, stallFunc() returns early
+            {0, 0, 40},
+            {-50, 0, 0},       // straight on
+            {50, 0, 0},        // reversed flow
+            {30, 0, -20},      // reversed flow, both signs of z
+            {30, 0, 20},
+            {20, 5, -0.5f},
+            {-60, -10, 3},
+        };
+        for (const float* v : winds)
+            checkSurface(s, v, rho, cg);
+
+        // alpha swept through the stall, with and without flaps, slats
+        // and spoilers
+        for (float a=-1.6f; a<1.6f; a+=0.02f) {
+            float v[3] = {-40*Math::cos(a), 0, 40*Math::sin(a)};
+            checkSurface(s, v, rho, cg);
+            v[0] = -v[0];
+            checkSurface(s, v, rho, cg);
+        }
+        delete s;
+    }
+}
+
+
+void YASimSurfaceSetTests::testCalcWind()
+{
+    SurfaceGenerator generator;
+    Vector all;
+    std::vector<Surface*> surfaces;
+    for (int i=0; i<17; i++) {
+        surfaces.push_back(generator.surface());
+        all.add(surfaces.back());
+    }
+
+    SurfaceSet set;
+    set.load(all);
+    const float rho = 1.1f;
+    for (int t=0; t<100; t++) {
+        float wind[3], rot[3], v[3], cg[3];
+        generator.wind(wind);
+        generator.wind(v);
+        for (int i=0; i<3; i++) {
+            rot[i] = generator.uniform(-1, 1);
+            cg[i] = generator.uniform(-1, 1);
+        }
+        set.calcWind(wind, rot, v, cg);
+        float force[3], torque[3];
+        set.calcForces(rho, cg, force, torque);
+
+        // Model::localWind() without turbulence: wind - v - rot cross (pos - cg)
+        float expectedForce[3] = {0, 0, 0}, expectedTorque[3] = {0, 0, 0};
+        float scale = 0;
+        for (Surface* s : surfaces) {
+            float pos[3], arm[3], vs[3], tmp[3];
+            s->getPosition(pos);
+            Math::sub3(pos, cg, arm);
+            Math::cross3(rot, arm, tmp);
+            Math::sub3(wind, v, vs);
+            Math::sub3(vs, tmp, vs);
+
+            float f[3], tq[3];
+            calcForce(s, vs, rho, cg, f, tq);
+            Math::add3(f, expectedForce, expectedForce);
+            Math::add3(tq, expectedTorque, expectedTorque);
+            scale += 0.5f*rho*Math::dot3(vs, vs)*s->getTotalForceCoefficient()
+                     *(1 + s->getLiftCoefficient());
+        }
+        checkClose(expectedForce, force, 1e-5f*scale);
+        checkClose(expectedTorque, torque, 2e-4f*scale);
+    }
+
+    for (Surface* s : surfaces)
+        delete s;
+}
@@ -18,7 +18,9 @@
  */
 
 #include "test_flightplan.hxx"
+#include "test_navdatfiles.hxx"
 
 
 // Set up the unit tests.
 CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(FlightplanTests, "Unit tests");
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(NavDatFilesTests, "Unit tests");
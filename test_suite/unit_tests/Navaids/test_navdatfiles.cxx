@@ -0,0 +1,240 @@
+#include "test_navdatfiles.hxx"
+
+#include "test_suite/helpers/globals.hxx"
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <tuple>
+
+#include <simgear/constants.h>
+#include <simgear/math/SGGeod.hxx>
+#include <simgear/math/SGVec3.hxx>
+#include <simgear/structure/exception.hxx>
+
+#include <Navaids/NavDataCache.hxx>
+#include <Navaids/fixlist.hxx>
+#include <Navaids/navdb.hxx>
+#include <Navaids/positioned.hxx>
+
+using namespace flightgear;
+
+
+// The duplicate detection radius of the fix and navaid loaders.
+static const double DuplicateRadiusNm = 15.0;
+
+static double distanceNm(const SGGeod& a, const SGGeod& b)
+{
+    return dist(SGVec3d::fromGeod(a), SGVec3d::fromGeod(b)) * SG_METER_TO_NM;
+}
+
+static void writeFile(const SGPath& path, const std::string& contents)
+{
+    std::ofstream output(path.local8BitStr(), std::ios::out | std::ios::trunc);
+    output << contents;
+}
+
+// Whether the cache holds a positioned of this type and ident near 'pos',
+// i.e. the one read from the file or the one it duplicates.
+static bool inCache(FGPositioned::Type type, const std::string& ident, const SGGeod& pos)
+{
+    FGPositioned::TypeFilter filter(type);
+    FGPositionedRef ref = FGPositioned::findClosestWithIdent(ident, pos, &filter);
+    return ref.valid() && distanceNm(pos, ref->geod()) <= DuplicateRadiusNm;
+}
+
+
+// Set up function for each test.
+void NavDatFilesTests::setUp()
+{
+    fgtest::initTestGlobals("navdatfiles");
+    _tempDir = simgear::Dir::tempDir("fgtest-navdatfiles");
+}
+
+
+// Clean up after each test.
+void NavDatFilesTests::tearDown()
+{
+    _tempDir.remove(true);
+    fgtest::shutdownTestGlobals();
+}
+
+
+void NavDatFilesTests::testReadFixes()
+{
+    SGPath path = _tempDir.file("fix.dat");
+    writeFile(path,
+              "I\n"
+              "1101 Version - test data\n"
+              "  50.000000   -1.000000 AAAAA\n"
+              "\n"
+              "  51.500000    2.250000 BBBBB ENRT EG 2\n"
+              "  -0.500000  179.500000 CCCCC ENRT EG\n"
+              "  52.000000\n"
+              "  north         2.000000 DDDDD\n"
+              "  53.000000    3.000000 EEEEE extra\n"
+              "XX\n"
+              "  54.000000    4.000000 FFFFF\n"
+              "99\n"
+              "  55.000000    5.000000 GGGGG\n");
+
+    FixesLoader::FixesFile file;
+    FixesLoader::readFixes(path, file);
+    CPPUNIT_ASSERT(file.path == path);
+    CPPUNIT_ASSERT_EQUAL(path.sizeInBytes(), file.sizeInBytes);
+
+    // malformed lines are skipped, nothing is read after the end of data
+    const char* idents[] = {"AAAAA", "BBBBB", "CCCCC", "EEEEE", "FFFFF"};
+    const unsigned int lineNumbers[] = {3, 5, 6, 9, 11};
+    const double lats[] = {50.0, 51.5, -0.5, 53.0, 54.0};
+    const double lons[] = {-1.0, 2.25, 179.5, 3.0, 4.0};
+    CPPUNIT_ASSERT_EQUAL(size_t(5), file.fixes.size());
+    for (size_t i=0; i<file.fixes.size(); ++i) {
+        CPPUNIT_ASSERT_EQUAL(std::string(idents[i]), file.fixes[i].ident);
+        CPPUNIT_ASSERT_EQUAL(lineNumbers[i], file.fixes[i].lineNumber);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(lats[i], file.fixes[i].pos.getLatitudeDeg(), 1e-9);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(lons[i], file.fixes[i].pos.getLongitudeDeg(), 1e-9);
+    }
+
+    // reading again replaces the fixes
+    FixesLoader::readFixes(path, file);
+    CPPUNIT_ASSERT_EQUAL(size_t(5), file.fixes.size());
+
+    CPPUNIT_ASSERT_THROW(FixesLoader::readFixes(_tempDir.file("missing.dat"), file),
+                         sg_io_exception);
+}
+
+
+void NavDatFilesTests::testReadNav()
+{
+    SGPath path810 = _tempDir.file("nav810.dat");
+    writeFile(path810,
+              "I\n"
+              "810 Version - test data\n"
+              "2  50.000000  -1.000000    100   350  50    0.0 AA  ALPHA   NDB\n"
+              "3  51.000000   2.000000    200 11390 130   -2.0 BB  BRAVO VOR-DME\n"
+              "12 51.000000   2.000000    200 11390 130    0.0 BB  BRAVO VOR-DME\n"
+              "3  52.000000   3.000000\n"
+              "3  north       3.000000    200 11390 130   -2.0 CC  CHARLIE VOR\n"
+              "14 53.000000   4.000000    200 11390 130   -2.0 DD  DELTA\n"
+              "99\n");
+
+    NavLoader::NavFile file;
+    NavLoader::readNav(path810, file);
+    CPPUNIT_ASSERT(file.path == path810);
+    CPPUNIT_ASSERT_EQUAL(path810.sizeInBytes(), file.sizeInBytes);
+    CPPUNIT_ASSERT_EQUAL(size_t(3), file.lines.size());
+
+    const NavLoader::NavLine& ndb = file.lines[0];
+    CPPUNIT_ASSERT_EQUAL(3u, ndb.lineNum);
+    CPPUNIT_ASSERT_EQUAL(FGPositioned::NDB, ndb.type);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(50.0, ndb.pos.getLatitudeDeg(), 1e-9);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(-1.0, ndb.pos.getLongitudeDeg(), 1e-9);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(100.0, ndb.pos.getElevationFt(), 1e-9);
+    CPPUNIT_ASSERT_EQUAL(100, ndb.elev_ft);
+    CPPUNIT_ASSERT_EQUAL(35000, ndb.freq);  // ADF frequencies are scaled
+    CPPUNIT_ASSERT_EQUAL(50, ndb.range);
+    CPPUNIT_ASSERT_EQUAL(std::string("AA"), ndb.ident);
+    CPPUNIT_ASSERT_EQUAL(std::string("ALPHA NDB"), ndb.name);
+
+    const NavLoader::NavLine& vor = file.lines[1];
+    CPPUNIT_ASSERT_EQUAL(4u, vor.lineNum);
+    CPPUNIT_ASSERT_EQUAL(FGPositioned::VOR, vor.type);
+    CPPUNIT_ASSERT_EQUAL(11390, vor.freq);
+    CPPUNIT_ASSERT_EQUAL(-2.0, vor.multiuse);
+    CPPUNIT_ASSERT_EQUAL(std::string("BRAVO VOR-DME"), vor.name);
+    CPPUNIT_ASSERT_EQUAL(FGPositioned::DME, file.lines[2].type);
+    CPPUNIT_ASSERT_EQUAL(5u, file.lines[2].lineNum);
+
+    // the 1100 format names match the 810 ones
+    SGPath path1100 = _tempDir.file("nav1100.dat");
+    writeFile(path1100,
+              "I\n"
+              "1100 Version - test data\n"
+              "3  51.000000   2.000000    200 11390 130   -2.0 BB  ENRT EG BRAVO VOR-DME\n"
+              "4  52.000000   3.000000    300 10950  18  270.0 IXX EGXX EG 27 ILS-cat-I\n");
+    NavLoader::readNav(path1100, file);
+    CPPUNIT_ASSERT(file.path == path1100);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), file.lines.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("BRAVO VOR-DME"), file.lines[0].name);
+    CPPUNIT_ASSERT_EQUAL(FGPositioned::ILS, file.lines[1].type);
+    CPPUNIT_ASSERT_EQUAL(std::string("IXX"), file.lines[1].ident);
+    CPPUNIT_ASSERT_EQUAL(std::string("EGXX 27 ILS-cat-I"), file.lines[1].name);
+
+    SGPath noVersion = _tempDir.file("noversion.dat");
+    writeFile(noVersion, "I\nVersion - test data\n");
+    CPPUNIT_ASSERT_THROW(NavLoader::readNav(noVersion, file), sg_format_exception);
+    CPPUNIT_ASSERT_THROW(NavLoader::readNav(_tempDir.file("missing.dat"), file),
+                         sg_io_exception);
+}
+
+
+// The cache rebuild reads the files on another thread and inserts them
+// later. Each fix read from the same files must have ended up in the cache,
+// or be a duplicate of one which did.
+void NavDatFilesTests::testFixesInserted()
+{
+    NavDataCache* cache = NavDataCache::instance();
+    const PathList& paths = cache->getDatFilesInfo(NavDataCache::DATFILETYPE_FIX).paths;
+    CPPUNIT_ASSERT(!paths.empty());
+
+    size_t count = 0;
+    for (const SGPath& path : paths) {
+        FixesLoader::FixesFile file;
+        FixesLoader::readFixes(path, file);
+        for (const FixesLoader::Fix& fix : file.fixes) {
+            if (!inCache(FGPositioned::FIX, fix.ident, fix.pos)) {
+                CPPUNIT_FAIL(path.utf8Str() + ":" + std::to_string(fix.lineNumber) +
+                             ": fix " + fix.ident + " is not in the cache");
+            }
+        }
+        count += file.fixes.size();
+    }
+    CPPUNIT_ASSERT(count > 0);
+}
+
+
+// As above, for the navaids. Navaids near an earlier one with the same
+// type, ident and name are skipped without looking at the cache, and those
+// of a runway only load when the runway exists.
+void NavDatFilesTests::testNavaidsInserted()
+{
+    NavDataCache* cache = NavDataCache::instance();
+    const PathList& paths = cache->getDatFilesInfo(NavDataCache::DATFILETYPE_NAV).paths;
+    CPPUNIT_ASSERT(!paths.empty());
+
+    std::multimap<std::tuple<FGPositioned::Type, std::string, std::string>, SGGeod> loaded;
+    size_t checked = 0;
+    for (const SGPath& path : paths) {
+        NavLoader::NavFile file;
+        NavLoader::readNav(path, file);
+        for (const NavLoader::NavLine& nav : file.lines) {
+            // markers have no ident to look them up with
+            if ((nav.type >= FGPositioned::OM) && (nav.type <= FGPositioned::IM))
+                continue;
+
+            auto key = std::make_tuple(nav.type, nav.ident, nav.name);
+            auto range = loaded.equal_range(key);
+            bool duplicate = false;
+            for (auto it = range.first; it != range.second && !duplicate; ++it)
+                duplicate = distanceNm(nav.pos, it->second) <= DuplicateRadiusNm;
+            if (duplicate)
+                continue;
+            loaded.emplace(key, nav.pos);
+
+            if ((nav.type >= FGPositioned::ILS) && (nav.type <= FGPositioned::GS)) {
+                AirportRunwayPair arp = cache->findAirportRunway(nav.name);
+                if (!arp.first || !arp.second)
+                    continue;
+            }
+
+            if (!inCache(nav.type, nav.ident, nav.pos)) {
+                CPPUNIT_FAIL(path.utf8Str() + ":" + std::to_string(nav.lineNum) +
+                             ": navaid " + nav.ident + " (" + nav.name +
+                             ") is not in the cache");
+            }
+            ++checked;
+        }
+    }
+    CPPUNIT_ASSERT(checked > 0);
+}
@@ -0,0 +1,109 @@
+#include "test_jsonprops.hxx"
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <string>
+
+#include <3rdparty/cjson/cJSON.h>
+#include <Network/http/jsonprops.hxx>
+
+using flightgear::http::JSON;
+
+
+// What the http server sent before the writer, printed by cJSON.
+static std::string printJson(bool indent, SGPropertyNode* n, int depth, double timestamp)
+{
+    cJSON* json = JSON::toJson(n, depth, timestamp);
+    char* text = indent ? cJSON_Print(json) : cJSON_PrintUnformatted(json);
+    std::string result(text);
+    free(text);
+    cJSON_Delete(json);
+    return result;
+}
+
+
+void JsonPropsTests::setUp()
+{
+    _root = new SGPropertyNode;
+
+    // numbers cJSON prints as integers, with %f, or with %e
+    const double numbers[] = {0.0, -0.0, 1.0, -1.0, 2147483647.0, 2147483648.0,
+                              -2147483649.0, 1e20, 1e61, -1e61, 3.5, 0.1, 1e-7,
+                              -1e-7, 1234567890.5, 999999999.5, 1e-300,
+                              HUGE_VAL, -HUGE_VAL, 123456.789012, 0.000001,
+                              4.9e-324, std::numeric_limits<double>::quiet_NaN()};
+    for (unsigned int i=0; i<sizeof(numbers)/sizeof(numbers[0]); ++i)
+        _root->getNode("values/number", i, true)->setDoubleValue(numbers[i]);
+    _root->setFloatValue("values/float", 0.1f);
+    _root->setIntValue("values/int", -17);
+    _root->setLongValue("values/long", 99);
+    _root->setBoolValue("values/true", true);
+    _root->setBoolValue("values/false", false);
+
+    // escapes, control characters and UTF-8
+    _root->setStringValue("strings/escaped", "q\"b\\s/\b\f\n\r\t\x01\x1f\xc3\xa9 end");
+    _root->setStringValue("strings/empty", "");
+    _root->getNode("strings/none", true);
+
+    _root->setStringValue("nested/a/b/c/d", "deep");
+    _root->setIntValue("nested/a[1]/b", 1);
+    _root->setIntValue("nested/a[3]", 3);
+}
+
+
+void JsonPropsTests::tearDown()
+{
+    _root.clear();
+}
+
+
+void JsonPropsTests::testWriteJson()
+{
+    const char* paths[] = {"/", "values", "strings", "strings/escaped", "nested"};
+    const double timestamps[] = {-1.0, 0.0, 17.25, 1e12};
+
+    for (int indent=0; indent<2; ++indent) {
+        for (int depth=0; depth<6; ++depth) {
+            for (double ts : timestamps) {
+                for (const char* path : paths) {
+                    SGPropertyNode* n = _root->getNode(path);
+                    std::string expected = printJson(indent, n, depth, ts);
+                    CPPUNIT_ASSERT_EQUAL(expected, JSON::toJsonString(indent, n, depth, ts));
+                }
+            }
+        }
+    }
+
+    // writeJson() appends
+    std::string out("prefix");
+    JSON::writeJson(out, false, _root->getNode("values"), 1);
+    CPPUNIT_ASSERT_EQUAL("prefix" + printJson(false, _root->getNode("values"), 1, -1.0), out);
+}
+
+
+void JsonPropsTests::testSnapshot()
+{
+    const char* paths[] = {"/", "values", "strings/escaped", "nested"};
+
+    for (int indent=0; indent<2; ++indent) {
+        for (int depth=0; depth<6; ++depth) {
+            for (const char* path : paths) {
+                SGPropertyNode* n = _root->getNode(path);
+                JSON::Snapshot snapshot;
+                JSON::takeSnapshot(n, depth, snapshot);
+                std::string expected = printJson(indent, n, depth, 12.5);
+                CPPUNIT_ASSERT_EQUAL(expected, JSON::toJsonString(indent, snapshot, 12.5));
+            }
+        }
+    }
+
+    // the snapshot doesn't change with the tree
+    JSON::Snapshot snapshot;
+    JSON::takeSnapshot(_root->getNode("nested"), 3, snapshot);
+    std::string expected = printJson(true, _root->getNode("nested"), 3, -1.0);
+    _root->setStringValue("nested/a/b/c/d", "changed");
+    _root->setIntValue("nested/a[2]", 2);
+    CPPUNIT_ASSERT_EQUAL(expected, JSON::toJsonString(true, snapshot));
+    CPPUNIT_ASSERT(expected != printJson(true, _root->getNode("nested"), 3, -1.0));
+}
@@ -0,0 +1,538 @@
+#include "test_mirrorpropertytree.hxx"
+
+#include "test_suite/helpers/globals.hxx"
+
+#include <cstring>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include <simgear/props/props.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <Main/fg_props.hxx>
+#include <Network/http/MirrorPropertyTreeWebsocket.hxx>
+
+using namespace flightgear::http;
+
+
+// Reads the integers of a binary mirror frame, failing the test at the end
+// of the data.
+class FrameReader
+{
+public:
+    FrameReader(const std::string& data, size_t pos = 0) :
+        _data(data),
+        _pos(pos)
+    {
+    }
+
+    uint8_t byte()
+    {
+        CPPUNIT_ASSERT(_pos < _data.size());
+        return static_cast<uint8_t>(_data[_pos++]);
+    }
+
+    uint64_t varint()
+    {
+        uint64_t v = 0;
+        for (int shift = 0; ; shift += 7) {
+            CPPUNIT_ASSERT(shift < 64);
+            uint8_t b = byte();
+            v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) {
+                return v;
+            }
+        }
+    }
+
+    std::string bytes(size_t len)
+    {
+        CPPUNIT_ASSERT(len <= _data.size() - _pos);
+        _pos += len;
+        return _data.substr(_pos - len, len);
+    }
+
+    std::string rest() const { return _data.substr(_pos); }
+    bool atEnd() const { return _pos == _data.size(); }
+
+private:
+    const std::string& _data;
+    size_t _pos;
+};
+
+
+// A client of the binary frame format, written from the description in
+// MirrorPropertyTreeWebsocket.cxx rather than from the encoder.
+class MirrorDecoder
+{
+public:
+    struct Node
+    {
+        std::string path;
+        int index = 0;
+        uint8_t code = 0;
+        uint64_t bits = 0;       // bool, integer, float and double values
+        std::string string;      // string and unspecified values
+    };
+
+    // The ids each frame listed, in frame order.
+    struct Batch
+    {
+        bool deflated = false;
+        std::vector<unsigned int> created, removed, changed;
+    };
+
+    Batch decode(const std::string& data)
+    {
+        Batch batch;
+        FrameReader frame(data);
+        uint8_t flags = frame.byte();
+        CPPUNIT_ASSERT_EQUAL(0, flags & ~1);
+
+        std::string payload;
+        batch.deflated = flags & 1;
+        if (batch.deflated) {
+            uLongf len = frame.varint();
+            std::string compressed = frame.rest();
+            payload.resize(len);
+            CPPUNIT_ASSERT_EQUAL(Z_OK, uncompress(reinterpret_cast<Bytef*>(&payload[0]), &len,
+                                                  reinterpret_cast<const Bytef*>(compressed.data()),
+                                                  compressed.size()));
+            CPPUNIT_ASSERT_EQUAL(payload.size(), static_cast<size_t>(len));
+        } else {
+            payload = frame.rest();
+        }
+
+        FrameReader in(payload);
+        uint64_t count = in.varint();
+        for (uint64_t i = 0; i < count; ++i) {
+            unsigned int id = in.varint();
+            // ids are never reused, a created id is new to the client
+            CPPUNIT_ASSERT(nodes.find(id) == nodes.end());
+            Node& node = nodes[id];
+            node.index = in.varint();
+            in.varint();  // position
+            node.path = in.bytes(in.varint());
+            decodeValue(in, node);
+            batch.created.push_back(id);
+        }
+
+        unsigned int id = 0;
+        count = in.varint();
+        for (uint64_t i = 0; i < count; ++i) {
+            uint64_t delta = in.varint();
+            CPPUNIT_ASSERT(delta > 0);
+            id += delta;
+            CPPUNIT_ASSERT_EQUAL(size_t(1), nodes.erase(id));
+            batch.removed.push_back(id);
+        }
+
+        id = 0;
+        count = in.varint();
+        for (uint64_t i = 0; i < count; ++i) {
+            uint64_t delta = in.varint();
+            CPPUNIT_ASSERT(delta > 0);
+            id += delta;
+            auto it = nodes.find(id);
+            CPPUNIT_ASSERT(it != nodes.end());
+            decodeValue(in, it->second);
+            batch.changed.push_back(id);
+        }
+
+        CPPUNIT_ASSERT(in.atEnd());
+        return batch;
+    }
+
+    unsigned int idOf(const std::string& path) const
+    {
+        for (auto& n : nodes) {
+            if (n.second.path == path) {
+                return n.first;
+            }
+        }
+        return 0;
+    }
+
+    std::map<unsigned int, Node> nodes;
+
+private:
+    // The value is relative to the last one of the node if it had the
+    // same type code. A new node starts out without one.
+    static void decodeValue(FrameReader& in, Node& node)
+    {
+        uint8_t type = in.byte();
+        uint8_t code = type & 0x0f;
+        uint64_t base = (node.code == code) ? node.bits : 0;
+        node.string.clear();
+        switch (code) {
+        case 0:
+            node.bits = 0;
+            break;
+
+        case 1:
+            node.bits = in.byte();
+            CPPUNIT_ASSERT(node.bits <= 1);
+            break;
+
+        case 2:
+        case 3: {
+            uint64_t z = in.varint();
+            node.bits = base + ((z >> 1) ^ (0 - (z & 1)));
+            break;
+        }
+
+        case 4:
+        case 5: {
+            unsigned int k = type >> 4;
+            CPPUNIT_ASSERT(k <= (code == 4 ? 4u : 8u));
+            uint64_t x = 0;
+            for (unsigned int i = 0; i < k; ++i) {
+                x |= static_cast<uint64_t>(in.byte()) << (8 * i);
+            }
+            node.bits = base ^ x;
+            break;
+        }
+
+        case 6:
+        case 7:
+            node.bits = 0;
+            node.string = in.bytes(in.varint());
+            break;
+
+        default:
+            CPPUNIT_FAIL("unknown type code " + std::to_string(code));
+        }
+        node.code = code;
+    }
+};
+
+
+class FrameWriter : public WebsocketWriter
+{
+public:
+    virtual int writeToWebsocket(int opcode, const char* data, size_t len) override
+    {
+        frames.push_back(std::make_pair(opcode, std::string(data, len)));
+        return 0;
+    }
+
+    std::vector<std::pair<int, std::string> > frames;
+};
+
+
+// Wait out the minimum send interval, then decode the frame sent.
+static MirrorDecoder::Batch pollFrame(MirrorPropertyTreeWebsocket& ws, MirrorDecoder& decoder)
+{
+    FrameWriter writer;
+    SGTimeStamp::sleepForMSec(110);
+    ws.poll(writer);
+    CPPUNIT_ASSERT_EQUAL(size_t(1), writer.frames.size());
+    CPPUNIT_ASSERT_EQUAL(2, writer.frames[0].first);  // binary
+    return decoder.decode(writer.frames[0].second);
+}
+
+static uint8_t typeCode(SGPropertyNode* node)
+{
+    switch (node->getType()) {
+    case simgear::props::NONE:        return 0;
+    case simgear::props::BOOL:        return 1;
+    case simgear::props::INT:         return 2;
+    case simgear::props::LONG:        return 3;
+    case simgear::props::FLOAT:       return 4;
+    case simgear::props::DOUBLE:      return 5;
+    case simgear::props::UNSPECIFIED: return 7;
+    default:                          return 6;
+    }
+}
+
+static void checkNode(const std::map<std::string, const MirrorDecoder::Node*>& mirror,
+                      SGPropertyNode* node, size_t& count)
+{
+    std::string path = node->getPath(true);
+    auto it = mirror.find(path);
+    if (it == mirror.end()) {
+        CPPUNIT_FAIL(path + " is not mirrored");
+    }
+
+    // compare bit patterns, so NaN and -0.0 must come out unchanged
+    const MirrorDecoder::Node& m = *it->second;
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(path, node->getIndex(), m.index);
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(path, static_cast<int>(typeCode(node)), static_cast<int>(m.code));
+    switch (m.code) {
+    case 1:
+        CPPUNIT_ASSERT_EQUAL_MESSAGE(path, uint64_t(node->getBoolValue()), m.bits);
+        break;
+
+    case 2:
+        CPPUNIT_ASSERT_EQUAL_MESSAGE(path, int64_t(node->getIntValue()), int64_t(m.bits));
+        break;
+
+    case 3:
+        CPPUNIT_ASSERT_EQUAL_MESSAGE(path, int64_t(node->getLongValue()), int64_t(m.bits));
+        break;
+
+    case 4: {
+        float f = node->getFloatValue();
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        CPPUNIT_ASSERT_EQUAL_MESSAGE(path, uint64_t(bits), m.bits);
+        break;
+    }
+
+    case 5: {
+        double d = node->getDoubleValue();
+        uint64_t bits;
+        memcpy(&bits, &d, sizeof(bits));
+        CPPUNIT_ASSERT_EQUAL_MESSAGE(path, bits, m.bits);
+        break;
+    }
+
+    case 6:
+    case 7:
+        CPPUNIT_ASSERT_EQUAL_MESSAGE(path, std::string(node->getStringValue()), m.string);
+        break;
+    }
+
+    ++count;
+    for (int i = 0; i < node->nChildren(); ++i) {
+        checkNode(mirror, node->getChild(i), count);
+    }
+}
+
+// The client must hold exactly the nodes of the subtree, with their values.
+static void checkMirror(const MirrorDecoder& decoder, SGPropertyNode* root)
+{
+    std::map<std::string, const MirrorDecoder::Node*> mirror;
+    for (auto& n : decoder.nodes) {
+        CPPUNIT_ASSERT(mirror.insert(std::make_pair(n.second.path, &n.second)).second);
+    }
+
+    size_t count = 0;
+    checkNode(mirror, root, count);
+    CPPUNIT_ASSERT_EQUAL(decoder.nodes.size(), count);
+}
+
+
+// Set up function for each test.
+void MirrorPropertyTreeTests::setUp()
+{
+    fgtest::initTestGlobals("mirrorpropertytree");
+}
+
+
+// Clean up after each test.
+void MirrorPropertyTreeTests::tearDown()
+{
+    fgtest::shutdownTestGlobals();
+}
+
+
+void MirrorPropertyTreeTests::testValues()
+{
+    SGPropertyNode* root = fgGetNode("/mirror", true);
+    root->setIntValue("int", -5);
+    root->setLongValue("long", -(1L << 40));
+    root->setDoubleValue("nan", std::numeric_limits<double>::quiet_NaN());
+    root->setDoubleValue("zero", -0.0);
+    root->setFloatValue("float", -1.5f);
+    root->setBoolValue("bool", true);
+    root->setStringValue("string", "hello");
+    root->setUnspecifiedValue("unspecified", "1.5");
+    root->getNode("group/value[2]", true)->setDoubleValue(1e300);
+
+    MirrorPropertyTreeWebsocket ws("/mirror", MirrorPropertyTreeWebsocket::BinaryProtocol);
+    MirrorDecoder decoder;
+    MirrorDecoder::Batch batch = pollFrame(ws, decoder);
+    CPPUNIT_ASSERT(!batch.deflated);
+    CPPUNIT_ASSERT_EQUAL(size_t(11), batch.created.size());
+    CPPUNIT_ASSERT(batch.removed.empty());
+    CPPUNIT_ASSERT(batch.changed.empty());
+    checkMirror(decoder, root);
+
+    // nothing changed, nothing sent
+    FrameWriter writer;
+    SGTimeStamp::sleepForMSec(110);
+    ws.poll(writer);
+    CPPUNIT_ASSERT(writer.frames.empty());
+
+    // deltas which wrap around, and special floating point values
+    root->setIntValue("int", std::numeric_limits<int>::min());
+    root->setLongValue("long", std::numeric_limits<long>::max());
+    root->setDoubleValue("nan", -0.0);
+    root->setDoubleValue("zero", std::numeric_limits<double>::quiet_NaN());
+    root->setFloatValue("float", -std::numeric_limits<float>::infinity());
+    root->setBoolValue("bool", false);
+    root->setStringValue("string", "");
+    root->setDoubleValue("group/value[2]", -1e-300);
+    batch = pollFrame(ws, decoder);
+    CPPUNIT_ASSERT(batch.created.empty());
+    CPPUNIT_ASSERT(batch.removed.empty());
+    CPPUNIT_ASSERT_EQUAL(size_t(8), batch.changed.size());
+    checkMirror(decoder, root);
+
+    root->setIntValue("int", std::numeric_limits<int>::max());
+    root->setLongValue("long", std::numeric_limits<long>::min());
+    root->setDoubleValue("nan", 1.0);
+    root->setFloatValue("float", std::numeric_limits<float>::quiet_NaN());
+    root->setUnspecifiedValue("unspecified", "-2");
+    batch = pollFrame(ws, decoder);
+    CPPUNIT_ASSERT_EQUAL(size_t(5), batch.changed.size());
+    checkMirror(decoder, root);
+
+    ws.close();
+}
+
+
+// A node keeps its id when its type changes, the value must not be
+// decoded relative to one of the old type.
+void MirrorPropertyTreeTests::testTypeChanges()
+{
+    SGPropertyNode* root = fgGetNode("/mirror", true);
+    SGPropertyNode* a = root->getNode("a", true);
+    SGPropertyNode* b = root->getNode("b", true);
+    SGPropertyNode* c = root->getNode("c", true);
+    SGPropertyNode* d = root->getNode("d", true);
+    a->setIntValue(100);
+    b->setDoubleValue(2.5);
+    c->setStringValue("text");
+    d->setBoolValue(true);
+
+    MirrorPropertyTreeWebsocket ws("/mirror", MirrorPropertyTreeWebsocket::BinaryProtocol);
+    MirrorDecoder decoder;
+    pollFrame(ws, decoder);
+    checkMirror(decoder, root);
+    unsigned int ids[] = {decoder.idOf("/mirror/a"), decoder.idOf("/mirror/b"),
+                          decoder.idOf("/mirror/c"), decoder.idOf("/mirror/d")};
+
+    a->clearValue();
+    a->setDoubleValue(100.5);
+    b->clearValue();
+    b->setIntValue(-2);
+    c->clearValue();
+    c->setLongValue(-3);
+    d->clearValue();
+    d->setStringValue("true");
+    MirrorDecoder::Batch batch = pollFrame(ws, decoder);
+    CPPUNIT_ASSERT(batch.created.empty());
+    CPPUNIT_ASSERT(batch.removed.empty());
+    CPPUNIT_ASSERT_EQUAL(size_t(4), batch.changed.size());
+    checkMirror(decoder, root);
+
+    // and back, then relative to the new type
+    a->clearValue();
+    a->setIntValue(-100);
+    b->clearValue();
+    b->setDoubleValue(-2.5);
+    c->clearValue();
+    c->setIntValue(5);
+    d->clearValue();
+    d->setFloatValue(0.25f);
+    pollFrame(ws, decoder);
+    checkMirror(decoder, root);
+
+    a->setIntValue(7);
+    b->setDoubleValue(-0.0);
+    c->setIntValue(-1);
+    d->setFloatValue(-0.25f);
+    pollFrame(ws, decoder);
+    checkMirror(decoder, root);
+
+    CPPUNIT_ASSERT_EQUAL(ids[0], decoder.idOf("/mirror/a"));
+    CPPUNIT_ASSERT_EQUAL(ids[1], decoder.idOf("/mirror/b"));
+    CPPUNIT_ASSERT_EQUAL(ids[2], decoder.idOf("/mirror/c"));
+    CPPUNIT_ASSERT_EQUAL(ids[3], decoder.idOf("/mirror/d"));
+
+    ws.close();
+}
+
+
+void MirrorPropertyTreeTests::testRemoved()
+{
+    SGPropertyNode* root = fgGetNode("/mirror", true);
+    root->setDoubleValue("gone", 1.0);
+    root->setIntValue("kept", -10);
+    root->setDoubleValue("recycled", 1.25);
+
+    MirrorPropertyTreeWebsocket ws("/mirror", MirrorPropertyTreeWebsocket::BinaryProtocol);
+    MirrorDecoder decoder;
+    pollFrame(ws, decoder);
+    checkMirror(decoder, root);
+    unsigned int gone = decoder.idOf("/mirror/gone");
+    unsigned int recycled = decoder.idOf("/mirror/recycled");
+
+    // Removed and created again before the next frame, as Nasal does with
+    // canvas nodes: the node goes through recentlyRemoved and is sent as a
+    // change of the old id, relative to the value sent for it before.
+    root->removeChild("gone");
+    root->getNode("recycled")->clearValue();
+    root->removeChild("recycled");
+    root->getNode("recycled", true)->setDoubleValue(1.75);
+    root->setIntValue("kept", -11);
+    MirrorDecoder::Batch batch = pollFrame(ws, decoder);
+    CPPUNIT_ASSERT(batch.created.empty());
+    CPPUNIT_ASSERT_EQUAL(size_t(1), batch.removed.size());
+    CPPUNIT_ASSERT_EQUAL(gone, batch.removed[0]);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), batch.changed.size());
+    CPPUNIT_ASSERT_EQUAL(recycled, decoder.idOf("/mirror/recycled"));
+    checkMirror(decoder, root);
+
+    // once removed, a node of the same path is a new one
+    root->setDoubleValue("gone", 1.0);
+    batch = pollFrame(ws, decoder);
+    CPPUNIT_ASSERT_EQUAL(size_t(1), batch.created.size());
+    CPPUNIT_ASSERT(batch.created[0] > recycled);
+    checkMirror(decoder, root);
+
+    root->setDoubleValue("recycled", -1.75);
+    root->removeChild("kept");
+    batch = pollFrame(ws, decoder);
+    CPPUNIT_ASSERT_EQUAL(size_t(1), batch.removed.size());
+    CPPUNIT_ASSERT_EQUAL(size_t(1), batch.changed.size());
+    checkMirror(decoder, root);
+
+    ws.close();
+}
+
+
+void MirrorPropertyTreeTests::testDeflate()
+{
+    SGPropertyNode* root = fgGetNode("/mirror", true);
+    for (int i = 0; i < 64; ++i) {
+        root->getNode("item", i, true)->setStringValue("value number " + std::to_string(i));
+    }
+
+    MirrorPropertyTreeWebsocket ws("/mirror", MirrorPropertyTreeWebsocket::BinaryDeflateProtocol);
+    MirrorDecoder decoder;
+    MirrorDecoder::Batch batch = pollFrame(ws, decoder);
+    CPPUNIT_ASSERT(batch.deflated);
+    CPPUNIT_ASSERT_EQUAL(size_t(65), batch.created.size());
+    checkMirror(decoder, root);
+
+    // small frames are not worth compressing
+    root->getNode("item", 3)->setStringValue("changed");
+    batch = pollFrame(ws, decoder);
+    CPPUNIT_ASSERT(!batch.deflated);
+    checkMirror(decoder, root);
+
+    for (int i = 0; i < 64; ++i) {
+        root->getNode("item", i)->setStringValue("changed value " + std::to_string(i));
+    }
+    batch = pollFrame(ws, decoder);
+    CPPUNIT_ASSERT(batch.deflated);
+    CPPUNIT_ASSERT_EQUAL(size_t(64), batch.changed.size());
+    checkMirror(decoder, root);
+
+    // and never without being asked for
+    MirrorPropertyTreeWebsocket plain("/mirror", MirrorPropertyTreeWebsocket::BinaryProtocol);
+    MirrorDecoder plainDecoder;
+    batch = pollFrame(plain, plainDecoder);
+    CPPUNIT_ASSERT(!batch.deflated);
+    checkMirror(plainDecoder, root);
+
+    plain.close();
+    ws.close();
+}
@@ -0,0 +1,95 @@
+#include "test_propertychangeobserver.hxx"
+
+#include "test_suite/helpers/globals.hxx"
+
+#include <simgear/props/props.hxx>
+
+#include <Main/fg_props.hxx>
+#include <Network/http/PropertyChangeObserver.hxx>
+
+using namespace flightgear::http;
+
+
+// Set up function for each test.
+void PropertyChangeObserverTests::setUp()
+{
+    fgtest::initTestGlobals("propertychangeobserver");
+}
+
+
+// Clean up after each test.
+void PropertyChangeObserverTests::tearDown()
+{
+    fgtest::shutdownTestGlobals();
+}
+
+
+void PropertyChangeObserverTests::testListener()
+{
+    PropertyChangeObserver observer;
+    fgSetDouble("/test/plain", 1.0);
+    PropertyChangeObserverEntryRef entry = observer.addObservation("/test/plain");
+
+    // a new observation is reported once
+    unsigned serial = observer.getSerial();
+    observer.check();
+    CPPUNIT_ASSERT(observer.isChangedValue(entry, serial));
+    serial = observer.getSerial();
+    observer.check();
+    CPPUNIT_ASSERT(!observer.isChangedValue(entry, serial));
+
+    // setting the same value is no change
+    fgSetDouble("/test/plain", 1.0);
+    serial = observer.getSerial();
+    observer.check();
+    CPPUNIT_ASSERT(!observer.isChangedValue(entry, serial));
+
+    fgSetDouble("/test/plain", 2.0);
+    serial = observer.getSerial();
+    observer.check();
+    CPPUNIT_ASSERT(observer.isChangedValue(entry, serial));
+    CPPUNIT_ASSERT_EQUAL(std::string(fgGetString("/test/plain")), entry->_prevValue);
+}
+
+
+void PropertyChangeObserverTests::testTiedLater()
+{
+    // the tied variable must outlive the observer, which polls it
+    double value = 1.0;
+    PropertyChangeObserver observer;
+    SGPropertyNode_ptr node = fgGetNode("/test/tied", true);
+    node->setDoubleValue(1.0);
+    PropertyChangeObserverEntryRef entry = observer.addObservation("/test/tied");
+    observer.check();
+    CPPUNIT_ASSERT(!entry->_polled);
+
+    // tied after the first observation, as the FDM properties are
+    node->tie(SGRawValuePointer<double>(&value), false);
+    observer.check();
+    CPPUNIT_ASSERT(entry->_polled);
+
+    value = 3.0;
+    unsigned serial = observer.getSerial();
+    observer.check();
+    CPPUNIT_ASSERT(observer.isChangedValue(entry, serial));
+    CPPUNIT_ASSERT_EQUAL(std::string(node->getStringValue()), entry->_prevValue);
+
+    serial = observer.getSerial();
+    observer.check();
+    CPPUNIT_ASSERT(!observer.isChangedValue(entry, serial));
+
+    // back to the listener once untied, with the last value of the variable
+    value = 4.0;
+    node->untie();
+    serial = observer.getSerial();
+    observer.check();
+    CPPUNIT_ASSERT(!entry->_polled);
+    CPPUNIT_ASSERT(observer.isChangedValue(entry, serial));
+    CPPUNIT_ASSERT_EQUAL(std::string(node->getStringValue()), entry->_prevValue);
+
+    node->setDoubleValue(5.0);
+    serial = observer.getSerial();
+    observer.check();
+    CPPUNIT_ASSERT(observer.isChangedValue(entry, serial));
+    CPPUNIT_ASSERT_EQUAL(std::string(node->getStringValue()), entry->_prevValue);
+}
@@ -0,0 +1,211 @@
+#include "test_elevationservice.hxx"
+
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+#include <Scenery/elevationservice.hxx>
+#include <Scenery/terrain.hxx>
+
+
+// Analytic terrain without scenery north of 60 degrees. Counts the
+// intersections, which run on the worker threads.
+class TestTerrain : public FGTerrain
+{
+public:
+    TestTerrain() : queries(0) {}
+
+    static double elevation(const SGGeod& geod)
+    {
+        return 1000.0 + 100.0*sin(geod.getLatitudeRad()) + 50.0*cos(3.0*geod.getLongitudeRad());
+    }
+
+    virtual void init(osg::Group*) {}
+    virtual void reinit() {}
+    virtual void shutdown() {}
+    virtual void bind() {}
+    virtual void unbind() {}
+    virtual void update(double) {}
+
+    virtual bool get_elevation_m(const SGGeod& geod, double& alt,
+                                 const simgear::BVHMaterial** material,
+                                 const osg::Node* = 0)
+    {
+        ++queries;
+        if (material)
+            *material = 0;
+        if (geod.getLatitudeDeg() > 60.0 || geod.getElevationM() < elevation(geod))
+            return false;
+        alt = elevation(geod);
+        return true;
+    }
+
+    virtual bool get_cart_elevation_m(const SGVec3d&, double, double&,
+                                      const simgear::BVHMaterial**,
+                                      const osg::Node* = 0) { return false; }
+    virtual bool get_cart_ground_intersection(const SGVec3d&, const SGVec3d&,
+                                              SGVec3d&, const osg::Node* = 0) { return false; }
+    virtual bool scenery_available(const SGGeod&, double) { return true; }
+    virtual bool schedule_scenery(const SGGeod&, double, double = 0.0) { return true; }
+    virtual void materialLibChanged() {}
+
+    std::atomic<int> queries;
+};
+
+// A grid of points from 50N to 70N, starting the search at 5000m.
+static std::vector<SGGeod> makePoints(int count, double startM = 5000.0)
+{
+    std::vector<SGGeod> points;
+    for (int i=0; i<count; ++i)
+        points.push_back(SGGeod::fromDegM(-10.0 + 0.01*i, 50.0 + 20.0*i/count, startM));
+    return points;
+}
+
+static void checkResults(const FGElevationService::Request& request)
+{
+    const std::vector<SGGeod>& points = request.getPoints();
+    const FGElevationService::ResultList& results = request.getResults();
+    CPPUNIT_ASSERT_EQUAL(points.size(), results.size());
+    for (size_t i=0; i<points.size(); ++i) {
+        bool expected = points[i].getLatitudeDeg() <= 60.0;
+        CPPUNIT_ASSERT_EQUAL(expected, results[i].valid);
+        if (expected)
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(TestTerrain::elevation(points[i]), results[i].elevationM, 1e-9);
+    }
+}
+
+
+void ElevationServiceTests::testBatch()
+{
+    TestTerrain terrain;
+    FGElevationService service;
+    service.setNumThreads(2);
+    CPPUNIT_ASSERT_EQUAL(0.0, service.getQueryTimeSec());
+
+    FGElevationService::RequestRef small = service.query(makePoints(5));
+    FGElevationService::RequestRef large = service.query(makePoints(1000));
+    CPPUNIT_ASSERT(!small->isDone());
+    CPPUNIT_ASSERT(!large->isDone());
+
+    // nothing happens until the scenery processes the queue
+    CPPUNIT_ASSERT_EQUAL(0, terrain.queries.load());
+    service.process(&terrain);
+    CPPUNIT_ASSERT(small->isDone());
+    CPPUNIT_ASSERT(large->isDone());
+    checkResults(*small);
+    checkResults(*large);
+    CPPUNIT_ASSERT(service.getQueryTimeSec() > 0.0);
+
+    // an empty batch is answered as well
+    FGElevationService::RequestRef empty = service.query(std::vector<SGGeod>());
+    service.process(&terrain);
+    CPPUNIT_ASSERT(empty->isDone());
+    CPPUNIT_ASSERT(empty->getResults().empty());
+
+    service.shutdown();
+}
+
+
+void ElevationServiceTests::testCallback()
+{
+    TestTerrain terrain;
+    FGElevationService service;
+    service.setNumThreads(1);
+
+    int calls = 0;
+    FGElevationService::RequestRef next;
+    FGElevationService::RequestRef request = service.query(makePoints(100),
+        [&](const FGElevationService::Request& done) {
+            ++calls;
+            CPPUNIT_ASSERT(done.isDone());
+            checkResults(done);
+            // requests queued from a callback are answered next time
+            next = service.query(makePoints(10));
+        });
+
+    service.process(&terrain);
+    CPPUNIT_ASSERT_EQUAL(1, calls);
+    CPPUNIT_ASSERT(next.valid());
+    CPPUNIT_ASSERT(!next->isDone());
+
+    service.process(&terrain);
+    CPPUNIT_ASSERT_EQUAL(1, calls);
+    CPPUNIT_ASSERT(next->isDone());
+    checkResults(*next);
+
+    service.shutdown();
+}
+
+
+void ElevationServiceTests::testCache()
+{
+    TestTerrain terrain;
+    FGElevationService service;
+    service.setNumThreads(1);
+
+    FGElevationService::RequestRef request = service.query(makePoints(200));
+    service.process(&terrain);
+    CPPUNIT_ASSERT_EQUAL(200, terrain.queries.load());
+
+    // hits are reused for any start between the hit and the cached start,
+    // misses are not cached
+    request = service.query(makePoints(200, 2000.0));
+    service.process(&terrain);
+    checkResults(*request);
+    int misses = 0;
+    for (const FGElevationService::Result& result : request->getResults())
+        misses += result.valid ? 0 : 1;
+    CPPUNIT_ASSERT_EQUAL(200 + misses, terrain.queries.load());
+
+    // a start above the cached one needs a new intersection
+    terrain.queries = 0;
+    request = service.query(makePoints(200, 6000.0));
+    service.process(&terrain);
+    checkResults(*request);
+    CPPUNIT_ASSERT_EQUAL(200, terrain.queries.load());
+
+    // a start below the terrain finds nothing
+    terrain.queries = 0;
+    request = service.query(makePoints(200, 0.0));
+    service.process(&terrain);
+    CPPUNIT_ASSERT_EQUAL(200, terrain.queries.load());
+    for (const FGElevationService::Result& result : request->getResults())
+        CPPUNIT_ASSERT(!result.valid);
+
+    // without a cache, each point is intersected
+    service.setCacheSize(0);
+    terrain.queries = 0;
+    request = service.query(makePoints(200));
+    service.process(&terrain);
+    checkResults(*request);
+    CPPUNIT_ASSERT_EQUAL(200, terrain.queries.load());
+
+    service.shutdown();
+}
+
+
+void ElevationServiceTests::testThreads()
+{
+    // the results don't depend on the number of worker threads
+    for (int threads=1; threads<=4; ++threads) {
+        TestTerrain terrain;
+        FGElevationService service;
+        service.setNumThreads(threads);
+        service.setCacheSize(0);
+
+        std::vector<FGElevationService::RequestRef> requests;
+        for (int i=1; i<=10; ++i)
+            requests.push_back(service.query(makePoints(37*i)));
+        service.process(&terrain);
+
+        int points = 0;
+        for (const FGElevationService::RequestRef& request : requests) {
+            CPPUNIT_ASSERT(request->isDone());
+            checkResults(*request);
+            points += request->getPoints().size();
+        }
+        CPPUNIT_ASSERT_EQUAL(points, terrain.queries.load());
+
+        service.shutdown();
+    }
+}